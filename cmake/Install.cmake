@@ -85,7 +85,7 @@ function(kickcat_install_package os_libraries)
   set(pc_cflags_extra "")
 
   set(pc_skip_libs "")
-  if(ENABLE_AF_XDP AND LINUX)
+  if(ENABLE_AF_XDP)
     list(APPEND pc_skip_libs ${LIBXDP_LIBRARIES} ${LIBBPF_LIBRARIES})
   endif()
 
@@ -103,7 +103,7 @@ function(kickcat_install_package os_libraries)
     endif()
   endforeach()
 
-  if(ENABLE_AF_XDP AND LINUX)
+  if(ENABLE_AF_XDP)
     list(APPEND pc_requires_private "libxdp" "libbpf")
     list(APPEND pc_cflags_extra "-DKICKCAT_AF_XDP_ENABLED")
   endif()
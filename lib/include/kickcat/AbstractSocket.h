@@ -1,6 +1,7 @@
 #ifndef KICKCAT_ABSTRACT_SOCKET_H
 #define KICKCAT_ABSTRACT_SOCKET_H
 
+#include <cerrno>
 #include <string>
 #include <chrono>
 #include <vector>
@@ -9,6 +10,13 @@ namespace kickcat
 {
     using namespace std::chrono;
 
+    /// \brief One frame of a batched socket operation (see AbstractSocket::readBatch() / writeBatch())
+    struct SocketBuffer
+    {
+        void*   data{nullptr};
+        int32_t size{0};    // write: bytes to write - read: buffer capacity on call, bytes read on return
+    };
+
     class AbstractSocket
     {
     public:
@@ -30,9 +38,101 @@ namespace kickcat
         /// \param  frame_size  size of the frame to write on the network
         /// \return Number of bytes written or a negative errno code otherwise
         virtual int32_t write(void const* frame, int32_t frame_size) = 0;
+
+        /// \brief   Read up to count frames in a row.
+        /// \details Sockets with a vectored syscall shall override it, the default implementation loops on read()
+        ///          and stops at the first failed read.
+        /// \param   frames  buffers where the frames will be stored: size is updated with the number of bytes read
+        /// \param   count   number of buffers
+        /// \return  Number of frames read or a negative errno code if none could be read
+        virtual int32_t readBatch(SocketBuffer* frames, int32_t count)
+        {
+            int32_t received = 0;
+            while (received < count)
+            {
+                int32_t rc = read(frames[received].data, frames[received].size);
+                if (rc <= 0)
+                {
+                    if (received == 0)
+                    {
+                        return rc;
+                    }
+                    break;
+                }
+                frames[received].size = rc;
+                ++received;
+            }
+            return received;
+        }
+
+        /// \brief   Write count frames in a row.
+        /// \details Sockets with a vectored syscall shall override it, the default implementation loops on write()
+        ///          and stops at the first frame not fully written.
+        /// \param   frames  frames to write on the network
+        /// \param   count   number of frames
+        /// \return  Number of frames written or a negative errno code if none could be written
+        virtual int32_t writeBatch(SocketBuffer const* frames, int32_t count)
+        {
+            int32_t sent = 0;
+            while (sent < count)
+            {
+                int32_t rc = write(frames[sent].data, frames[sent].size);
+                if (rc != frames[sent].size)
+                {
+                    if ((sent == 0) and (rc < 0))
+                    {
+                        return rc;
+                    }
+                    break;
+                }
+                ++sent;
+            }
+            return sent;
+        }
+
+        /// \return true if the socket lends its own buffers (borrowBuffer() / readBorrowed()) to skip the frame copies
+        virtual bool isZeroCopy() const { return false; }
+
+        /// \brief   Zero-copy TX: lend a socket-owned buffer of at least ETH_MAX_SIZE bytes to build a frame in place.
+        /// \details The buffer goes back to the socket when it is passed to write() or writeBatch(), whatever the
+        ///          result. It shall not be modified afterward: the NIC may still be sending it.
+        /// \return  nullptr when no buffer can be lent: the frame is built in user memory and copied on write.
+        virtual void* borrowBuffer() { return nullptr; }
+
+        /// \brief Give back a buffer lent by borrowBuffer() that will not be written.
+        virtual void returnBuffer(void*) {}
+
+        /// \brief   Zero-copy RX: like readBatch() but data is set to the socket-owned memory the frames landed in.
+        /// \details Each buffer stays valid, and writable, until it is handed back with releaseBatch().
+        /// \return  Number of frames read or a negative errno code if none could be read
+        virtual int32_t readBorrowed(SocketBuffer*, int32_t) { return -EOPNOTSUPP; }
+
+        /// \brief Give back buffers lent by readBorrowed().
+        virtual void releaseBatch(SocketBuffer const*, int32_t) {}
+
+        /// \brief   Multiplexed wait support (see waitForFrames()): descriptor that polls readable when a frame is pending.
+        /// \return  -1 if the socket cannot be waited on with its peers
+        virtual int pollHandle() const { return -1; }
+
+        /// \brief   Busy-poll support (see waitForFrames()): check for pending frames without blocking.
+        /// \details For sockets whose frames land in user space memory (e.g. XDP rings): checking them is cheaper
+        ///          than a syscall, so they are polled in a loop instead of waited on.
+        /// \return  1 if a frame is pending, 0 if none, -EOPNOTSUPP if the socket shall be waited on with pollHandle()
+        virtual int32_t pendingFrames() { return -EOPNOTSUPP; }
     };
 
 
+    /// \brief   Wait until at least one of the sockets has a frame to read.
+    /// \details Sockets are waited on all at once, instead of spending a timeout on each one in turn. If one socket is
+    ///          busy-polled, the wait spins until the deadline.
+    /// \param   sockets  sockets to wait on (32 max)
+    /// \param   count    number of sockets
+    /// \param   timeout  max time to wait, infinite if negative
+    /// \return  bitmask of the ready sockets (bit i for sockets[i]), 0 on timeout or a negative errno code.
+    ///          -EOPNOTSUPP if one of the sockets cannot be multiplexed: read them one after the other instead.
+    int32_t waitForFrames(AbstractSocket* const* sockets, int32_t count, nanoseconds timeout);
+
+
     struct NetworkInterface
     {
         std::string name;
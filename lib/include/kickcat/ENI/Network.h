@@ -0,0 +1,165 @@
+#ifndef KICKCAT_ENI_NETWORK_H
+#define KICKCAT_ENI_NETWORK_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kickcat/protocol.h"
+
+namespace kickcat::ENI
+{
+    // ETG.2100 InitCmd Transition. Unlike the ESI one, the ENI also describes the transitions toward INIT and BOOT,
+    // hence a bitmask: an InitCmd lists every transition it applies to.
+    enum Transition : uint16_t
+    {
+        IP = (1 << 0),   // Init   -> PreOp
+        PS = (1 << 1),   // PreOp  -> SafeOp
+        SO = (1 << 2),   // SafeOp -> Op
+        SP = (1 << 3),   // SafeOp -> PreOp
+        OP = (1 << 4),   // Op     -> PreOp
+        OS = (1 << 5),   // Op     -> SafeOp
+        PI = (1 << 6),   // PreOp  -> Init
+        SI = (1 << 7),   // SafeOp -> Init
+        OI = (1 << 8),   // Op     -> Init
+        II = (1 << 9),   // Init   -> Init
+        IB = (1 << 10),  // Init   -> Boot
+        BI = (1 << 11),  // Boot   -> Init
+    };
+
+    inline constexpr std::pair<Transition, char const*> TRANSITIONS[] =
+    {
+        {IP, "IP"}, {PS, "PS"}, {SO, "SO"}, {SP, "SP"}, {OP, "OP"}, {OS, "OS"},
+        {PI, "PI"}, {SI, "SI"}, {OI, "OI"}, {II, "II"}, {IB, "IB"}, {BI, "BI"},
+    };
+
+    inline char const* toString(Transition t)
+    {
+        for (auto const& [transition, label] : TRANSITIONS)
+        {
+            if (transition == t) { return label; }
+        }
+        return "unknown";
+    }
+
+    /// \brief One EtherCAT datagram of an ENI <InitCmds> list, ready to be sent as is.
+    struct InitCommand
+    {
+        struct Validation
+        {
+            std::vector<uint8_t> data;
+            std::vector<uint8_t> mask;  // empty: every bit is compared
+            milliseconds timeout{0};
+        };
+
+        uint16_t transitions{0};        // Transition bitmask
+        bool before_slave{false};       // master commands only: run before the slaves ones
+        Command command{Command::NOP};
+        uint32_t address{0};            // Adp/Ado pair (createAddress()) or logical address
+        std::vector<uint8_t> data;      // payload, zeroed to the datagram length for reads
+        std::optional<uint16_t> wkc;    // expected working counter (<Cnt>)
+        int32_t retries{0};
+        std::optional<Validation> validate;
+        std::string comment;
+
+        bool appliesTo(Transition t) const { return (transitions & t) != 0; }
+    };
+
+    /// \brief One SDO download of an ENI <Mailbox>/<CoE>/<InitCmds> list.
+    struct CoEInitCommand
+    {
+        uint16_t transitions{0};        // Transition bitmask
+        uint16_t index{0};
+        uint8_t subindex{0};
+        bool complete_access{false};
+        std::vector<uint8_t> data;
+        milliseconds timeout{0};        // 0: not specified
+        std::string comment;
+
+        bool appliesTo(Transition t) const { return (transitions & t) != 0; }
+    };
+
+    /// \brief One datagram of a cyclic frame, with its location in the process image.
+    struct CyclicCommand
+    {
+        uint16_t states{0};             // State bitmask (State::PRE_OP, ...) during which it is sent
+        Command command{Command::NOP};
+        uint32_t address{0};
+        uint16_t length{0};
+        std::optional<uint16_t> wkc;
+        std::optional<uint32_t> input_offset;   // bytes in the input image of the datagram data
+        std::optional<uint32_t> output_offset;  // bytes in the output image of the datagram data
+    };
+
+    struct CyclicFrame
+    {
+        std::vector<CyclicCommand> commands;
+    };
+
+    /// \brief Location of a slave image in the ENI process image (<ProcessData>/<Send> or <Recv>).
+    struct ProcessData
+    {
+        uint32_t bit_start{0};          // in the output (Send) or input (Recv) image
+        uint32_t bit_length{0};
+    };
+
+    struct Slave
+    {
+        std::string name;
+        uint16_t address{0};            // <PhysAddr>
+        uint16_t position{0};           // <AutoIncAddr>
+        uint32_t vendor_id{0};
+        uint32_t product_code{0};
+        uint32_t revision{0};
+        uint32_t serial{0};
+        std::vector<InitCommand> init_cmds;
+        std::vector<CoEInitCommand> coe_init_cmds;
+        std::optional<ProcessData> inputs;   // <Recv>
+        std::optional<ProcessData> outputs;  // <Send>
+    };
+
+    /// \brief ENI (EtherCAT Network Information) content relevant to a master: the ordered init commands of the
+    ///        master and of each slave, the CoE init commands of each slave, the cyclic frames and the process image
+    ///        size.
+    /// \details The init commands are replayed with Bus::runInitCommands() and Bus::runMailboxInitCommands(). The process
+    ///          data frames are built from the cyclic frames by Bus::createMapping(Network const&, ...).
+    struct Network
+    {
+        std::vector<InitCommand> master_init_cmds;
+        std::vector<Slave> slaves;
+
+        microseconds cycle_time{0};
+        std::vector<CyclicFrame> frames;
+        uint32_t input_size{0};         // process image, bytes
+        uint32_t output_size{0};
+
+        /// \return the commands of a transition in replay order: master commands flagged before slave, every slave
+        ///         commands in the network order, then the other master commands.
+        std::vector<InitCommand const*> initCommands(Transition transition) const
+        {
+            std::vector<InitCommand const*> commands;
+            auto select = [&](std::vector<InitCommand> const& list, std::optional<bool> before_slave)
+            {
+                for (auto const& cmd : list)
+                {
+                    if (cmd.appliesTo(transition) and ((not before_slave) or (*before_slave == cmd.before_slave)))
+                    {
+                        commands.push_back(&cmd);
+                    }
+                }
+            };
+
+            select(master_init_cmds, true);
+            for (auto const& slave : slaves)
+            {
+                select(slave.init_cmds, std::nullopt);
+            }
+            select(master_init_cmds, false);
+            return commands;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef KICKCAT_ENI_PARSER_H
+#define KICKCAT_ENI_PARSER_H
+
+#include <tinyxml2.h>
+#include <string>
+#include <vector>
+
+#include "kickcat/ENI/Network.h"
+
+namespace kickcat::ENI
+{
+    // ETG.2100 ENI reader: turns <EtherCATConfig>/<Config> into a Network, i.e. the master and slaves <InitCmds>,
+    // the slaves CoE <InitCmds> (SDO downloads only) and <ProcessData> images, the <Cyclic> frames and the <ProcessImage>
+    // sizes.
+    class Parser
+    {
+    public:
+        Parser() = default;
+        ~Parser() = default;
+
+        Network loadFile  (std::string const& file);
+        Network loadString(std::string const& xml);
+
+    private:
+        Network parse();
+
+        std::vector<InitCommand> parseInitCmds(tinyxml2::XMLElement* parent, std::string const& where);
+        InitCommand              parseInitCmd (tinyxml2::XMLElement* node,   std::string const& where);
+        CoEInitCommand           parseCoEInitCmd(tinyxml2::XMLElement* node, std::string const& where);
+        Slave                    parseSlave   (tinyxml2::XMLElement* node);
+        void                     parseCyclic  (tinyxml2::XMLElement* config, Network& network);
+
+        tinyxml2::XMLDocument doc_;
+    };
+}
+
+#endif
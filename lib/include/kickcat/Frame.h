@@ -64,8 +64,19 @@ namespace kickcat
 
         void setSourceMAC(MAC const& src);
 
+        /// \brief   Write the Ethernet and EtherCAT headers of an empty frame (broadcast destination, no datagram).
+        /// \details Done at construction: only needed to build a new frame in an attached buffer.
+        void prepare();
+
+        /// \brief   Rebase the frame on an external buffer of at least ETH_MAX_SIZE bytes (zero-copy socket I/O).
+        /// \details The buffer content is kept as is: call prepare() before building a new frame in it.
+        ///          nullptr goes back to the frame own storage. The datagram context is reset.
+        /// \warning The frame does not own the buffer: it shall stay valid until the frame is detached.
+        void attach(void* buffer);
+        bool isAttached() const { return data_ != frame_.data(); }
+
         // helper to access raw frame (mostly for unit testing)
-        uint8_t* data() { return frame_.data(); }
+        uint8_t* data() { return data_; }
         EthercatHeader* header()   { return header_; }
         EthernetHeader* ethernet() { return ethernet_; }
 
@@ -78,9 +89,16 @@ namespace kickcat
         uint8_t* next_datagram_{nullptr};   // Next datagram **to write** or **to read**
         int32_t datagram_counter_{0};       // number of datagram already written
         bool is_datagram_available_{false};
+        uint8_t* data_;                     // frame_ or an attached external buffer
     };
 
     int32_t readFrame (AbstractSocket& socket, Frame& frame);
+
+    /// \brief   Check a frame received on a socket (EtherCAT type, size) and make its datagrams available.
+    /// \details readFrame() post-processing, for frames received through AbstractSocket::readBatch().
+    /// \param   read  number of bytes read or a negative errno code, as returned by the socket
+    /// \return  read, or a negative errno code if the frame is invalid
+    int32_t checkFrame(Frame& frame, int32_t read);
     int32_t writeFrame(AbstractSocket& socket, Frame& frame, MAC const& src);
 
     [[deprecated("pass the socket by reference: readFrame(AbstractSocket&, Frame&)")]]
@@ -18,12 +18,19 @@ namespace kickcat
     // slaves in the same process - no shared memory, no second process. One
     // master writeThenRead == one simulator iteration. The tick callback advances
     // the slave application(s) (Slave::routine, output validation, ...).
+    // The answers are queued: several frames may be in flight, as on a real wire.
+    // The queue is a ring of frame buffers allocated once: write() and read() do not allocate.
     class LoopbackSocket final : public AbstractSocket
     {
     public:
+        // One frame per datagram of the link index window: a full window of single datagram frames fits.
+        static constexpr std::size_t WIRE_CAPACITY = 256;
+
         LoopbackSocket(std::vector<EmulatedESC*> escs, std::function<void()> tick)
             : network_(std::move(escs))
             , tick_(std::move(tick))
+            , wire_(WIRE_CAPACITY)
+            , wire_sizes_(WIRE_CAPACITY)
         {
         }
 
@@ -43,37 +50,43 @@ namespace kickcat
             tick_();
             if (not delivered)
             {
-                pending_ = false; // frame destroyed by an ESC (circulating flag)
-                return size;
+                return size; // frame destroyed by an ESC (circulating flag)
+            }
+            if (pending_ == WIRE_CAPACITY)
+            {
+                return size; // receive queue overflow: the frame is lost, as on a NIC
             }
-            std::memcpy(buffer_, frame.data(), static_cast<size_t>(size));
-            size_ = size;
-            pending_ = true;
+            std::size_t tail = (head_ + pending_) % WIRE_CAPACITY;
+            std::memcpy(wire_[tail].data(), frame.data(), static_cast<size_t>(size));
+            wire_sizes_[tail] = size;
+            ++pending_;
             return size;
         }
 
         int32_t read(void* data, int32_t size) override
         {
-            if (not pending_)
+            if (pending_ == 0)
             {
                 return 0;
             }
-            int32_t n = size_;
+            int32_t n = wire_sizes_[head_];
             if (size < n)
             {
                 n = size;  // never write past the caller's buffer
             }
-            std::memcpy(data, buffer_, static_cast<size_t>(n));
-            pending_ = false;
+            std::memcpy(data, wire_[head_].data(), static_cast<size_t>(n));
+            head_ = (head_ + 1) % WIRE_CAPACITY;
+            --pending_;
             return n;
         }
 
     private:
         EmulatedNetwork network_;
         std::function<void()> tick_;
-        uint8_t buffer_[ETH_MAX_SIZE];
-        int32_t size_    = 0;
-        bool    pending_ = false;
+        std::vector<EthernetFrame> wire_;   // ring of received frames
+        std::vector<int32_t> wire_sizes_;
+        std::size_t head_{0};               // next frame to read
+        std::size_t pending_{0};
     };
 }
 
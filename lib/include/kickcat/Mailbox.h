@@ -39,6 +39,7 @@ namespace kickcat::mailbox::request
         constexpr uint32_t SUCCESS                      = 0x000;
         constexpr uint32_t RUNNING                      = 0x001;
         constexpr uint32_t TIMEDOUT                     = 0x002;
+        constexpr uint32_t CANCELLED                    = 0x003;   // never sent: a previous message of the sequence failed
 
         constexpr uint32_t COE_WRONG_SERVICE            = 0x101;
         constexpr uint32_t COE_UNKNOWN_SERVICE          = 0x102;
@@ -142,6 +143,10 @@ namespace kickcat::mailbox::request
         /// \param current_time     Considered time to process message timeout (enable injection for tests)
         bool receive(uint8_t const* raw_message, nanoseconds current_time = now());
 
+        /// \brief Drop a message waiting to be sent or waiting for its answer: it will not be sent nor processed anymore.
+        /// \details To call before releasing the client buffers of a message still in flight.
+        void cancel(std::shared_ptr<AbstractMessage> const& message);
+
 
         std::queue<std::shared_ptr<AbstractMessage>> to_send;     // message waiting to be sent
         std::list <std::shared_ptr<AbstractMessage>> to_process;  // message already sent, waiting for an answer
@@ -8,7 +8,26 @@ namespace kickcat
     class Socket final : public AbstractSocket
     {
     public:
-        Socket(nanoseconds coalescing = -1us, nanoseconds polling_period = 20us);
+        /// \brief How a read waits for a frame that is not there yet
+        enum class ReceiveStrategy
+        {
+            SLEEP,              ///< non-blocking reads with a polling_period sleep in between (default)
+            BUSY_POLL,          ///< non-blocking reads in a tight loop: lowest latency, burns a core
+            KERNEL_BUSY_POLL,   ///< blocking reads, the kernel busy polls the NIC queue for polling_period first
+                                ///  (SO_BUSY_POLL/SO_PREFER_BUSY_POLL - may require CAP_NET_ADMIN)
+            POLL,               ///< poll() until the deadline: no user space loop, woken up by the frame arrival
+        };
+
+        /// \brief RX timestamps of the frames (SO_TIMESTAMPING), see lastRxTimestamp()
+        enum class Timestamping
+        {
+            NONE,
+            SOFTWARE,   ///< taken by the kernel when the frame enters the stack (CLOCK_REALTIME)
+            HARDWARE,   ///< taken by the NIC (PHC time): falls back to SOFTWARE if the interface does not support it
+        };
+
+        Socket(nanoseconds coalescing = -1us, nanoseconds polling_period = 20us,
+               ReceiveStrategy strategy = ReceiveStrategy::SLEEP);
         virtual ~Socket()
         {
             close();
@@ -20,11 +39,42 @@ namespace kickcat
         int32_t read(void* frame, int32_t frame_size) override;
         int32_t write(void const* frame, int32_t frame_size) override;
 
+        /// \brief Read frames with recvmmsg(): wait (within the timeout) until count frames are received.
+        int32_t readBatch(SocketBuffer* frames, int32_t count) override;
+
+        /// \brief Write frames with a single sendmmsg() call (per chunk of MAX_BATCH frames).
+        int32_t writeBatch(SocketBuffer const* frames, int32_t count) override;
+
+        static constexpr int32_t MAX_BATCH = 64; // frames per syscall - bigger batches are split
+
+        int pollHandle() const override { return fd_; }
+
+        /// \brief Select the receive strategy: applied right away if the socket is open, at open() otherwise.
+        void setReceiveStrategy(ReceiveStrategy strategy);
+        ReceiveStrategy receiveStrategy() const { return strategy_; }
+
+        /// \brief Enable RX timestamps: applied right away if the socket is open, at open() otherwise.
+        void setTimestamping(Timestamping mode);
+        Timestamping timestamping() const { return timestamping_; } // active mode, after a hardware fallback
+
+        /// \return RX timestamp of the last frame read (the last of a batch), 0 if none
+        nanoseconds lastRxTimestamp() const { return last_rx_timestamp_; }
+
     private:
+        void applyReceiveStrategy();
+        void applyTimestamping();
+        void updateFlags();
+        bool waitForData(nanoseconds deadline);  // false once the deadline is reached
+
         int fd_{-1};
+        std::string interface_;
         nanoseconds coalescing_;
-        nanoseconds timeout_;
+        nanoseconds timeout_{0};
         nanoseconds polling_period_;
+        ReceiveStrategy strategy_;
+        Timestamping timestamping_{Timestamping::NONE};
+        nanoseconds last_rx_timestamp_{0};
+        nanoseconds receive_timeout_{0};    // SO_RCVTIMEO applied to the socket, 0: infinite
 
         int flags_{0};
     };
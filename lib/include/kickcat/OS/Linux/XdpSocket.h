@@ -19,6 +19,7 @@ namespace kickcat
         static constexpr uint32_t TX_RING_SIZE     = 2048;
         static constexpr uint32_t FILL_RING_SIZE   = 2048;
         static constexpr uint32_t COMP_RING_SIZE   = 2048;
+        static constexpr int32_t  MAX_BATCH        = 64;
 
         XdpSocket(nanoseconds polling_period = 20us, uint32_t queue_id = 0);
         virtual ~XdpSocket()
@@ -31,8 +32,26 @@ namespace kickcat
         void close() noexcept override;
         int32_t read(void* frame, int32_t frame_size) override;
         int32_t write(void const* frame, int32_t frame_size) override;
+        int32_t readBatch(SocketBuffer* frames, int32_t count) override;
+        int32_t writeBatch(SocketBuffer const* frames, int32_t count) override;
+
+        /// Zero-copy path: frames are built and parsed straight in UMEM chunks.
+        bool isZeroCopy() const override { return true; }
+        void* borrowBuffer() override;
+        void returnBuffer(void* buffer) override;
+        int32_t readBorrowed(SocketBuffer* frames, int32_t count) override;
+        void releaseBatch(SocketBuffer const* frames, int32_t count) override;
+
+        /// Busy-polled by waitForFrames(): pending frames are checked on the RX ring, without a syscall.
+        int pollHandle() const override;
+        int32_t pendingFrames() override;
 
     private:
+        int32_t receive(SocketBuffer* frames, int32_t count, bool copy);
+        int32_t peekRx(SocketBuffer* frames, int32_t count, bool copy);
+        int32_t prepareTx(SocketBuffer const& frame, uint64_t& addr);
+        bool isLent(void const* data) const;
+        uint64_t chunkOf(void const* data) const;
         void reclaimCompletedTx();
         void refillFillRing();
         uint64_t allocFrame();
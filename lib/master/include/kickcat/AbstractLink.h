@@ -27,6 +27,7 @@ namespace kickcat
             uint16_t contribution{0};  // expected wkc contribution of this slave on LRW
             int32_t  input_offset{-1}; // frame offset of its input block, -1 when none
             int32_t  input_size{0};
+            uint8_t  input_mask{0xFF}; // bits of a one byte input block owned by the slave (bit-packed mapping)
         };
         std::vector<Entry> entries;
     };
@@ -57,6 +58,29 @@ namespace kickcat
                                  std::function<DatagramState(DatagramHeader const*, uint8_t const* data, uint16_t wkc)> const& process,
                                  std::function<void(DatagramState const& state)> const& error) = 0;
 
+        /// \brief Allocation-free datagram callbacks: plain functions called back with the context given to addDatagram().
+        using ProcessCallback = DatagramState(*)(void* context, DatagramHeader const*, uint8_t const* data, uint16_t wkc);
+        using ErrorCallback   = void(*)(void* context, DatagramState const& state);
+
+        /// \brief Queue a datagram with function pointer callbacks (see ProcessCallback and ErrorCallback).
+        /// \details Unlike std::function, nothing is copied but the pointers: use it on the cyclic path, where a
+        ///          capture bigger than the std::function small buffer would allocate on each call.
+        ///          The context shall outlive the datagram processing.
+        ///          The default implementation forwards to the std::function overload.
+        virtual void addDatagram(enum Command command, uint32_t address, void const* data, uint16_t data_size,
+                                 ProcessCallback process, ErrorCallback error, void* context)
+        {
+            addDatagram(command, address, data, data_size,
+                [process, context](DatagramHeader const* header, uint8_t const* payload, uint16_t wkc)
+                {
+                    return process(context, header, payload, wkc);
+                },
+                [error, context](DatagramState const& state)
+                {
+                    error(context, state);
+                });
+        }
+
         /// \brief Provide the layout of the mapped logical frames, replacing any previous one.
         /// \details Links without redundancy support ignore it.
         virtual void setLogicalMapping(std::vector<LogicalFrameDescription> const&) {}
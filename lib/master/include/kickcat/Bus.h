@@ -1,6 +1,7 @@
 #ifndef KICKCAT_BUS_H
 #define KICKCAT_BUS_H
 
+#include <type_traits>
 #include <vector>
 
 #include "kickcat/Error.h"
@@ -11,6 +12,13 @@
 namespace kickcat
 {
     class Timer;
+    class SIICache;
+    struct BusSnapshot;
+    namespace ENI
+    {
+        struct Network;
+        enum Transition : uint16_t;
+    }
 
     enum MailboxStatusFMMU : uint8_t
     {
@@ -29,6 +37,7 @@ namespace kickcat
 
     class Bus
     {
+        friend class SDOBatch; // drives the mailbox loop at the bus pace
     public:
         Bus(std::shared_ptr<AbstractLink> link);
         ~Bus() = default;
@@ -41,6 +50,40 @@ namespace kickcat
         // 0ms disables the watchdog
         void init(nanoseconds watchdog = 100ms);
 
+        /// \brief   Set the bus to PREOP state without reading the full SII, from the snapshot of a previous init().
+        /// \details The snapshot spares the SII download and the PI mapping discovery only: the SII of the slaves and, if
+        ///          the snapshot was taken after createMapping(), their PI mapping sizes come from it (the next
+        ///          createMapping() uses them as static mappings). Only the identity of the slaves (vendor id, product
+        ///          code, revision and serial number) is read. The slaves are still configured one by one: the mailbox
+        ///          SyncManagers here, the FMMUs and process data SyncManagers by createMapping() (the snapshot holds no
+        ///          register image). Throw if no slave is detected or the bus does not match the snapshot: the caller
+        ///          may then fall back to init().
+        void init(BusSnapshot const& snapshot, nanoseconds watchdog = 100ms);
+
+        /// \return the configuration discovered by init() (and createMapping(), if called), to warm start the next run
+        BusSnapshot snapshot() const;
+
+        /// \brief   Replay the ENI init commands of a transition, in the order of ENI::Network::initCommands().
+        /// \details The commands are sent in batched frames. A command with a validation closes its batch and is sent
+        ///          again until its answer matches or its timeout expires. A command whose working counter does not
+        ///          match is sent again up to its retries count. Throw on failure.
+        void runInitCommands(ENI::Network const& network, ENI::Transition transition);
+
+        /// \brief   Replay the ENI CoE init commands (SDO downloads) of a transition.
+        /// \details Call it in PRE_OP with the slaves mailboxes configured: after runInitCommands() for the IP transition,
+        ///          before it for the other ones (the SDOs shall be written before the state is requested). The slaves
+        ///          are found by their ENI address and progress together, one SDO in flight per slave. Throw on failure.
+        void runMailboxInitCommands(ENI::Network const& network, ENI::Transition transition);
+
+        /// \brief   Cross-check the PI frames with the ENI cyclic frames and process image.
+        /// \details The logical commands sent in OP are matched in order with the PI frames (one frame per logical
+        ///          address): their length and expected working counter shall be the ones of the frame. The process
+        ///          image mapped in the client buffer shall fit the ENI one. The logical addresses and the image offsets
+        ///          are not compared: a mapping discovered by createMapping(iomap, ...) lays out its own logical space
+        ///          and client buffer.
+        /// \return  true if the mapping matches, false otherwise (every mismatch is logged)
+        bool checkMapping(ENI::Network const& network) const;
+
         /// \brief Enable Distributed Clock
         /// \details  Shall be called in PRE-OP, but some slaves needs a call in INIT
         /// \param    cycle_time    Duration of the slave cycle time
@@ -49,6 +92,24 @@ namespace kickcat
         /// \return   a now()-domain sync point for Timer::start, phase-aligned to the slaves DC cycle
         nanoseconds enableDC(nanoseconds cycle_time = 1ms, nanoseconds shift_cycle = 500us, nanoseconds start_delay = 100ms);
 
+        /// \brief   Tune the static drift compensation of enableDC().
+        /// \details The FRMW drift datagrams are sent in bursts of several full frames in flight. Every check_period
+        ///          datagrams, the compensation stops early if every DC slave system time difference (0x092C) is under
+        ///          the threshold (see isDCSynchronized()).
+        /// \param   max_iterations  Upper bound of FRMW datagrams (15 000 from the doc)
+        /// \param   threshold       Convergence threshold, 0ns to always send max_iterations datagrams
+        /// \param   check_period    FRMW datagrams between two convergence checks
+        void configureStaticDriftCompensation(int32_t max_iterations = 15000, nanoseconds threshold = 100ns, int32_t check_period = 1000);
+
+        struct StaticDriftReport
+        {
+            int32_t iterations{0};       // FRMW datagrams sent
+            nanoseconds duration{0};     // time to converge (or to spend the budget)
+            bool converged{false};       // stopped early, under the threshold
+        };
+        /// \return the outcome of the last static drift compensation of enableDC()
+        StaticDriftReport const& staticDriftReport() const { return static_drift_report_; }
+
         /// \return the number of slaves detected on the bus
         int32_t detectedSlaves() const;
 
@@ -78,6 +139,16 @@ namespace kickcat
         // wait for a single slave to reach a state
         void waitForState(Slave& slave, State request, nanoseconds timeout, std::function<void()> background_task = [](){});
 
+        /// \brief   Wait for the bus state transitions on AL status change events instead of polling every slave.
+        /// \details waitForState(request, ...) then enables the AL status event of the slaves while it waits: the state is
+        ///          checked when the event shows up in the frames of the background task, or every poll_period otherwise.
+        ///          A check is one BRD of AL_STATUS for the whole bus; the slaves are read one by one only when the broadcast
+        ///          is inconclusive (error indicator, unexpected working counter or BOOT request).
+        /// \param   enable       Event-driven wait (true) or per slave polling (false, default)
+        /// \param   poll_period  Fallback check period, when the background task sends no frame
+        void configureEventDrivenStateWait(bool enable, nanoseconds poll_period = 1ms)
+        { event_driven_state_wait_ = enable; state_poll_period_ = poll_period; }
+
         /// \brief Select and validate the preferred mailbox status check mode.
         /// \details Must be called during PRE_OP, before createMapping(). Validates that all
         ///          mailbox-capable slaves have enough FMMUs for the requested mode. Throws on error.
@@ -89,13 +160,50 @@ namespace kickcat
         /// \return the currently configured mailbox status FMMU mode
         MailboxStatusFMMU mailboxStatusFMMUMode() const { return mailbox_status_fmmu_; }
 
+        /// \brief   Exchange the mailboxes of some slaves with logical datagrams instead of one FPRD/FPWR per slave.
+        /// \details Must be called during PRE_OP. Both mailbox SyncManagers of each slave are mapped byte-wise, with
+        ///          its last two FMMUs, into a dedicated logical region starting at logical_address (keep it away from
+        ///          the PI frames). The message exchange then reads their mailboxes with one LRD per frame of
+        ///          mailboxes, sent when at least one can be read, and writes their pending messages with one LWR
+        ///          per run of consecutive slaves ready to receive one: a mailbox written while it has nothing to
+        ///          receive would be taken by the slave as a message. Throws if a slave has not enough FMMUs.
+        void configureLogicalMailboxes(std::vector<Slave*> const& slaves, uint32_t logical_address = 0x40000000);
+
+        /// \brief   Pack the sub-byte process images at bit granularity.
+        /// \details Must be called before createMapping(). Slaves whose input and output images are both smaller
+        ///          than a byte then share frame bytes: their FMMUs are configured bit-wise, and Slave::PIMapping::bit_offset
+        ///          locates their bits in the byte pointed by data. Use Slave::PIMapping::bit() and setBit() to access them.
+        void configureBitPackedMapping(bool enable) { bit_packed_mapping_ = enable; }
+        bool bitPackedMapping() const { return bit_packed_mapping_; }
+
+        /// \brief   Period of the logical PI exchange cycle.
+        /// \details createMapping() uses it to reject a Slave::cycle_divisor whose period exceeds the SM watchdog set by
+        ///          init(). enableDC() sets it to the DC cycle time. 0 (default): unknown, the divisors are not checked.
+        void configureCyclePeriod(nanoseconds period) { cycle_period_ = period; }
+
         // create the mapping between slaves PI and client buffer
         // if OK, set the bus to SAFE_OP state
         [[deprecated("pass the iomap size so it can be bounds-checked: createMapping(uint8_t*, std::size_t)")]]
         void createMapping(uint8_t* iomap);
-        /// \brief Like createMapping(iomap), but throws if iomap_size cannot hold the process image.
+        /// \brief Like createMapping(iomap), but throws if iomap_size cannot hold the process image. Both throw on a null
+        ///        iomap: only createMapping() without argument selects the in-frame process image.
         void createMapping(uint8_t* iomap, std::size_t iomap_size);
 
+        /// \brief   Create the mapping with an in-frame process image: no client buffer.
+        /// \details Slave::output.data points into the payload of the next frame to send and Slave::input.data
+        ///          into the payload of the last frame received, so the cyclic exchange copies neither the outputs
+        ///          into the frames nor the inputs block by block. The pointers stay valid until the next mapping.
+        void createMapping();
+
+        /// \brief   Create the mapping from the ENI cyclic frames, without any SII or CoE mapping discovery.
+        /// \details Each logical command sent in OP gives a PI frame with its ENI logical address, length and expected
+        ///          working counter (the commands at the same address share the frame). The slaves images are located
+        ///          with their <ProcessData> bit ranges and the InputOffs/OutputOffs of the commands: the client buffer
+        ///          is the ENI process image, ENI::Network::input_size bytes of inputs then the outputs. Nothing is
+        ///          written to the slaves: their FMMUs and SyncManagers are programmed by the ENI init commands (see
+        ///          runInitCommands()). Throws if iomap cannot hold the image or the ENI images are inconsistent.
+        void createMapping(ENI::Network const& network, uint8_t* iomap, std::size_t iomap_size);
+
         std::vector<Slave>& slaves() { return slaves_; }
 
         // asynchrone read/write/mailbox/state methods
@@ -103,9 +211,25 @@ namespace kickcat
         void sendGetALStatus(Slave& slave, std::function<void(DatagramState const&)> const& error);
         void sendGetDLStatus(Slave& slave, std::function<void(DatagramState const&)> const& error);
 
+        // Logical PI exchange: only the frames due this cycle are queued (see Slave::cycle_divisor).
+        // A cycle is closed by sendLogicalWrite() or sendLogicalReadWrite(): a read followed by a write is one cycle.
+        // The error callback is copied: it is called when the datagrams are processed, after the call. The copy allocates
+        // beyond the std::function small buffer: in the cyclic path, set the callbacks once with
+        // setLogicalErrorCallbacks() and call the overloads without argument.
         void sendLogicalRead(std::function<void(DatagramState const&)> const& error);
         void sendLogicalWrite(std::function<void(DatagramState const&)> const& error);
         void sendLogicalReadWrite(std::function<void(DatagramState const&)> const& error);
+        void setLogicalErrorCallbacks(std::function<void(DatagramState const&)> read,
+                                      std::function<void(DatagramState const&)> write,
+                                      std::function<void(DatagramState const&)> read_write);
+        void sendLogicalRead();
+        void sendLogicalWrite();
+        void sendLogicalReadWrite();
+        // Allocation-free overloads for the cyclic path (see AbstractLink::ErrorCallback): only the pointers are
+        // kept, the context shall outlive the datagram processing.
+        void sendLogicalRead(AbstractLink::ErrorCallback error, void* context);
+        void sendLogicalWrite(AbstractLink::ErrorCallback error, void* context);
+        void sendLogicalReadWrite(AbstractLink::ErrorCallback error, void* context);
         void sendMailboxesReadChecks (std::function<void(DatagramState const&)> const& error);  // Fetch in  mailboxes states (full/empty) of compatible slaves
         void sendMailboxesWriteChecks(std::function<void(DatagramState const&)> const& error);  // Fetch out mailboxes states (full/empty) of compatible slaves
         void sendNop(std::function<void(DatagramState const&)> const& error);                   // Send a NOP datagram
@@ -114,13 +238,35 @@ namespace kickcat
         // Process messages (read or write slave mailbox) - one at once per slave.
         void sendReadMessages(std::function<void(DatagramState const&)> const& error);
         void sendWriteMessages(std::function<void(DatagramState const&)> const& error);
+        void sendLogicalReadMessages(std::function<void(DatagramState const&)> const& error);
+        void sendLogicalWriteMessages(std::function<void(DatagramState const&)> const& error);
         void sendRefreshErrorCounters(std::function<void(DatagramState const&)> const& error);
 
         // helpers around start/finalize operations
         void finalizeDatagrams(); // send a frame if there is awaiting datagram inside
-        void processDataRead(std::function<void(DatagramState const&)> const& error);
-        void processDataWrite(std::function<void(DatagramState const&)> const& error);
-        void processDataReadWrite(std::function<void(DatagramState const&)> const& error);
+        // The error callable is referenced, not copied, for the duration of the call: nothing is allocated whatever
+        // its captures.
+        template<typename Error>
+        void processDataRead(Error const& error)
+        {
+            Callable<Error> const& callable = error;
+            processDataRead(callError<Callable<Error>>, toContext(callable));
+        }
+        template<typename Error>
+        void processDataWrite(Error const& error)
+        {
+            Callable<Error> const& callable = error;
+            processDataWrite(callError<Callable<Error>>, toContext(callable));
+        }
+        template<typename Error>
+        void processDataReadWrite(Error const& error)
+        {
+            Callable<Error> const& callable = error;
+            processDataReadWrite(callError<Callable<Error>>, toContext(callable));
+        }
+        void processDataRead(AbstractLink::ErrorCallback error, void* context);
+        void processDataWrite(AbstractLink::ErrorCallback error, void* context);
+        void processDataReadWrite(AbstractLink::ErrorCallback error, void* context);
 
         void checkMailboxes( std::function<void(DatagramState const&)> const& error);
         void processMessages(std::function<void(DatagramState const&)> const& error);
@@ -129,10 +275,12 @@ namespace kickcat
         /// \details Writes the current master time to the DC reference clock slave's system time register (0x0910)
         ///          using FPWR, then reads it back with FRMW so that each slave on the segment updates its
         ///          local clock offset accordingly.
-        ///          Called cyclically during process data exchange, and repeatedly (15 000 times) during
-        ///          static drift compensation at DC initialization.
+        ///          Called cyclically during process data exchange, and repeatedly (up to 15 000 times, see
+        ///          configureStaticDriftCompensation()) during static drift compensation at DC initialization.
         /// \param  error  Callback invoked when a datagram error occurs
         void sendDriftCompensation(std::function<void(DatagramState const&)> const& error);
+        /// \brief  Allocation-free overload (see sendLogicalRead(AbstractLink::ErrorCallback, void*))
+        void sendDriftCompensation(AbstractLink::ErrorCallback error, void* context);
 
         /// \brief  Check if distributed clocks are synchronized
         /// \details Reads the system time difference register (0x092C) of each DC slave.
@@ -166,6 +314,11 @@ namespace kickcat
         ///        Non-owning; pass nullptr to detach. Install before init().
         void setMasterMailbox(mailbox::response::Mailbox* mbx) { master_mailbox_ = mbx; }
 
+        /// \brief Use a SII cache in fetchEeprom(): the slaves found in it are hydrated from their header only,
+        ///        the other ones are read in full and added to the cache, saved at the end of the fetch.
+        ///        Non-owning; pass nullptr to detach. Install before init().
+        void setSIICache(SIICache* cache) { sii_cache_ = cache; }
+
         void clearErrorCounters();
 
         // Helpers for broadcast commands, mainly for init purpose
@@ -210,11 +363,41 @@ namespace kickcat
 
         void configureMailboxes();
 
+        // clear the mailboxes and create the reception callbacks of the messages not requested by the master
+        void prepareMailboxes();
+
+        // Per slave requests: the datagrams of a large bus do not fit in the link datagram index window, they are
+        // processed by rounds. Call reserveDatagrams() before queueing 'count' datagrams: the 'queued' ones are
+        // processed first if the window would overflow.
+        static constexpr std::size_t DATAGRAMS_PER_ROUND = 255;
+        void reserveDatagrams(std::size_t& queued, std::size_t count);
+
+        // checkMailboxes() and processMessages() queue up to two datagrams per slave, writes then reads: they send
+        // them by rounds of slaves. The overloads below work on the slaves [begin, end).
+        static constexpr std::size_t MAILBOX_SLAVES_PER_ROUND = DATAGRAMS_PER_ROUND / 2;
+        void sendMailboxesReadChecks (std::function<void(DatagramState const&)> const& error, std::size_t begin, std::size_t end);
+        void sendMailboxesWriteChecks(std::function<void(DatagramState const&)> const& error, std::size_t begin, std::size_t end);
+        void sendReadMessages (std::function<void(DatagramState const&)> const& error, std::size_t begin, std::size_t end);
+        void sendWriteMessages(std::function<void(DatagramState const&)> const& error, std::size_t begin, std::size_t end);
+        // The logical mailboxes datagrams reserved on top of the 'queued' ones (see reserveDatagrams())
+        void sendLogicalReadMessages (std::function<void(DatagramState const&)> const& error, std::size_t& queued);
+        void sendLogicalWriteMessages(std::function<void(DatagramState const&)> const& error, std::size_t& queued);
+
+        // state helpers
+        State decodeALStatus(Slave const& slave);          // throw on AL status error
+        void waitForStateOnEvents(State request, nanoseconds timeout, std::function<void()> const& background_task);
+        bool isStateReached(State request);                 // one BRD, per slave reads if inconclusive
+
         // mapping helpers
         void detectMapping();
+        void detectCoEMapping(std::vector<Slave*> const& slaves); // one SDO in flight per slave, all slaves at once
         void readMappedPDO(Slave& slave, uint16_t index);
         void configureFMMUs();
         void configureMailboxFMMUs();
+        void buildPIFrames();
+        void describePIFrames(); // payload buffers, per slave working counter entries, link logical mapping
+        void bindProcessImage(uint8_t* iomap); // nullptr: in-frame process image
+        void compileCyclicProgram();
 
         // DC helpers
         void fetchReceivedTimes();
@@ -251,6 +434,9 @@ namespace kickcat
             std::vector<MailboxStatusEntry> mailbox_read_status;
             std::vector<MailboxStatusEntry> mailbox_write_status;
 
+            // Exchanged once every 'divisor' cycles: all the slaves of the frame share this cycle divisor
+            int32_t divisor{1};
+
             // Adjust wkc in case the slave do not have a PDO read but still answer because of the mbx check
             uint16_t mailbox_status_wkc_read_adjust{0};
 
@@ -261,25 +447,127 @@ namespace kickcat
             // Outgoing payload, zeroed once at mapping time so the gaps between output
             // blocks never carry residual bytes on the wire
             std::vector<uint8_t> output_buffer;
+
+            // In-frame process image only (see createMapping()): last received payload
+            std::vector<uint8_t> input_buffer;
+
+            // Cyclic program, compiled once the iomap is bound (see compileCyclicProgram()): a cycle only
+            // moves payload bytes along these lists and checks the wkc against the precomputed values.
+            struct Copy
+            {
+                uint8_t* iomap;     // client buffer
+                uint32_t offset;    // frame offset
+                int32_t  size;      // contiguous run of one or more block IO
+            };
+            std::vector<Copy> gather;   // outputs: iomap -> output_buffer
+            std::vector<Copy> scatter;  // inputs:  frame -> iomap
+            uint16_t expected_lrd_wkc{0};
+            uint16_t expected_lwr_wkc{0};
+
+            // Context of the cyclic datagrams, queued with function pointer callbacks: no closure is built in
+            // the cyclic path. The client error callback is kept per command, as LRD and LWR can be queued
+            // in the same cycle.
+            struct Handler
+            {
+                PIFrame* frame{nullptr};
+                AbstractLink::ErrorCallback error{nullptr};
+                void* error_context{nullptr};
+            };
+            Handler lrd;
+            Handler lwr;
+            Handler lrw;
+        };
+
+        // Client buffer bytes taken by a block IO list
+        static std::size_t blocksSize(std::vector<blockIO> const& blocks);
+
+        // Cyclic datagram callbacks, the context is a PIFrame::Handler
+        static void scatterInputs(PIFrame const& pi_frame, uint8_t const* data);
+        static DatagramState processLogicalRead(void* context, DatagramHeader const*, uint8_t const* data, uint16_t wkc);
+        static DatagramState processLogicalWrite(void* context, DatagramHeader const*, uint8_t const* data, uint16_t wkc);
+        static DatagramState processLogicalReadWrite(void* context, DatagramHeader const*, uint8_t const* data, uint16_t wkc);
+        static void logicalError(void* context, DatagramState const& state);
+
+        // Call a client error callable given as a context (see processDataRead())
+        // A function name decays to a pointer: the context then points to this pointer, bound for the call.
+        // Any other callable is referenced as is.
+        template<typename Error>
+        using Callable = std::decay_t<Error>;
+
+        template<typename Error>
+        static void callError(void* context, DatagramState const& state)
+        {
+            (*static_cast<Error const*>(context))(state);
+        }
+        template<typename Error>
+        static void* toContext(Error const& error)
+        {
+            return const_cast<void*>(static_cast<void const*>(&error));
+        }
+
+        // Copies of the std::function error callbacks of the split cyclic API, alive until the datagrams are processed
+        // (see setLogicalErrorCallbacks())
+        std::function<void(DatagramState const&)> logical_read_error_;
+        std::function<void(DatagramState const&)> logical_write_error_;
+        std::function<void(DatagramState const&)> logical_read_write_error_;
+        std::function<void(DatagramState const&)> drift_error_;
+
+        // Context of the cyclic drift compensation datagram
+        struct DriftHandler
+        {
+            Bus* bus{nullptr};
+            AbstractLink::ErrorCallback error{nullptr};
+            void* error_context{nullptr};
         };
+        DriftHandler drift_handler_{};
+        static DatagramState captureReferenceTime(void* context, DatagramHeader const*, uint8_t const* data, uint16_t wkc);
+        static void driftError(void* context, DatagramState const& state);
+        bool isDue(PIFrame const& pi_frame) const;
+        bool isBitPacked(Slave const& slave) const;
+
         std::vector<PIFrame> pi_frames_; // PI frame description
+        uint64_t cycle_{0};              // logical exchange cycles since the mapping
+        nanoseconds cycle_period_{0};    // 0: unknown
+        nanoseconds watchdog_{0};        // PDIO watchdog set by init(), 0: disabled
 
         nanoseconds tiny_wait{200us};
         nanoseconds big_wait{10ms};
 
         uint16_t irq_mask_{0};
 
+        bool event_driven_state_wait_{false};
+        nanoseconds state_poll_period_{1ms};
+
         Slave* dc_slave_{nullptr};
         uint64_t last_ref_system_time_{0};     // reference 0x0910 from the last cyclic FRMW
         mutable bool last_ref_time_valid_{false};  // mutable: sync() consumes it (one sample, one use)
 
+        int32_t static_drift_iterations_{15000};
+        nanoseconds static_drift_threshold_{100ns};
+        int32_t static_drift_check_period_{1000};
+        StaticDriftReport static_drift_report_{};
+
         MailboxStatusFMMU mailbox_status_fmmu_{MailboxStatusFMMU::NONE};
 
+        // Mailboxes exchanged with logical datagrams (see configureLogicalMailboxes()), in logical address order
+        struct LogicalMailbox
+        {
+            Slave*   slave;
+            uint32_t address;   // logical address
+            uint16_t size;
+        };
+        std::vector<LogicalMailbox> logical_read_mailboxes_;   // SM1: slave to master
+        std::vector<LogicalMailbox> logical_write_mailboxes_;  // SM0: master to slave
+        bool bit_packed_mapping_{false};
+
         mailbox::response::Mailbox* master_mailbox_{nullptr};
+        SIICache* sii_cache_{nullptr};
     };
 
     /**
      * @brief Configure a slave PDO mapping
+     * @details With one complete access SDO per record (mapping then assignment) when the slave SII declares complete
+     *          access support, subindex by subindex otherwise.
      * @param bus           EtherCAT bus to use for SDO transfers
      * @param slave         Slave to configure
      * @param pdo_map       PDO mapping index (e.g. 0x1A00 for TxPDO, 0x1600 for RxPDO)
@@ -0,0 +1,45 @@
+#ifndef KICKCAT_BUS_SNAPSHOT_H
+#define KICKCAT_BUS_SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "kickcat/protocol.h"
+
+namespace kickcat
+{
+    /// \brief Configuration of a bus, as discovered by Bus::init() and Bus::createMapping().
+    /// \details Taken with Bus::snapshot() and given back to Bus::init(snapshot) on the next start: the slaves are then
+    ///          configured from it instead of being discovered (no SII download, no PDO mapping discovery).
+    ///          File format: "KBUS" magic, u32 version, u32 slave count, u8 mapped, then for each slave its address,
+    ///          ESC description, input and output mapping (i32 sync manager, i32 size in bits), u32 SII size and SII image.
+    struct BusSnapshot
+    {
+        struct Mapping
+        {
+            int32_t sync_manager{0};
+            int32_t size{0};            // bits
+        };
+
+        struct SlaveConfig
+        {
+            uint16_t address{0};
+            ESC::Description esc{};
+            Mapping input{};
+            Mapping output{};
+            std::vector<uint8_t> sii;   // SII image (eeprom::SII::serialize())
+        };
+
+        std::vector<SlaveConfig> slaves;
+        bool mapped{false};             // taken after createMapping(): the mappings are valid
+
+        /// \brief Write the snapshot file. Throw on I/O error.
+        void save(std::string const& path) const;
+
+        /// \brief Read a snapshot file. Throw if it does not exist or is corrupted.
+        static BusSnapshot load(std::string const& path);
+    };
+}
+
+#endif
@@ -2,14 +2,15 @@
 #define KICKCAT_LINK_H
 
 #include <array>
+#include <exception>
 #include <functional>
 
 #include "kickcat/AbstractLink.h"
+#include "kickcat/AbstractSocket.h"
+#include "kickcat/Ring.h"
 
 namespace kickcat
 {
-    class AbstractSocket;
-
     /// \brief Rebuild a spliced LRW payload in place in data_nominal from the two ring copies.
     /// \details Slaves are attributed to a segment by accumulating their expected contributions
     ///          against the prefix copy's wkc.
@@ -27,12 +28,16 @@ namespace kickcat
         /// \details This class is responsible to handle frames and datagrams on the link layers:
         /// - associate an id to each datagram to call the associate callback later without depending on the read order
         /// - handle link redundancy
+        /// - batch the socket I/O: queued frames are written in one call and the answers drained in one call
+        /// - skip the frame copies on zero-copy sockets: frames are built and dispatched in the socket memory
+        /// - pipeline the cycles on demand: submitCycle() sends a cycle without waiting for its answers
+        /// - wait on both interfaces at once when the sockets support it (see waitForFrames())
         Link(std::shared_ptr<AbstractSocket> socket_nominal,
                        std::shared_ptr<AbstractSocket> socket_redundancy,
                        std::function<void(void)> const& redundancyActivatedCallback,
                        MAC const src_nominal = PRIMARY_IF_MAC,
                        MAC const src_redundancy = SECONDARY_IF_MAC);
-        ~Link() override = default;
+        ~Link() override;
 
         void writeThenRead(Frame& frame) override;
 
@@ -40,6 +45,8 @@ namespace kickcat
         void addDatagram(enum Command command, uint32_t address, void const* data, uint16_t data_size,
                          std::function<DatagramState(DatagramHeader const*, uint8_t const* data, uint16_t wkc)> const& process,
                          std::function<void(DatagramState const& state)> const& error) override;
+        void addDatagram(enum Command command, uint32_t address, void const* data, uint16_t data_size,
+                         ProcessCallback process, ErrorCallback error, void* context) override;
 
         void setLogicalMapping(std::vector<LogicalFrameDescription> const& mapping) override { logical_mapping_ = mapping; }
 
@@ -52,6 +59,35 @@ namespace kickcat
 
         void attachEcatEventCallback(enum EcatEvent event, std::function<void()> callback) override;
 
+        /// Max frames handed to a socket in one batched call: bigger cycles are flushed/drained in several batches
+        static constexpr int32_t MAX_BATCH_FRAMES = 32;
+
+        /// \brief Outcome of a pipelined cycle, posted when its answers have been dispatched
+        struct CycleCompletion
+        {
+            uint32_t cycle;         // id returned by submitCycle()
+            DatagramState status;   // OK, or the state of the first datagram of the cycle that failed
+        };
+        static constexpr int32_t MAX_CYCLES_IN_FLIGHT = 8;
+
+        /// \brief   Send the datagrams queued since the previous cycle without waiting for their answers.
+        /// \details Up to the pipeline depth cycles are kept in flight: when it is reached, the oldest cycle is
+        ///          completed first. The index space is shared, so all the cycles in flight hold 255 datagrams max.
+        /// \return  the cycle id, found back in its CycleCompletion
+        uint32_t submitCycle();
+
+        /// \brief   Wait for the answers of the oldest cycle in flight, dispatch them and post its completion.
+        /// \details Datagram callbacks are called as with processDatagrams(), which completes every cycle in flight.
+        /// \return  false if there was no cycle in flight
+        bool completeCycle();
+
+        /// \return false if the completion queue is empty. It keeps the latest completions if nobody pops them.
+        bool popCompletion(CycleCompletion& completion);
+
+        /// \brief Number of cycles submitCycle() keeps in flight, 1 to MAX_CYCLES_IN_FLIGHT (default 1)
+        void setPipelineDepth(int32_t depth);
+        int32_t cyclesInFlight() const { return static_cast<int32_t>(cycles_head_ - cycles_tail_); }
+
     private:
         uint8_t index_queue_{0};
         uint8_t index_head_{0};
@@ -64,12 +100,19 @@ namespace kickcat
             return static_cast<uint8_t>(index - index_queue_) >= in_flight;
         }
 
+        // Callbacks are always called through the function pointers. The std::function overload of addDatagram()
+        // stores the functions in the slot and points to trampolines that call them back with the slot as context.
         struct Callbacks
         {
             DatagramState status{DatagramState::LOST};
-            std::function<DatagramState(DatagramHeader const*, uint8_t const* data, uint16_t wkc)> process; // Shall not throw exception.
-            std::function<void(DatagramState const& state)> error; // May throw exception.
+            ProcessCallback process{nullptr};   // Shall not throw exception.
+            ErrorCallback error{nullptr};       // May throw exception.
+            void* context{nullptr};
+
+            std::function<DatagramState(DatagramHeader const*, uint8_t const* data, uint16_t wkc)> process_function;
+            std::function<void(DatagramState const& state)> error_function;
         };
+        void queueDatagram(enum Command command, uint32_t address, void const* data, uint16_t data_size);
         std::array<Callbacks, 256> callbacks_{};
 
         std::vector<LogicalFrameDescription> logical_mapping_{}; // Empty: command-based default merge.
@@ -82,8 +125,30 @@ namespace kickcat
         std::array<IRQ, 16> irqs_{};
 
 
-        void read() ;
-        void sendFrame() ;
+        // One cycle of datagrams: [first, end) index range and the frames that carry it
+        struct Cycle
+        {
+            uint32_t id{0};
+            uint8_t  first{0};
+            uint8_t  end{0};
+            int32_t  frames{0};     // frames sent
+            int32_t  received{0};   // answers already dispatched while completing an older cycle
+            uint16_t irq{0};        // aggregated IRQ feedbacks
+            bool     notify{false}; // post a CycleCompletion (pipelined cycle)
+        };
+
+        uint32_t commitCycle(bool notify);
+        void completeCycle(std::exception_ptr& client_exception);
+        Cycle* cycleOf(uint8_t index);
+        Cycle* dispatchFrame(int32_t pair, bool& desynchronized);
+
+        int32_t read(int32_t count);
+        int32_t readMultiplexed(int32_t count);
+        int32_t readBatch(AbstractSocket& socket, std::vector<Frame>& frames, int32_t first, int32_t count,
+                          nanoseconds timeout, int32_t& lent);
+        void releaseFrames(AbstractSocket& socket, std::vector<Frame>& frames, int32_t& lent);
+        void queueFrame();
+        void sendFrames();
         bool isDatagramAvailable() ;
         std::tuple<DatagramHeader const*, uint8_t*, uint16_t> nextDatagram(bool& dropped_pair) ;
         void addDatagramToFrame(uint8_t index, enum Command command, uint32_t address, void const* data, uint16_t data_size) ;
@@ -96,10 +161,48 @@ namespace kickcat
         std::shared_ptr<AbstractSocket> socket_nominal_;
         std::shared_ptr<AbstractSocket> socket_redundancy_;
 
-        Frame frame_nominal_{};
-        MAC src_nominal_;
+        // Frames are built in tx_frames_[tx_queued_] and queued until the next flush. Answers are received in
+        // dedicated frames, so that the next cycle can be built while the previous one is dispatched. All grow on
+        // demand up to MAX_BATCH_FRAMES: steady-state cycles do not allocate.
+        std::vector<Frame> tx_frames_;
+        std::vector<Frame> rx_from_nominal_;
+        std::vector<Frame> rx_from_redundancy_;
+        std::array<int32_t, MAX_BATCH_FRAMES> tx_sizes_{};     // bytes to write for each queued frame
+        std::array<uint8_t, MAX_BATCH_FRAMES> tx_datagrams_{}; // datagrams in each queued frame (send error report)
+        int32_t tx_queued_{0};
+        std::array<SocketBuffer, MAX_BATCH_FRAMES> io_buffers_{}; // wire view of the frames for the batched calls
+
+        // Zero-copy sockets: the first frames of the vectors may be attached to buffers lent by the socket they were
+        // read from, until the end of the dispatch round. TX frames may be attached to nominal socket buffers.
+        int32_t lent_redundancy_{0};    // rx_from_redundancy_ lent by socket_redundancy_
+        int32_t lent_nominal_{0};       // rx_from_nominal_ lent by socket_nominal_
+
+        // Multiplexed read (see waitForFrames()): disabled on the first socket that does not support it
+        bool multiplexed_read_{true};
+        std::array<bool, 2> path_answering_{true, true}; // nominal and redundancy paths answered the last read
+
+        // Cycles in flight, oldest at cycles_tail_. At least one more slot than the pipeline: processDatagrams()
+        // commits its own cycle on top of a full pipeline. A power of two, so that the slot sequence stays
+        // continuous when the counters wrap.
+        static constexpr uint32_t CYCLE_SLOTS = 16;
+        static_assert((CYCLE_SLOTS & (CYCLE_SLOTS - 1)) == 0, "cycle slots shall be a power of two");
+        static_assert(CYCLE_SLOTS > MAX_CYCLES_IN_FLIGHT, "no cycle slot for processDatagrams()");
+        Cycle& cycleSlot(uint32_t counter) { return cycles_[counter & (CYCLE_SLOTS - 1)]; }
+        std::array<Cycle, CYCLE_SLOTS> cycles_{};
+        uint32_t cycles_head_{0};
+        uint32_t cycles_tail_{0};
+        Cycle building_{};              // answers received before the cycle being built is committed
+        uint32_t next_cycle_id_{0};
+        int32_t pipeline_depth_{1};
+
+        Ring<CycleCompletion, 16>::Context completions_context_{};
+        Ring<CycleCompletion, 16> completions_{completions_context_};
+
+        // Frames of the pair being dispatched (see read() for the crossover)
+        Frame* frame_nominal_{nullptr};
+        Frame* frame_redundancy_{nullptr};
 
-        Frame frame_redundancy_{};
+        MAC src_nominal_;
         MAC src_redundancy_;
 
         nanoseconds timeout_{2ms};
@@ -0,0 +1,152 @@
+#ifndef KICKCAT_SDO_BATCH_H
+#define KICKCAT_SDO_BATCH_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Bus.h"
+
+namespace kickcat
+{
+    /// \brief Non-blocking SDO transfers, batched across the slaves of a bus.
+    ///
+    /// Unlike Bus::readSDO()/writeSDO(), queuing a transfer returns immediately with a handle on it.
+    /// The transfers are queued per slave and keep one SDO in the slave mailbox at a time (in queuing
+    /// order: a sequence of writes to one slave is applied as written), but all the slaves progress
+    /// together: a batch of N transfers spread over M slaves takes about N / M mailbox rounds instead of N.
+    ///
+    /// The transfers ride on the mailbox operations of the application loop (Bus::checkMailboxes() and
+    /// Bus::processMessages(), or a MailboxSequencer): update() shall be called after them to complete
+    /// the transfers that are over and to start the next ones. wait() is the blocking shortcut.
+    ///
+    /// A failed transfer cancels the transfers queued after it on the same slave: they complete with
+    /// MessageStatus::CANCELLED without being sent.
+    ///
+    /// \code
+    ///   SDOBatch batch(bus);
+    ///   for (auto& slave : bus.slaves())
+    ///   {
+    ///       batch.write(slave, 0x6060, 0, Bus::Access::PARTIAL, &mode, sizeof(mode));
+    ///   }
+    ///   auto serial = batch.read(bus.slaves().at(0), 0x1018, 4, Bus::Access::PARTIAL, &value, sizeof(value));
+    ///
+    ///   while (not batch.done())
+    ///   {
+    ///       bus.sendLogicalRead(error);
+    ///       bus.sendLogicalWrite(error);
+    ///       sequencer.step(error);
+    ///       bus.finalizeDatagrams();
+    ///       bus.processAwaitingFrames();
+    ///       batch.update();
+    ///   }
+    /// \endcode
+    class SDOBatch
+    {
+    public:
+        class Transfer
+        {
+        public:
+            /// \return mailbox::request::MessageStatus value or CoE abort code
+            uint32_t status() const { return status_; }
+            bool done() const { return status_ != mailbox::request::MessageStatus::RUNNING; }
+
+            /// \return bytes uploaded (read) or downloaded (write) once the transfer succeeded
+            uint32_t size() const { return size_; }
+
+            Slave&   slave() const    { return *slave_;   }
+            uint16_t index() const    { return index_;    }
+            uint8_t  subindex() const { return subindex_; }
+            bool     isRead() const   { return request_ == CoE::SDO::request::UPLOAD; }
+
+        private:
+            friend class SDOBatch;
+            using Callback = std::function<void(Transfer const&)>;
+
+            void start(nanoseconds timeout);
+            bool advance(nanoseconds timeout); // return true when the transfer is over
+            void complete(uint32_t status);
+
+            Slave*   slave_{nullptr};
+            uint16_t index_{0};
+            uint8_t  subindex_{0};
+            Bus::Access access_{Bus::Access::PARTIAL};
+            uint8_t  request_{CoE::SDO::request::UPLOAD};
+            uint8_t* data_{nullptr};
+            uint32_t capacity_{0};
+            std::vector<uint8_t> payload_; // write: copy of the client data, sent later
+            Callback on_completion_;
+
+            std::shared_ptr<mailbox::request::AbstractMessage> sdo_;
+            uint32_t status_{mailbox::request::MessageStatus::RUNNING};
+            uint32_t size_{0};
+            uint32_t chunk_{0};    // size of the SDO in flight
+
+            // emulated complete access
+            int32_t count_{0};      // subindex 0
+            uint8_t current_{0};    // subindex in flight
+        };
+
+        using Handle = std::shared_ptr<Transfer const>;
+        using Callback = Transfer::Callback;
+
+        /// \param bus      Bus owning the slaves
+        /// \param timeout  Per SDO timeout: an emulated complete access takes one SDO per subindex
+        SDOBatch(Bus& bus, nanoseconds timeout = 1s);
+
+        /// \brief Drop the transfers not over yet: their SDO in flight points into them and the client buffers,
+        ///        it is cancelled in the slave mailbox. The handles complete with MessageStatus::CANCELLED.
+        ~SDOBatch();
+
+        SDOBatch(SDOBatch const&) = delete;
+        SDOBatch& operator=(SDOBatch const&) = delete;
+
+        /// \brief Queue an upload
+        /// \param data             Client buffer: shall outlive the transfer
+        /// \param data_size        Client buffer size
+        /// \param on_completion    Called by update() when the transfer is over (optional)
+        Handle read(Slave& slave, uint16_t index, uint8_t subindex, Bus::Access CA, void* data, uint32_t data_size,
+                    Callback on_completion = {});
+
+        /// \brief Queue a download. The data is copied: the client buffer may be released on return.
+        /// \note  Emulated complete access is not supported for write (as Bus::writeSDO()).
+        Handle write(Slave& slave, uint16_t index, uint8_t subindex, Bus::Access CA, void const* data, uint32_t data_size,
+                     Callback on_completion = {});
+
+        /// \brief Complete the transfers that are over (handles and callbacks) and start the next ones.
+        ///        Call it after the mailbox operations of the loop.
+        /// \return number of transfers completed
+        int32_t update();
+
+        /// \return true when every queued transfer is over
+        bool done() const;
+
+        /// \brief Run the mailbox loop until every queued transfer is over.
+        /// \details Throw an error for the first transfer that failed since the previous wait(), if any:
+        ///          the other ones are over anyway and their handles remain valid.
+        void wait();
+
+    private:
+        struct Queue
+        {
+            Slave* slave;
+            std::deque<std::shared_ptr<Transfer>> transfers; // front: in flight
+        };
+
+        Handle enqueue(std::shared_ptr<Transfer> transfer);
+        void cancel(Queue& queue);
+
+        Bus& bus_;
+        nanoseconds timeout_;
+        std::deque<Queue> queues_; // deque: a completion callback may queue a new slave while update() walks them
+        std::shared_ptr<Transfer const> failed_; // first failed transfer since the last wait()
+    };
+
+
+    /// \brief Queue the configuration of a slave PDO mapping in a batch (see mapPDO() for the parameters):
+    ///        the mapping of several slaves may then be downloaded at once.
+    void mapPDO(SDOBatch& batch, Slave& slave, uint16_t pdo_map, uint32_t const* mapping, uint8_t mapping_count, uint16_t sm_map);
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef KICKCAT_SII_CACHE_H
+#define KICKCAT_SII_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace kickcat
+{
+    /// \brief On-disk cache of slave SII images, keyed by the slave identity.
+    /// \details The key is read from the SII header (vendor id, product code, revision and serial number).
+    ///          A cached image is only used if its whole header (configuration area, checksum and identity)
+    ///          matches the one read on the slave: Bus::fetchEeprom() then reads the header only.
+    ///          File format: "KSII" magic, u32 version, then for each image a u32 size and the image bytes.
+    class SIICache
+    {
+    public:
+        static constexpr uint32_t HEADER_SIZE = 32; // bytes - SII words 0x00 to 0x0F
+        static constexpr uint32_t MAX_IMAGE_SIZE = 65536 * 1024 / 8; // bytes - SII EEPROM size word: up to 64 Mbit
+
+        /// \param path  Cache file. It is loaded if it exists: a corrupted file gives an empty cache.
+        SIICache(std::string path);
+
+        /// \param header  First HEADER_SIZE bytes of a slave SII
+        /// \return the cached image of this slave, nullptr if unknown or if the header does not match
+        std::vector<uint8_t> const* find(uint8_t const* header) const;
+
+        /// \brief Add or replace the image of a slave (the cache is saved by save() only).
+        void store(std::vector<uint8_t> image);
+
+        /// \brief Write the cache file if it changed since the last load/save. Throw on I/O error.
+        void save();
+
+        int32_t size() const { return static_cast<int32_t>(images_.size()); }
+        std::string const& path() const { return path_; }
+
+    private:
+        using Identity = std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>; // vendor, product, revision, serial
+        static Identity identity(uint8_t const* header);
+
+        void load();
+
+        std::string path_;
+        std::map<Identity, std::vector<uint8_t>> images_;
+        bool dirty_{false};
+    };
+}
+
+#endif
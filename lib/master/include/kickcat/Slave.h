@@ -77,12 +77,29 @@ namespace kickcat
             int32_t bsize{0};         // size of the mapping (in bytes)
             int32_t sync_manager{0};  // associated Sync manager
             uint32_t address{0};      // logical address
+            uint8_t bit_offset{0};    // first bit of the mapping in data[0] and at the logical address (bit-packed mapping)
+
+            // Bit accessors, whatever the mapping alignment: index 0 is the first bit of the mapping
+            bool bit(int32_t index) const;
+            void setBit(int32_t index, bool value);
         };
         // set it to true to let user define the mapping, false to autodetect it
-        // If set to true, user shall set input and output mapping bsize and sync_manager members.
+        // If set to true, user shall set input and output mapping bsize and sync_manager members (and size, in bits,
+        // for a sub-byte image to be bit-packed).
         bool is_static_mapping{false};
         PIMapping input{};  // slave to master
         PIMapping output{};
+        // Exchange the PI once every cycle_divisor logical cycles. Slaves sharing a divisor are packed in their
+        // own frames by createMapping(): set it before the mapping.
+        // The slow frames also carry:
+        // - the mailbox status FMMU bits of their slaves: mailbox.can_read/can_write are refreshed every N cycles only.
+        // - the output writes that trigger the SM watchdog: it trips if N x cycle exceeds the watchdog of init()
+        //   (100 ms by default). createMapping() rejects such a divisor when the cycle period is known
+        //   (see Bus::configureCyclePeriod()).
+        int32_t cycle_divisor{1};
+
+        // Mailbox exchanged with LRD/LWR instead of FPRD/FPWR (see Bus::configureLogicalMailboxes())
+        bool is_logical_mailbox{false};
 
         ErrorCounters error_counters{};
         int previous_errors_sum{0};
@@ -0,0 +1,47 @@
+#ifndef KICKCAT_STATE_FILE_H
+#define KICKCAT_STATE_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace kickcat
+{
+    /// \brief Binary files the master keeps between two starts (SIICache, BusSnapshot).
+    namespace state_file
+    {
+        struct Closer
+        {
+            void operator()(std::FILE* file) const { std::fclose(file); }
+        };
+
+        /// \brief A file closed on every path, errors and allocation failures included.
+        using File = std::unique_ptr<std::FILE, Closer>;
+
+        /// \return the file opened for reading, nullptr if it cannot be opened (errno is set)
+        File open(std::string const& path);
+
+        /// \brief Write a file aside, sync it to the storage, then rename it and sync its directory: neither a crash nor
+        ///        a power loss during the save can corrupt the previous file.
+        /// \param write    Fill the file, return false on a write error
+        /// \return 0, or the errno of the failure: the previous file is then left untouched, unless the directory sync
+        ///         failed (the new file is in place but may not survive a power loss)
+        int32_t save(std::string const& path, std::function<bool(std::FILE*)> const& write);
+
+        template<typename T>
+        bool put(std::FILE* file, T const& value)
+        {
+            return std::fwrite(&value, sizeof(T), 1, file) == 1;
+        }
+
+        template<typename T>
+        bool get(std::FILE* file, T& value)
+        {
+            return std::fread(&value, sizeof(T), 1, file) == 1;
+        }
+    }
+}
+
+#endif
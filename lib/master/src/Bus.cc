@@ -6,6 +6,7 @@
 #include "debug.h"
 #include "Bus.h"
 #include "Prints.h"
+#include "SIICache.h"
 
 #include "CoE/mailbox/request.h"
 
@@ -109,6 +110,12 @@ namespace kickcat
         requestState(State::PRE_OP);
         waitForState(State::PRE_OP, 3000ms);
 
+        prepareMailboxes();
+    }
+
+
+    void Bus::prepareMailboxes()
+    {
         // clear mailboxes
         auto error_callback = [](DatagramState const& state){ THROW_ERROR_DATAGRAM("init error while cleaning slaves mailboxes", state); };
         checkMailboxes(error_callback);
@@ -219,7 +226,12 @@ namespace kickcat
 
         sendGetALStatus(slave, error);
         link_->processDatagrams();
+        return decodeALStatus(slave);
+    }
+
 
+    State Bus::decodeALStatus(Slave const& slave)
+    {
         // error indicator flag set: check status code
         if (slave.al_status & 0x10)
         {
@@ -235,6 +247,12 @@ namespace kickcat
 
     void Bus::waitForState(State request, nanoseconds timeout, std::function<void()> background_task)
     {
+        if (event_driven_state_wait_)
+        {
+            waitForStateOnEvents(request, timeout, background_task);
+            return;
+        }
+
         nanoseconds start = now();
 
         while (true)
@@ -265,8 +283,132 @@ namespace kickcat
     }
 
 
+    bool Bus::isStateReached(State request)
+    {
+        // BRD ORs the AL status of every slave
+        uint16_t status = 0;
+        uint16_t answers = 0;
+        bool answered = false;
+        auto process = [&](DatagramHeader const*, uint8_t const* data, uint16_t wkc)
+        {
+            std::memcpy(&status, data, sizeof(status));
+            answers = wkc;
+            answered = true;
+            return DatagramState::OK;
+        };
+        auto error = [](DatagramState const& state)
+        {
+            bus_error("Error while trying to get the bus state (%s).\n", toString(state));
+        };
+        link_->addDatagram(Command::BRD, createAddress(0, reg::AL_STATUS), nullptr, sizeof(status), process, error);
+        link_->processDatagrams();
+
+        bool const single_state = (request & (request - 1)) == 0; // BOOT (0x3) is the OR of INIT and PRE_OP
+        if (answered and (answers == slaves_.size()) and single_state and not (status & AL_STATUS_ERR_IND))
+        {
+            return (status & 0xF) == request;
+        }
+
+        // inconclusive: read every slave in one go
+        auto slave_error = [](DatagramState const& state)
+        {
+            bus_error("Error while trying to get slave state (%s).\n", toString(state));
+        };
+        std::size_t queued = 0;
+        for (auto& slave : slaves_)
+        {
+            reserveDatagrams(queued, 1);
+            sendGetALStatus(slave, slave_error);
+        }
+        link_->processDatagrams();
+
+        bool is_state_reached = true;
+        for (auto& slave : slaves_)
+        {
+            if (decodeALStatus(slave) != request)
+            {
+                is_state_reached = false;
+            }
+        }
+        return is_state_reached;
+    }
+
+
+    void Bus::waitForStateOnEvents(State request, nanoseconds timeout, std::function<void()> const& background_task)
+    {
+        // A slave raises the AL status event on every state change, until its AL status is read: the IRQ field of
+        // the background task frames tells when to check again. A client callback on this event is left untouched.
+        bool al_event = true; // check right away
+        bool const own_event = not (irq_mask_ & EcatEvent::AL_STATUS);
+        if (own_event)
+        {
+            link_->attachEcatEventCallback(EcatEvent::AL_STATUS, [&al_event]() { al_event = true; });
+            uint16_t mask = irq_mask_ | EcatEvent::AL_STATUS;
+            broadcastWrite(reg::ECAT_EVENT_MASK, &mask, sizeof(mask));
+        }
+
+        auto restore = [this, own_event]()
+        {
+            if (own_event)
+            {
+                link_->attachEcatEventCallback(EcatEvent::AL_STATUS, [](){});
+                broadcastWrite(reg::ECAT_EVENT_MASK, &irq_mask_, sizeof(irq_mask_));
+            }
+        };
+
+        try
+        {
+            nanoseconds start = now();
+            nanoseconds last_check = start;
+            while (true)
+            {
+                background_task();
+
+                if (al_event or (elapsed_time(last_check) >= state_poll_period_))
+                {
+                    al_event = false;
+                    last_check = now();
+                    if (isStateReached(request))
+                    {
+                        break;
+                    }
+                }
+                else
+                {
+                    sleep(tiny_wait);
+                }
+
+                if (elapsed_time(start) > timeout)
+                {
+                    THROW_ERROR("Timeout");
+                }
+            }
+        }
+        catch (...)
+        {
+            // The wait error is the one reported: a failure to restore the event mask is only logged
+            try
+            {
+                restore();
+            }
+            catch (std::exception const& e)
+            {
+                bus_error("Cannot restore the ECAT event mask: %s\n", e.what());
+            }
+            catch (...)
+            {
+                bus_error("Cannot restore the ECAT event mask\n");
+            }
+            throw;
+        }
+        restore();
+    }
+
+
     void Bus::resetSlaves(nanoseconds watchdog)
     {
+        watchdog_ = watchdog;
+
         // buffer to reset them all
         uint8_t param[256];
         std::memset(param, 0, sizeof(param));
@@ -316,6 +458,7 @@ namespace kickcat
             THROW_ERROR_DATAGRAM("Error while fetching Slave ESC description", state);
         };
 
+        std::size_t queued = 0;
         for (auto& slave : slaves_)
         {
             auto process = [this, &slave](DatagramHeader const*, uint8_t const* data, uint16_t wkc)
@@ -328,6 +471,7 @@ namespace kickcat
                 return DatagramState::OK;
             };
 
+            reserveDatagrams(queued, 1);
             link_->addDatagram(Command::FPRD, createAddress(slave.address, reg::TYPE), nullptr, sizeof(ESC::Description), process, error);
         }
         link_->processDatagrams();
@@ -341,8 +485,10 @@ namespace kickcat
             THROW_ERROR_DATAGRAM("Error fetching DL status", state);
         };
 
+        std::size_t queued = 0;
         for (auto& slave : slaves_)
         {
+            reserveDatagrams(queued, 1);
             sendGetDLStatus(slave, error);
         }
         processAwaitingFrames();
@@ -401,12 +547,14 @@ namespace kickcat
             THROW_ERROR("Invalid working counter");
         };
 
+        std::size_t queued = 0;
         for (auto& slave : slaves_)
         {
             if (slave.sii.info.mailbox_protocol)
             {
                 SyncManager::Register SM[2];
                 slave.mailbox.generateSMConfig(SM);
+                reserveDatagrams(queued, 1);
                 link_->addDatagram(Command::FPWR, createAddress(slave.address, reg::SYNC_MANAGER), SM, process, error);
             }
         }
@@ -429,56 +577,26 @@ namespace kickcat
         };
 
         // Determines PI sizes for each slave
+        std::vector<Slave*> coe_slaves;
         for (auto& slave : slaves_)
         {
             if (slave.is_static_mapping)
             {
-                slave.input.size  = slave.input.bsize  * 8;
-                slave.output.size = slave.output.bsize * 8;
+                // keep a bit size given by the user when it matches the byte size
+                for (auto* mapping : {&slave.input, &slave.output})
+                {
+                    if (bits_to_bytes(mapping->size) != mapping->bsize)
+                    {
+                        mapping->size = mapping->bsize * 8;
+                    }
+                }
                 continue;
             }
 
             if (slave.sii.info.mailbox_protocol& eeprom::MailboxProtocol::CoE)
             {
-                // Slave support CAN over EtherCAT -> use mailbox/SDO to get mapping size
-                uint8_t sm[512];
-                uint32_t sm_size = sizeof(sm);
-                readSDO(slave, CoE::SM_COM_TYPE, 1, Access::EMULATE_COMPLETE, sm, &sm_size);
-
-                for (uint32_t i = 0; i < sm_size; ++i)
-                {
-                    //TODO we support only one input and one output per slave for now
-                    if (sm[i] <= 2) // mailboxes
-                    {
-                        continue;
-                    }
-
-                    Slave::PIMapping* mapping = &slave.input;
-                    if (sm[i] == SyncManager::Output)
-                    {
-                        mapping = &slave.output;
-                    }
-                    mapping->sync_manager = i;
-                    mapping->size = 0;
-
-                    uint16_t mapped_index[128];
-                    uint32_t map_size = sizeof(mapped_index);
-                    readSDO(slave, CoE::SM_CHANNEL + static_cast<uint16_t>(i), 1, Access::EMULATE_COMPLETE, mapped_index, &map_size);
-
-                    for (uint32_t j = 0; j < (map_size / 2); ++j)
-                    {
-                        uint8_t object[512];
-                        uint32_t object_size = sizeof(object);
-                        readSDO(slave, mapped_index[j], 1, Access::EMULATE_COMPLETE, object, &object_size);
-
-                        for (uint32_t k = 0; k < object_size; k += 4)
-                        {
-                            mapping->size += object[k];
-                        }
-                    }
-
-                    mapping->bsize = bits_to_bytes(mapping->size);
-                }
+                // Slave support CAN over EtherCAT -> use mailbox/SDO to get mapping size (all slaves at once, below)
+                coe_slaves.push_back(&slave);
             }
             else
             {
@@ -513,6 +631,8 @@ namespace kickcat
                 siiMapping(&slave.input,  slave.sii.TxPDO, SyncManager::Input);
             }
         }
+
+        detectCoEMapping(coe_slaves);
     }
 
 
@@ -537,10 +657,15 @@ namespace kickcat
                 continue;
             }
 
-            if (slave.esc.fmmus < required_fmmus)
+            uint8_t slave_fmmus = required_fmmus;
+            if (slave.is_logical_mailbox)
+            {
+                slave_fmmus += 2;
+            }
+            if (slave.esc.fmmus < slave_fmmus)
             {
                 bus_error("Slave %d has %d FMMUs, need %d for requested mailbox status FMMU mode\n",
-                    slave.address, slave.esc.fmmus, required_fmmus);
+                    slave.address, slave.esc.fmmus, slave_fmmus);
                 THROW_ERROR("Insufficient FMMUs for mailbox status mapping");
             }
         }
@@ -549,6 +674,109 @@ namespace kickcat
     }
 
 
+    void Bus::configureLogicalMailboxes(std::vector<Slave*> const& slaves, uint32_t logical_address)
+    {
+        // PDO FMMUs, mailbox status FMMUs then the two mailbox ones
+        uint8_t required_fmmus = 4;
+        if (mailbox_status_fmmu_ & MailboxStatusFMMU::READ_CHECK)
+        {
+            ++required_fmmus;
+        }
+        if (mailbox_status_fmmu_ & MailboxStatusFMMU::WRITE_CHECK)
+        {
+            ++required_fmmus;
+        }
+
+        for (auto const* slave : slaves)
+        {
+            if (slave->sii.info.mailbox_protocol == 0)
+            {
+                bus_error("Slave %d has no mailbox\n", slave->address);
+                THROW_ERROR("Logical mailbox requested for a slave without mailbox");
+            }
+            if (slave->esc.fmmus < required_fmmus)
+            {
+                bus_error("Slave %d has %d FMMUs, need %d for logical mailboxes\n",
+                    slave->address, slave->esc.fmmus, required_fmmus);
+                THROW_ERROR("Insufficient FMMUs for logical mailbox mapping");
+            }
+            if ((slave->mailbox.send_size > MAX_ETHERCAT_PAYLOAD_SIZE) or (slave->mailbox.recv_size > MAX_ETHERCAT_PAYLOAD_SIZE))
+            {
+                THROW_ERROR("Logical mailbox bigger than a frame");
+            }
+        }
+
+        auto process = [](DatagramHeader const*, uint8_t const*, uint16_t wkc)
+        {
+            if (wkc != 1)
+            {
+                return DatagramState::INVALID_WKC;
+            }
+            return DatagramState::OK;
+        };
+
+        auto error = [](DatagramState const& state)
+        {
+            THROW_ERROR_DATAGRAM("Invalid working counter while programming logical mailbox FMMU", state);
+        };
+
+        // Read mailboxes first, then write ones: each direction is a contiguous run of mailboxes
+        logical_read_mailboxes_.clear();
+        logical_write_mailboxes_.clear();
+        uint32_t address = logical_address;
+        for (auto* slave : slaves)
+        {
+            logical_read_mailboxes_.push_back({slave, address, slave->mailbox.send_size});
+            address += slave->mailbox.send_size;
+        }
+        for (auto* slave : slaves)
+        {
+            logical_write_mailboxes_.push_back({slave, address, slave->mailbox.recv_size});
+            address += slave->mailbox.recv_size;
+        }
+
+        auto configureFMMU = [&](LogicalMailbox const& mailbox, uint16_t physical_address, uint8_t type, uint8_t index)
+        {
+            fmmu::Register fmmu;
+            std::memset(&fmmu, 0, sizeof(fmmu::Register));
+            fmmu.logical_address    = mailbox.address;
+            fmmu.length             = mailbox.size;
+            fmmu.logical_start_bit  = 0;
+            fmmu.logical_stop_bit   = 7;
+            fmmu.physical_address   = physical_address;
+            fmmu.physical_start_bit = 0;
+            fmmu.type               = type;
+            fmmu.activate           = 1;
+
+            link_->addDatagram(Command::FPWR,
+                createAddress(mailbox.slave->address, static_cast<uint16_t>(reg::FMMU + index * sizeof(fmmu::Register))),
+                fmmu, process, error);
+
+            bus_info("Mailbox FMMU slave %04x - FMMU%d - logical 0x%08x - physical 0x%04x - %d bytes\n",
+                mailbox.slave->address, index, fmmu.logical_address, physical_address, mailbox.size);
+        };
+
+        std::size_t queued = 0;
+        for (std::size_t i = 0; i < slaves.size(); ++i)
+        {
+            reserveDatagrams(queued, 2); // read and write mailbox FMMUs
+            Slave* slave = slaves[i];
+            configureFMMU(logical_read_mailboxes_[i],  slave->mailbox.send_offset, 1, static_cast<uint8_t>(slave->esc.fmmus - 1));
+            configureFMMU(logical_write_mailboxes_[i], slave->mailbox.recv_offset, 2, static_cast<uint8_t>(slave->esc.fmmus - 2));
+        }
+        link_->processDatagrams();
+
+        for (auto& slave : slaves_)
+        {
+            slave.is_logical_mailbox = false;
+        }
+        for (auto* slave : slaves)
+        {
+            slave->is_logical_mailbox = true;
+        }
+    }
+
+
     void Bus::createMapping(uint8_t* iomap)
     {
         createMapping(iomap, SIZE_MAX);
@@ -557,60 +785,182 @@ namespace kickcat
 
     void Bus::createMapping(uint8_t* iomap, std::size_t iomap_size)
     {
+        if (iomap == nullptr)
+        {
+            THROW_ERROR("createMapping: null iomap (use createMapping() for an in-frame process image)");
+        }
+        buildPIFrames();
+
+        // Validate the client buffer can hold the process image before writing into it.
+        std::size_t required = 0;
+        for (auto const& frame : pi_frames_)
+        {
+            required += blocksSize(frame.inputs);
+            required += blocksSize(frame.outputs);
+        }
+        if (required > iomap_size)
+        {
+            THROW_ERROR("createMapping: iomap buffer too small for the process image");
+        }
+
+        bindProcessImage(iomap);
+    }
+
+
+    std::size_t Bus::blocksSize(std::vector<blockIO> const& blocks)
+    {
+        // Bit-packed neighbours (consecutive block IO at the same frame offset) share their byte
+        std::size_t size = 0;
+        for (std::size_t i = 0; i < blocks.size(); ++i)
+        {
+            if ((i == 0) or (blocks[i].offset != blocks[i - 1].offset))
+            {
+                size += static_cast<std::size_t>(blocks[i].size);
+            }
+        }
+        return size;
+    }
+
+
+    void Bus::createMapping()
+    {
+        buildPIFrames();
+        bindProcessImage(nullptr);
+    }
+
+
+    void Bus::buildPIFrames()
+    {
+        for (auto const& slave : slaves_)
+        {
+            if (slave.cycle_divisor < 1)
+            {
+                THROW_ERROR("createMapping: a slave cycle divisor shall be at least 1");
+            }
+        }
+
         // First we need to know:
         // - how many bits to map per slave
         // - which SM to use
         // - logical offset in the frame
         detectMapping();
 
+        // The outputs of a slow frame trigger the SM watchdog once every 'divisor' cycles only
+        if ((watchdog_ > 0ns) and (cycle_period_ > 0ns))
+        {
+            for (auto const& slave : slaves_)
+            {
+                if ((slave.output.bsize > 0) and ((slave.cycle_divisor * cycle_period_) > watchdog_))
+                {
+                    bus_error("Slave %d: cycle divisor %" PRIi32 " exceeds the SM watchdog\n", slave.address, slave.cycle_divisor);
+                    THROW_ERROR("createMapping: a slave cycle divisor period exceeds the SM watchdog");
+                }
+            }
+        }
+
         // Second step: create 'block I/O' lists for read and write op
         // Note A: offset computing will overlap input and output in the frame (better density and compatibility, more works for master)
         // Note B: a frame cannot handle more than 1486 bytes
         // Full reset: a previous mapping would otherwise leak its block IO lists into this one.
         pi_frames_.clear();
         pi_frames_.push_back(PIFrame{});
+        cycle_ = 0;
         pi_frames_[0].description.address = 0;
         std::vector<std::vector<Slave*>> frame_mbx_slaves(1);
         uint32_t address = 0;
-        for (auto& slave : slaves_)
-        {
-            // get the biggest one.
-            int32_t size = std::max(slave.input.bsize, slave.output.bsize);
-            if ((address + size) > (pi_frames_.size() * MAX_ETHERCAT_PAYLOAD_SIZE)) // do we overflow current frame ?
-            {
-                auto& desc = pi_frames_.back().description;
-                desc.logical_size = address - desc.address; // frame size = current address - frame address
+        uint8_t  packed_bit = 0; // next free bit in the byte before address, 0 when there is none
+        auto nextFrame = [&](int32_t divisor)
+        {
+            packed_bit = 0;
+            auto& desc = pi_frames_.back().description;
+            desc.logical_size = address - desc.address; // frame size = current address - frame address
+
+            address = static_cast<uint32_t>(pi_frames_.size()) * MAX_ETHERCAT_PAYLOAD_SIZE;
+            PIFrame new_frame{};
+            new_frame.description.address = address;
+            new_frame.divisor = divisor;
+            pi_frames_.push_back(std::move(new_frame));
+            frame_mbx_slaves.push_back({});
+        };
 
-                // current size will overflow the frame at the current offset: set in on the next frame
-                address = static_cast<uint32_t>(pi_frames_.size()) * MAX_ETHERCAT_PAYLOAD_SIZE;
-                PIFrame new_frame{};
-                new_frame.description.address = address;
-                pi_frames_.push_back(std::move(new_frame));
-                frame_mbx_slaves.push_back({});
-            }
+        // Slaves exchanged at the same rate share their frames: one group of frames per cycle divisor,
+        // fastest first, so that a slow slave never inflates a frame sent every cycle.
+        std::vector<int32_t> divisors;
+        for (auto const& slave : slaves_)
+        {
+            divisors.push_back(slave.cycle_divisor);
+        }
+        std::sort(divisors.begin(), divisors.end());
+        divisors.erase(std::unique(divisors.begin(), divisors.end()), divisors.end());
+        if (not divisors.empty())
+        {
+            pi_frames_[0].divisor = divisors.front();
+        }
 
-            // create block IO entries
-            PIFrame& current_frame = pi_frames_.back();
-            if (slave.input.bsize > 0)
+        for (int32_t divisor : divisors)
+        {
+            if (divisor != pi_frames_.back().divisor)
             {
-                current_frame.inputs.push_back ({nullptr, address - current_frame.description.address, slave.input.bsize,  &slave});
+                nextFrame(divisor);
             }
 
-            if (slave.output.bsize > 0)
+            for (auto& slave : slaves_)
             {
-                current_frame.outputs.push_back({nullptr, address - current_frame.description.address, slave.output.bsize, &slave});
-            }
+                if (slave.cycle_divisor != divisor)
+                {
+                    continue;
+                }
 
-            // save mapping offset (need to configure slave FMMU)
-            slave.input.address  = address;
-            slave.output.address = address;
+                // get the biggest one.
+                int32_t size = std::max(slave.input.bsize, slave.output.bsize);
+                int32_t bits = std::max(slave.input.size, slave.output.size);
+                bool packed = isBitPacked(slave);
+                if (packed and (packed_bit != 0) and ((packed_bit + bits) <= 8))
+                {
+                    // share the byte of the previous bit-packed slave
+                    address -= 1;
+                    size = 0;
+                }
+                else
+                {
+                    packed_bit = 0;
+                    if ((address + size) > (pi_frames_.size() * MAX_ETHERCAT_PAYLOAD_SIZE)) // do we overflow current frame ?
+                    {
+                        // current size will overflow the frame at the current offset: set in on the next frame
+                        nextFrame(divisor);
+                    }
+                }
 
-            // update offset
-            address += size;
+                // create block IO entries
+                PIFrame& current_frame = pi_frames_.back();
+                if (slave.input.bsize > 0)
+                {
+                    current_frame.inputs.push_back ({nullptr, address - current_frame.description.address, slave.input.bsize,  &slave});
+                }
 
-            if (slave.sii.info.mailbox_protocol != 0)
-            {
-                frame_mbx_slaves.back().push_back(&slave);
+                if (slave.output.bsize > 0)
+                {
+                    current_frame.outputs.push_back({nullptr, address - current_frame.description.address, slave.output.bsize, &slave});
+                }
+
+                // save mapping offset (need to configure slave FMMU)
+                slave.input.address  = address;
+                slave.output.address = address;
+                slave.input.bit_offset  = packed_bit;
+                slave.output.bit_offset = packed_bit;
+
+                // update offset
+                if (packed)
+                {
+                    packed_bit = static_cast<uint8_t>((packed_bit + bits) % 8);
+                    size = 1;
+                }
+                address += size;
+
+                if (slave.sii.info.mailbox_protocol != 0)
+                {
+                    frame_mbx_slaves.back().push_back(&slave);
+                }
             }
         }
 
@@ -692,6 +1042,12 @@ namespace kickcat
             }
         }
 
+        describePIFrames();
+    }
+
+
+    void Bus::describePIFrames()
+    {
         for (auto& frame : pi_frames_)
         {
             frame.output_buffer.assign(static_cast<size_t>(frame.description.logical_size), 0);
@@ -705,6 +1061,10 @@ namespace kickcat
                 entry.contribution += 1;
                 entry.input_offset = static_cast<int32_t>(bio.offset);
                 entry.input_size = bio.size;
+                if (isBitPacked(*bio.slave))
+                {
+                    entry.input_mask = static_cast<uint8_t>(((1 << bio.slave->input.size) - 1) << bio.slave->input.bit_offset);
+                }
             }
             for (auto const& bio : frame.outputs)
             {
@@ -749,40 +1109,62 @@ namespace kickcat
             descriptions.push_back(frame.description);
         }
         link_->setLogicalMapping(descriptions);
+    }
 
-        // Validate the client buffer can hold the process image before writing into it.
-        std::size_t required = 0;
-        for (auto const& frame : pi_frames_)
-        {
-            for (auto const& bio : frame.inputs)  { required += bio.size; }
-            for (auto const& bio : frame.outputs) { required += bio.size; }
-        }
-        if (required > iomap_size)
-        {
-            THROW_ERROR("createMapping: iomap buffer too small for the process image");
-        }
 
-        // Third step: associate client buffer address to block IO and slaves
-        // Note: inputs are mapped first, outputs second
-        uint8_t* pos = iomap;
-        for (auto& frame : pi_frames_)
+    void Bus::bindProcessImage(uint8_t* iomap)
+    {
+        if (iomap == nullptr)
         {
-            for (auto& bio : frame.inputs)
+            // Third step (in-frame): block IO and slaves point into the PI frames payload. Inputs and outputs share
+            // their logical offsets, hence the two buffers: the next payload to send and the last one received.
+            for (auto& frame : pi_frames_)
             {
-                bio.iomap = pos;
-                bio.slave->input.data = pos;
-                pos += bio.size;
+                frame.input_buffer.assign(static_cast<size_t>(frame.description.logical_size), 0);
+                for (auto& bio : frame.inputs)
+                {
+                    bio.iomap = frame.input_buffer.data() + bio.offset;
+                    bio.slave->input.data = bio.iomap;
+                }
+                for (auto& bio : frame.outputs)
+                {
+                    bio.iomap = frame.output_buffer.data() + bio.offset;
+                    bio.slave->output.data = bio.iomap;
+                }
             }
         }
-        for (auto& frame : pi_frames_)
+        else
         {
-            for (auto& bio : frame.outputs)
+            // Third step: associate client buffer address to block IO and slaves
+            // Note: inputs are mapped first, outputs second. Bit-packed neighbours share their byte.
+            uint8_t* pos = iomap;
+            auto bind = [&pos](std::vector<blockIO>& blocks, Slave::PIMapping Slave::* mapping)
             {
-                bio.iomap = pos;
-                bio.slave->output.data = pos;
-                pos += bio.size;
-            }
+                for (std::size_t i = 0; i < blocks.size(); ++i)
+                {
+                    auto& bio = blocks[i];
+                    if ((i > 0) and (bio.offset == blocks[i - 1].offset))
+                    {
+                        bio.iomap = blocks[i - 1].iomap;
+                    }
+                    else
+                    {
+                        bio.iomap = pos;
+                        pos += bio.size;
+                    }
+                    (bio.slave->*mapping).data = bio.iomap;
+                }
+            };
+            for (auto& frame : pi_frames_)
+            {
+                bind(frame.inputs, &Slave::input);
+            }
+            for (auto& frame : pi_frames_)
+            {
+                bind(frame.outputs, &Slave::output);
+            }
         }
+        compileCyclicProgram();
 
         // Fourth step: program FMMUs and SyncManagers
         configureFMMUs();
@@ -794,133 +1176,277 @@ namespace kickcat
     }
 
 
-    void Bus::sendLogicalRead(std::function<void(DatagramState const&)> const& error)
+    void Bus::compileCyclicProgram()
     {
-        for (auto const& pi_frame : pi_frames_)
+        // Merge the block IO that are contiguous both in the client buffer and in the frame
+        auto coalesce = [](std::vector<blockIO> const& blocks)
         {
-            auto process = [&pi_frame](DatagramHeader const*, uint8_t const* data, uint16_t wkc)
+            std::vector<PIFrame::Copy> copies;
+            for (auto const& bio : blocks)
             {
-				// copy before: a wrong wkc doesn't mean that all data shall be discarded
-                for (auto& input : pi_frame.inputs)
+                if (not copies.empty())
                 {
-                    std::memcpy(input.iomap, data + input.offset, input.size);
+                    auto& last = copies.back();
+                    if ((last.iomap + last.size - 1 == bio.iomap) and (last.offset + last.size - 1 == bio.offset))
+                    {
+                        continue; // bit-packed neighbour: its byte is already moved
+                    }
+                    if ((last.iomap + last.size == bio.iomap) and (last.offset + last.size == bio.offset))
+                    {
+                        last.size += bio.size;
+                        continue;
+                    }
                 }
+                copies.push_back({bio.iomap, bio.offset, bio.size});
+            }
+            return copies;
+        };
 
-                for (auto const& ms : pi_frame.mailbox_read_status)
-                {
-                    ms.slave->mailbox.can_read = (data[ms.byte_offset] >> ms.bit_position) & 1;
-                }
-                for (auto const& ms : pi_frame.mailbox_write_status)
-                {
-                    ms.slave->mailbox.can_write = not ((data[ms.byte_offset] >> ms.bit_position) & 1);
-                }
+        for (auto& frame : pi_frames_)
+        {
+            if (frame.input_buffer.empty())
+            {
+                frame.gather  = coalesce(frame.outputs);
+                frame.scatter = coalesce(frame.inputs);
+            }
+            else
+            {
+                // In-frame process image: outputs are already in place, the answer is kept whole
+                frame.gather.clear();
+                frame.scatter = {{frame.input_buffer.data(), 0, frame.description.logical_size}};
+            }
+            frame.expected_lrd_wkc = static_cast<uint16_t>(frame.inputs.size() + frame.mailbox_status_wkc_read_adjust);
+            frame.expected_lwr_wkc = static_cast<uint16_t>(frame.outputs.size());
 
-                uint16_t expected_wkc = static_cast<uint16_t>(pi_frame.inputs.size() + pi_frame.mailbox_status_wkc_read_adjust);
-                if (wkc != expected_wkc)
-                {
-                    bus_error("Invalid working counter: expected %d, got %d\n", expected_wkc, wkc);
-                    return DatagramState::INVALID_WKC;
-                }
+            // pi_frames_ is not resized until the next createMapping(): the handlers can hold the frame address
+            frame.lrd.frame = &frame;
+            frame.lwr.frame = &frame;
+            frame.lrw.frame = &frame;
+        }
+    }
 
-                return DatagramState::OK;
-            };
 
-            link_->addDatagram(Command::LRD, pi_frame.description.address, nullptr, static_cast<uint16_t>(pi_frame.description.logical_size), process, error);
+    void Bus::scatterInputs(PIFrame const& pi_frame, uint8_t const* data)
+    {
+        for (auto const& input : pi_frame.scatter)
+        {
+            std::memcpy(input.iomap, data + input.offset, input.size);
         }
+
+        for (auto const& ms : pi_frame.mailbox_read_status)
+        {
+            ms.slave->mailbox.can_read = (data[ms.byte_offset] >> ms.bit_position) & 1;
+        }
+        for (auto const& ms : pi_frame.mailbox_write_status)
+        {
+            ms.slave->mailbox.can_write = not ((data[ms.byte_offset] >> ms.bit_position) & 1);
+        }
+    }
+
+
+    DatagramState Bus::processLogicalRead(void* context, DatagramHeader const*, uint8_t const* data, uint16_t wkc)
+    {
+        PIFrame const& pi_frame = *static_cast<PIFrame::Handler*>(context)->frame;
+
+        // copy before: a wrong wkc doesn't mean that all data shall be discarded
+        scatterInputs(pi_frame, data);
+
+        if (wkc != pi_frame.expected_lrd_wkc)
+        {
+            bus_error("Invalid working counter: expected %d, got %d\n", pi_frame.expected_lrd_wkc, wkc);
+            return DatagramState::INVALID_WKC;
+        }
+        return DatagramState::OK;
+    }
+
+
+    DatagramState Bus::processLogicalWrite(void* context, DatagramHeader const*, uint8_t const*, uint16_t wkc)
+    {
+        PIFrame const& pi_frame = *static_cast<PIFrame::Handler*>(context)->frame;
+        if (wkc != pi_frame.expected_lwr_wkc)
+        {
+            bus_error("Invalid working counter: expected %d, got %d\n", pi_frame.expected_lwr_wkc, wkc);
+            return DatagramState::INVALID_WKC;
+        }
+        return DatagramState::OK;
+    }
+
+
+    DatagramState Bus::processLogicalReadWrite(void* context, DatagramHeader const*, uint8_t const* data, uint16_t wkc)
+    {
+        PIFrame const& pi_frame = *static_cast<PIFrame::Handler*>(context)->frame;
+        if (wkc != pi_frame.expected_lrw_wkc)
+        {
+            bus_error("Invalid working counter: expected %d, got %d\n", pi_frame.expected_lrw_wkc, wkc);
+            return DatagramState::INVALID_WKC;
+        }
+
+        scatterInputs(pi_frame, data);
+        return DatagramState::OK;
+    }
+
+
+    void Bus::logicalError(void* context, DatagramState const& state)
+    {
+        auto* handler = static_cast<PIFrame::Handler*>(context);
+        handler->error(handler->error_context, state);
+    }
+
+
+    bool Bus::isBitPacked(Slave const& slave) const
+    {
+        int32_t bits = std::max(slave.input.size, slave.output.size);
+        return bit_packed_mapping_ and (bits > 0) and (bits < 8);
+    }
+
+
+    bool Bus::isDue(PIFrame const& pi_frame) const
+    {
+        return (cycle_ % static_cast<uint64_t>(pi_frame.divisor)) == 0;
     }
 
 
-    void Bus::processDataRead(std::function<void(DatagramState const&)> const& error)
+    void Bus::sendLogicalRead(std::function<void(DatagramState const&)> const& error)
     {
-        sendLogicalRead(error);
+        logical_read_error_ = error;
+        sendLogicalRead();
+    }
+
+
+    void Bus::setLogicalErrorCallbacks(std::function<void(DatagramState const&)> read,
+                                       std::function<void(DatagramState const&)> write,
+                                       std::function<void(DatagramState const&)> read_write)
+    {
+        logical_read_error_       = std::move(read);
+        logical_write_error_      = std::move(write);
+        logical_read_write_error_ = std::move(read_write);
+    }
+
+
+    void Bus::sendLogicalRead()
+    {
+        sendLogicalRead(callError<std::function<void(DatagramState const&)>>, &logical_read_error_);
+    }
+
+
+    void Bus::sendLogicalRead(AbstractLink::ErrorCallback error, void* context)
+    {
+        for (auto& pi_frame : pi_frames_)
+        {
+            if (not isDue(pi_frame))
+            {
+                continue;
+            }
+
+            pi_frame.lrd.error = error;
+            pi_frame.lrd.error_context = context;
+            link_->addDatagram(Command::LRD, pi_frame.description.address, nullptr, static_cast<uint16_t>(pi_frame.description.logical_size),
+                               processLogicalRead, logicalError, &pi_frame.lrd);
+        }
+    }
+
+
+    void Bus::processDataRead(AbstractLink::ErrorCallback error, void* context)
+    {
+        sendLogicalRead(error, context);
         link_->processDatagrams();
     }
 
 
     void Bus::sendLogicalWrite(std::function<void(DatagramState const&)> const& error)
+    {
+        logical_write_error_ = error;
+        sendLogicalWrite();
+    }
+
+
+    void Bus::sendLogicalWrite()
+    {
+        sendLogicalWrite(callError<std::function<void(DatagramState const&)>>, &logical_write_error_);
+    }
+
+
+    void Bus::sendLogicalWrite(AbstractLink::ErrorCallback error, void* context)
     {
         for (auto& pi_frame : pi_frames_)
         {
+            if (not isDue(pi_frame))
+            {
+                continue;
+            }
+
             uint8_t* buffer = pi_frame.output_buffer.data();
-            for (auto const& output : pi_frame.outputs)
+            for (auto const& output : pi_frame.gather)
             {
                 std::memcpy(buffer + output.offset, output.iomap, output.size);
             }
 
-            auto process = [&pi_frame](DatagramHeader const*, uint8_t const*, uint16_t wkc)
-            {
-                if (wkc != pi_frame.outputs.size())
-                {
-                    bus_error("Invalid working counter: expected %zu, got %" PRIu16 "\n", pi_frame.outputs.size(), wkc);
-                    return DatagramState::INVALID_WKC;
-                }
-                return DatagramState::OK;
-            };
-            link_->addDatagram(Command::LWR, pi_frame.description.address, buffer, static_cast<uint16_t>(pi_frame.description.pdo_size), process, error);
+            pi_frame.lwr.error = error;
+            pi_frame.lwr.error_context = context;
+            link_->addDatagram(Command::LWR, pi_frame.description.address, buffer, static_cast<uint16_t>(pi_frame.description.pdo_size),
+                               processLogicalWrite, logicalError, &pi_frame.lwr);
         }
+        ++cycle_;
 
         if (dc_slave_ != nullptr)
         {
-            sendDriftCompensation(error);
+            sendDriftCompensation(error, context);
         }
     }
 
 
-    void Bus::processDataWrite(std::function<void(DatagramState const&)> const& error)
+    void Bus::processDataWrite(AbstractLink::ErrorCallback error, void* context)
     {
-        sendLogicalWrite(error);
+        sendLogicalWrite(error, context);
         link_->processDatagrams();
     }
 
 
     void Bus::sendLogicalReadWrite(std::function<void(DatagramState const&)> const& error)
+    {
+        logical_read_write_error_ = error;
+        sendLogicalReadWrite();
+    }
+
+
+    void Bus::sendLogicalReadWrite()
+    {
+        sendLogicalReadWrite(callError<std::function<void(DatagramState const&)>>, &logical_read_write_error_);
+    }
+
+
+    void Bus::sendLogicalReadWrite(AbstractLink::ErrorCallback error, void* context)
     {
         for (auto& pi_frame : pi_frames_)
         {
-            uint8_t* buffer = pi_frame.output_buffer.data();
-            for (auto const& output : pi_frame.outputs)
+            if (not isDue(pi_frame))
             {
-                std::memcpy(buffer + output.offset, output.iomap, output.size);
+                continue;
             }
 
-            auto process = [&pi_frame](DatagramHeader const*, uint8_t const* data, uint16_t wkc)
+            uint8_t* buffer = pi_frame.output_buffer.data();
+            for (auto const& output : pi_frame.gather)
             {
-                if (wkc != pi_frame.expected_lrw_wkc)
-                {
-                    bus_error("Invalid working counter: expected %d, got %d\n", pi_frame.expected_lrw_wkc, wkc);
-                    return DatagramState::INVALID_WKC;
-                }
-
-                for (auto& input : pi_frame.inputs)
-                {
-                    std::memcpy(input.iomap, data + input.offset, input.size);
-                }
-
-                for (auto const& ms : pi_frame.mailbox_read_status)
-                {
-                    ms.slave->mailbox.can_read = (data[ms.byte_offset] >> ms.bit_position) & 1;
-                }
-                for (auto const& ms : pi_frame.mailbox_write_status)
-                {
-                    ms.slave->mailbox.can_write = not ((data[ms.byte_offset] >> ms.bit_position) & 1);
-                }
-
-                return DatagramState::OK;
-            };
+                std::memcpy(buffer + output.offset, output.iomap, output.size);
+            }
 
-            link_->addDatagram(Command::LRW, pi_frame.description.address, buffer, static_cast<uint16_t>(pi_frame.description.logical_size), process, error);
+            pi_frame.lrw.error = error;
+            pi_frame.lrw.error_context = context;
+            link_->addDatagram(Command::LRW, pi_frame.description.address, buffer, static_cast<uint16_t>(pi_frame.description.logical_size),
+                               processLogicalReadWrite, logicalError, &pi_frame.lrw);
         }
+        ++cycle_;
 
         if (dc_slave_ != nullptr)
         {
-            sendDriftCompensation(error);
+            sendDriftCompensation(error, context);
         }
     }
 
 
-    void Bus::processDataReadWrite(std::function<void(DatagramState const&)> const& error)
+    void Bus::processDataReadWrite(AbstractLink::ErrorCallback error, void* context)
     {
-        sendLogicalReadWrite(error);
+        sendLogicalReadWrite(error, context);
         link_->processDatagrams();
     }
 
@@ -985,12 +1511,20 @@ namespace kickcat
             fmmu.physical_address   = sii_sm.start_address;
             fmmu.physical_start_bit = 0;
             fmmu.activate           = 1;
+            if (isBitPacked(slave))
+            {
+                fmmu.logical_start_bit = mapping.bit_offset;
+                fmmu.logical_stop_bit  = static_cast<uint8_t>(mapping.bit_offset + mapping.size - 1);
+            }
             link_->addDatagram(Command::FPWR, createAddress(slave.address, targeted_fmmu), fmmu, process, error);
             bus_info("slave %04x - size %" PRIu32 " - ladd 0x%04" PRIu32 " - paddr 0x%04x\n", slave.address, mapping.bsize, mapping.address, fmmu.physical_address);
         };
 
+        // Up to four datagrams per slave (SM and FMMU of each direction)
+        std::size_t queued = 0;
         for (auto& slave : slaves_)
         {
+            reserveDatagrams(queued, 4);
             prepareDatagrams(slave, slave.input,  SyncManager::Input);
             prepareDatagrams(slave, slave.output, SyncManager::Output);
         }
@@ -1015,6 +1549,7 @@ namespace kickcat
             THROW_ERROR_DATAGRAM("Invalid working counter while programming mailbox status FMMU", state);
         };
 
+        std::size_t queued = 0;
         for (auto const& frame : pi_frames_)
         {
             auto configureBitFMMU = [&](auto const& entries, uint16_t physical_address, uint16_t fmmu_reg_offset)
@@ -1032,6 +1567,7 @@ namespace kickcat
                     fmmu.type               = 1; // read access (slave to master)
                     fmmu.activate           = 1;
 
+                    reserveDatagrams(queued, 1);
                     link_->addDatagram(Command::FPWR,
                         createAddress(entry.slave->address, static_cast<uint16_t>(reg::FMMU + fmmu_reg_offset)),
                         fmmu, process, error);
@@ -1094,14 +1630,15 @@ namespace kickcat
         for (int i = 0; i < 10; ++i)
         {
             sleep(tiny_wait);
-            for (auto& slave : slaves_)
-            {
-                link_->addDatagram(Command::FPRD, createAddress(slave.address, reg::EEPROM_CONTROL), nullptr, 2, process, error);
-            }
-
             ready = true; // rearm check
             try
             {
+                std::size_t queued = 0;
+                for (auto& slave : slaves_)
+                {
+                    reserveDatagrams(queued, 1);
+                    link_->addDatagram(Command::FPRD, createAddress(slave.address, reg::EEPROM_CONTROL), nullptr, 2, process, error);
+                }
                 link_->processDatagrams();
             }
             catch (...)
@@ -1145,6 +1682,7 @@ namespace kickcat
             THROW_ERROR_DATAGRAM("Error while fetching eeprom data", state);
         };
 
+        std::size_t queued = 0;
         for (auto& slave : slaves)
         {
             auto process = [&slave, &apply](DatagramHeader const*, uint8_t const* data, uint16_t wkc)
@@ -1159,59 +1697,202 @@ namespace kickcat
                 return DatagramState::OK;
             };
 
+            reserveDatagrams(queued, 1);
             link_->addDatagram(Command::FPRD, createAddress(slave->address, reg::EEPROM_DATA), nullptr, 4, process, error);
         }
         link_->processDatagrams();
     }
 
 
-    void Bus::fetchEeprom()
+    namespace
     {
-        // Per-slave accumulation buffers (indexed same as slaves_)
-        std::vector<std::vector<uint32_t>> buffers(slaves_.size());
+        // EEPROM interface registers, read in one go: control/status, address and data
+        struct EepromInterface
+        {
+            uint16_t control;
+            uint32_t address;
+            uint32_t data[2]; // 4 or 8 bytes read, as advertised by eeprom::Control::NB_READ_BYTES
+        } __attribute__((__packed__));
 
-        std::vector<Slave*> pending;
-        for (auto& slave : slaves_)
+        // End of the SII: End category after the info area
+        bool isSIIEnd(std::vector<uint32_t> const& buffer)
         {
-            pending.push_back(&slave);
+            return (((buffer.back() >> 16) == eeprom::Category::End) or
+                    ((buffer.back() & eeprom::Category::End) == eeprom::Category::End)) and
+                     (buffer.size() > 32);
         }
+    }
 
-        auto getBuffer = [&](Slave& s) -> std::vector<uint32_t>&
+
+    void Bus::fetchEeprom()
+    {
+        // Each slave downloads its SII on its own: a new read is requested as soon as the previous one is over,
+        // with the size the ESC supports. The requests and the status polls of all the slaves share one frame per round,
+        // so the download is bounded by the slowest EEPROM, not by the sum of the slowest reads of each step.
+        // A status polled in the frame of its request may predate the request: it is trusted only once the register
+        // address is known to differ from the requested one, i.e. after the first read of the slave.
+        constexpr nanoseconds READ_TIMEOUT = 10ms;
+
+        struct Fetch
+        {
+            std::vector<uint32_t> buffer;
+            uint32_t address{0};        // next word to read
+            eeprom::Request request{};
+            nanoseconds requested_at{0};
+            bool requested{false};
+            bool requested_now{false};  // read request in the frame of the status poll
+            bool polled{false};
+            bool read_once{false};      // the register holds the previous read address
+            bool cached{false};
+            bool done{false};
+            EepromInterface status{};
+        };
+        std::vector<Fetch> fetches(slaves_.size());
+
+        auto error = [](DatagramState const& state)
+        {
+            THROW_ERROR_DATAGRAM("Error while fetching eeprom data", state);
+        };
+
+        auto pending = [&fetches]()
         {
-            auto idx = static_cast<std::size_t>(&s - slaves_.data());
-            return buffers[idx];
+            return std::any_of(fetches.begin(), fetches.end(), [](Fetch const& fetch) { return not fetch.done; });
         };
 
-        // Get SII
-        int32_t pos = 0;
-        while (not pending.empty())
+        while (pending())
         {
-            readEeprom(static_cast<uint16_t>(pos), pending,
-            [&](Slave& s, uint32_t word)
+            std::size_t queued = 0;
+            for (std::size_t i = 0; i < slaves_.size(); ++i)
             {
-                getBuffer(s).push_back(word);
-            });
+                auto& fetch = fetches[i];
+                if (fetch.done)
+                {
+                    continue;
+                }
+
+                uint16_t slave_address = slaves_[i].address;
+                reserveDatagrams(queued, 2); // read request and status poll
+                if (not fetch.requested)
+                {
+                    fetch.request = { eeprom::Control::READ, static_cast<uint16_t>(fetch.address), static_cast<uint16_t>(fetch.address >> 16) };
+                    fetch.requested = true;
+                    fetch.requested_now = true;
+                    fetch.requested_at = now();
+
+                    auto process = [](DatagramHeader const*, uint8_t const*, uint16_t wkc)
+                    {
+                        if (wkc != 1)
+                        {
+                            return DatagramState::INVALID_WKC;
+                        }
+                        return DatagramState::OK;
+                    };
+                    link_->addDatagram(Command::FPWR, createAddress(slave_address, reg::EEPROM_CONTROL),
+                                       &fetch.request, sizeof(fetch.request), process, error);
+                }
 
-            pos += 2;
+                // poll in the same frame: an emulated or a fast ESC already answered (see the address check below)
+                auto process = [&fetch](DatagramHeader const*, uint8_t const* data, uint16_t wkc)
+                {
+                    if (wkc != 1)
+                    {
+                        return DatagramState::INVALID_WKC;
+                    }
+                    std::memcpy(&fetch.status, data, sizeof(EepromInterface));
+                    fetch.polled = true;
+                    return DatagramState::OK;
+                };
+                link_->addDatagram(Command::FPRD, createAddress(slave_address, reg::EEPROM_CONTROL),
+                                   nullptr, sizeof(EepromInterface), process, error);
+            }
+            link_->processDatagrams();
 
-            pending.erase(std::remove_if(pending.begin(), pending.end(),
-            [&](Slave* s)
+            for (auto& fetch : fetches)
             {
-                auto& buf = getBuffer(*s);
-                return (((buf.back() >> 16) == eeprom::Category::End) or
-                        ((buf.back() & eeprom::Category::End) == eeprom::Category::End)) and
-                         (buf.size() > 32);
-            }),
-            pending.end());
+                if (fetch.done or (not fetch.polled))
+                {
+                    continue;
+                }
+                fetch.polled = false;
+                if (fetch.requested_now)
+                {
+                    fetch.requested_now = false;
+                    if (not fetch.read_once)
+                    {
+                        continue; // the ESC may apply the request after the poll: the register is not known yet
+                    }
+                }
+
+                // The address check filters out the result of the previous read if the ESC did not flag the new one yet
+                if ((fetch.status.control & (eeprom::Control::BUSY | eeprom::Control::COMMAND))
+                    or (fetch.status.address != fetch.address))
+                {
+                    if (elapsed_time(fetch.requested_at) > READ_TIMEOUT)
+                    {
+                        THROW_ERROR("Timeout while fetching eeprom data");
+                    }
+                    continue;
+                }
+                if (fetch.status.control & eeprom::Control::ERROR_CMD)
+                {
+                    THROW_ERROR("Error while fetching eeprom data - missing EEPROM acknowledge");
+                }
+
+                uint32_t words = (fetch.status.control & eeprom::Control::NB_READ_BYTES) ? 2 : 1;
+                for (uint32_t k = 0; (k < words) and (not fetch.done); ++k)
+                {
+                    fetch.buffer.push_back(fetch.status.data[k]);
+                    fetch.done = isSIIEnd(fetch.buffer);
+
+                    // Header read: a slave known by the cache is hydrated from it
+                    if ((sii_cache_ != nullptr) and ((fetch.buffer.size() * sizeof(uint32_t)) == SIICache::HEADER_SIZE))
+                    {
+                        auto const* image = sii_cache_->find(reinterpret_cast<uint8_t const*>(fetch.buffer.data()));
+                        if (image != nullptr)
+                        {
+                            fetch.buffer.resize((image->size() + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+                            std::memcpy(fetch.buffer.data(), image->data(), image->size());
+                            fetch.cached = true;
+                            fetch.done = true;
+                        }
+                    }
+                }
+                fetch.address += words * 2;
+                fetch.requested = false;
+                fetch.read_once = true;
+            }
         }
 
         // Parse SII
         for (std::size_t i = 0; i < slaves_.size(); ++i)
         {
-            auto& buf = buffers[i];
+            auto& buf = fetches[i].buffer;
             slaves_[i].parseSII(reinterpret_cast<uint8_t const*>(buf.data()),
                                 buf.size() * sizeof(uint32_t));
         }
+
+        if (sii_cache_ == nullptr)
+        {
+            return;
+        }
+
+        for (auto const& fetch : fetches)
+        {
+            if (not fetch.cached)
+            {
+                uint8_t const* raw = reinterpret_cast<uint8_t const*>(fetch.buffer.data());
+                sii_cache_->store({raw, raw + fetch.buffer.size() * sizeof(uint32_t)});
+            }
+        }
+
+        try
+        {
+            sii_cache_->save();
+        }
+        catch (std::exception const& e)
+        {
+            bus_warning("Cannot save the SII cache %s: %s\n", sii_cache_->path().c_str(), e.what()); // next start reads the SII in full
+        }
     }
 
 
@@ -1304,6 +1985,11 @@ namespace kickcat
 
 
     void Bus::sendMailboxesReadChecks(std::function<void(DatagramState const&)> const& error)
+    {
+        sendMailboxesReadChecks(error, 0, slaves_.size());
+    }
+
+    void Bus::sendMailboxesReadChecks(std::function<void(DatagramState const&)> const& error, std::size_t begin, std::size_t end)
     {
         auto isFull = [](uint8_t state, uint16_t wkc, bool stable_value)
         {
@@ -1315,8 +2001,9 @@ namespace kickcat
             return ((state & SM_STATUS_MAILBOX) == SM_STATUS_MAILBOX);
         };
 
-        for (auto& slave : slaves_)
+        for (std::size_t i = begin; i < end; ++i)
         {
+            auto& slave = slaves_[i];
             auto process_read = [&slave, isFull](DatagramHeader const*, uint8_t const* state, uint16_t wkc)
             {
                 slave.mailbox.can_read = isFull(*state, wkc, false);
@@ -1332,6 +2019,11 @@ namespace kickcat
     }
 
     void Bus::sendMailboxesWriteChecks(std::function<void(DatagramState const&)> const& error)
+    {
+        sendMailboxesWriteChecks(error, 0, slaves_.size());
+    }
+
+    void Bus::sendMailboxesWriteChecks(std::function<void(DatagramState const&)> const& error, std::size_t begin, std::size_t end)
     {
         auto isFull = [](uint8_t state, uint16_t wkc, bool stable_value)
         {
@@ -1343,8 +2035,9 @@ namespace kickcat
             return ((state & 0x08) == 0x08);
         };
 
-        for (auto& slave : slaves_)
+        for (std::size_t i = begin; i < end; ++i)
         {
+            auto& slave = slaves_[i];
             auto process_write = [&slave, isFull](DatagramHeader const*, uint8_t const* state, uint16_t wkc)
             {
                 slave.mailbox.can_write = not isFull(*state, wkc, true);
@@ -1359,15 +2052,41 @@ namespace kickcat
         }
     }
 
+    void Bus::reserveDatagrams(std::size_t& queued, std::size_t count)
+    {
+        if ((queued + count) > DATAGRAMS_PER_ROUND)
+        {
+            link_->processDatagrams();
+            queued = 0;
+        }
+        queued += count;
+    }
+
+
     void Bus::checkMailboxes(std::function<void(DatagramState const&)> const& error)
     {
-        sendMailboxesWriteChecks(error);
-        sendMailboxesReadChecks(error);
+        std::size_t begin = 0;
+        while ((slaves_.size() - begin) > MAILBOX_SLAVES_PER_ROUND)
+        {
+            sendMailboxesWriteChecks(error, begin, begin + MAILBOX_SLAVES_PER_ROUND);
+            sendMailboxesReadChecks(error, begin, begin + MAILBOX_SLAVES_PER_ROUND);
+            link_->processDatagrams();
+            begin += MAILBOX_SLAVES_PER_ROUND;
+        }
+
+        sendMailboxesWriteChecks(error, begin, slaves_.size());
+        sendMailboxesReadChecks(error, begin, slaves_.size());
         link_->processDatagrams();
     }
 
 
     void Bus::sendWriteMessages(std::function<void(DatagramState const&)> const& error)
+    {
+        sendWriteMessages(error, 0, slaves_.size());
+        sendLogicalWriteMessages(error);
+    }
+
+    void Bus::sendWriteMessages(std::function<void(DatagramState const&)> const& error, std::size_t begin, std::size_t end)
     {
         auto process = [](DatagramHeader const*, uint8_t const*, uint16_t wkc)
         {
@@ -1379,8 +2098,13 @@ namespace kickcat
             return DatagramState::OK;
         };
 
-        for (auto& slave : slaves_)
+        for (std::size_t i = begin; i < end; ++i)
         {
+            auto& slave = slaves_[i];
+            if (slave.is_logical_mailbox)
+            {
+                continue;
+            }
             if ((slave.mailbox.can_write) and (not slave.mailbox.to_send.empty()))
             {
                 // send one waiting message
@@ -1393,9 +2117,15 @@ namespace kickcat
 
     void Bus::sendReadMessages(std::function<void(DatagramState const&)> const& error)
     {
-        Frame frame;
-        for (auto& slave : slaves_)
+        sendReadMessages(error, 0, slaves_.size());
+        sendLogicalReadMessages(error);
+    }
+
+    void Bus::sendReadMessages(std::function<void(DatagramState const&)> const& error, std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
         {
+            auto& slave = slaves_[i];
             auto process = [&slave](DatagramHeader const*, uint8_t const* data, uint16_t wkc)
             {
                 if (wkc != 1)
@@ -1413,7 +2143,7 @@ namespace kickcat
                 return DatagramState::OK;
             };
 
-            if (slave.mailbox.can_read)
+            if (slave.mailbox.can_read and (not slave.is_logical_mailbox))
             {
                 // retrieve waiting message
                 link_->addDatagram(Command::FPRD, createAddress(slave.address, slave.mailbox.send_offset), nullptr, slave.mailbox.send_size, process, error);
@@ -1422,10 +2152,156 @@ namespace kickcat
     }
 
 
+    void Bus::sendLogicalWriteMessages(std::function<void(DatagramState const&)> const& error)
+    {
+        std::size_t queued = 0;
+        sendLogicalWriteMessages(error, queued);
+    }
+
+
+    void Bus::sendLogicalWriteMessages(std::function<void(DatagramState const&)> const& error, std::size_t& queued)
+    {
+        // One LWR per run of consecutive mailboxes ready to receive a message: the other ones shall not be written.
+        // The messages are left in their queue until the LWR is acknowledged by every mailbox of the run: on a short
+        // working counter, the ones written are sent again with their mailbox counter, the slaves drop the repeat.
+        std::size_t begin = 0;
+        while (begin < logical_write_mailboxes_.size())
+        {
+            auto isReady = [](LogicalMailbox const& mailbox)
+            {
+                return mailbox.slave->mailbox.can_write and (not mailbox.slave->mailbox.to_send.empty());
+            };
+            if (not isReady(logical_write_mailboxes_[begin]))
+            {
+                ++begin;
+                continue;
+            }
+
+            uint32_t const address = logical_write_mailboxes_[begin].address;
+            std::size_t end = begin;
+            std::vector<uint8_t> buffer;
+            std::vector<std::pair<Slave*, std::shared_ptr<mailbox::request::AbstractMessage>>> messages;
+            while ((end < logical_write_mailboxes_.size()) and isReady(logical_write_mailboxes_[end])
+                   and ((buffer.size() + logical_write_mailboxes_[end].size) <= MAX_ETHERCAT_PAYLOAD_SIZE))
+            {
+                Slave* slave = logical_write_mailboxes_[end].slave;
+                auto const& message = slave->mailbox.to_send.front();
+                buffer.insert(buffer.end(), message->data(), message->data() + message->size());
+                buffer.resize(logical_write_mailboxes_[end].address + logical_write_mailboxes_[end].size - address, 0);
+                messages.emplace_back(slave, message);
+                ++end;
+            }
+
+            auto process = [messages](DatagramHeader const*, uint8_t const*, uint16_t wkc)
+            {
+                if (wkc != messages.size())
+                {
+                    bus_error("Invalid working counter: expected %zu, got %d\n", messages.size(), wkc);
+                    return DatagramState::INVALID_WKC;
+                }
+                for (auto const& [slave, message] : messages)
+                {
+                    // Not cancelled in the meantime
+                    if ((not slave->mailbox.to_send.empty()) and (slave->mailbox.to_send.front() == message))
+                    {
+                        slave->mailbox.send();
+                    }
+                }
+                return DatagramState::OK;
+            };
+            reserveDatagrams(queued, 1);
+            link_->addDatagram(Command::LWR, address, buffer.data(), static_cast<uint16_t>(buffer.size()), process, error);
+            begin = end;
+        }
+    }
+
+
+    void Bus::sendLogicalReadMessages(std::function<void(DatagramState const&)> const& error)
+    {
+        std::size_t queued = 0;
+        sendLogicalReadMessages(error, queued);
+    }
+
+
+    void Bus::sendLogicalReadMessages(std::function<void(DatagramState const&)> const& error, std::size_t& queued)
+    {
+        // One LRD per run of consecutive mailboxes with a message to read: reading a mailbox releases its message,
+        // the other ones shall not be read. An empty mailbox is not read by the ESC anyway (no wkc increment, data
+        // left untouched): every non empty message in the answer was released by the slave.
+        std::size_t begin = 0;
+        while (begin < logical_read_mailboxes_.size())
+        {
+            if (not logical_read_mailboxes_[begin].slave->mailbox.can_read)
+            {
+                ++begin;
+                continue;
+            }
+
+            uint32_t const address = logical_read_mailboxes_[begin].address;
+            std::size_t end = begin;
+            while ((end < logical_read_mailboxes_.size()) and logical_read_mailboxes_[end].slave->mailbox.can_read
+                   and ((logical_read_mailboxes_[end].address + logical_read_mailboxes_[end].size - address) <= MAX_ETHERCAT_PAYLOAD_SIZE))
+            {
+                ++end;
+            }
+
+            std::vector<LogicalMailbox> mailboxes(logical_read_mailboxes_.begin() + begin, logical_read_mailboxes_.begin() + end);
+            auto process = [mailboxes, address](DatagramHeader const*, uint8_t const* data, uint16_t wkc)
+            {
+                uint16_t received = 0;
+                for (auto const& mailbox : mailboxes)
+                {
+                    uint8_t const* message = data + (mailbox.address - address);
+                    mailbox::Header header;
+                    std::memcpy(&header, message, sizeof(mailbox::Header));
+                    if (header.len == 0)
+                    {
+                        continue;
+                    }
+
+                    ++received;
+                    if (not mailbox.slave->mailbox.receive(message))
+                    {
+                        bus_warning("Slave %d: receive a message but didn't process it\n", mailbox.slave->address);
+                    }
+                }
+
+                if (wkc != received)
+                {
+                    bus_error("Invalid working counter: expected %d, got %d\n", received, wkc);
+                    return DatagramState::INVALID_WKC;
+                }
+                return DatagramState::OK;
+            };
+
+            uint32_t const size = mailboxes.back().address + mailboxes.back().size - address;
+            reserveDatagrams(queued, 1);
+            link_->addDatagram(Command::LRD, address, nullptr, static_cast<uint16_t>(size), process, error);
+            begin = end;
+        }
+    }
+
+
     void Bus::processMessages(std::function<void(DatagramState const&)> const& error)
     {
-        sendWriteMessages(error);
-        sendReadMessages(error);
+        // The logical mailboxes, not exchanged by these per slave datagrams, ride on the last round: their datagrams
+        // are reserved on top of the (at most one per slave) write then read of its slaves.
+        std::size_t begin = 0;
+        while ((slaves_.size() - begin) > MAILBOX_SLAVES_PER_ROUND)
+        {
+            sendWriteMessages(error, begin, begin + MAILBOX_SLAVES_PER_ROUND);
+            sendReadMessages(error, begin, begin + MAILBOX_SLAVES_PER_ROUND);
+            link_->processDatagrams();
+            begin += MAILBOX_SLAVES_PER_ROUND;
+        }
+
+        std::size_t queued = 0;
+        reserveDatagrams(queued, slaves_.size() - begin);
+        sendWriteMessages(error, begin, slaves_.size());
+        sendLogicalWriteMessages(error, queued);
+        reserveDatagrams(queued, slaves_.size() - begin);
+        sendReadMessages(error, begin, slaves_.size());
+        sendLogicalReadMessages(error, queued);
         link_->processDatagrams();
     }
 
@@ -0,0 +1,201 @@
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+#include "debug.h"
+#include "kickcat/Error.h"
+#include "Bus.h"
+#include "BusSnapshot.h"
+#include "SIICache.h"
+#include "StateFile.h"
+
+namespace kickcat
+{
+    namespace
+    {
+        constexpr char     MAGIC[4] = {'K', 'B', 'U', 'S'};
+        constexpr uint32_t VERSION  = 1;
+
+        // identity words of the SII header: vendor id, product code, revision and serial number
+        constexpr uint16_t IDENTITY_ADDRESS = 0x08;
+        constexpr int32_t  IDENTITY_WORDS   = 4;    // 32 bits words
+    }
+
+
+    void BusSnapshot::save(std::string const& path) const
+    {
+        using state_file::put;
+        int32_t error = state_file::save(path, [this](std::FILE* file)
+        {
+            bool written = put(file, MAGIC)
+                       and put(file, VERSION)
+                       and put(file, static_cast<uint32_t>(slaves.size()))
+                       and put(file, static_cast<uint8_t>(mapped));
+            for (auto const& slave : slaves)
+            {
+                uint32_t sii_size = static_cast<uint32_t>(slave.sii.size());
+                written = written
+                      and put(file, slave.address)
+                      and put(file, slave.esc)
+                      and put(file, slave.input)
+                      and put(file, slave.output)
+                      and put(file, sii_size)
+                      and (std::fwrite(slave.sii.data(), sii_size, 1, file) == 1);
+            }
+            return written;
+        });
+        if (error != 0)
+        {
+            THROW_SYSTEM_ERROR_CODE("Cannot write the bus snapshot", error);
+        }
+    }
+
+
+    BusSnapshot BusSnapshot::load(std::string const& path)
+    {
+        using state_file::get;
+        auto file = state_file::open(path);
+        if (file == nullptr)
+        {
+            THROW_SYSTEM_ERROR("Cannot open the bus snapshot");
+        }
+
+        BusSnapshot snapshot;
+        char magic[sizeof(MAGIC)];
+        uint32_t version = 0;
+        uint32_t count = 0;
+        uint8_t mapped = 0;
+        bool valid = get(file.get(), magic)
+                 and (std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0)
+                 and get(file.get(), version)
+                 and (version == VERSION)
+                 and get(file.get(), count)
+                 and get(file.get(), mapped);
+        snapshot.mapped = (mapped != 0);
+
+        for (uint32_t i = 0; valid and (i < count); ++i)
+        {
+            SlaveConfig slave;
+            uint32_t sii_size = 0;
+            valid = get(file.get(), slave.address)
+                and get(file.get(), slave.esc)
+                and get(file.get(), slave.input)
+                and get(file.get(), slave.output)
+                and get(file.get(), sii_size)
+                and (sii_size > 0) and (sii_size <= SIICache::MAX_IMAGE_SIZE); // checked before the allocation
+            if (valid)
+            {
+                slave.sii.resize(sii_size);
+                valid = (std::fread(slave.sii.data(), sii_size, 1, file.get()) == 1);
+                snapshot.slaves.push_back(std::move(slave));
+            }
+        }
+        file.reset();
+
+        if (not valid)
+        {
+            THROW_ERROR("Corrupted bus snapshot");
+        }
+        return snapshot;
+    }
+
+
+    BusSnapshot Bus::snapshot() const
+    {
+        BusSnapshot snapshot;
+        snapshot.mapped = not pi_frames_.empty();
+        for (auto const& slave : slaves_)
+        {
+            BusSnapshot::SlaveConfig config;
+            config.address = slave.address;
+            config.esc     = slave.esc;
+            config.input   = {slave.input.sync_manager,  slave.input.size};
+            config.output  = {slave.output.sync_manager, slave.output.size};
+            config.sii     = slave.sii.serialize();
+            snapshot.slaves.push_back(std::move(config));
+        }
+        return snapshot;
+    }
+
+
+    void Bus::init(BusSnapshot const& snapshot, nanoseconds watchdogTimePDIO)
+    {
+        int32_t detected = detectSlaves();
+        if (detected == 0)
+        {
+            THROW_ERROR("No slave detected");
+        }
+        if (detected != static_cast<int32_t>(snapshot.slaves.size()))
+        {
+            THROW_ERROR("Bus snapshot mismatch: slave count");
+        }
+        resetSlaves(watchdogTimePDIO);
+        setAddresses();
+        fetchDL(); // the topology is read anyway: a cable may have moved
+
+        for (std::size_t i = 0; i < slaves_.size(); ++i)
+        {
+            auto const& config = snapshot.slaves[i];
+            auto& slave = slaves_[i];
+            if (config.address != slave.address)
+            {
+                THROW_ERROR("Bus snapshot mismatch: slave address");
+            }
+
+            slave.esc = config.esc;
+            slave.parseSII(config.sii.data(), config.sii.size());
+
+            if (snapshot.mapped)
+            {
+                auto restore = [](Slave::PIMapping& mapping, BusSnapshot::Mapping const& saved)
+                {
+                    mapping.sync_manager = saved.sync_manager;
+                    mapping.size  = saved.size;
+                    mapping.bsize = (saved.size + 7) / 8;
+                };
+                slave.is_static_mapping = true;
+                restore(slave.input,  config.input);
+                restore(slave.output, config.output);
+            }
+        }
+
+        // The slaves shall be the ones of the snapshot: read their identity only, all the slaves at once
+        std::vector<Slave*> slaves;
+        for (auto& slave : slaves_)
+        {
+            slaves.push_back(&slave);
+        }
+        std::vector<std::array<uint32_t, IDENTITY_WORDS>> identities(slaves_.size());
+        for (int32_t word = 0; word < IDENTITY_WORDS; ++word)
+        {
+            readEeprom(static_cast<uint16_t>(IDENTITY_ADDRESS + word * 2), slaves, [&](Slave& slave, uint32_t value)
+            {
+                identities[static_cast<std::size_t>(&slave - slaves_.data())][word] = value;
+            });
+        }
+
+        for (std::size_t i = 0; i < slaves_.size(); ++i)
+        {
+            auto const& info = slaves_[i].sii.info;
+            std::array<uint32_t, IDENTITY_WORDS> expected{info.vendor_id, info.product_code, info.revision_number, info.serial_number};
+            if (identities[i] != expected)
+            {
+                bus_error("Slave %d: 0x%08x 0x%08x rev 0x%08x sn %u instead of 0x%08x 0x%08x rev 0x%08x sn %u\n",
+                          slaves_[i].address,
+                          identities[i][0], identities[i][1], identities[i][2], identities[i][3],
+                          expected[0], expected[1], expected[2], expected[3]);
+                THROW_ERROR("Bus snapshot mismatch: slave identity");
+            }
+        }
+
+        requestState(State::INIT);
+        waitForState(State::INIT, 5000ms);
+
+        configureMailboxes();
+
+        requestState(State::PRE_OP);
+        waitForState(State::PRE_OP, 3000ms);
+
+        prepareMailboxes();
+    }
+}
@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <cstring>
+#include <deque>
 
 #include "Bus.h"
+#include "SDOBatch.h"
 
 namespace kickcat
 {
@@ -82,6 +85,211 @@ namespace kickcat
     }
 
 
+    namespace
+    {
+        // PDO mapping discovery of one CoE slave, driven by the mailbox loop of Bus::detectCoEMapping(): it chains
+        // in a SDO batch the uploads of 0x1C00, each 0x1C1x and each mapped 0x16xx/0x1Axx object (emulated complete
+        // access), one at a time.
+        class MappingDiscovery
+        {
+        public:
+            MappingDiscovery(SDOBatch& batch, Slave& slave)
+                : batch_(batch)
+                , slave_(slave)
+            {
+            }
+
+            // The objects are uploaded into this discovery: it shall not move
+            MappingDiscovery(MappingDiscovery const&) = delete;
+            MappingDiscovery& operator=(MappingDiscovery const&) = delete;
+            MappingDiscovery(MappingDiscovery&&) = delete;
+            MappingDiscovery& operator=(MappingDiscovery&&) = delete;
+
+            void start()
+            {
+                phase_ = Phase::SM_TYPES;
+                readObject(CoE::SM_COM_TYPE, sm_types_, sizeof(sm_types_));
+            }
+
+            bool done() const { return phase_ == Phase::DONE; }
+
+            // Advance when the object being read is over. Return true if it was.
+            bool update()
+            {
+                if (done() or (not transfer_->done()))
+                {
+                    return false;
+                }
+
+                if (transfer_->status() == MessageStatus::TIMEDOUT)
+                {
+                    THROW_ERROR("Error while reading SDO - Timeout");
+                }
+                if (transfer_->status() == MessageStatus::COE_CLIENT_BUFFER_TOO_SMALL)
+                {
+                    THROW_ERROR("Error while reading SDO - client buffer too small");
+                }
+                if (transfer_->status() != MessageStatus::SUCCESS)
+                {
+                    THROW_ERROR_CODE("Error while reading SDO - emulated complete access", error::category::CoE, transfer_->status());
+                }
+
+                objectRead(transfer_->size());
+                return true;
+            }
+
+        private:
+            enum class Phase
+            {
+                SM_TYPES,
+                SM_CHANNEL,
+                PDO,
+                DONE
+            };
+
+            void readObject(uint16_t index, uint8_t* object, uint32_t capacity)
+            {
+                transfer_ = batch_.read(slave_, index, 0, Bus::Access::EMULATE_COMPLETE, object, capacity);
+            }
+
+            void objectRead(uint32_t size)
+            {
+                switch (phase_)
+                {
+                    case Phase::SM_TYPES:
+                    {
+                        sm_count_ = size;
+                        sm_ = 0;
+                        nextSyncManager();
+                        break;
+                    }
+                    case Phase::SM_CHANNEL:
+                    {
+                        mapped_count_ = size / 2;
+                        mapped_next_ = 0;
+                        nextPDO();
+                        break;
+                    }
+                    case Phase::PDO:
+                    {
+                        for (uint32_t k = 0; k < size; k += 4)
+                        {
+                            mapping_->size += pdo_[k];
+                        }
+                        nextPDO();
+                        break;
+                    }
+                    case Phase::DONE:
+                    {
+                        break;
+                    }
+                }
+            }
+
+            void nextSyncManager()
+            {
+                //TODO we support only one input and one output per slave for now
+                while ((sm_ < sm_count_) and (sm_types_[sm_] <= 2)) // mailboxes
+                {
+                    ++sm_;
+                }
+                if (sm_ == sm_count_)
+                {
+                    phase_ = Phase::DONE;
+                    return;
+                }
+
+                mapping_ = &slave_.input;
+                if (sm_types_[sm_] == SyncManager::Output)
+                {
+                    mapping_ = &slave_.output;
+                }
+                mapping_->sync_manager = static_cast<int32_t>(sm_);
+                mapping_->size = 0;
+
+                phase_ = Phase::SM_CHANNEL;
+                readObject(static_cast<uint16_t>(CoE::SM_CHANNEL + sm_), reinterpret_cast<uint8_t*>(mapped_index_), sizeof(mapped_index_));
+            }
+
+            void nextPDO()
+            {
+                if (mapped_next_ == mapped_count_)
+                {
+                    mapping_->bsize = (mapping_->size + 7) / 8;
+                    ++sm_;
+                    nextSyncManager();
+                    return;
+                }
+
+                phase_ = Phase::PDO;
+                readObject(mapped_index_[mapped_next_], pdo_, sizeof(pdo_));
+                ++mapped_next_;
+            }
+
+            SDOBatch& batch_;
+            Slave& slave_;
+            Phase phase_{Phase::DONE};
+            SDOBatch::Handle transfer_; // object being read
+
+            uint8_t  sm_types_[512];
+            uint32_t sm_count_{0};
+            uint32_t sm_{0};
+            Slave::PIMapping* mapping_{nullptr};
+
+            uint16_t mapped_index_[128];
+            uint32_t mapped_count_{0};
+            uint32_t mapped_next_{0};
+
+            uint8_t  pdo_[512];
+        };
+    }
+
+
+    void Bus::detectCoEMapping(std::vector<Slave*> const& slaves)
+    {
+        auto error_callback_check = [](DatagramState const& state)
+        {
+            THROW_ERROR_DATAGRAM("error while checking mailboxes", state);
+        };
+
+        auto error_callback_process = [](DatagramState const& state)
+        {
+            THROW_ERROR_DATAGRAM("error while process mailboxes", state);
+        };
+
+        // The SDOs in flight point into the discoveries: they are not moved once started, and the batch (declared
+        // after them, destroyed first) cancels its SDOs in flight if a discovery fails.
+        std::deque<MappingDiscovery> discoveries;
+        SDOBatch batch(*this, 1s);
+        for (auto* slave : slaves)
+        {
+            discoveries.emplace_back(batch, *slave);
+            discoveries.back().start();
+        }
+
+        auto running = [&discoveries]()
+        {
+            return std::any_of(discoveries.begin(), discoveries.end(), [](MappingDiscovery const& d) { return not d.done(); });
+        };
+
+        while (running())
+        {
+            checkMailboxes(error_callback_check);
+            processMessages(error_callback_process);
+
+            if (batch.update() == 0)
+            {
+                sleep(tiny_wait);
+                continue;
+            }
+            for (auto& discovery : discoveries)
+            {
+                discovery.update();
+            }
+        }
+    }
+
+
     void Bus::writeSDO(Slave& slave, uint16_t index, uint8_t subindex, Access CA, void const* data, uint32_t data_size, nanoseconds timeout)
     {
         if ((CA == Access::PARTIAL) or (CA == Access::COMPLETE))
@@ -100,29 +308,8 @@ namespace kickcat
 
     void mapPDO(Bus& bus, Slave& slave, uint16_t pdo_map, uint32_t const* mapping, uint8_t mapping_count, uint16_t sm_map)
     {
-        uint8_t zeroU8 = 0;
-
-        // Unmap previous registers, setting 0 in PDO_MAP subindex 0
-        bus.writeSDO(slave, pdo_map, 0, Bus::Access::PARTIAL, &zeroU8, sizeof(zeroU8));
-
-        // Modify mapping, setting register address in PDO's subindexes
-        for (uint8_t i = 0; i < mapping_count; ++i)
-        {
-            bus.writeSDO(slave, pdo_map, i + 1, Bus::Access::PARTIAL, mapping + i, sizeof(uint32_t));
-        }
-
-        // Enable mapping by setting number of registers in PDO_MAP subindex 0
-        bus.writeSDO(slave, pdo_map, 0, Bus::Access::PARTIAL, &mapping_count, sizeof(mapping_count));
-
-        // Set PDO mapping to SM
-        // Unmap previous mappings, setting 0 in SM_MAP subindex 0
-        bus.writeSDO(slave, sm_map, 0, Bus::Access::PARTIAL, &zeroU8, sizeof(zeroU8));
-
-        // Write first mapping (PDO_map) address in SM_MAP subindex 1
-        bus.writeSDO(slave, sm_map, 1, Bus::Access::PARTIAL, &pdo_map, sizeof(pdo_map));
-
-        // Save mapping count in SM (here only one PDO_MAP)
-        uint8_t pdoMapSize = 1;
-        bus.writeSDO(slave, sm_map, 0, Bus::Access::PARTIAL, &pdoMapSize, sizeof(pdoMapSize));
+        SDOBatch batch(bus);
+        mapPDO(batch, slave, pdo_map, mapping, mapping_count, sm_map);
+        batch.wait();
     }
 }
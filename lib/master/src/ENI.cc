@@ -0,0 +1,465 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <inttypes.h>
+#include <optional>
+
+#include "debug.h"
+#include "kickcat/Error.h"
+#include "kickcat/ENI/Network.h"
+#include "Bus.h"
+#include "SDOBatch.h"
+
+namespace kickcat
+{
+    namespace
+    {
+        struct Pending
+        {
+            ENI::InitCommand const* cmd;
+            int32_t attempts{0};
+            bool done{false};
+            std::vector<uint8_t> answer;
+        };
+
+        // Send the batch in order (the link splits it in as many frames as needed, reserve() processes it by rounds
+        // of the datagram window). When a working counter does not match, the batch is sent again from that command,
+        // as long as its retries allow it: the following commands are not applied before it.
+        void send(AbstractLink& link, std::vector<Pending>& batch, std::function<void(std::size_t&)> const& reserve)
+        {
+            auto first = batch.begin();
+            while (first != batch.end())
+            {
+                std::size_t queued = 0;
+                for (auto it = first; it != batch.end(); ++it)
+                {
+                    Pending& entry = *it;
+                    auto process = [&entry](DatagramHeader const*, uint8_t const* data, uint16_t wkc)
+                    {
+                        if (entry.cmd->wkc and (*entry.cmd->wkc != wkc))
+                        {
+                            return DatagramState::INVALID_WKC;
+                        }
+                        std::memcpy(entry.answer.data(), data, entry.answer.size());
+                        entry.done = true;
+                        return DatagramState::OK;
+                    };
+                    auto error = [&entry](DatagramState const& state)
+                    {
+                        bus_warning("ENI init command '%s' (attempt %d): %s\n",
+                                    entry.cmd->comment.c_str(), entry.attempts, toString(state));
+                    };
+
+                    entry.done = false;
+                    entry.answer.resize(entry.cmd->data.size());
+                    ++entry.attempts;
+                    reserve(queued);
+                    link.addDatagram(entry.cmd->command, entry.cmd->address,
+                                     entry.cmd->data.data(), static_cast<uint16_t>(entry.cmd->data.size()),
+                                     process, error);
+                }
+                link.processDatagrams();
+
+                first = std::find_if(first, batch.end(), [](Pending const& entry) { return not entry.done; });
+                if (first == batch.end())
+                {
+                    return;
+                }
+                if (first->attempts > first->cmd->retries)
+                {
+                    bus_error("ENI init command '%s' failed after %d attempt(s)\n", first->cmd->comment.c_str(), first->attempts);
+                    THROW_ERROR("ENI init command failed");
+                }
+
+                // The following commands are sent again after this one: their attempt does not count
+                for (auto it = std::next(first); it != batch.end(); ++it)
+                {
+                    --it->attempts;
+                }
+            }
+        }
+
+        Slave& findSlave(std::vector<Slave>& slaves, ENI::Slave const& eni_slave)
+        {
+            auto it = std::find_if(slaves.begin(), slaves.end(),
+                [&eni_slave](Slave const& s) { return s.address == eni_slave.address; });
+            if (it == slaves.end())
+            {
+                bus_error("ENI slave '%s' (%d) not found on the bus\n", eni_slave.name.c_str(), eni_slave.address);
+                THROW_ERROR("ENI slave not found on the bus");
+            }
+            return *it;
+        }
+
+        bool isLogical(Command command)
+        {
+            return (command == Command::LRD) or (command == Command::LWR) or (command == Command::LRW);
+        }
+
+        bool isValid(ENI::InitCommand::Validation const& validation, std::vector<uint8_t> const& answer)
+        {
+            for (std::size_t i = 0; i < validation.data.size(); ++i)
+            {
+                uint8_t mask = validation.mask.empty() ? 0xFF : validation.mask[i];
+                if ((answer[i] & mask) != (validation.data[i] & mask))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+
+    void Bus::runInitCommands(ENI::Network const& network, ENI::Transition transition)
+    {
+        auto commands = network.initCommands(transition);
+        auto reserve = [this](std::size_t& queued) { reserveDatagrams(queued, 1); };
+        bus_info("ENI %s: %zu init commands\n", ENI::toString(transition), commands.size());
+
+        auto next = commands.begin();
+        while (next != commands.end())
+        {
+            // Batch up to the next command to validate: the following ones may depend on it
+            auto last = std::find_if(next, commands.end(), [](ENI::InitCommand const* cmd) { return cmd->validate.has_value(); });
+            if (last != commands.end())
+            {
+                ++last;
+            }
+
+            std::vector<Pending> batch;
+            for (auto it = next; it != last; ++it)
+            {
+                batch.push_back(Pending{*it, 0, false, {}});
+            }
+            next = last;
+            send(*link_, batch, reserve);
+
+            if (not batch.back().cmd->validate)
+            {
+                continue;
+            }
+
+            std::vector<Pending> polled{batch.back()};
+            Pending& entry = polled.front();
+            auto const& validation = *entry.cmd->validate;
+            nanoseconds start = now();
+            while (not isValid(validation, entry.answer))
+            {
+                if (elapsed_time(start) > validation.timeout)
+                {
+                    bus_error("ENI init command '%s': validation timeout\n", entry.cmd->comment.c_str());
+                    THROW_ERROR("ENI init command validation timeout");
+                }
+                sleep(tiny_wait);
+
+                entry.attempts = 0;
+                send(*link_, polled, reserve);
+            }
+        }
+    }
+
+
+    void Bus::runMailboxInitCommands(ENI::Network const& network, ENI::Transition transition)
+    {
+        // One timeout for the batch: the longest one of the transition commands
+        std::size_t count = 0;
+        nanoseconds timeout = 0ns;
+        for (auto const& eni_slave : network.slaves)
+        {
+            for (auto const& cmd : eni_slave.coe_init_cmds)
+            {
+                if (cmd.appliesTo(transition))
+                {
+                    ++count;
+                    timeout = std::max<nanoseconds>(timeout, cmd.timeout);
+                }
+            }
+        }
+        bus_info("ENI %s: %zu CoE init commands\n", ENI::toString(transition), count);
+        if (count == 0)
+        {
+            return;
+        }
+        if (timeout == 0ns)
+        {
+            timeout = 1s;
+        }
+
+        SDOBatch batch(*this, timeout);
+        for (auto const& eni_slave : network.slaves)
+        {
+            Slave* slave = nullptr;
+            for (auto const& cmd : eni_slave.coe_init_cmds)
+            {
+                if (not cmd.appliesTo(transition))
+                {
+                    continue;
+                }
+
+                if (slave == nullptr)
+                {
+                    slave = &findSlave(slaves_, eni_slave);
+                }
+
+                auto report = [&cmd](SDOBatch::Transfer const& transfer)
+                {
+                    if (transfer.status() != mailbox::request::MessageStatus::SUCCESS)
+                    {
+                        bus_error("ENI CoE init command '%s' (0x%04x.%d) failed: 0x%08x\n",
+                                  cmd.comment.c_str(), cmd.index, cmd.subindex, transfer.status());
+                    }
+                };
+                batch.write(*slave, cmd.index, cmd.subindex, cmd.complete_access ? Access::COMPLETE : Access::PARTIAL,
+                            cmd.data.data(), static_cast<uint32_t>(cmd.data.size()), report);
+            }
+        }
+        batch.wait();
+    }
+
+
+    bool Bus::checkMapping(ENI::Network const& network) const
+    {
+        bool match = true;
+
+        // The logical commands sent in OP, one PI frame per logical address
+        std::size_t frame_index = 0;
+        std::optional<uint32_t> address;
+        for (auto const& frame : network.frames)
+        {
+            for (auto const& cmd : frame.commands)
+            {
+                if (((cmd.states & State::OPERATIONAL) == 0) or (not isLogical(cmd.command)))
+                {
+                    continue;
+                }
+                if (address and (*address != cmd.address))
+                {
+                    ++frame_index;
+                }
+                address = cmd.address;
+
+                if (frame_index >= pi_frames_.size())
+                {
+                    bus_warning("ENI cyclic %s at 0x%08x: no matching PI frame\n", toString(cmd.command), cmd.address);
+                    match = false;
+                    continue;
+                }
+
+                auto const& pi_frame = pi_frames_[frame_index];
+                if (cmd.length != pi_frame.description.logical_size)
+                {
+                    bus_warning("ENI cyclic %s at 0x%08x: length %d, PI frame %zu is %d bytes\n", toString(cmd.command),
+                                cmd.address, cmd.length, frame_index, pi_frame.description.logical_size);
+                    match = false;
+                }
+
+                uint16_t expected_wkc = pi_frame.expected_lrw_wkc;
+                if (cmd.command == Command::LRD)
+                {
+                    expected_wkc = pi_frame.expected_lrd_wkc;
+                }
+                else if (cmd.command == Command::LWR)
+                {
+                    expected_wkc = pi_frame.expected_lwr_wkc;
+                }
+                if (cmd.wkc and (*cmd.wkc != expected_wkc))
+                {
+                    bus_warning("ENI cyclic %s at 0x%08x: working counter %d, PI frame %zu expects %d\n", toString(cmd.command),
+                                cmd.address, *cmd.wkc, frame_index, expected_wkc);
+                    match = false;
+                }
+            }
+        }
+
+        std::size_t eni_frames = address ? (frame_index + 1) : 0;
+        if (eni_frames != pi_frames_.size())
+        {
+            bus_warning("ENI describes %zu logical frames, the mapping has %zu PI frames\n", eni_frames, pi_frames_.size());
+            match = false;
+        }
+
+        std::size_t input_size = 0;
+        std::size_t output_size = 0;
+        for (auto const& pi_frame : pi_frames_)
+        {
+            input_size  += blocksSize(pi_frame.inputs);
+            output_size += blocksSize(pi_frame.outputs);
+        }
+        if ((input_size > network.input_size) or (output_size > network.output_size))
+        {
+            bus_warning("Mapped process image (%zu input bytes, %zu output bytes) does not fit the ENI one (%" PRIu32 ", %" PRIu32 ")\n",
+                        input_size, output_size, network.input_size, network.output_size);
+            match = false;
+        }
+
+        return match;
+    }
+
+
+    void Bus::createMapping(ENI::Network const& network, uint8_t* iomap, std::size_t iomap_size)
+    {
+        if (iomap == nullptr)
+        {
+            THROW_ERROR("createMapping: null iomap");
+        }
+        if ((static_cast<std::size_t>(network.input_size) + network.output_size) > iomap_size)
+        {
+            THROW_ERROR("createMapping: iomap buffer too small for the ENI process image");
+        }
+
+        // The slave images in the ENI process image: the inputs first, then the outputs
+        struct Image
+        {
+            Slave* slave;
+            Slave::PIMapping Slave::* mapping;
+            uint32_t offset;    // bytes, in the input or output image
+            bool mapped;
+        };
+        std::vector<Image> inputs;
+        std::vector<Image> outputs;
+        for (auto& slave : slaves_)
+        {
+            slave.input  = Slave::PIMapping{};
+            slave.output = Slave::PIMapping{};
+        }
+        auto locate = [](std::vector<Image>& images, Slave& slave, Slave::PIMapping Slave::* mapping,
+                         ENI::ProcessData const& data, uint8_t* image, uint32_t image_size)
+        {
+            Slave::PIMapping& pi = slave.*mapping;
+            uint32_t const offset = data.bit_start / 8;
+            pi.bit_offset = static_cast<uint8_t>(data.bit_start % 8);
+            pi.size  = static_cast<int32_t>(data.bit_length);
+            pi.bsize = static_cast<int32_t>((pi.bit_offset + data.bit_length + 7) / 8);
+            if ((offset + static_cast<uint32_t>(pi.bsize)) > image_size)
+            {
+                bus_error("Slave %d: ENI image at bit %" PRIu32 " is out of the process image\n", slave.address, data.bit_start);
+                THROW_ERROR("createMapping: ENI slave image out of the process image");
+            }
+            pi.data = image + offset;
+            images.push_back({&slave, mapping, offset, false});
+        };
+        for (auto const& eni_slave : network.slaves)
+        {
+            if ((not eni_slave.inputs) and (not eni_slave.outputs))
+            {
+                continue;
+            }
+            Slave& slave = findSlave(slaves_, eni_slave);
+            if (eni_slave.inputs and (eni_slave.inputs->bit_length > 0))
+            {
+                locate(inputs, slave, &Slave::input, *eni_slave.inputs, iomap, network.input_size);
+            }
+            if (eni_slave.outputs and (eni_slave.outputs->bit_length > 0))
+            {
+                locate(outputs, slave, &Slave::output, *eni_slave.outputs, iomap + network.input_size, network.output_size);
+            }
+        }
+
+        // One PI frame per logical address of the commands sent in OP, with the expected working counters of the ENI
+        struct ExpectedWkc
+        {
+            std::optional<uint16_t> lrd;
+            std::optional<uint16_t> lwr;
+            std::optional<uint16_t> lrw;
+        };
+        std::vector<ExpectedWkc> expected_wkc;
+        pi_frames_.clear();
+        cycle_ = 0;
+
+        auto bind = [](PIFrame& pi_frame, std::vector<blockIO>& blocks, std::vector<Image>& images,
+                       ENI::CyclicCommand const& cmd, std::optional<uint32_t> const& data_offset)
+        {
+            if (not data_offset)
+            {
+                bus_error("ENI cyclic %s at 0x%08x: no data offset in the process image\n", toString(cmd.command), cmd.address);
+                THROW_ERROR("createMapping: ENI cyclic command without its process image offset");
+            }
+
+            for (auto& image : images)
+            {
+                Slave::PIMapping& pi = image.slave->*image.mapping;
+                if (image.mapped or (image.offset < *data_offset)
+                    or ((image.offset + static_cast<uint32_t>(pi.bsize)) > (*data_offset + cmd.length)))
+                {
+                    continue;
+                }
+                image.mapped = true;
+
+                uint32_t const frame_offset = image.offset - *data_offset;
+                pi.address = pi_frame.description.address + frame_offset;
+                blocks.push_back({pi.data, frame_offset, pi.bsize, image.slave});
+            }
+        };
+
+        for (auto const& frame : network.frames)
+        {
+            for (auto const& cmd : frame.commands)
+            {
+                if (((cmd.states & State::OPERATIONAL) == 0) or (not isLogical(cmd.command)))
+                {
+                    continue;
+                }
+
+                if (pi_frames_.empty() or (pi_frames_.back().description.address != cmd.address))
+                {
+                    PIFrame pi_frame{};
+                    pi_frame.description.address = cmd.address;
+                    pi_frames_.push_back(std::move(pi_frame));
+                    expected_wkc.push_back({});
+                }
+                PIFrame& pi_frame = pi_frames_.back();
+                pi_frame.description.logical_size = std::max<int32_t>(pi_frame.description.logical_size, cmd.length);
+                pi_frame.description.pdo_size = pi_frame.description.logical_size;
+
+                if (cmd.command != Command::LWR)
+                {
+                    bind(pi_frame, pi_frame.inputs, inputs, cmd, cmd.input_offset);
+                }
+                if (cmd.command != Command::LRD)
+                {
+                    bind(pi_frame, pi_frame.outputs, outputs, cmd, cmd.output_offset);
+                }
+
+                auto& wkc = expected_wkc.back();
+                switch (cmd.command)
+                {
+                    case Command::LRD: { wkc.lrd = cmd.wkc; break; }
+                    case Command::LWR: { wkc.lwr = cmd.wkc; break; }
+                    default:           { wkc.lrw = cmd.wkc; break; }
+                }
+            }
+        }
+
+        for (auto const* images : {&inputs, &outputs})
+        {
+            for (auto const& image : *images)
+            {
+                if (not image.mapped)
+                {
+                    bus_error("Slave %d: ENI image not exchanged by any cyclic command in OP\n", image.slave->address);
+                    THROW_ERROR("createMapping: ENI slave image out of the cyclic commands");
+                }
+            }
+        }
+
+        for (auto& pi_frame : pi_frames_)
+        {
+            auto byOffset = [](blockIO const& lhs, blockIO const& rhs) { return lhs.offset < rhs.offset; };
+            std::stable_sort(pi_frame.inputs.begin(),  pi_frame.inputs.end(),  byOffset);
+            std::stable_sort(pi_frame.outputs.begin(), pi_frame.outputs.end(), byOffset);
+        }
+        describePIFrames();
+        compileCyclicProgram();
+
+        // The ENI counts every FMMU it programs (mailbox status bits included): its working counters prevail
+        for (std::size_t i = 0; i < pi_frames_.size(); ++i)
+        {
+            auto& pi_frame = pi_frames_[i];
+            pi_frame.expected_lrd_wkc = expected_wkc[i].lrd.value_or(pi_frame.expected_lrd_wkc);
+            pi_frame.expected_lwr_wkc = expected_wkc[i].lwr.value_or(pi_frame.expected_lwr_wkc);
+            pi_frame.expected_lrw_wkc = expected_wkc[i].lrw.value_or(pi_frame.expected_lrw_wkc);
+        }
+        bus_info("ENI mapping: %zu PI frames\n", pi_frames_.size());
+    }
+}
@@ -36,7 +36,13 @@ namespace kickcat
                 break;
             }
             acc += entry.contribution;
-            if (entry.input_offset >= 0)
+            if ((entry.input_offset >= 0) and (entry.input_mask != 0xFF))
+            {
+                // bit-packed slave: its neighbours in the byte may have answered on the other segment
+                uint8_t& merged = data_nominal[entry.input_offset];
+                merged = static_cast<uint8_t>((merged & ~entry.input_mask) | (data_redundancy[entry.input_offset] & entry.input_mask));
+            }
+            else if (entry.input_offset >= 0)
             {
                 std::memcpy(data_nominal + entry.input_offset, data_redundancy + entry.input_offset,
                             static_cast<size_t>(entry.input_size));
@@ -63,12 +69,61 @@ namespace kickcat
     {
         std::copy(src_nominal, src_nominal + MAC_SIZE, src_nominal_);
         std::copy(src_redundancy, src_redundancy + MAC_SIZE, src_redundancy_);
+
+        tx_frames_.resize(1);
+        rx_from_nominal_.resize(1);
+        rx_from_redundancy_.resize(1);
+    }
+
+
+    Link::~Link()
+    {
+        // Frames built in nominal socket buffers but never sent: the buffers go back to the socket
+        for (auto& frame : tx_frames_)
+        {
+            if (frame.isAttached())
+            {
+                socket_nominal_->returnBuffer(frame.data());
+                frame.attach(nullptr);
+            }
+        }
     }
 
 
     void Link::addDatagram(enum Command command, uint32_t address, void const* data, uint16_t data_size,
                                std::function<DatagramState(DatagramHeader const*, uint8_t const* data, uint16_t wkc)> const& process,
                                std::function<void(DatagramState const& state)> const& error)
+    {
+        auto& callback = callbacks_[index_head_];
+        queueDatagram(command, address, data, data_size);
+
+        callback.process_function = process;
+        callback.error_function = error;
+        callback.process = [](void* context, DatagramHeader const* header, uint8_t const* payload, uint16_t wkc)
+        {
+            return static_cast<Callbacks*>(context)->process_function(header, payload, wkc);
+        };
+        callback.error = [](void* context, DatagramState const& state)
+        {
+            static_cast<Callbacks*>(context)->error_function(state);
+        };
+        callback.context = &callback;
+    }
+
+
+    void Link::addDatagram(enum Command command, uint32_t address, void const* data, uint16_t data_size,
+                           ProcessCallback process, ErrorCallback error, void* context)
+    {
+        auto& callback = callbacks_[index_head_];
+        queueDatagram(command, address, data, data_size);
+
+        callback.process = process;
+        callback.error = error;
+        callback.context = context;
+    }
+
+
+    void Link::queueDatagram(enum Command command, uint32_t address, void const* data, uint16_t data_size)
     {
         if (index_queue_ == static_cast<uint8_t>(index_head_ + 1))
         {
@@ -77,29 +132,32 @@ namespace kickcat
         link_info("Adding a datagram (already %d pending)\n", index_queue_);
 
         uint16_t const needed_space = datagram_size(data_size);
-        if (frame_nominal_.freeSpace() < needed_space)
+        if (tx_frames_[tx_queued_].freeSpace() < needed_space)
         {
-            sendFrame();
+            queueFrame();
         }
 
         addDatagramToFrame(index_head_, command, address, data, data_size);
-        callbacks_[index_head_].process = process;
-        callbacks_[index_head_].error = error;
         callbacks_[index_head_].status = DatagramState::LOST;
         ++index_head_;
 
-        if (frame_nominal_.isFull())
+        if (tx_frames_[tx_queued_].isFull())
         {
-            sendFrame();
+            queueFrame();
         }
     }
 
 
     void Link::finalizeDatagrams()
     {
-        if (frame_nominal_.datagramCounter() != 0)
+        if (tx_frames_[tx_queued_].datagramCounter() != 0)
+        {
+            queueFrame();
+        }
+
+        if (tx_queued_ != 0)
         {
-            sendFrame();
+            sendFrames();
         }
     }
 
@@ -107,74 +165,235 @@ namespace kickcat
     void Link::processDatagrams()
     {
         finalizeDatagrams();
+        commitCycle(false);
+
+        // Synchronous: complete every cycle in flight, the pipelined ones included
+        std::exception_ptr client_exception;
+        while (cyclesInFlight() > 0)
+        {
+            completeCycle(client_exception);
+        }
+
+        // Rethrow last catched client exception.
+        if (client_exception)
+        {
+            std::rethrow_exception(client_exception);
+        }
+    }
+
+
+    uint32_t Link::submitCycle()
+    {
+        std::exception_ptr client_exception;
+        while (cyclesInFlight() >= pipeline_depth_)
+        {
+            completeCycle(client_exception);
+        }
+
+        finalizeDatagrams();
+        uint32_t id = commitCycle(true);
+
+        if (client_exception)
+        {
+            std::rethrow_exception(client_exception);
+        }
+        return id;
+    }
+
+
+    bool Link::completeCycle()
+    {
+        if (cyclesInFlight() == 0)
+        {
+            return false;
+        }
+
+        std::exception_ptr client_exception;
+        completeCycle(client_exception);
+        if (client_exception)
+        {
+            std::rethrow_exception(client_exception);
+        }
+        return true;
+    }
+
+
+    bool Link::popCompletion(CycleCompletion& completion)
+    {
+        return completions_.pop(completion);
+    }
+
+
+    void Link::setPipelineDepth(int32_t depth)
+    {
+        if ((depth < 1) or (depth > MAX_CYCLES_IN_FLIGHT))
+        {
+            THROW_ERROR("Invalid pipeline depth");
+        }
+        pipeline_depth_ = depth;
+    }
+
+
+    uint32_t Link::commitCycle(bool notify)
+    {
+        Cycle& cycle = cycleSlot(cycles_head_);
+        cycle.id = next_cycle_id_++;
+        cycle.first = index_queue_;
+        if (cyclesInFlight() > 0)
+        {
+            cycle.first = cycleSlot(cycles_head_ - 1).end;
+        }
+        cycle.end = index_head_;
+        cycle.frames = sent_frame_;
+        cycle.received = building_.received;
+        cycle.irq = building_.irq;
+        cycle.notify = notify;
+        ++cycles_head_;
 
-        uint8_t waiting_frame = sent_frame_;
         sent_frame_ = 0;
-        uint16_t irq = 0;
+        building_ = {};
+        return cycle.id;
+    }
 
+
+    Link::Cycle* Link::cycleOf(uint8_t index)
+    {
+        for (uint32_t i = cycles_tail_; i != cycles_head_; ++i)
+        {
+            Cycle& cycle = cycleSlot(i);
+            uint8_t const size = static_cast<uint8_t>(cycle.end - cycle.first);
+            if (static_cast<uint8_t>(index - cycle.first) < size)
+            {
+                return &cycle;
+            }
+        }
+        return &building_; // datagrams already flushed for the cycle being built
+    }
+
+
+    Link::Cycle* Link::dispatchFrame(int32_t pair, bool& desynchronized)
+    {
+        frame_nominal_    = &rx_from_redundancy_[pair];
+        frame_redundancy_ = &rx_from_nominal_[pair];
+
+        Cycle* owner = nullptr;
+        bool stale_frame = false;
+        bool dropped_datagram = false;
+        while (isDatagramAvailable())
+        {
+            bool dropped_pair = false;
+            auto [header, data, wkc] = nextDatagram(dropped_pair);
+            dropped_datagram = dropped_datagram or dropped_pair;
+            if (isStale(header->index))
+            {
+                // Frame from a previous cycle, already reported lost: drop it. Reading it again
+                // here would corrupt the dispatch of the frames currently being iterated.
+                stale_frame = true;
+                continue;
+            }
+
+            if (owner == nullptr)
+            {
+                owner = cycleOf(header->index);
+            }
+            owner->irq |= header->irq; // aggregate IRQ feedbacks
+
+            auto& callback = callbacks_[header->index];
+            if (callback.status == DatagramState::OK)
+            {
+                continue; // already answered by the other redundancy copy: never downgrade it
+            }
+            callback.status = callback.process(callback.context, header, data, wkc);
+        }
+
+        desynchronized = stale_frame or dropped_datagram;
+        return owner; // nullptr: only stale datagrams
+    }
+
+
+    void Link::completeCycle(std::exception_ptr& client_exception)
+    {
+        Cycle& cycle = cycleSlot(cycles_tail_);
+
+        int32_t waiting_frame = cycle.frames - cycle.received; // some answers may have come with an older cycle
         int32_t stale_budget = waiting_frame;
-        for (int32_t i = 0; i < waiting_frame; ++i)
+        while (waiting_frame > 0)
         {
-            read();
-            bool stale_frame = false;
-            bool dropped_datagram = false;
-            while (isDatagramAvailable())
+            int32_t const batch = std::min(waiting_frame, MAX_BATCH_FRAMES);
+            int32_t const received = read(batch); // a short batch is completed by the next round
+
+            for (int32_t i = 0; i < received; ++i)
             {
-                bool dropped_pair = false;
-                auto [header, data, wkc] = nextDatagram(dropped_pair);
-                dropped_datagram = dropped_datagram or dropped_pair;
-                if (isStale(header->index))
+                bool desynchronized = false;
+                Cycle* owner = dispatchFrame(i, desynchronized);
+                if (desynchronized and (stale_budget > 0))
                 {
-                    // Frame from a previous cycle, already reported lost: drop it. Reading it again
-                    // here would corrupt the dispatch of the frames currently being iterated.
-                    stale_frame = true;
+                    // A stale or desynchronized frame consumed this read: the expected one may still
+                    // be queued behind the batch.
+                    --stale_budget;
                     continue;
                 }
-                irq |= header->irq; // aggregate IRQ feedbacks
-                auto& callback = callbacks_[header->index];
-                if (callback.status == DatagramState::OK)
+
+                if ((owner != nullptr) and (owner != &cycle))
                 {
-                    continue; // already answered by the other redundancy copy: never downgrade it
+                    ++owner->received; // a later cycle of the pipeline, or the one being built
+                    continue;
                 }
-                callback.status = callback.process(header, data, wkc);
+                --waiting_frame;
             }
+            releaseFrames(*socket_redundancy_, rx_from_redundancy_, lent_redundancy_);
+            releaseFrames(*socket_nominal_,    rx_from_nominal_,    lent_nominal_);
 
-            if ((stale_frame or dropped_datagram) and (stale_budget > 0))
+            if (received == 0)
             {
-                // A stale or desynchronized frame consumed this read: the expected one may still
-                // be queued behind it.
-                --stale_budget;
-                --i;
+                break; // read timeout on both interfaces: the missing frames are lost
             }
         }
 
-        std::exception_ptr client_exception;
-        for (uint8_t i = index_queue_; i != index_head_; ++i)
+        DatagramState cycle_status = DatagramState::OK;
+        bool cycle_exception = false;
+        for (uint8_t i = cycle.first; i != cycle.end; ++i)
         {
             if (callbacks_[i].status != DatagramState::OK)
             {
+                if (cycle_status == DatagramState::OK)
+                {
+                    cycle_status = callbacks_[i].status;
+                }
+
                 // Datagram was either lost or processing it encountered an error.
                 try
                 {
-                    callbacks_[i].error(callbacks_[i].status);
+                    callbacks_[i].error(callbacks_[i].context, callbacks_[i].status);
                 }
                 catch (...)
                 {
                     client_exception = std::current_exception();
+                    cycle_exception = true;
                 }
             }
         }
 
-        index_queue_ = index_head_;
+        index_queue_ = cycle.end;
+        ++cycles_tail_;
         resetFrameContext();
 
-        // Rethrow last catched client exception.
-        if (client_exception)
+        if (cycle.notify)
         {
-            std::rethrow_exception(client_exception);
+            CycleCompletion completion{cycle.id, cycle_status};
+            if (not completions_.push(completion))
+            {
+                // Nobody is consuming the completions: keep the latest ones
+                CycleCompletion oldest;
+                completions_.pop(oldest);
+                completions_.push(completion);
+            }
         }
 
-        checkEcatEvents(irq);
+        if (not cycle_exception)
+        {
+            checkEcatEvents(cycle.irq);
+        }
     }
 
 
@@ -265,106 +484,316 @@ namespace kickcat
     }
 
 
-    void Link::sendFrame()
+    void Link::queueFrame()
     {
-        auto write = [&](std::shared_ptr<AbstractSocket> socket, Frame& frame, MAC const& src, int32_t to_Write)
+        Frame& frame = tx_frames_[tx_queued_];
+        tx_datagrams_[tx_queued_] = static_cast<uint8_t>(frame.datagramCounter());
+        tx_sizes_[tx_queued_] = frame.finalize();
+        ++tx_queued_;
+
+        if (tx_queued_ == MAX_BATCH_FRAMES)
         {
-            bool is_frame_sent = true;
-            frame.setSourceMAC(src);
-            int32_t written = socket->write(frame.data(), to_Write);
-            if (written != to_Write)
+            sendFrames();
+            return;
+        }
+
+        if (tx_frames_.size() == static_cast<size_t>(tx_queued_))
+        {
+            tx_frames_.emplace_back();
+        }
+    }
+
+
+    void Link::sendFrames()
+    {
+        for (int32_t i = 0; i < tx_queued_; ++i)
+        {
+            io_buffers_[i] = {tx_frames_[i].data(), tx_sizes_[i]};
+        }
+
+        auto write = [&](AbstractSocket& socket, MAC const& src)
+        {
+            for (int32_t i = 0; i < tx_queued_; ++i)
             {
-                is_frame_sent = false;
-                link_error("Nominal: write failed, written %" PRIi32 ", to write %" PRIi32 "\n", written, to_Write);
+                tx_frames_[i].setSourceMAC(src);
             }
 
-            return is_frame_sent;
+            int32_t written = socket.writeBatch(io_buffers_.data(), tx_queued_);
+            if (written != tx_queued_)
+            {
+                link_error("write failed, written %" PRIi32 " frames, to write %" PRIi32 "\n", written, tx_queued_);
+            }
+            return std::max(written, 0);
         };
 
-        // save number of datagrams in the frame to handle send error properly if any
-        int32_t const datagrams = frame_nominal_.datagramCounter();
-        int32_t to_Write = frame_nominal_.finalize();
+        // Frames built in nominal socket buffers belong to the NIC once written: send the redundancy copies first.
+        bool const lent = std::any_of(tx_frames_.begin(), tx_frames_.begin() + tx_queued_,
+                                      [](Frame const& frame) { return frame.isAttached(); });
+        int32_t sent_redundancy = 0;
+        if (lent)
+        {
+            sent_redundancy = write(*socket_redundancy_, SECONDARY_IF_MAC);
+        }
+        int32_t const sent_nominal = write(*socket_nominal_, PRIMARY_IF_MAC);
+        if (not lent)
+        {
+            sent_redundancy = write(*socket_redundancy_, SECONDARY_IF_MAC);
+        }
+        int32_t const sent = std::max(sent_nominal, sent_redundancy);
+        sent_frame_ = static_cast<uint8_t>(sent_frame_ + sent);
+
+        // Frames written on no interface will never be answered: report their datagrams.
+        uint8_t index = index_head_;
+        for (int32_t i = tx_queued_ - 1; i >= sent; --i)
+        {
+            for (int32_t j = 0; j < tx_datagrams_[i]; ++j)
+            {
+                --index;
+                callbacks_[index].status = DatagramState::SEND_ERROR;
+            }
+        }
+
+        for (int32_t i = 0; i < tx_queued_; ++i)
+        {
+            tx_frames_[i].attach(nullptr); // no-op when the frame was built in user memory
+            tx_frames_[i].clear();
+        }
+        tx_queued_ = 0;
+    }
 
-        bool is_frame_sent_nominal = write(socket_nominal_, frame_nominal_, PRIMARY_IF_MAC, to_Write);
-        bool is_frame_sent_redundancy = write(socket_redundancy_, frame_nominal_, SECONDARY_IF_MAC, to_Write);
 
-        frame_nominal_.clear();
-        frame_redundancy_.clear();
-        frame_redundancy_.resetContext();
+    int32_t Link::readBatch(AbstractSocket& socket, std::vector<Frame>& frames, int32_t first, int32_t count,
+                            nanoseconds timeout, int32_t& lent)
+    {
+        if (frames.size() < static_cast<size_t>(count))
+        {
+            frames.resize(static_cast<size_t>(count));
+        }
 
-        if (is_frame_sent_nominal or is_frame_sent_redundancy)
+        int32_t const wanted = count - first;
+        for (int32_t i = 0; i < wanted; ++i)
         {
-            ++sent_frame_;
+            Frame& frame = frames[first + i];
+            frame.resetContext();
+            io_buffers_[i] = {frame.data(), ETH_MAX_SIZE};
+        }
+
+        socket.setTimeout(timeout);
+        int32_t received = 0;
+        if (socket.isZeroCopy())
+        {
+            received = socket.readBorrowed(io_buffers_.data(), wanted);
         }
         else
         {
-            for (int32_t i = 0; i < datagrams; ++i)
+            received = socket.readBatch(io_buffers_.data(), wanted);
+        }
+        if (received < 0)
+        {
+            return 0;
+        }
+
+        for (int32_t i = 0; i < received; ++i)
+        {
+            Frame& frame = frames[first + i];
+            if (io_buffers_[i].data != frame.data())
             {
-                uint8_t index = static_cast<uint8_t>(index_head_ - i - 1);
-                callbacks_[index].status = DatagramState::SEND_ERROR;
+                // Dispatch straight from the socket memory: given back by releaseFrames()
+                frame.attach(io_buffers_[i].data);
+                ++lent;
             }
+            checkFrame(frame, io_buffers_[i].size);
         }
+        return received;
     }
 
-    void Link::read()
+
+    void Link::releaseFrames(AbstractSocket& socket, std::vector<Frame>& frames, int32_t& lent)
     {
+        if (lent == 0)
+        {
+            return;
+        }
+
+        for (int32_t i = 0; i < lent; ++i)
+        {
+            io_buffers_[i] = {frames[i].data(), 0};
+            frames[i].attach(nullptr);
+        }
+        socket.releaseBatch(io_buffers_.data(), lent);
+        lent = 0;
+    }
+
+
+    int32_t Link::read(int32_t count)
+    {
+        if (multiplexed_read_)
+        {
+            int32_t received = readMultiplexed(count);
+            if (received != -EOPNOTSUPP)
+            {
+                return received;
+            }
+            multiplexed_read_ = false; // the interfaces are read one after the other from now on
+        }
+
         nanoseconds deadline = now() + timeout_;
 
-        socket_redundancy_->setTimeout(timeout_);
-        if (readFrame(*socket_redundancy_, frame_nominal_) < 0)
+        // Crossover: a frame sent on the nominal interface comes back on the redundancy one.
+        int32_t received_nominal = readBatch(*socket_redundancy_, rx_from_redundancy_, 0, count, timeout_, lent_redundancy_);
+        if (received_nominal < count)
         {
-            link_warning("Nominal frame read fail\n");
+            link_warning("Nominal frame read fail (%" PRIi32 "/%" PRIi32 ")\n", received_nominal, count);
         }
 
         nanoseconds remaining_timeout = deadline - now();
         nanoseconds min_timeout = 0us;
         nanoseconds timeout_second_socket = std::max(remaining_timeout, min_timeout);
 
-        socket_nominal_->setTimeout(timeout_second_socket);
-        if (readFrame(*socket_nominal_, frame_redundancy_) < 0)
+        int32_t received_redundancy = readBatch(*socket_nominal_, rx_from_nominal_, 0, count, timeout_second_socket, lent_nominal_);
+        if (received_redundancy < count)
         {
-            link_warning("Redundancy frame read fail\n");
+            link_warning("Redundancy frame read fail (%" PRIi32 "/%" PRIi32 ")\n", received_redundancy, count);
         }
+
+        return std::max(received_nominal, received_redundancy);
+    }
+
+
+    int32_t Link::readMultiplexed(int32_t count)
+    {
+        // Crossover: a frame sent on the nominal interface comes back on the redundancy one.
+        AbstractSocket* sockets[] = {socket_redundancy_.get(), socket_nominal_.get()};
+        std::vector<Frame>* frames[] = {&rx_from_redundancy_, &rx_from_nominal_};
+        int32_t* lent[] = {&lent_redundancy_, &lent_nominal_};
+        int32_t received[] = {0, 0};
+
+        // Wait on both interfaces at once. Done when one path brought the whole batch back and the other one either
+        // did too or is quiet (nothing received in the previous read): a path that does not answer, like the
+        // unplugged side of a line topology, never costs its timeout.
+        nanoseconds deadline = now() + timeout_;
+        while (true)
+        {
+            nanoseconds timeout = timeout_;
+            if (timeout_ >= 0ns)
+            {
+                timeout = std::max(deadline - now(), 0ns);
+            }
+
+            int32_t ready = waitForFrames(sockets, 2, timeout);
+            if (ready == -EOPNOTSUPP)
+            {
+                return ready;
+            }
+            if (ready < 0)
+            {
+                link_error("Fail to wait on the interfaces: %s\n", strerror(-ready));
+                break;
+            }
+            if (ready == 0)
+            {
+                break; // timeout
+            }
+
+            for (int32_t path = 0; path < 2; ++path)
+            {
+                if ((ready & (1 << path)) and (received[path] < count))
+                {
+                    received[path] += readBatch(*sockets[path], *frames[path], received[path], count, 0ns, *lent[path]);
+                }
+            }
+
+            bool done = (std::max(received[0], received[1]) == count);
+            for (int32_t path = 0; path < 2; ++path)
+            {
+                if (path_answering_[path] and (received[path] < count))
+                {
+                    done = false;
+                }
+            }
+            if (done)
+            {
+                break;
+            }
+        }
+
+        for (int32_t path = 0; path < 2; ++path)
+        {
+            if ((received[path] < count) and (waitForFrames(&sockets[path], 1, 0ns) > 0))
+            {
+                // A quiet path that starts answering: take what is already there, without waiting
+                received[path] += readBatch(*sockets[path], *frames[path], received[path], count, 0ns, *lent[path]);
+            }
+            path_answering_[path] = (received[path] > 0);
+        }
+
+        if (received[0] < count)
+        {
+            link_warning("Nominal frame read fail (%" PRIi32 "/%" PRIi32 ")\n", received[0], count);
+        }
+        if (received[1] < count)
+        {
+            link_warning("Redundancy frame read fail (%" PRIi32 "/%" PRIi32 ")\n", received[1], count);
+        }
+        return std::max(received[0], received[1]);
     }
 
 
     void Link::addDatagramToFrame(uint8_t index, enum Command command, uint32_t address, void const* data, uint16_t data_size)
     {
-        frame_nominal_.addDatagram(index, command, address, data, data_size);
+        Frame& frame = tx_frames_[tx_queued_];
+        if ((frame.datagramCounter() == 0) and (not frame.isAttached()))
+        {
+            // Build the frame straight in the nominal socket memory when it lends its buffers
+            void* buffer = socket_nominal_->borrowBuffer();
+            if (buffer != nullptr)
+            {
+                frame.attach(buffer);
+                frame.prepare();
+            }
+        }
+        frame.addDatagram(index, command, address, data, data_size);
     }
 
 
     void Link::resetFrameContext()
     {
-        frame_nominal_.resetContext();
-        frame_redundancy_.resetContext();
+        // TX frames are not touched: the next cycle may already be built in them
+        for (auto& frame : rx_from_nominal_)
+        {
+            frame.resetContext();
+        }
+        for (auto& frame : rx_from_redundancy_)
+        {
+            frame.resetContext();
+        }
     }
 
 
     bool Link::isDatagramAvailable()
     {
-        return frame_nominal_.isDatagramAvailable() or frame_redundancy_.isDatagramAvailable();
+        return frame_nominal_->isDatagramAvailable() or frame_redundancy_->isDatagramAvailable();
     }
 
 
     std::tuple<DatagramHeader const*, uint8_t*, uint16_t> Link::nextDatagram(bool& dropped_pair)
     {
-        bool nom = frame_nominal_.isDatagramAvailable();
-        bool red = frame_redundancy_.isDatagramAvailable();
+        bool nom = frame_nominal_->isDatagramAvailable();
+        bool red = frame_redundancy_->isDatagramAvailable();
 
         // When using the bus without redundancy not nom and red is the used case.
         if (not nom and red)
         {
-            return frame_redundancy_.nextDatagram();
+            return frame_redundancy_->nextDatagram();
         }
 
         if (nom and not red)
         {
-            return frame_nominal_.nextDatagram();
+            return frame_nominal_->nextDatagram();
         }
 
-        auto [header_nominal, data_nominal, wkc_nominal] = frame_nominal_.nextDatagram();
-        auto [header_redundancy, data_redundancy, wkc_redundancy] = frame_redundancy_.nextDatagram();
+        auto [header_nominal, data_nominal, wkc_nominal] = frame_nominal_->nextDatagram();
+        auto [header_redundancy, data_redundancy, wkc_redundancy] = frame_redundancy_->nextDatagram();
 
         if (header_nominal->index != header_redundancy->index)
         {
@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <cstring>
+
+#include "SDOBatch.h"
+
+namespace kickcat
+{
+    using namespace mailbox::request;
+
+    void SDOBatch::Transfer::start(nanoseconds timeout)
+    {
+        if (access_ == Bus::Access::EMULATE_COMPLETE)
+        {
+            // subindex 0 first: it gives the number of subindexes to read
+            count_   = 0;
+            current_ = 0;
+            chunk_   = sizeof(count_);
+            sdo_ = slave_->mailbox.createSDO(index_, 0, false, request_, &count_, &chunk_, timeout);
+            return;
+        }
+
+        uint8_t* data = data_;
+        chunk_ = capacity_;
+        if (not payload_.empty())
+        {
+            data = payload_.data();
+            chunk_ = static_cast<uint32_t>(payload_.size());
+        }
+        sdo_ = slave_->mailbox.createSDO(index_, subindex_, access_ == Bus::Access::COMPLETE, request_, data, &chunk_, timeout);
+    }
+
+
+    bool SDOBatch::Transfer::advance(nanoseconds timeout)
+    {
+        uint32_t status = sdo_->status();
+        if (status == MessageStatus::RUNNING)
+        {
+            return false;
+        }
+        if (status != MessageStatus::SUCCESS)
+        {
+            complete(status);
+            return true;
+        }
+
+        if (access_ != Bus::Access::EMULATE_COMPLETE)
+        {
+            size_ = chunk_;
+            complete(MessageStatus::SUCCESS);
+            return true;
+        }
+
+        if (current_ > 0)
+        {
+            size_ += chunk_;
+        }
+        if (current_ >= count_)
+        {
+            complete(MessageStatus::SUCCESS);
+            return true;
+        }
+
+        chunk_ = capacity_ - size_;
+        if (chunk_ == 0)
+        {
+            complete(MessageStatus::COE_CLIENT_BUFFER_TOO_SMALL);
+            return true;
+        }
+        ++current_;
+        sdo_ = slave_->mailbox.createSDO(index_, current_, false, request_, data_ + size_, &chunk_, timeout);
+        return false;
+    }
+
+
+    void SDOBatch::Transfer::complete(uint32_t status)
+    {
+        sdo_.reset();
+        status_ = status;
+        if (on_completion_)
+        {
+            on_completion_(*this);
+        }
+    }
+
+
+    SDOBatch::SDOBatch(Bus& bus, nanoseconds timeout)
+        : bus_(bus)
+        , timeout_(timeout)
+    {
+    }
+
+
+    SDOBatch::~SDOBatch()
+    {
+        for (auto& queue : queues_)
+        {
+            for (auto& transfer : queue.transfers)
+            {
+                if (transfer->sdo_)
+                {
+                    queue.slave->mailbox.cancel(transfer->sdo_);
+                    transfer->sdo_.reset();
+                }
+                transfer->status_ = MessageStatus::CANCELLED;
+            }
+        }
+    }
+
+
+    SDOBatch::Handle SDOBatch::read(Slave& slave, uint16_t index, uint8_t subindex, Bus::Access CA, void* data, uint32_t data_size,
+                                    Callback on_completion)
+    {
+        auto transfer = std::make_shared<Transfer>();
+        transfer->slave_     = &slave;
+        transfer->index_     = index;
+        transfer->subindex_  = subindex;
+        transfer->access_    = CA;
+        transfer->request_   = CoE::SDO::request::UPLOAD;
+        transfer->data_      = static_cast<uint8_t*>(data);
+        transfer->capacity_  = data_size;
+        transfer->on_completion_ = std::move(on_completion);
+        return enqueue(std::move(transfer));
+    }
+
+
+    SDOBatch::Handle SDOBatch::write(Slave& slave, uint16_t index, uint8_t subindex, Bus::Access CA, void const* data, uint32_t data_size,
+                                     Callback on_completion)
+    {
+        if (CA == Bus::Access::EMULATE_COMPLETE)
+        {
+            THROW_SYSTEM_ERROR_CODE("Emulated complete access not supported for write", ENOTSUP);
+        }
+        if (data_size == 0)
+        {
+            THROW_ERROR("Cannot write an empty SDO");
+        }
+
+        auto transfer = std::make_shared<Transfer>();
+        transfer->slave_     = &slave;
+        transfer->index_     = index;
+        transfer->subindex_  = subindex;
+        transfer->access_    = CA;
+        transfer->request_   = CoE::SDO::request::DOWNLOAD;
+        uint8_t const* raw = static_cast<uint8_t const*>(data);
+        transfer->payload_.assign(raw, raw + data_size);
+        transfer->on_completion_ = std::move(on_completion);
+        return enqueue(std::move(transfer));
+    }
+
+
+    SDOBatch::Handle SDOBatch::enqueue(std::shared_ptr<Transfer> transfer)
+    {
+        if (transfer->slave_->mailbox.recv_size == 0)
+        {
+            THROW_ERROR("This mailbox is inactive");
+        }
+
+        auto it = std::find_if(queues_.begin(), queues_.end(), [&](Queue const& q) { return q.slave == transfer->slave_; });
+        if (it == queues_.end())
+        {
+            queues_.push_back({transfer->slave_, {}});
+            it = std::prev(queues_.end());
+        }
+
+        it->transfers.push_back(transfer);
+        if (it->transfers.size() == 1)
+        {
+            transfer->start(timeout_); // the slave was idle: the transfer goes in the next mailbox round
+        }
+        return transfer;
+    }
+
+
+    void SDOBatch::cancel(Queue& queue)
+    {
+        while (not queue.transfers.empty())
+        {
+            auto transfer = queue.transfers.front();
+            queue.transfers.pop_front();
+            if (transfer->sdo_)
+            {
+                // started by a completion callback while the queue was being cancelled
+                queue.slave->mailbox.cancel(transfer->sdo_);
+            }
+            transfer->complete(MessageStatus::CANCELLED);
+        }
+    }
+
+
+    int32_t SDOBatch::update()
+    {
+        int32_t completed = 0;
+
+        // By index: the completion callbacks may queue transfers to slaves not seen yet
+        for (std::size_t i = 0; i < queues_.size(); ++i)
+        {
+            auto& queue = queues_[i];
+            while (not queue.transfers.empty())
+            {
+                auto transfer = queue.transfers.front();
+                if (not transfer->advance(timeout_))
+                {
+                    break;
+                }
+                queue.transfers.pop_front();
+                ++completed;
+
+                if (transfer->status() != MessageStatus::SUCCESS)
+                {
+                    if (failed_ == nullptr)
+                    {
+                        failed_ = transfer;
+                    }
+                    completed += static_cast<int32_t>(queue.transfers.size());
+                    cancel(queue);
+                    break;
+                }
+
+                if (not queue.transfers.empty())
+                {
+                    queue.transfers.front()->start(timeout_);
+                }
+            }
+        }
+        return completed;
+    }
+
+
+    bool SDOBatch::done() const
+    {
+        return std::all_of(queues_.begin(), queues_.end(), [](Queue const& q) { return q.transfers.empty(); });
+    }
+
+
+    void SDOBatch::wait()
+    {
+        auto error_callback_check = [](DatagramState const& state)
+        {
+            THROW_ERROR_DATAGRAM("error while checking mailboxes", state);
+        };
+
+        auto error_callback_process = [](DatagramState const& state)
+        {
+            THROW_ERROR_DATAGRAM("error while process mailboxes", state);
+        };
+
+        while (not done())
+        {
+            bus_.checkMailboxes(error_callback_check);
+            bus_.processMessages(error_callback_process);
+            if (update() == 0)
+            {
+                sleep(bus_.tiny_wait);
+            }
+        }
+
+        auto failed = std::move(failed_);
+        failed_.reset();
+        if (failed == nullptr)
+        {
+            return;
+        }
+
+        if (failed->isRead())
+        {
+            if (failed->status() == MessageStatus::TIMEDOUT)
+            {
+                THROW_ERROR("Error while reading SDO - Timeout");
+            }
+            THROW_ERROR_CODE("Error while reading SDO", error::category::CoE, failed->status());
+        }
+
+        if (failed->status() == MessageStatus::TIMEDOUT)
+        {
+            THROW_ERROR("Error while writing SDO - Timeout");
+        }
+        THROW_ERROR_CODE("Error while writing SDO", error::category::CoE, failed->status());
+    }
+
+
+    void mapPDO(SDOBatch& batch, Slave& slave, uint16_t pdo_map, uint32_t const* mapping, uint8_t mapping_count, uint16_t sm_map)
+    {
+        if (slave.sii.general.SDO_complete_access)
+        {
+            // One complete access download per record. Subindex 0 is transferred on 16 bits (ETG.1000.6)
+            std::vector<uint8_t> record(2 + mapping_count * sizeof(uint32_t), 0);
+            record[0] = mapping_count;
+            std::memcpy(record.data() + 2, mapping, mapping_count * sizeof(uint32_t));
+            batch.write(slave, pdo_map, 0, Bus::Access::COMPLETE, record.data(), static_cast<uint32_t>(record.size()));
+
+            uint8_t assignment[4] = {1, 0, 0, 0};
+            std::memcpy(assignment + 2, &pdo_map, sizeof(pdo_map));
+            batch.write(slave, sm_map, 0, Bus::Access::COMPLETE, assignment, sizeof(assignment));
+            return;
+        }
+
+        // No complete access: subindex by subindex
+        uint8_t zeroU8 = 0;
+
+        // Unmap previous registers, setting 0 in PDO_MAP subindex 0
+        batch.write(slave, pdo_map, 0, Bus::Access::PARTIAL, &zeroU8, sizeof(zeroU8));
+
+        // Modify mapping, setting register address in PDO's subindexes
+        for (uint8_t i = 0; i < mapping_count; ++i)
+        {
+            batch.write(slave, pdo_map, static_cast<uint8_t>(i + 1), Bus::Access::PARTIAL, mapping + i, sizeof(uint32_t));
+        }
+
+        // Enable mapping by setting number of registers in PDO_MAP subindex 0
+        batch.write(slave, pdo_map, 0, Bus::Access::PARTIAL, &mapping_count, sizeof(mapping_count));
+
+        // Set PDO mapping to SM
+        // Unmap previous mappings, setting 0 in SM_MAP subindex 0
+        batch.write(slave, sm_map, 0, Bus::Access::PARTIAL, &zeroU8, sizeof(zeroU8));
+
+        // Write first mapping (PDO_map) address in SM_MAP subindex 1
+        batch.write(slave, sm_map, 1, Bus::Access::PARTIAL, &pdo_map, sizeof(pdo_map));
+
+        // Save mapping count in SM (here only one PDO_MAP)
+        uint8_t pdoMapSize = 1;
+        batch.write(slave, sm_map, 0, Bus::Access::PARTIAL, &pdoMapSize, sizeof(pdoMapSize));
+    }
+}
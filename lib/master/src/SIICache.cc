@@ -0,0 +1,145 @@
+#include <cstring>
+
+#include "debug.h"
+#include "kickcat/Error.h"
+#include "SIICache.h"
+#include "StateFile.h"
+
+namespace kickcat
+{
+    namespace
+    {
+        constexpr char     MAGIC[4] = {'K', 'S', 'I', 'I'};
+        constexpr uint32_t VERSION  = 1;
+
+        // identity words of the SII header
+        constexpr uint32_t VENDOR_ID_OFFSET = 0x08 * 2;
+    }
+
+
+    SIICache::SIICache(std::string path)
+        : path_(std::move(path))
+    {
+        load();
+    }
+
+
+    SIICache::Identity SIICache::identity(uint8_t const* header)
+    {
+        uint32_t words[4];
+        std::memcpy(words, header + VENDOR_ID_OFFSET, sizeof(words));
+        return {words[0], words[1], words[2], words[3]};
+    }
+
+
+    std::vector<uint8_t> const* SIICache::find(uint8_t const* header) const
+    {
+        auto it = images_.find(identity(header));
+        if (it == images_.end())
+        {
+            return nullptr;
+        }
+
+        if (std::memcmp(it->second.data(), header, HEADER_SIZE) != 0)
+        {
+            return nullptr; // same identity, other content (reflashed EEPROM)
+        }
+        return &it->second;
+    }
+
+
+    void SIICache::store(std::vector<uint8_t> image)
+    {
+        if (image.size() < HEADER_SIZE)
+        {
+            THROW_ERROR("SII image too small to be cached");
+        }
+        if (image.size() > MAX_IMAGE_SIZE)
+        {
+            THROW_ERROR("SII image too large to be cached");
+        }
+
+        auto& cached = images_[identity(image.data())];
+        if (cached != image)
+        {
+            cached = std::move(image);
+            dirty_ = true;
+        }
+    }
+
+
+    void SIICache::load()
+    {
+        auto file = state_file::open(path_);
+        if (file == nullptr)
+        {
+            return; // first run
+        }
+
+        char magic[sizeof(MAGIC)];
+        uint32_t version = 0;
+        bool valid = state_file::get(file.get(), magic)
+                 and (std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0)
+                 and state_file::get(file.get(), version)
+                 and (version == VERSION);
+
+        while (valid)
+        {
+            uint32_t size;
+            if (not state_file::get(file.get(), size))
+            {
+                break; // end of file
+            }
+
+            // the size is checked before the allocation: a corrupted one cannot request gigabytes
+            valid = (size >= HEADER_SIZE) and (size <= MAX_IMAGE_SIZE);
+            if (not valid)
+            {
+                break;
+            }
+
+            std::vector<uint8_t> image(size);
+            valid = (std::fread(image.data(), size, 1, file.get()) == 1);
+            if (valid)
+            {
+                images_[identity(image.data())] = std::move(image);
+            }
+        }
+        file.reset();
+
+        if (not valid)
+        {
+            bus_warning("SII cache %s is corrupted: discarded\n", path_.c_str());
+            images_.clear();
+            dirty_ = true;
+        }
+    }
+
+
+    void SIICache::save()
+    {
+        if (not dirty_)
+        {
+            return;
+        }
+
+        int32_t error = state_file::save(path_, [this](std::FILE* file)
+        {
+            bool written = state_file::put(file, MAGIC)
+                       and state_file::put(file, VERSION);
+            for (auto const& [id, image] : images_)
+            {
+                uint32_t size = static_cast<uint32_t>(image.size());
+                written = written
+                      and state_file::put(file, size)
+                      and (std::fwrite(image.data(), size, 1, file) == 1);
+            }
+            return written;
+        });
+        if (error != 0)
+        {
+            THROW_SYSTEM_ERROR_CODE("Cannot write the SII cache", error);
+        }
+        dirty_ = false;
+    }
+}
@@ -168,6 +168,26 @@ namespace kickcat
         return previous_port;
     }
 
+    bool Slave::PIMapping::bit(int32_t index) const
+    {
+        int32_t position = bit_offset + index;
+        return (data[position / 8] >> (position % 8)) & 1;
+    }
+
+    void Slave::PIMapping::setBit(int32_t index, bool value)
+    {
+        int32_t position = bit_offset + index;
+        uint8_t mask = static_cast<uint8_t>(1 << (position % 8));
+        if (value)
+        {
+            data[position / 8] = static_cast<uint8_t>(data[position / 8] | mask);
+        }
+        else
+        {
+            data[position / 8] = static_cast<uint8_t>(data[position / 8] & ~mask);
+        }
+    }
+
     Slave* findSlaveByAddress(std::vector<Slave>& slaves, uint16_t address)
     {
         auto it = std::find_if(slaves.begin(), slaves.end(),
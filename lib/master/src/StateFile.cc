@@ -0,0 +1,98 @@
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "StateFile.h"
+
+namespace kickcat::state_file
+{
+    namespace
+    {
+        // Push the file content to the storage: a rename is only durable once the data it points to is.
+        bool syncFile(std::FILE* file)
+        {
+            if (std::fflush(file) != 0)
+            {
+                return false;
+            }
+#ifdef _WIN32
+            return ::_commit(::_fileno(file)) == 0;
+#else
+            return ::fsync(::fileno(file)) == 0;
+#endif
+        }
+
+        // Replace path with tmp in one step: std::rename() does not overwrite an existing file on Windows.
+        bool replaceFile(std::string const& tmp, std::string const& path)
+        {
+#ifdef _WIN32
+            return ::MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+            return std::rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+        }
+
+        // Make the rename itself durable: it lives in the parent directory entries.
+        int32_t syncDirectory(std::string const& path)
+        {
+#ifdef _WIN32
+            (void) path; // MOVEFILE_WRITE_THROUGH: the directory entries are committed with the rename
+            return 0;
+#else
+            std::string directory = ".";
+            std::size_t separator = path.rfind('/');
+            if (separator != std::string::npos)
+            {
+                directory = (separator == 0) ? "/" : path.substr(0, separator);
+            }
+
+            int fd = ::open(directory.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                return errno;
+            }
+            int32_t error = 0;
+            if (::fsync(fd) != 0)
+            {
+                error = errno;
+            }
+            ::close(fd);
+            return error;
+#endif
+        }
+    }
+
+
+    File open(std::string const& path)
+    {
+        return File(std::fopen(path.c_str(), "rb"));
+    }
+
+
+    int32_t save(std::string const& path, std::function<bool(std::FILE*)> const& write)
+    {
+        std::string tmp = path + ".tmp";
+        std::FILE* file = std::fopen(tmp.c_str(), "wb");
+        if (file == nullptr)
+        {
+            return errno;
+        }
+
+        bool written = write(file);
+        written = syncFile(file) and written;
+        written = (std::fclose(file) == 0) and written;
+
+        if ((not written) or (not replaceFile(tmp, path)))
+        {
+            std::remove(tmp.c_str());
+            return EIO;
+        }
+        return syncDirectory(path);
+    }
+}
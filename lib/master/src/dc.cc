@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <inttypes.h>
 #include <unordered_map>
 
@@ -28,6 +29,8 @@ namespace kickcat
 
     nanoseconds Bus::enableDC(nanoseconds cycle_time, nanoseconds shift_cycle, nanoseconds start_delay)
     {
+        cycle_period_ = cycle_time;
+
         for (auto& slave : slaves_)
         {
             if (slave.esc.features & ESC::feature::DC_AVAILABLE)
@@ -68,17 +71,43 @@ namespace kickcat
         uint16_t reset = 0x1000;
         broadcastWrite(reg::DC_SPEED_CNT_START, &reset, sizeof(uint16_t));
 
-        // 2. Send multiple FRMW drift compensation frames (15000 from the doc)
+        // 2. Send multiple FRMW drift compensation datagrams (15000 from the doc): full frames, several in flight,
+        //    until the system time differences converge
         auto error = [](DatagramState const& state)
         {
             THROW_ERROR_DATAGRAM("Error while doing static drift compensation", state);
         };
 
-        for (int i = 0; i < 15000; ++i)
+        constexpr int32_t BURST = MAX_ETHERCAT_DATAGRAMS * 16; // datagrams in flight: 16 frames (Link max is 255)
+        static_drift_report_ = {};
+        nanoseconds start = kickcat::now();
+        int32_t next_check = static_drift_check_period_;
+        while (static_drift_report_.iterations < static_drift_iterations_)
         {
-            sendDriftCompensation(error);
+            int32_t burst = std::min({BURST, static_drift_iterations_ - static_drift_report_.iterations,
+                                      next_check - static_drift_report_.iterations});
+            for (int32_t i = 0; i < burst; ++i)
+            {
+                sendDriftCompensation(callError<decltype(error)>, toContext(error));
+            }
             link_->processDatagrams();
+            static_drift_report_.iterations += burst;
+
+            if (static_drift_report_.iterations < next_check)
+            {
+                continue;
+            }
+            next_check += static_drift_check_period_;
+            if ((static_drift_threshold_ > 0ns) and isDCSynchronized(static_drift_threshold_))
+            {
+                static_drift_report_.converged = true;
+                break;
+            }
         }
+        static_drift_report_.duration = elapsed_time(start);
+        dc_info("Static drift compensation: %" PRId32 " datagrams in %" PRId64 " us (%s)\n",
+                static_drift_report_.iterations, duration_cast<microseconds>(static_drift_report_.duration).count(),
+                static_drift_report_.converged ? "converged" : "iteration budget spent");
 
         //----------------------- Apply cycle time ----------------------//
         uint32_t cycle_time_raw = static_cast<uint32_t>(cycle_time.count());
@@ -150,6 +179,7 @@ namespace kickcat
 
     void Bus::fetchReceivedTimes()
     {
+        std::size_t queued = 0;
         for (auto& slave : slaves_)
         {
             auto error = [](DatagramState const& state)
@@ -172,6 +202,7 @@ namespace kickcat
                 }
                 return DatagramState::OK;
             };
+            reserveDatagrams(queued, 2);
             link_->addDatagram(Command::FPRD, createAddress(slave.address, reg::DC_RECEIVED_TIME), nullptr, 16, process, error);
 
             auto process_ecat = [&slave](DatagramHeader const*, uint8_t const* data, uint16_t wkc)
@@ -459,6 +490,7 @@ namespace kickcat
         }
 
         // Apply propagation delay to slaves
+        std::size_t queued = 0;
         for (auto& slave : slaves_)
         {
             if (slave.isDCSupport())
@@ -480,6 +512,7 @@ namespace kickcat
                 };
 
                 uint32_t raw_delay = static_cast<uint32_t>(slave.delay.count());
+                reserveDatagrams(queued, 1);
                 link_->addDatagram(Command::FPWR, createAddress(slave.address, reg::DC_SYSTEM_TIME_DELAY), &raw_delay, sizeof(raw_delay), process, error);
             }
         }
@@ -504,6 +537,7 @@ namespace kickcat
             return DatagramState::OK;
         };
 
+        std::size_t queued = 0;
         for (auto& slave : slaves_)
         {
             if (not slave.isDCSupport())
@@ -512,13 +546,55 @@ namespace kickcat
             }
             int64_t raw_dc_time_diff = slave.dc_time_offset.count();
             dc_info("DC slave %d time offset is %ld from DC ref\n", slave.address, slave.dc_time_offset.count());
+            reserveDatagrams(queued, 1);
             link_->addDatagram(Command::FPWR, createAddress(slave.address, reg::DC_SYSTEM_TIME_OFFSET), &raw_dc_time_diff, sizeof(raw_dc_time_diff), process, error);
         }
         link_->processDatagrams();
     }
 
 
+    void Bus::configureStaticDriftCompensation(int32_t max_iterations, nanoseconds threshold, int32_t check_period)
+    {
+        if ((max_iterations < 0) or (check_period <= 0))
+        {
+            THROW_ERROR("Invalid static drift compensation settings");
+        }
+        static_drift_iterations_   = max_iterations;
+        static_drift_threshold_    = threshold;
+        static_drift_check_period_ = check_period;
+    }
+
+
+    DatagramState Bus::captureReferenceTime(void* context, DatagramHeader const*, uint8_t const* data, uint16_t wkc)
+    {
+        Bus* bus = static_cast<DriftHandler*>(context)->bus;
+        if (wkc == 0)
+        {
+            bus->last_ref_time_valid_ = false;
+            dc_error("Invalid working counter:  %" PRIu16 "\n", wkc);
+            return DatagramState::INVALID_WKC;
+        }
+        std::memcpy(&bus->last_ref_system_time_, data, sizeof(uint64_t));
+        bus->last_ref_time_valid_ = true;
+        return DatagramState::OK;
+    }
+
+
+    void Bus::driftError(void* context, DatagramState const& state)
+    {
+        auto* handler = static_cast<DriftHandler*>(context);
+        handler->error(handler->error_context, state);
+    }
+
+
     void Bus::sendDriftCompensation(std::function<void(DatagramState const&)> const& error)
+    {
+        drift_error_ = error;
+        sendDriftCompensation(callError<std::function<void(DatagramState const&)>>, &drift_error_);
+    }
+
+
+    void Bus::sendDriftCompensation(AbstractLink::ErrorCallback error, void* context)
     {
         nanoseconds now = since_ecat_epoch();
         uint64_t raw_now = now.count();
@@ -527,19 +603,9 @@ namespace kickcat
         // with master time: slaves cut from the reference by a ring split track master time instead
         // of being slammed to zero by the redundancy frame copy. The FRMW return payload is the
         // reference slave's live 0x0910 that the master can use to phase-lock its cycle loop.
-        auto capture_ref = [this](DatagramHeader const*, uint8_t const* data, uint16_t wkc)
-        {
-            if (wkc == 0)
-            {
-                last_ref_time_valid_ = false;
-                dc_error("Invalid working counter:  %" PRIu16 "\n", wkc);
-                return DatagramState::INVALID_WKC;
-            }
-            std::memcpy(&last_ref_system_time_, data, sizeof(uint64_t));
-            last_ref_time_valid_ = true;
-            return DatagramState::OK;
-        };
-        link_->addDatagram(Command::FRMW, createAddress(dc_slave_->address, reg::DC_SYSTEM_TIME), &raw_now, sizeof(uint64_t), capture_ref, error);
+        drift_handler_ = {this, error, context};
+        link_->addDatagram(Command::FRMW, createAddress(dc_slave_->address, reg::DC_SYSTEM_TIME), &raw_now, sizeof(uint64_t),
+                           captureReferenceTime, driftError, &drift_handler_);
 
         // Age of the drift timestamp when the caller flushes the datagrams: the payload
         // is already this stale when it leaves the master (live ripple investigation).
@@ -580,6 +646,7 @@ namespace kickcat
             datagram_error = true;
         };
 
+        std::size_t queued = 0;
         for (auto& slave : slaves_)
         {
             if (not slave.isDCSupport() or &slave == dc_slave_)
@@ -600,6 +667,7 @@ namespace kickcat
                 return DatagramState::OK;
             };
 
+            reserveDatagrams(queued, 1);
             link_->addDatagram(Command::FPRD, createAddress(slave.address, reg::DC_SYSTEM_TIME_DIFF), nullptr, sizeof(sync.time_diff_raw), process, error);
         }
         link_->processDatagrams();
@@ -25,7 +25,18 @@ namespace kickcat
         {
             using Bus::Bus;
             std::vector<uint8_t> io_buffer;
+
+            // Error callbacks of the split cyclic API, alive until the datagrams are processed: only a reference count
+            // changes at each cycle, no std::function is copied.
+            nb::object logical_read_error;
+            nb::object logical_write_error;
         };
+
+        void callPython(void* context, DatagramState const& state)
+        {
+            nb::gil_scoped_acquire acquire;
+            (*static_cast<nb::object*>(context))(state);
+        }
     }
 
     void create_bus_python_bindings(nb::module_ &m)
@@ -112,23 +123,13 @@ namespace kickcat
                 })
             .def("send_logical_read", [](PyBus &self, nb::callable error_callback)
                 {
-                    std::function<void(DatagramState const&)> cpp_callback =
-                        [error_callback](DatagramState const& state)
-                        {
-                            nb::gil_scoped_acquire acquire;
-                            error_callback(state);
-                        };
-                    self.sendLogicalRead(cpp_callback);
+                    self.logical_read_error = error_callback;
+                    self.sendLogicalRead(callPython, &self.logical_read_error);
                 })
             .def("send_logical_write", [](PyBus &self, nb::callable error_callback)
                 {
-                    std::function<void(DatagramState const&)> cpp_callback =
-                        [error_callback](DatagramState const& state)
-                        {
-                            nb::gil_scoped_acquire acquire;
-                            error_callback(state);
-                        };
-                    self.sendLogicalWrite(cpp_callback);
+                    self.logical_write_error = error_callback;
+                    self.sendLogicalWrite(callPython, &self.logical_write_error);
                 })
             .def("send_refresh_error_counters", [](PyBus &self, nb::callable error_callback)
                 {
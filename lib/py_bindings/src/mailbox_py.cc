@@ -54,6 +54,7 @@ namespace kickcat
         message_status.attr("SUCCESS") = MessageStatus::SUCCESS;
         message_status.attr("RUNNING") = MessageStatus::RUNNING;
         message_status.attr("TIMEDOUT") = MessageStatus::TIMEDOUT;
+        message_status.attr("CANCELLED") = MessageStatus::CANCELLED;
         message_status.attr("COE_WRONG_SERVICE") = MessageStatus::COE_WRONG_SERVICE;
         message_status.attr("COE_UNKNOWN_SERVICE") = MessageStatus::COE_UNKNOWN_SERVICE;
         message_status.attr("COE_CLIENT_BUFFER_TOO_SMALL") = MessageStatus::COE_CLIENT_BUFFER_TOO_SMALL;
@@ -0,0 +1,59 @@
+#ifndef KICKCAT_SIMULATION_SLAVE_STEPPER_H
+#define KICKCAT_SIMULATION_SLAVE_STEPPER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "kickcat/simulation/SimulatedSlave.h"
+
+namespace kickcat::sim
+{
+    // Runs the slave-side applications (routine, output validation, device
+    // behaviour) between two routed frames. With workers, the slaves are split in
+    // contiguous shards: the caller steps the first one, each worker thread one of
+    // the others, and step() returns at the frame barrier, once every shard is done.
+    // Slaves share no state, so the shards need no locking; the ESCs are only
+    // touched by the routing thread outside of step().
+    class SlaveStepper
+    {
+    public:
+        // workers: threads besides the caller (0 steps every slave inline).
+        SlaveStepper(std::vector<SimulatedSlave>& slaves, int32_t workers);
+        ~SlaveStepper();
+
+        SlaveStepper(SlaveStepper const&) = delete;
+        SlaveStepper& operator=(SlaveStepper const&) = delete;
+
+        // Step every slave once; slaves without a device echo input_pattern on their inputs.
+        // Rethrows the first exception raised by a slave of this step.
+        void step(uint8_t input_pattern);
+
+        int32_t workers() const { return static_cast<int32_t>(threads_.size()); }
+
+    private:
+        void stepShard(std::size_t shard);
+        void work(std::size_t shard);
+
+        std::vector<SimulatedSlave>& slaves_;
+        std::vector<std::size_t> bounds_;   // shard i covers [bounds_[i], bounds_[i + 1])
+        std::vector<std::thread> threads_;
+
+        // Frame barrier: step() bumps the generation to release the workers, each
+        // worker decrements pending_ when its shard is done.
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::atomic<uint64_t> generation_{0};
+        std::atomic<int32_t> pending_{0};
+        std::atomic<bool> stop_{false};
+        uint8_t input_pattern_{0};
+
+        std::mutex error_mutex_;
+        std::exception_ptr error_;
+    };
+}
+
+#endif
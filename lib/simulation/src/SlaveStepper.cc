@@ -0,0 +1,165 @@
+#include <algorithm>
+
+#include "kickcat/OS/Time.h"
+#include "kickcat/simulation/SlaveStepper.h"
+
+namespace kickcat::sim
+{
+    namespace
+    {
+        // A worker spins this long for the next frame before sleeping on the condition
+        // variable: cyclic traffic keeps it awake (no wake-up latency on the frame path),
+        // an idle bus does not burn the cores.
+        constexpr nanoseconds SPIN_TIME = 2ms;
+
+        void stepSlave(SimulatedSlave& sim_slave, uint8_t input_pattern)
+        {
+            sim_slave.slave->routine();
+            if (sim_slave.slave->state() == State::SAFE_OP)
+            {
+                // Re-validate every cycle the master is delivering output data (any
+                // byte differs from the 0xFF init) - not once - so the slave recovers
+                // if it drops back from OP (e.g. a transient process-data watchdog).
+                // Input-only slaves reach OP slave-side without this.
+                bool const written = std::any_of(sim_slave.output.begin(), sim_slave.output.end(),
+                    [](uint8_t b) { return b != 0xFF; });
+                if (written)
+                {
+                    sim_slave.slave->validateOutputData();
+                }
+            }
+
+            // A device behaviour (e.g. a DS402 motor) drives its own TxPDO;
+            // the others just echo a rolling test pattern on their inputs.
+            if (sim_slave.device)
+            {
+                sim_slave.device->step();
+            }
+            else
+            {
+                std::fill(sim_slave.input.begin(), sim_slave.input.end(), input_pattern);
+            }
+        }
+    }
+
+
+    SlaveStepper::SlaveStepper(std::vector<SimulatedSlave>& slaves, int32_t workers)
+        : slaves_(slaves)
+    {
+        // No point in more shards than slaves.
+        std::size_t shards = std::min<std::size_t>(static_cast<std::size_t>(std::max(workers, 0)) + 1, slaves_.size());
+        shards = std::max<std::size_t>(shards, 1);
+
+        for (std::size_t i = 0; i <= shards; ++i)
+        {
+            bounds_.push_back(slaves_.size() * i / shards);
+        }
+
+        for (std::size_t shard = 1; shard < shards; ++shard)
+        {
+            threads_.emplace_back(&SlaveStepper::work, this, shard);
+        }
+    }
+
+
+    SlaveStepper::~SlaveStepper()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_.store(true, std::memory_order_release);
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+
+    void SlaveStepper::step(uint8_t input_pattern)
+    {
+        input_pattern_ = input_pattern;
+        if (not threads_.empty())
+        {
+            pending_.store(static_cast<int32_t>(threads_.size()), std::memory_order_relaxed);
+            {
+                // Under the lock: a worker about to sleep cannot miss this generation.
+                std::lock_guard<std::mutex> lock(mutex_);
+                generation_.fetch_add(1, std::memory_order_release);
+            }
+            wake_.notify_all();
+        }
+
+        stepShard(0);
+
+        // Frame barrier: the shards are short, spin instead of sleeping (yield in case
+        // the workers outnumber the free cores).
+        while (pending_.load(std::memory_order_acquire) != 0)
+        {
+            std::this_thread::yield();
+        }
+
+        std::exception_ptr error;
+        {
+            std::lock_guard<std::mutex> lock(error_mutex_);
+            std::swap(error, error_);
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+
+    void SlaveStepper::stepShard(std::size_t shard)
+    {
+        try
+        {
+            for (std::size_t i = bounds_[shard]; i < bounds_[shard + 1]; ++i)
+            {
+                stepSlave(slaves_[i], input_pattern_);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(error_mutex_);
+            if (not error_)
+            {
+                error_ = std::current_exception();
+            }
+        }
+    }
+
+
+    void SlaveStepper::work(std::size_t shard)
+    {
+        uint64_t seen = 0;
+        while (true)
+        {
+            auto released = [&]()
+            {
+                return (generation_.load(std::memory_order_acquire) != seen) or stop_.load(std::memory_order_acquire);
+            };
+
+            nanoseconds start = now();
+            while ((not released()) and (elapsed_time(start) < SPIN_TIME))
+            {
+                std::this_thread::yield();
+            }
+            if (not released())
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, released);
+            }
+
+            if (stop_.load(std::memory_order_acquire))
+            {
+                return;
+            }
+            seen = generation_.load(std::memory_order_acquire);
+
+            stepShard(shard);
+            pending_.fetch_sub(1, std::memory_order_release);
+        }
+    }
+}
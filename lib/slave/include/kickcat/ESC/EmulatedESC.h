@@ -1,7 +1,9 @@
 #ifndef KICKCAT_SLAVE_ESC_EMULATED_ESC_H
 #define KICKCAT_SLAVE_ESC_EMULATED_ESC_H
 
+#include <array>
 #include <filesystem>
+#include <memory>
 
 #include "kickcat/protocol.h"
 #include "kickcat/AbstractESC.h"
@@ -34,6 +36,23 @@ namespace kickcat
         // Access from ECAT POV
         void processDatagram(DatagramHeader* header, void* data, uint16_t* wkc);
 
+        // Logical datagram that maps none of the FMMUs: the memory and the WKC are left untouched, but the internal
+        // logic still runs and the pending ECAT events are still ORed into the IRQ field, as with processDatagram().
+        void passDatagram(DatagramHeader* header);
+
+        // Logical byte ranges [begin, end) of the active FMMUs, and a counter bumped each time they are reconfigured:
+        // the network indexes them to process a logical datagram only on the overlapping ESCs.
+        struct LogicalRange
+        {
+            uint32_t begin;
+            uint32_t end;
+        };
+        std::vector<LogicalRange> logicalRanges() const;
+        uint32_t fmmuRevision() const { return fmmu_revision_; }
+
+        // Host memory held by this ESC: the object itself, the allocated process data RAM pages and the EEPROM.
+        std::size_t residentMemory() const;
+
         // Access from the PDI POV
         int32_t read (uint16_t address, void* data,       uint16_t size) override;
         int32_t write(uint16_t address, void const* data, uint16_t size) override;
@@ -181,11 +200,21 @@ namespace kickcat
             uint8_t padding28[96];
 
             uint8_t user_ram[128];
-
-            uint8_t process_data_ram[0xf000];   // 60KB max following documentation
         }__attribute__((__packed__));
 
         Memory memory_;
+
+        // The process data RAM (60KB max following documentation) is paged: most slaves only use a few hundred bytes
+        // of it. A page is allocated on its first write, an unallocated page reads as zeros.
+        static constexpr uint32_t MEMORY_SIZE   = 0x10000;
+        static constexpr uint32_t RAM_ADDRESS   = 0x1000;
+        static constexpr uint32_t RAM_PAGE_SIZE = 0x400;
+        static_assert(sizeof(Memory) == RAM_ADDRESS, "the registers map shall end where the RAM begins");
+        std::array<std::unique_ptr<uint8_t[]>, (MEMORY_SIZE - RAM_ADDRESS) / RAM_PAGE_SIZE> ram_pages_;
+
+        // Access to the flat ESC address space, registers and RAM, without any access right check
+        void readMemory (uint32_t address, void* data,       uint32_t size) const;
+        void writeMemory(uint32_t address, void const* data, uint32_t size);
         std::vector<uint16_t> eeprom_;      // EEPPROM addressing is word/16 bits
 
         struct SM
@@ -197,12 +226,12 @@ namespace kickcat
         };
         std::vector<SM> syncs_;
 
-        // physical is a flat offset into the ESC memory map, so one FMMU list covers
-        // both process-data RAM and register space (e.g. an SM mailbox-status bit).
+        // physical_address is a flat offset into the ESC memory map, so one FMMU list
+        // covers both process-data RAM and register space (e.g. an SM mailbox-status bit).
         struct Fmmu
         {
             uint32_t logical_address;
-            uint8_t* physical;
+            uint32_t physical_address;
             uint32_t bit_length;
             uint8_t  logical_start_bit;
             uint8_t  physical_start_bit;
@@ -210,12 +239,18 @@ namespace kickcat
         };
         std::vector<Fmmu> fmmus_;
         bool has_output_fmmu_{false};   // process-data watchdog only applies when outputs exist
+        uint32_t fmmu_revision_{0};
 
         void loadEeprom();
 
         void processEcatRequest(DatagramHeader* header, void* data, uint16_t* wkc);
         void processInternalLogic();
 
+        // ECAT event request (0x210): AL status event, cleared by an ECAT read of AL_STATUS.
+        // The unmasked events are ORed into the IRQ field of every datagram.
+        void raiseEcatEvents();
+        uint16_t last_al_status_{State::INIT};
+
         void processReadCommand     (DatagramHeader* header, void* data, uint16_t* wkc, uint16_t offset);
         void processWriteCommand    (DatagramHeader* header, void* data, uint16_t* wkc, uint16_t offset);
         void processReadWriteCommand(DatagramHeader* header, void* data, uint16_t* wkc, uint16_t offset);
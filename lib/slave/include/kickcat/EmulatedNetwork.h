@@ -23,6 +23,10 @@ namespace kickcat
     // are precomputed once and only recomputed when a link state changes. The
     // per-frame hot path is then a flat iteration over the precomputed order, with
     // no allocation - same cost as the historical "loop over all slaves".
+    //
+    // Logical datagrams are looked up in an index of the slaves FMMU ranges, rebuilt
+    // when an ESC reconfigures its FMMUs: only the overlapping slaves copy process
+    // data, the others just run their internal logic and raise their events.
     class EmulatedNetwork
     {
     public:
@@ -103,6 +107,17 @@ namespace kickcat
         void computeDlStatus();
         void writeReceiveTimes(size_t node, nanoseconds base);
 
+        // Logical address index: FMMU ranges sorted by start address, tagged with their node.
+        struct LogicalEntry
+        {
+            uint32_t begin;
+            uint32_t end;
+            size_t   node;
+        };
+        bool isLogicalIndexStale() const;
+        void rebuildLogicalIndex();
+        void markLogicalTargets(uint32_t begin, uint32_t end); // tag the nodes overlapping [begin, end)
+
         std::vector<EmulatedESC*> slaves_;
         std::vector<Node>         nodes_;
 
@@ -119,6 +134,13 @@ namespace kickcat
         std::vector<std::array<nanoseconds, PORT_COUNT>> recv_offset_;
         std::vector<nanoseconds> epu_offset_;
 
+        std::vector<LogicalEntry> logical_index_;
+        uint32_t logical_span_ = 0;              // widest FMMU range: bounds the search before a datagram start
+        std::vector<uint32_t> fmmu_revisions_;   // ESC FMMU revisions the index was built from
+        std::vector<uint32_t> logical_marks_;    // per node: logical_stamp_ when the current datagram overlaps it
+        uint32_t logical_stamp_ = 0;
+        bool logical_dirty_ = true;
+
         bool custom_topology_ = false;   // true once connect() drops the default line
         bool ring_intact_ = false;       // head injection reaches the tail injection point
         bool dirty_ = true;
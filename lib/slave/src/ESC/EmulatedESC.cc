@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 
@@ -231,11 +232,91 @@ namespace kickcat
     }
 
 
-    int32_t EmulatedESC::computeInternalMemoryAccess(uint16_t address, void* buffer, uint16_t size, Access access)
+    void EmulatedESC::readMemory(uint32_t address, void* data, uint32_t size) const
     {
-        uint8_t* pos = reinterpret_cast<uint8_t*>(&memory_) + address;
+        uint8_t* out = static_cast<uint8_t*>(data);
+        while (size > 0)
+        {
+            uint32_t chunk;
+            if (address < RAM_ADDRESS)
+            {
+                chunk = std::min(size, RAM_ADDRESS - address);
+                std::memcpy(out, reinterpret_cast<uint8_t const*>(&memory_) + address, chunk);
+            }
+            else
+            {
+                uint32_t const offset = address - RAM_ADDRESS;
+                uint32_t const in_page = offset % RAM_PAGE_SIZE;
+                chunk = std::min(size, RAM_PAGE_SIZE - in_page);
 
-        if (address >= 0x1000)
+                auto const& page = ram_pages_[offset / RAM_PAGE_SIZE];
+                if (page)
+                {
+                    std::memcpy(out, page.get() + in_page, chunk);
+                }
+                else
+                {
+                    std::memset(out, 0, chunk);
+                }
+            }
+            address += chunk;
+            out     += chunk;
+            size    -= chunk;
+        }
+    }
+
+
+    void EmulatedESC::writeMemory(uint32_t address, void const* data, uint32_t size)
+    {
+        uint8_t const* in = static_cast<uint8_t const*>(data);
+        while (size > 0)
+        {
+            uint32_t chunk;
+            if (address < RAM_ADDRESS)
+            {
+                chunk = std::min(size, RAM_ADDRESS - address);
+                std::memcpy(reinterpret_cast<uint8_t*>(&memory_) + address, in, chunk);
+            }
+            else
+            {
+                uint32_t const offset = address - RAM_ADDRESS;
+                uint32_t const in_page = offset % RAM_PAGE_SIZE;
+                chunk = std::min(size, RAM_PAGE_SIZE - in_page);
+
+                auto& page = ram_pages_[offset / RAM_PAGE_SIZE];
+                if (not page)
+                {
+                    page = std::make_unique<uint8_t[]>(RAM_PAGE_SIZE); // zero filled
+                }
+                std::memcpy(page.get() + in_page, in, chunk);
+            }
+            address += chunk;
+            in      += chunk;
+            size    -= chunk;
+        }
+    }
+
+
+    std::size_t EmulatedESC::residentMemory() const
+    {
+        std::size_t size = sizeof(EmulatedESC);
+        for (auto const& page : ram_pages_)
+        {
+            if (page)
+            {
+                size += RAM_PAGE_SIZE;
+            }
+        }
+        size += eeprom_.capacity() * sizeof(uint16_t);
+        size += syncs_.capacity()  * sizeof(SM);
+        size += fmmus_.capacity()  * sizeof(Fmmu);
+        return size;
+    }
+
+
+    int32_t EmulatedESC::computeInternalMemoryAccess(uint16_t address, void* buffer, uint16_t size, Access access)
+    {
+        if (address >= RAM_ADDRESS)
         {
             uint16_t to_copy = std::min(size, uint16_t(UINT16_MAX - address));
 
@@ -264,7 +345,7 @@ namespace kickcat
                         {
                             return -EAGAIN; // Cannot read mailbox: it is empty
                         }
-                        std::memcpy(buffer, pos, to_copy);
+                        readMemory(address, buffer, to_copy);
 
                         if ((address + size - 1) == (sync.address + sync.size - 1))
                         {
@@ -280,7 +361,7 @@ namespace kickcat
                         {
                             return -EAGAIN; // Cannot write mailbox: it is full
                         }
-                        std::memcpy(pos, buffer, to_copy);
+                        writeMemory(address, buffer, to_copy);
 
                         if ((address + size - 1) == (sync.address + sync.size - 1))
                         {
@@ -298,11 +379,12 @@ namespace kickcat
             {
                 for (auto& fmmu : fmmus_)
                 {
-                    if (fmmu.is_input or (pos < fmmu.physical) or ((pos + to_copy) > (fmmu.physical + fmmu.bit_length / 8)))
+                    if (fmmu.is_input or (address < fmmu.physical_address)
+                        or ((address + to_copy) > (fmmu.physical_address + fmmu.bit_length / 8)))
                     {
                         continue;
                     }
-                    std::memcpy(buffer, pos, to_copy);
+                    readMemory(address, buffer, to_copy);
                     return to_copy;
                 }
             }
@@ -311,11 +393,12 @@ namespace kickcat
             {
                 for (auto& fmmu : fmmus_)
                 {
-                    if ((not fmmu.is_input) or (pos < fmmu.physical) or ((pos + to_copy) > (fmmu.physical + fmmu.bit_length / 8)))
+                    if ((not fmmu.is_input) or (address < fmmu.physical_address)
+                        or ((address + to_copy) > (fmmu.physical_address + fmmu.bit_length / 8)))
                     {
                         continue;
                     }
-                    std::memcpy(pos, buffer, to_copy);
+                    writeMemory(address, buffer, to_copy);
                     return to_copy;
                 }
             }
@@ -325,11 +408,20 @@ namespace kickcat
         }
 
         // register access: cannot overlap memory after register space in one access
-        uint16_t to_copy = std::min(size, uint16_t(0x1000 - address));
+        uint8_t* pos = reinterpret_cast<uint8_t*>(&memory_) + address;
+        uint16_t to_copy = std::min(size, uint16_t(RAM_ADDRESS - address));
         switch (access)
         {
-            case PDI_READ:
             case ECAT_READ:
+            {
+                if ((address <= reg::AL_STATUS) and (reg::AL_STATUS < (address + to_copy)))
+                {
+                    memory_.ecat_event_request &= static_cast<uint16_t>(~EcatEvent::AL_STATUS);
+                }
+                std::memcpy(buffer, pos, to_copy);
+                return to_copy;
+            }
+            case PDI_READ:
             {
                 std::memcpy(buffer, pos, to_copy);
                 return to_copy;
@@ -359,8 +451,45 @@ namespace kickcat
 
     void EmulatedESC::processDatagram(DatagramHeader* header, void* data, uint16_t* wkc)
     {
+        raiseEcatEvents(); // PDI side changes since the previous datagram
         processEcatRequest(header, data, wkc);
         processInternalLogic();
+        raiseEcatEvents();
+        header->irq |= memory_.ecat_event_request & memory_.ecat_event_mask;
+    }
+
+
+    void EmulatedESC::passDatagram(DatagramHeader* header)
+    {
+        raiseEcatEvents();
+        processInternalLogic();
+        raiseEcatEvents();
+        header->irq |= memory_.ecat_event_request & memory_.ecat_event_mask;
+    }
+
+
+    std::vector<EmulatedESC::LogicalRange> EmulatedESC::logicalRanges() const
+    {
+        // Same byte span as copyFmmu(): the bits are rounded out to whole logical bytes
+        std::vector<LogicalRange> ranges;
+        ranges.reserve(fmmus_.size());
+        for (auto const& fmmu : fmmus_)
+        {
+            uint32_t const begin = fmmu.logical_address + fmmu.logical_start_bit / 8;
+            uint32_t const end   = fmmu.logical_address + (fmmu.logical_start_bit + fmmu.bit_length - 1) / 8 + 1;
+            ranges.push_back({begin, end});
+        }
+        return ranges;
+    }
+
+
+    void EmulatedESC::raiseEcatEvents()
+    {
+        if (memory_.al_status != last_al_status_)
+        {
+            last_al_status_ = memory_.al_status;
+            memory_.ecat_event_request |= EcatEvent::AL_STATUS;
+        }
     }
 
 
@@ -381,14 +510,14 @@ namespace kickcat
             }
             uint32_t const to_copy = max - min;
             uint8_t* frame_p = static_cast<uint8_t*>(frame) + (min - start);
-            uint8_t* phys_p  = fmmu.physical + (min - fmmu.logical_address);
+            uint32_t const physical = fmmu.physical_address + (min - fmmu.logical_address);
             if (read)
             {
-                std::memcpy(frame_p, phys_p, to_copy);
+                readMemory(physical, frame_p, to_copy);
             }
             else
             {
-                std::memcpy(phys_p, frame_p, to_copy);
+                writeMemory(physical, frame_p, to_copy);
                 lastLogicalWrite_ = now();   // update watchdog
             }
             return true;
@@ -407,17 +536,20 @@ namespace kickcat
             uint8_t* frame_byte = static_cast<uint8_t*>(frame) + (logical_byte - start);
             uint8_t const  loff = logical_bit % 8;
             uint32_t const physical_bit = fmmu.physical_start_bit + b;
-            uint8_t* phys_byte = fmmu.physical + (physical_bit / 8);
+            uint32_t const phys_address = fmmu.physical_address + (physical_bit / 8);
             uint8_t const  poff = physical_bit % 8;
+            uint8_t phys_byte;
+            readMemory(phys_address, &phys_byte, 1);
             if (read)
             {
-                uint8_t const bit = (*phys_byte >> poff) & 1u;
+                uint8_t const bit = (phys_byte >> poff) & 1u;
                 *frame_byte = static_cast<uint8_t>((*frame_byte & ~(1u << loff)) | (bit << loff));
             }
             else
             {
                 uint8_t const bit = (*frame_byte >> loff) & 1u;
-                *phys_byte = static_cast<uint8_t>((*phys_byte & ~(1u << poff)) | (bit << poff));
+                phys_byte = static_cast<uint8_t>((phys_byte & ~(1u << poff)) | (bit << poff));
+                writeMemory(phys_address, &phys_byte, 1);
                 wrote = true;
             }
             hit = true;
@@ -682,6 +814,9 @@ namespace kickcat
             }
         }
 
+        // 8 bytes reads, as most ESCs: read-only bit, restored after the master writes
+        memory_.eeprom_control |= eeprom::Control::NB_READ_BYTES;
+
         // Handle eeprom access. Command is in bits [10:8] only: a conformant master
         // sets WR_EN (bit 0) alongside WRITE, so matching on bit 0 too drops writes.
         uint16_t order = memory_.eeprom_control & eeprom::Control::COMMAND;
@@ -689,15 +824,13 @@ namespace kickcat
         {
             case eeprom::Control::READ:
             {
-                if (memory_.eeprom_address + 2 <= eeprom_.size())
+                // Out of bound words read as an unwritten eeprom.
+                // This is a shortcut for emulation, real device should handle the eeprom size.
+                memory_.eeprom_data = UINT64_MAX;
+                if (memory_.eeprom_address < eeprom_.size())
                 {
-                    std::memcpy((void*)&memory_.eeprom_data, eeprom_.data() + memory_.eeprom_address, 4);
-                }
-                else
-                {
-                    // Eeprom address is out of bound: return the default value of an unwritten eeprom.
-                    // This is a shortcut for emulation, real device should handle the eeprom size.
-                    memory_.eeprom_data = UINT64_MAX;
+                    std::size_t words = std::min<std::size_t>(4, eeprom_.size() - memory_.eeprom_address);
+                    std::memcpy((void*)&memory_.eeprom_data, eeprom_.data() + memory_.eeprom_address, words * sizeof(uint16_t));
                 }
                 memory_.eeprom_control &= ~0x0700; // clear order
                 break;
@@ -909,14 +1042,14 @@ namespace kickcat
             // Reject a span that runs past the flat memory map (a non-zero physical start bit
             // can push the last byte one past `length`), else logical access dereferences OOB.
             uint32_t const physical_bytes = (fmmu.physical_start_bit + bit_length + 7u) / 8u;
-            if (static_cast<std::size_t>(fmmu.physical_address) + physical_bytes > sizeof(memory_))
+            if (static_cast<std::size_t>(fmmu.physical_address) + physical_bytes > MEMORY_SIZE)
             {
                 continue;
             }
 
             Fmmu f;
             f.logical_address    = fmmu.logical_address;
-            f.physical           = reinterpret_cast<uint8_t*>(&memory_) + fmmu.physical_address;
+            f.physical_address   = fmmu.physical_address;
             f.bit_length         = bit_length;
             f.logical_start_bit  = fmmu.logical_start_bit;
             f.physical_start_bit = fmmu.physical_start_bit;
@@ -928,6 +1061,7 @@ namespace kickcat
             fmmus_.push_back(f);
         }
         lastLogicalWrite_ = now();  // restart the output watchdog window at PDO (re)config
+        ++fmmu_revision_;
     }
 
 
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "kickcat/EmulatedNetwork.h"
 
 namespace kickcat
@@ -39,6 +41,11 @@ namespace kickcat
             }
         }
 
+        bool isLogical(Command command)
+        {
+            return (command == Command::LRD) or (command == Command::LWR) or (command == Command::LRW);
+        }
+
         // Cable propagation delay between two ESCs. Kept at zero for now: the per-ESC
         // forwarding delay alone yields ordered, non-degenerate port deltas.
         constexpr nanoseconds CABLE_DELAY = 0ns;
@@ -325,6 +332,75 @@ namespace kickcat
         esc->write(reg::DC_ECAT_RECEIVED_TIME, &epu, sizeof(epu));
     }
 
+    bool EmulatedNetwork::isLogicalIndexStale() const
+    {
+        if (logical_dirty_)
+        {
+            return true;
+        }
+        for (size_t i = 0; i < nodes_.size(); ++i)
+        {
+            if (nodes_[i].esc->fmmuRevision() != fmmu_revisions_[i])
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void EmulatedNetwork::rebuildLogicalIndex()
+    {
+        logical_index_.clear();
+        logical_span_ = 0;
+        fmmu_revisions_.resize(nodes_.size());
+        for (size_t i = 0; i < nodes_.size(); ++i)
+        {
+            fmmu_revisions_[i] = nodes_[i].esc->fmmuRevision();
+            for (auto const& range : nodes_[i].esc->logicalRanges())
+            {
+                logical_index_.push_back({range.begin, range.end, i});
+                logical_span_ = std::max(logical_span_, range.end - range.begin);
+            }
+        }
+        std::sort(logical_index_.begin(), logical_index_.end(),
+            [](LogicalEntry const& a, LogicalEntry const& b) { return a.begin < b.begin; });
+
+        logical_marks_.assign(nodes_.size(), 0);
+        logical_stamp_ = 0;
+        logical_dirty_ = false;
+    }
+
+    void EmulatedNetwork::markLogicalTargets(uint32_t begin, uint32_t end)
+    {
+        if (isLogicalIndexStale())
+        {
+            rebuildLogicalIndex();
+        }
+
+        ++logical_stamp_;
+        if (logical_stamp_ == 0)
+        {
+            logical_marks_.assign(nodes_.size(), 0); // stamp wrapped: forget the old marks
+            logical_stamp_ = 1;
+        }
+
+        // A range starting before begin - logical_span_ ends before begin.
+        uint32_t first = 0;
+        if (begin > logical_span_)
+        {
+            first = begin - logical_span_;
+        }
+        auto it = std::lower_bound(logical_index_.begin(), logical_index_.end(), first,
+            [](LogicalEntry const& entry, uint32_t address) { return entry.begin < address; });
+        for (; (it != logical_index_.end()) and (it->begin < end); ++it)
+        {
+            if (it->end > begin)
+            {
+                logical_marks_[it->node] = logical_stamp_;
+            }
+        }
+    }
+
     bool EmulatedNetwork::route(Frame& frame, bool redundancy)
     {
         if (dirty_)
@@ -351,6 +427,12 @@ namespace kickcat
             uint16_t offset = static_cast<uint16_t>(header->address >> 16);
             bool latch = isPhysicalWrite(header->command) and (offset == reg::DC_RECEIVED_TIME);
 
+            bool const logical = isLogical(header->command);
+            if (logical)
+            {
+                markLogicalTargets(header->address, header->address + header->len);
+            }
+
             for (auto const& hop : *order)
             {
                 if (hop.port0_closed)
@@ -364,6 +446,11 @@ namespace kickcat
                     }
                     header->circulating = 1;
                 }
+                if (logical and (logical_marks_[hop.node] != logical_stamp_))
+                {
+                    nodes_[hop.node].esc->passDatagram(header);
+                    continue;
+                }
                 nodes_[hop.node].esc->processDatagram(header, data, wkc);
             }
 
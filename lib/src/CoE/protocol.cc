@@ -47,6 +47,7 @@ namespace kickcat::CoE
             case mailbox::request::MessageStatus::SUCCESS:                     { return "Success";                                                     }
             case mailbox::request::MessageStatus::RUNNING:                     { return "Running";                                                     }
             case mailbox::request::MessageStatus::TIMEDOUT:                    { return "Timedout";                                                    }
+            case mailbox::request::MessageStatus::CANCELLED:                   { return "Cancelled";                                                   }
 
             // custom/internal status code from mailbox - CoE
             case mailbox::request::MessageStatus::COE_WRONG_SERVICE:           { return "CoE wrong service";                                           }
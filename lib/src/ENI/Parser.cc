@@ -0,0 +1,444 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "kickcat/ENI/Parser.h"
+
+using namespace tinyxml2;
+
+namespace kickcat::ENI
+{
+
+namespace
+{
+    [[noreturn]] void fail(std::string const& msg, std::string const& where)
+    {
+        std::string what = "ENI: ";
+        what += msg;
+        what += " in ";
+        what += where;
+        throw std::invalid_argument(what);
+    }
+
+    XMLElement* requireChild(XMLNode* node, char const* name, std::string const& where)
+    {
+        auto element = node->FirstChildElement(name);
+        if (element == nullptr)
+        {
+            fail(std::string{"missing mandatory <"} + name + ">", where);
+        }
+        return element;
+    }
+
+    // ENI numbers are decimal or hexadecimal with the XML "#x" prefix (the "0x" one is accepted too).
+    int64_t parseNumber(char const* raw, std::string const& where)
+    {
+        if (raw == nullptr)
+        {
+            fail("empty numeric value", where);
+        }
+
+        std::string text = raw;
+        int base = 10;
+        if ((text.rfind("#x", 0) == 0) or (text.rfind("0x", 0) == 0) or (text.rfind("0X", 0) == 0))
+        {
+            text = text.substr(2);
+            base = 16;
+        }
+
+        std::size_t end = 0;
+        int64_t value = 0;
+        try
+        {
+            value = std::stoll(text, &end, base);
+        }
+        catch (std::exception const&)
+        {
+            end = 0;
+        }
+        if ((end == 0) or (end != text.size()))
+        {
+            fail(std::string{"invalid numeric value '"} + raw + "'", where);
+        }
+        return value;
+    }
+
+    template<typename T>
+    T requireNumber(XMLNode* parent, char const* child, std::string const& where)
+    {
+        int64_t value = parseNumber(requireChild(parent, child, where)->GetText(), where);
+        // Signed values are accepted for unsigned fields: configurators write auto-increment addresses as negatives.
+        using S = std::make_signed_t<T>;
+        if ((value < std::numeric_limits<S>::min()) or (value > static_cast<int64_t>(std::numeric_limits<T>::max())))
+        {
+            fail(std::string{"value out of range for <"} + child + ">", where);
+        }
+        return static_cast<T>(value);
+    }
+
+    template<typename T>
+    std::optional<T> findNumber(XMLNode* parent, char const* child, std::string const& where)
+    {
+        if (parent->FirstChildElement(child) == nullptr)
+        {
+            return std::nullopt;
+        }
+        return requireNumber<T>(parent, child, where);
+    }
+
+    std::string textOf(XMLNode* parent, char const* child)
+    {
+        auto* element = parent->FirstChildElement(child);
+        if ((element == nullptr) or (element->GetText() == nullptr))
+        {
+            return {};
+        }
+        return element->GetText();
+    }
+
+    std::vector<uint8_t> loadHexBinary(XMLElement* node, std::string const& where)
+    {
+        char const* raw = node->GetText();
+        if (raw == nullptr)
+        {
+            return {};
+        }
+        std::string field = raw;
+        field.erase(std::remove_if(field.begin(), field.end(),
+            [](unsigned char c){ return std::isspace(c) != 0; }), field.end());
+        if (field.size() % 2 != 0)
+        {
+            fail(std::string{"hex binary <"} + node->Value() + "> has odd length", where);
+        }
+
+        std::vector<uint8_t> data;
+        data.reserve(field.size() / 2);
+        for (std::size_t i = 0; i < field.size(); i += 2)
+        {
+            if ((not std::isxdigit(static_cast<unsigned char>(field[i])))
+                or (not std::isxdigit(static_cast<unsigned char>(field[i + 1]))))
+            {
+                fail(std::string{"invalid hex binary <"} + node->Value() + ">", where);
+            }
+            data.push_back(static_cast<uint8_t>(std::stoul(field.substr(i, 2), nullptr, 16)));
+        }
+        return data;
+    }
+
+    std::optional<ProcessData> parseProcessData(XMLElement* node, char const* name, std::string const& where)
+    {
+        auto* image = node->FirstChildElement(name);
+        if (image == nullptr)
+        {
+            return std::nullopt;
+        }
+
+        std::string image_where = where + "/ProcessData/" + name;
+        if (image->NextSiblingElement(name) != nullptr)
+        {
+            fail(std::string{"several <"} + name + "> are not supported", image_where);
+        }
+        ProcessData data;
+        data.bit_start  = requireNumber<uint32_t>(image, "BitStart",  image_where);
+        data.bit_length = requireNumber<uint32_t>(image, "BitLength", image_where);
+        return data;
+    }
+
+    bool isTrue(std::string const& text)
+    {
+        return (text == "true") or (text == "1");
+    }
+
+    Transition parseTransition(char const* text, std::string const& where)
+    {
+        if (text != nullptr)
+        {
+            for (auto const& [transition, label] : TRANSITIONS)
+            {
+                if (std::strcmp(text, label) == 0)
+                {
+                    return transition;
+                }
+            }
+        }
+        fail(std::string{"unknown Transition '"} + (text ? text : "") + "'", where);
+    }
+
+    State parseState(char const* text, std::string const& where)
+    {
+        if (text != nullptr)
+        {
+            if (std::strcmp(text, "INIT")   == 0) { return State::INIT;        }
+            if (std::strcmp(text, "PREOP")  == 0) { return State::PRE_OP;      }
+            if (std::strcmp(text, "SAFEOP") == 0) { return State::SAFE_OP;     }
+            if (std::strcmp(text, "OP")     == 0) { return State::OPERATIONAL; }
+        }
+        fail(std::string{"unknown State '"} + (text ? text : "") + "'", where);
+    }
+
+    bool isLogical(Command command)
+    {
+        return (command == Command::LRD) or (command == Command::LWR) or (command == Command::LRW);
+    }
+
+    // Datagram address: logical for the L commands, Adp/Ado pair for the others.
+    uint32_t parseAddress(XMLElement* node, Command command, std::string const& where)
+    {
+        if (isLogical(command))
+        {
+            return requireNumber<uint32_t>(node, "Addr", where);
+        }
+        uint16_t adp = findNumber<uint16_t>(node, "Adp", where).value_or(0);
+        uint16_t ado = requireNumber<uint16_t>(node, "Ado", where);
+        return createAddress(adp, ado);
+    }
+
+    Command parseCommand(XMLElement* node, std::string const& where)
+    {
+        uint8_t command = requireNumber<uint8_t>(node, "Cmd", where);
+        if (command > static_cast<uint8_t>(Command::FRMW))
+        {
+            fail("unknown command " + std::to_string(command), where);
+        }
+        return static_cast<Command>(command);
+    }
+}
+
+
+Network Parser::loadFile(std::string const& file)
+{
+    XMLError result = doc_.LoadFile(file.c_str());
+    if (result != XML_SUCCESS)
+    {
+        throw std::runtime_error(doc_.ErrorIDToName(result));
+    }
+    return parse();
+}
+
+
+Network Parser::loadString(std::string const& xml)
+{
+    XMLError result = doc_.Parse(xml.c_str());
+    if (result != XML_SUCCESS)
+    {
+        throw std::runtime_error(doc_.ErrorIDToName(result));
+    }
+    return parse();
+}
+
+
+Network Parser::parse()
+{
+    auto* root = doc_.RootElement();
+    if (root == nullptr)
+    {
+        throw std::invalid_argument("ENI: document has no root element");
+    }
+    auto* config = requireChild(root, "Config", "EtherCATConfig");
+
+    Network network;
+    auto* master = requireChild(config, "Master", "Config");
+    if (auto* cmds = master->FirstChildElement("InitCmds"))
+    {
+        network.master_init_cmds = parseInitCmds(cmds, "Master");
+    }
+
+    for (auto* slave = config->FirstChildElement("Slave"); slave != nullptr; slave = slave->NextSiblingElement("Slave"))
+    {
+        network.slaves.push_back(parseSlave(slave));
+    }
+
+    parseCyclic(config, network);
+
+    if (auto* image = config->FirstChildElement("ProcessImage"))
+    {
+        if (auto* inputs = image->FirstChildElement("Inputs"))
+        {
+            network.input_size = requireNumber<uint32_t>(inputs, "ByteSize", "ProcessImage/Inputs");
+        }
+        if (auto* outputs = image->FirstChildElement("Outputs"))
+        {
+            network.output_size = requireNumber<uint32_t>(outputs, "ByteSize", "ProcessImage/Outputs");
+        }
+    }
+
+    return network;
+}
+
+
+std::vector<InitCommand> Parser::parseInitCmds(XMLElement* parent, std::string const& where)
+{
+    std::vector<InitCommand> cmds;
+    for (auto* ic = parent->FirstChildElement("InitCmd"); ic != nullptr; ic = ic->NextSiblingElement("InitCmd"))
+    {
+        cmds.push_back(parseInitCmd(ic, where + "/InitCmd#" + std::to_string(cmds.size())));
+    }
+    return cmds;
+}
+
+
+InitCommand Parser::parseInitCmd(XMLElement* node, std::string const& where)
+{
+    InitCommand cmd;
+    for (auto* t = node->FirstChildElement("Transition"); t != nullptr; t = t->NextSiblingElement("Transition"))
+    {
+        cmd.transitions |= parseTransition(t->GetText(), where);
+    }
+    if (cmd.transitions == 0)
+    {
+        fail("InitCmd has no <Transition>", where);
+    }
+
+    cmd.before_slave = isTrue(textOf(node, "BeforeSlave"));
+    cmd.comment      = textOf(node, "Comment");
+    cmd.command      = parseCommand(node, where);
+    cmd.address      = parseAddress(node, cmd.command, where);
+    cmd.wkc          = findNumber<uint16_t>(node, "Cnt", where);
+    cmd.retries      = findNumber<uint16_t>(node, "Retries", where).value_or(0);
+
+    if (auto* data = node->FirstChildElement("Data"))
+    {
+        cmd.data = loadHexBinary(data, where);
+    }
+    else
+    {
+        cmd.data.resize(requireNumber<uint16_t>(node, "DataLength", where), 0);
+    }
+
+    if (auto* validate = node->FirstChildElement("Validate"))
+    {
+        InitCommand::Validation validation;
+        validation.data = loadHexBinary(requireChild(validate, "Data", where), where);
+        if (auto* mask = validate->FirstChildElement("DataMask"))
+        {
+            validation.mask = loadHexBinary(mask, where);
+            if (validation.mask.size() != validation.data.size())
+            {
+                fail("<Validate> mask and data sizes differ", where);
+            }
+        }
+        validation.timeout = milliseconds(requireNumber<uint32_t>(validate, "Timeout", where));
+        if (validation.data.size() > cmd.data.size())
+        {
+            fail("<Validate> data is bigger than the datagram", where);
+        }
+        cmd.validate = std::move(validation);
+    }
+
+    return cmd;
+}
+
+
+Slave Parser::parseSlave(XMLElement* node)
+{
+    Slave slave;
+    auto* info = requireChild(node, "Info", "Slave");
+    slave.name = textOf(info, "Name");
+
+    std::string where = "Slave '" + slave.name + "'";
+    slave.address      = requireNumber<uint16_t>(info, "PhysAddr", where);
+    slave.position     = findNumber<uint16_t>(info, "AutoIncAddr",  where).value_or(0);
+    slave.vendor_id    = findNumber<uint32_t>(info, "VendorId",     where).value_or(0);
+    slave.product_code = findNumber<uint32_t>(info, "ProductCode",  where).value_or(0);
+    slave.revision     = findNumber<uint32_t>(info, "RevisionNo",   where).value_or(0);
+    slave.serial       = findNumber<uint32_t>(info, "SerialNo",     where).value_or(0);
+
+    if (auto* cmds = node->FirstChildElement("InitCmds"))
+    {
+        slave.init_cmds = parseInitCmds(cmds, where);
+    }
+
+    if (auto* process_data = node->FirstChildElement("ProcessData"))
+    {
+        slave.outputs = parseProcessData(process_data, "Send", where);
+        slave.inputs  = parseProcessData(process_data, "Recv", where);
+    }
+
+    auto* mailbox = node->FirstChildElement("Mailbox");
+    auto* coe = mailbox ? mailbox->FirstChildElement("CoE") : nullptr;
+    auto* coe_cmds = coe ? coe->FirstChildElement("InitCmds") : nullptr;
+    if (coe_cmds != nullptr)
+    {
+        for (auto* ic = coe_cmds->FirstChildElement("InitCmd"); ic != nullptr; ic = ic->NextSiblingElement("InitCmd"))
+        {
+            std::string cmd_where = where + "/CoE/InitCmd#" + std::to_string(slave.coe_init_cmds.size());
+            slave.coe_init_cmds.push_back(parseCoEInitCmd(ic, cmd_where));
+        }
+    }
+    return slave;
+}
+
+
+CoEInitCommand Parser::parseCoEInitCmd(XMLElement* node, std::string const& where)
+{
+    CoEInitCommand cmd;
+    for (auto* t = node->FirstChildElement("Transition"); t != nullptr; t = t->NextSiblingElement("Transition"))
+    {
+        cmd.transitions |= parseTransition(t->GetText(), where);
+    }
+    if (cmd.transitions == 0)
+    {
+        fail("InitCmd has no <Transition>", where);
+    }
+
+    // Ccs 1: SDO download. The uploads only read an object back: there is nothing to replay.
+    uint8_t ccs = requireNumber<uint8_t>(node, "Ccs", where);
+    if (ccs != 1)
+    {
+        fail("unsupported CoE InitCmd <Ccs> " + std::to_string(ccs) + " (only SDO downloads are)", where);
+    }
+
+    char const* complete_access = node->Attribute("CompleteAccess");
+    cmd.complete_access = (complete_access != nullptr) and isTrue(complete_access);
+    cmd.comment  = textOf(node, "Comment");
+    cmd.index    = requireNumber<uint16_t>(node, "Index", where);
+    cmd.subindex = requireNumber<uint8_t>(node, "SubIndex", where);
+    cmd.timeout  = milliseconds(findNumber<uint32_t>(node, "Timeout", where).value_or(0));
+    cmd.data     = loadHexBinary(requireChild(node, "Data", where), where);
+    if (cmd.data.empty())
+    {
+        fail("CoE InitCmd has no <Data>", where);
+    }
+    return cmd;
+}
+
+
+void Parser::parseCyclic(XMLElement* config, Network& network)
+{
+    auto* cyclic = config->FirstChildElement("Cyclic");
+    if (cyclic == nullptr)
+    {
+        return;
+    }
+
+    network.cycle_time = microseconds(findNumber<uint32_t>(cyclic, "CycleTime", "Cyclic").value_or(0));
+    for (auto* frame = cyclic->FirstChildElement("Frame"); frame != nullptr; frame = frame->NextSiblingElement("Frame"))
+    {
+        CyclicFrame cyclic_frame;
+        for (auto* cmd = frame->FirstChildElement("Cmd"); cmd != nullptr; cmd = cmd->NextSiblingElement("Cmd"))
+        {
+            std::string where = "Cyclic/Frame#" + std::to_string(network.frames.size())
+                              + "/Cmd#" + std::to_string(cyclic_frame.commands.size());
+
+            CyclicCommand command;
+            for (auto* state = cmd->FirstChildElement("State"); state != nullptr; state = state->NextSiblingElement("State"))
+            {
+                command.states |= parseState(state->GetText(), where);
+            }
+            command.command       = parseCommand(cmd, where);
+            command.address       = parseAddress(cmd, command.command, where);
+            command.length        = requireNumber<uint16_t>(cmd, "DataLength", where);
+            command.wkc           = findNumber<uint16_t>(cmd, "Cnt", where);
+            command.input_offset  = findNumber<uint32_t>(cmd, "InputOffs", where);
+            command.output_offset = findNumber<uint32_t>(cmd, "OutputOffs", where);
+            cyclic_frame.commands.push_back(command);
+        }
+        network.frames.push_back(std::move(cyclic_frame));
+    }
+}
+
+}
@@ -10,11 +10,17 @@ namespace kickcat
         : ethernet_{pointData<EthernetHeader>(frame_.data())}
         , header_  {pointData<EthercatHeader>(ethernet_)}
         , first_datagram_{pointData<uint8_t>(header_)}
+        , data_    {reinterpret_cast<uint8_t*>(ethernet_)}
     {
-        resetContext();
-
         // cleanup memory
         std::memset(frame_.data(), 0, frame_.size());
+        prepare();
+    }
+
+
+    void Frame::prepare()
+    {
+        resetContext();
 
         // prepare Ethernet header once for the all future communication
         std::memset(ethernet_->dst, 0xFF,    sizeof(ethernet_->dst));      // broadcast
@@ -28,10 +34,26 @@ namespace kickcat
     }
 
 
+    void Frame::attach(void* buffer)
+    {
+        data_ = frame_.data();
+        if (buffer != nullptr)
+        {
+            data_ = static_cast<uint8_t*>(buffer);
+        }
+
+        ethernet_ = pointData<EthernetHeader>(data_);
+        header_   = pointData<EthercatHeader>(ethernet_);
+        first_datagram_ = pointData<uint8_t>(header_);
+        resetContext();
+    }
+
+
     Frame::Frame(void const* data, int32_t data_size)
         : ethernet_ { pointData<EthernetHeader>(frame_.data())  }
         , header_   { pointData<EthercatHeader>(ethernet_)      }
         , first_datagram_{ pointData<uint8_t>(header_)          }
+        , data_     { reinterpret_cast<uint8_t*>(ethernet_)     }
     {
         std::memcpy(frame_.data(), data, data_size);
         resetContext();
@@ -51,7 +73,8 @@ namespace kickcat
         auto last_offset = other.last_datagram_ - other.first_datagram_;
 
         frame_ = std::move(other.frame_);
-        ethernet_ = pointData<EthernetHeader>(frame_.data());
+        data_ = other.isAttached() ? other.data_ : frame_.data(); // external storage is shared, not copied
+        ethernet_ = pointData<EthernetHeader>(data_);
         header_   = pointData<EthercatHeader>(ethernet_);
         first_datagram_ = pointData<uint8_t>(header_);
         next_datagram_  = first_datagram_ + next_offset;
@@ -234,6 +257,12 @@ namespace kickcat
     int32_t readFrame(AbstractSocket& socket, Frame& frame)
     {
         int32_t read = socket.read(frame.data(), ETH_MAX_SIZE);
+        return checkFrame(frame, read);
+    }
+
+
+    int32_t checkFrame(Frame& frame, int32_t read)
+    {
         if (read < 0)
         {
             link_error("read() failed\n");
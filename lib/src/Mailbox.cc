@@ -158,6 +158,23 @@ namespace kickcat::mailbox::request
     }
 
 
+    void Mailbox::cancel(std::shared_ptr<AbstractMessage> const& message)
+    {
+        to_process.remove(message);
+
+        std::queue<std::shared_ptr<AbstractMessage>> kept;
+        while (not to_send.empty())
+        {
+            if (to_send.front() != message)
+            {
+                kept.push(std::move(to_send.front()));
+            }
+            to_send.pop();
+        }
+        to_send = std::move(kept);
+    }
+
+
     bool Mailbox::receive(uint8_t const* raw_message, nanoseconds current_time)
     {
         // remove timedout messages
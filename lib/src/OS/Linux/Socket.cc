@@ -2,11 +2,15 @@
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <poll.h>
 #include <net/if.h>
 #include <linux/if_packet.h>
 #include <linux/ethtool.h>
 #include <linux/sockios.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 
+#include <algorithm>
 #include <cstring>
 
 #include "OS/Linux/Socket.h"
@@ -46,11 +50,131 @@ namespace kickcat
         return interfaces;
     }
 
-    Socket::Socket(nanoseconds coalescing, nanoseconds polling_period)
+    int32_t waitForFrames(AbstractSocket* const* sockets, int32_t count, nanoseconds timeout)
+    {
+        constexpr int32_t MAX_SOCKETS = 32;
+        if ((count <= 0) or (count > MAX_SOCKETS))
+        {
+            return -EINVAL;
+        }
+
+        struct pollfd fds[MAX_SOCKETS];
+        uint32_t busy_polled = 0;   // sockets checked in user space
+        int32_t waited = 0;         // sockets waited on with their descriptor
+        for (int32_t i = 0; i < count; ++i)
+        {
+            fds[i] = {};
+            fds[i].fd = -1; // ignored by ppoll()
+            fds[i].events = POLLIN;
+            if (sockets[i]->pendingFrames() >= 0)
+            {
+                busy_polled |= 1u << i;
+                continue;
+            }
+
+            fds[i].fd = sockets[i]->pollHandle();
+            if (fds[i].fd < 0)
+            {
+                return -EOPNOTSUPP;
+            }
+            ++waited;
+        }
+
+        nanoseconds deadline = now() + timeout;
+        while (true)
+        {
+            uint32_t ready = 0;
+            for (int32_t i = 0; i < count; ++i)
+            {
+                if ((busy_polled & (1u << i)) and (sockets[i]->pendingFrames() > 0))
+                {
+                    ready |= 1u << i;
+                }
+            }
+
+            if (waited > 0)
+            {
+                // Busy-poll: the descriptors are only checked, the loop does the waiting
+                struct timespec wait{0, 0};
+                struct timespec* wait_ptr = &wait;
+                if ((busy_polled == 0) and (ready == 0))
+                {
+                    if (timeout < 0ns)
+                    {
+                        wait_ptr = nullptr;
+                    }
+                    else
+                    {
+                        nanoseconds remaining = std::max(deadline - now(), 0ns);
+                        wait.tv_sec  = static_cast<time_t>(duration_cast<seconds>(remaining).count());
+                        wait.tv_nsec = static_cast<long>((remaining % 1s).count());
+                    }
+                }
+
+                int rc = ::ppoll(fds, static_cast<nfds_t>(count), wait_ptr, nullptr);
+                if (rc < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return -errno;
+                }
+
+                for (int32_t i = 0; i < count; ++i)
+                {
+                    if (fds[i].revents != 0) // POLLERR/POLLHUP included: the read reports the error
+                    {
+                        ready |= 1u << i;
+                    }
+                }
+            }
+
+            if (ready != 0)
+            {
+                return static_cast<int32_t>(ready);
+            }
+            if ((timeout >= 0ns) and (now() >= deadline))
+            {
+                return 0;
+            }
+        }
+    }
+
+
+    namespace
+    {
+        // Room for one SCM_TIMESTAMPING control message
+        constexpr size_t TIMESTAMP_CONTROL_SIZE = CMSG_SPACE(sizeof(struct scm_timestamping));
+
+        // The kernel keeps SO_RCVTIMEO in jiffies (1ms at best, HZ=1000): a finer timeout only costs setsockopt calls
+        constexpr nanoseconds RECEIVE_TIMEOUT_GRANULARITY = 1ms;
+
+        nanoseconds rxTimestamp(struct msghdr& msg, Socket::Timestamping mode)
+        {
+            for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                if ((cmsg->cmsg_level == SOL_SOCKET) and (cmsg->cmsg_type == SCM_TIMESTAMPING))
+                {
+                    struct scm_timestamping stamps;
+                    std::memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+
+                    // ts[0]: software, ts[2]: raw hardware
+                    struct timespec const& stamp = (mode == Socket::Timestamping::HARDWARE) ? stamps.ts[2] : stamps.ts[0];
+                    return seconds{stamp.tv_sec} + nanoseconds{stamp.tv_nsec};
+                }
+            }
+            return 0ns;
+        }
+    }
+
+
+    Socket::Socket(nanoseconds coalescing, nanoseconds polling_period, ReceiveStrategy strategy)
         : AbstractSocket()
         , fd_{-1}
         , coalescing_{coalescing}
         , polling_period_(polling_period)
+        , strategy_{strategy}
     {
 
     }
@@ -145,17 +269,188 @@ namespace kickcat
         {
             THROW_SYSTEM_ERROR("bind()");
         }
+
+        interface_ = interface;
+        if (strategy_ == ReceiveStrategy::KERNEL_BUSY_POLL)
+        {
+            applyReceiveStrategy();
+        }
+        if (timestamping_ != Timestamping::NONE)
+        {
+            applyTimestamping();
+        }
+        updateFlags();
     }
 
     void Socket::setTimeout(nanoseconds timeout)
     {
         timeout_ = timeout;
+        updateFlags();
+    }
+
+    void Socket::setReceiveStrategy(ReceiveStrategy strategy)
+    {
+        bool const kernel_busy_poll = (strategy_ == ReceiveStrategy::KERNEL_BUSY_POLL)
+                                   or (strategy  == ReceiveStrategy::KERNEL_BUSY_POLL);
+        strategy_ = strategy;
+        if (fd_ < 0)
+        {
+            return;
+        }
+
+        if (kernel_busy_poll)
+        {
+            applyReceiveStrategy();
+        }
+        updateFlags();
+    }
+
+    void Socket::applyReceiveStrategy()
+    {
+        int busy_poll = 0;
+        int prefer_busy_poll = 0;
+        if (strategy_ == ReceiveStrategy::KERNEL_BUSY_POLL)
+        {
+            busy_poll = std::max(1, static_cast<int>(duration_cast<microseconds>(polling_period_).count()));
+            prefer_busy_poll = 1;
+        }
+
+        int rc = setsockopt(fd_, SOL_SOCKET, SO_BUSY_POLL, &busy_poll, sizeof(busy_poll));
+        if (rc < 0)
+        {
+            THROW_SYSTEM_ERROR("setsockopt(SO_BUSY_POLL)");
+        }
 
+#ifdef SO_PREFER_BUSY_POLL
+        rc = setsockopt(fd_, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer_busy_poll, sizeof(prefer_busy_poll));
+        if (rc < 0)
+        {
+            // Linux < 5.11: busy polling still happens, but may compete with the NIC interrupts
+            socket_warning("setsockopt(SO_PREFER_BUSY_POLL): %s\n", strerror(errno));
+        }
+#else
+        (void)prefer_busy_poll;
+#endif
+    }
+
+    void Socket::setTimestamping(Timestamping mode)
+    {
+        timestamping_ = mode;
+        last_rx_timestamp_ = 0ns;
+        if (fd_ >= 0)
+        {
+            applyTimestamping();
+        }
+    }
+
+    void Socket::applyTimestamping()
+    {
+        int flags = 0;
+        if (timestamping_ == Timestamping::HARDWARE)
+        {
+            struct hwtstamp_config config{};
+            config.tx_type   = HWTSTAMP_TX_OFF;
+            config.rx_filter = HWTSTAMP_FILTER_ALL;
+
+            struct ifreq ifr{};
+            std::strncpy(ifr.ifr_name, interface_.c_str(), sizeof(ifr.ifr_name)-1);
+            ifr.ifr_data = reinterpret_cast<char*>(&config);
+            if (ioctl(fd_, SIOCSHWTSTAMP, &ifr) < 0)
+            {
+                socket_warning("No hardware RX timestamps on %s (%s): fallback on software ones\n",
+                               interface_.c_str(), strerror(errno));
+                timestamping_ = Timestamping::SOFTWARE;
+            }
+            else
+            {
+                flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+            }
+        }
+        if (timestamping_ == Timestamping::SOFTWARE)
+        {
+            flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        }
+
+        int rc = setsockopt(fd_, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags));
+        if (rc < 0)
+        {
+            THROW_SYSTEM_ERROR("setsockopt(SO_TIMESTAMPING)");
+        }
+    }
+
+    void Socket::updateFlags()
+    {
         flags_ = MSG_DONTWAIT;
         if (timeout_ < 0ns)
         {
             flags_ = 0;
         }
+
+        // Kernel busy polling only happens in blocking reads: bound them with SO_RCVTIMEO (0: infinite).
+        // The link sets the remaining time of its deadline before each read: rounded up to the kernel granularity,
+        // it seldom changes and the option is not set again.
+        nanoseconds receive_timeout = 0ns;
+        if ((strategy_ == ReceiveStrategy::KERNEL_BUSY_POLL) and (timeout_ > 0ns))
+        {
+            int64_t const ticks = (timeout_.count() + RECEIVE_TIMEOUT_GRANULARITY.count() - 1) / RECEIVE_TIMEOUT_GRANULARITY.count();
+            receive_timeout = ticks * RECEIVE_TIMEOUT_GRANULARITY;
+            flags_ = 0;
+        }
+
+        if ((fd_ < 0) or (receive_timeout == receive_timeout_))
+        {
+            return;
+        }
+
+        struct timeval tv;
+        tv.tv_sec  = static_cast<time_t>(duration_cast<seconds>(receive_timeout).count());
+        tv.tv_usec = static_cast<suseconds_t>(duration_cast<microseconds>(receive_timeout % 1s).count());
+        int rc = setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        if (rc < 0)
+        {
+            socket_error("setsockopt(SO_RCVTIMEO): %s\n", strerror(errno));
+            flags_ = MSG_DONTWAIT;
+            return;
+        }
+        receive_timeout_ = receive_timeout;
+    }
+
+    bool Socket::waitForData(nanoseconds deadline)
+    {
+        if (timeout_ < 0ns)
+        {
+            return true;
+        }
+
+        nanoseconds remaining = deadline - now();
+        if (remaining <= 0ns)
+        {
+            return false;
+        }
+
+        switch (strategy_)
+        {
+            case ReceiveStrategy::SLEEP:
+            {
+                sleep(polling_period_);
+                break;
+            }
+            case ReceiveStrategy::BUSY_POLL:
+            case ReceiveStrategy::KERNEL_BUSY_POLL: // the blocking read already waited
+            {
+                break;
+            }
+            case ReceiveStrategy::POLL:
+            {
+                struct pollfd pfd{fd_, POLLIN, 0};
+                struct timespec wait;
+                wait.tv_sec  = static_cast<time_t>(duration_cast<seconds>(remaining).count());
+                wait.tv_nsec = static_cast<long>((remaining % 1s).count());
+                ::ppoll(&pfd, 1, &wait, nullptr); // EINTR or frame: the caller reads again
+                break;
+            }
+        }
+        return true;
     }
 
     void Socket::close() noexcept
@@ -171,19 +466,40 @@ namespace kickcat
             socket_error("close(): %s", strerror(errno)); // we cannot throw here - at least trace the error
         }
         fd_ = -1;
+        receive_timeout_ = 0ns; // a new socket has none
     }
 
     int32_t Socket::read(void* frame, int32_t frame_size)
     {
+        alignas(struct cmsghdr) uint8_t control[TIMESTAMP_CONTROL_SIZE];
+        struct iovec iov{frame, static_cast<size_t>(frame_size)};
+        struct msghdr msg{};
+        msg.msg_iov    = &iov;
+        msg.msg_iovlen = 1;
+
         nanoseconds deadline = now() + timeout_;
-        do
+        while (true)
         {
-            ssize_t read_size = ::recv(fd_, frame, frame_size, flags_);
+            ssize_t read_size = 0;
+            if (timestamping_ == Timestamping::NONE)
+            {
+                read_size = ::recv(fd_, frame, frame_size, flags_);
+            }
+            else
+            {
+                msg.msg_control    = control;
+                msg.msg_controllen = sizeof(control);
+                read_size = ::recvmsg(fd_, &msg, flags_);
+            }
+
             if (read_size < 0)
             {
                 if (errno == EAGAIN)
                 {
-                    sleep(polling_period_);
+                    if (not waitForData(deadline))
+                    {
+                        return -ETIMEDOUT;
+                    }
                     continue;
                 }
                 else
@@ -192,10 +508,12 @@ namespace kickcat
                 }
             }
 
+            if (timestamping_ != Timestamping::NONE)
+            {
+                last_rx_timestamp_ = rxTimestamp(msg, timestamping_);
+            }
             return static_cast<int32_t>(read_size);
-        } while (now() < deadline);
-
-        return -ETIMEDOUT;
+        }
     }
 
     int32_t Socket::write(void const* frame, int32_t frame_size)
@@ -207,4 +525,114 @@ namespace kickcat
         }
         return static_cast<int32_t>(written_size);
     }
+
+
+    int32_t Socket::readBatch(SocketBuffer* frames, int32_t count)
+    {
+        struct mmsghdr msgs[MAX_BATCH];
+        struct iovec   iovs[MAX_BATCH];
+        alignas(struct cmsghdr) uint8_t controls[MAX_BATCH][TIMESTAMP_CONTROL_SIZE];
+
+        // Blocking mode: return as soon as one frame is there, the loop below gathers the others
+        int const flags = flags_ | ((flags_ & MSG_DONTWAIT) ? 0 : MSG_WAITFORONE);
+
+        nanoseconds deadline = now() + timeout_;
+        int32_t received = 0;
+        do
+        {
+            int32_t const chunk = std::min(count - received, MAX_BATCH);
+            std::memset(msgs, 0, sizeof(struct mmsghdr) * static_cast<size_t>(chunk));
+            for (int32_t i = 0; i < chunk; ++i)
+            {
+                iovs[i].iov_base = frames[received + i].data;
+                iovs[i].iov_len  = static_cast<size_t>(frames[received + i].size);
+                msgs[i].msg_hdr.msg_iov    = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+                if (timestamping_ != Timestamping::NONE)
+                {
+                    msgs[i].msg_hdr.msg_control    = controls[i];
+                    msgs[i].msg_hdr.msg_controllen = TIMESTAMP_CONTROL_SIZE;
+                }
+            }
+
+            int rc = ::recvmmsg(fd_, msgs, static_cast<unsigned int>(chunk), flags, nullptr);
+            if (rc < 0)
+            {
+                if (errno == EAGAIN)
+                {
+                    if (not waitForData(deadline))
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                if (received == 0)
+                {
+                    return -errno;
+                }
+                break;
+            }
+
+            for (int32_t i = 0; i < rc; ++i)
+            {
+                frames[received + i].size = static_cast<int32_t>(msgs[i].msg_len);
+            }
+            if ((rc > 0) and (timestamping_ != Timestamping::NONE))
+            {
+                last_rx_timestamp_ = rxTimestamp(msgs[rc - 1].msg_hdr, timestamping_);
+            }
+            received += rc;
+        } while ((received < count) and ((timeout_ < 0ns) or (now() < deadline)));
+
+        if (received == 0)
+        {
+            return -ETIMEDOUT;
+        }
+        return received;
+    }
+
+    int32_t Socket::writeBatch(SocketBuffer const* frames, int32_t count)
+    {
+        struct mmsghdr msgs[MAX_BATCH];
+        struct iovec   iovs[MAX_BATCH];
+
+        int32_t sent = 0;
+        while (sent < count)
+        {
+            int32_t const chunk = std::min(count - sent, MAX_BATCH);
+            std::memset(msgs, 0, sizeof(struct mmsghdr) * static_cast<size_t>(chunk));
+            for (int32_t i = 0; i < chunk; ++i)
+            {
+                iovs[i].iov_base = frames[sent + i].data;
+                iovs[i].iov_len  = static_cast<size_t>(frames[sent + i].size);
+                msgs[i].msg_hdr.msg_iov    = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            int rc = ::sendmmsg(fd_, msgs, static_cast<unsigned int>(chunk), MSG_DONTWAIT);
+            if (rc < 0)
+            {
+                if (sent == 0)
+                {
+                    return -errno;
+                }
+                break;
+            }
+
+            for (int32_t i = 0; i < rc; ++i)
+            {
+                if (static_cast<int32_t>(msgs[i].msg_len) != frames[sent + i].size)
+                {
+                    return sent + i; // partial write: the frame is not on the wire
+                }
+            }
+            sent += rc;
+
+            if (rc < chunk)
+            {
+                break;
+            }
+        }
+        return sent;
+    }
 }
@@ -241,7 +241,46 @@ namespace kickcat
 
     void XdpSocket::freeFrame(uint64_t addr)
     {
-        free_frames_.push_back(addr);
+        free_frames_.push_back(addr & ~static_cast<uint64_t>(FRAME_SIZE - 1)); // RX addresses may carry an offset
+    }
+
+
+    bool XdpSocket::isLent(void const* data) const
+    {
+        uint8_t const* pos = static_cast<uint8_t const*>(data);
+        return (umem_area_ != nullptr) and (pos >= umem_area_)
+           and (pos < umem_area_ + static_cast<uint64_t>(NUM_FRAMES) * FRAME_SIZE);
+    }
+
+
+    uint64_t XdpSocket::chunkOf(void const* data) const
+    {
+        return static_cast<uint64_t>(static_cast<uint8_t const*>(data) - umem_area_);
+    }
+
+
+    void* XdpSocket::borrowBuffer()
+    {
+        if (umem_area_ == nullptr)
+        {
+            return nullptr;
+        }
+
+        uint64_t addr = allocFrame();
+        if (addr == UINT64_MAX)
+        {
+            return nullptr;
+        }
+        return xsk_umem__get_data(umem_area_, addr);
+    }
+
+
+    void XdpSocket::returnBuffer(void* buffer)
+    {
+        if (isLent(buffer))
+        {
+            freeFrame(chunkOf(buffer));
+        }
     }
 
 
@@ -283,31 +322,61 @@ namespace kickcat
     }
 
 
-    int32_t XdpSocket::read(void* frame, int32_t frame_size)
+    int32_t XdpSocket::peekRx(SocketBuffer* frames, int32_t count, bool copy)
     {
-        nanoseconds deadline = now() + timeout_;
+        uint32_t idx = 0;
+        uint32_t received = xsk_ring_cons__peek(&rx_ring_, static_cast<uint32_t>(count), &idx);
+        for (uint32_t i = 0; i < received; ++i)
+        {
+            struct xdp_desc const* desc = xsk_ring_cons__rx_desc(&rx_ring_, idx + i);
+            uint8_t* data = static_cast<uint8_t*>(xsk_umem__get_data(umem_area_, desc->addr));
+            if (copy)
+            {
+                uint32_t copy_len = std::min(static_cast<uint32_t>(frames[i].size), desc->len);
+                std::memcpy(frames[i].data, data, copy_len);
+                frames[i].size = static_cast<int32_t>(copy_len);
+                freeFrame(desc->addr);
+            }
+            else
+            {
+                // The chunk stays out of the fill ring until releaseBatch()
+                frames[i].data = data;
+                frames[i].size = static_cast<int32_t>(desc->len);
+            }
+        }
 
-        do
+        if (received > 0)
         {
-            uint32_t idx = 0;
-            uint32_t received = xsk_ring_cons__peek(&rx_ring_, 1, &idx);
-            if (received > 0)
+            xsk_ring_cons__release(&rx_ring_, received);
+            if (copy)
             {
-                uint64_t addr = xsk_ring_cons__rx_desc(&rx_ring_, idx)->addr;
-                uint32_t len  = xsk_ring_cons__rx_desc(&rx_ring_, idx)->len;
+                refillFillRing();
+            }
+        }
+        return static_cast<int32_t>(received);
+    }
 
-                uint32_t copy_len = std::min(static_cast<uint32_t>(frame_size), len);
-                std::memcpy(frame, xsk_umem__get_data(umem_area_, addr), copy_len);
 
-                xsk_ring_cons__release(&rx_ring_, 1);
-                freeFrame(addr);
-                refillFillRing();
+    int32_t XdpSocket::receive(SocketBuffer* frames, int32_t count, bool copy)
+    {
+        nanoseconds deadline = now() + timeout_;
+        int32_t received = 0;
 
-                return static_cast<int32_t>(copy_len);
+        do
+        {
+            received += peekRx(frames + received, count - received, copy);
+            if (received == count)
+            {
+                break;
             }
 
             if (timeout_ < 0ns)
             {
+                if (received > 0)
+                {
+                    break;
+                }
+
                 struct pollfd pfd = {};
                 pfd.fd     = xsk_socket__fd(xsk_);
                 pfd.events = POLLIN;
@@ -315,48 +384,186 @@ namespace kickcat
                 continue;
             }
 
+            if (now() >= deadline)
+            {
+                break; // no need to sleep past the deadline (e.g. zero timeout drain)
+            }
             sleep(polling_period_);
-        } while (now() < deadline);
+        } while ((timeout_ < 0ns) or (now() < deadline));
 
-        return -ETIMEDOUT;
+        if (received == 0)
+        {
+            return -ETIMEDOUT;
+        }
+        return received;
     }
 
 
-    int32_t XdpSocket::write(void const* frame, int32_t frame_size)
+    int32_t XdpSocket::read(void* frame, int32_t frame_size)
     {
-        if (frame_size < 0 or static_cast<uint32_t>(frame_size) > FRAME_SIZE)
+        SocketBuffer buffer{frame, frame_size};
+        int32_t rc = receive(&buffer, 1, true);
+        if (rc < 0)
+        {
+            return rc;
+        }
+        return buffer.size;
+    }
+
+
+    int32_t XdpSocket::readBatch(SocketBuffer* frames, int32_t count)
+    {
+        return receive(frames, count, true);
+    }
+
+
+    int32_t XdpSocket::readBorrowed(SocketBuffer* frames, int32_t count)
+    {
+        return receive(frames, count, false);
+    }
+
+
+    int XdpSocket::pollHandle() const
+    {
+        if (xsk_ == nullptr)
+        {
+            return -1;
+        }
+        return xsk_socket__fd(xsk_);
+    }
+
+
+    int32_t XdpSocket::pendingFrames()
+    {
+        if (xsk_ring_prod__needs_wakeup(&fill_ring_))
+        {
+            // The driver waits for a syscall to process RX again
+            recvfrom(xsk_socket__fd(xsk_), nullptr, 0, MSG_DONTWAIT, nullptr, nullptr);
+        }
+        return (xsk_cons_nb_avail(&rx_ring_, 1) > 0) ? 1 : 0;
+    }
+
+
+    void XdpSocket::releaseBatch(SocketBuffer const* frames, int32_t count)
+    {
+        for (int32_t i = 0; i < count; ++i)
+        {
+            if (isLent(frames[i].data))
+            {
+                freeFrame(chunkOf(frames[i].data));
+            }
+        }
+        refillFillRing();
+    }
+
+
+    int32_t XdpSocket::prepareTx(SocketBuffer const& frame, uint64_t& addr)
+    {
+        if (frame.size < 0 or static_cast<uint32_t>(frame.size) > FRAME_SIZE)
         {
             return -EINVAL;
         }
 
-        reclaimCompletedTx();
+        if (isLent(frame.data))
+        {
+            // Built in place by the caller: nothing to copy
+            addr = chunkOf(frame.data);
+            return frame.size;
+        }
 
-        uint64_t addr = allocFrame();
+        addr = allocFrame();
         if (addr == UINT64_MAX)
         {
             return -ENOMEM;
         }
 
-        std::memcpy(xsk_umem__get_data(umem_area_, addr), frame, frame_size);
+        std::memcpy(xsk_umem__get_data(umem_area_, addr), frame.data, frame.size);
+        return frame.size;
+    }
 
-        uint32_t idx = 0;
-        if (xsk_ring_prod__reserve(&tx_ring_, 1, &idx) != 1)
+
+    int32_t XdpSocket::write(void const* frame, int32_t frame_size)
+    {
+        SocketBuffer buffer{const_cast<void*>(frame), frame_size};
+        int32_t rc = writeBatch(&buffer, 1);
+        if (rc < 0)
         {
-            freeFrame(addr);
-            return -EAGAIN;
+            return rc;
         }
+        return frame_size;
+    }
 
-        struct xdp_desc* desc = xsk_ring_prod__tx_desc(&tx_ring_, idx);
-        desc->addr = addr;
-        desc->len  = static_cast<uint32_t>(frame_size);
 
-        xsk_ring_prod__submit(&tx_ring_, 1);
+    int32_t XdpSocket::writeBatch(SocketBuffer const* frames, int32_t count)
+    {
+        reclaimCompletedTx();
 
-        if (xsk_ring_prod__needs_wakeup(&tx_ring_))
+        uint64_t addrs[MAX_BATCH];
+        int32_t rc = 0;
+        int32_t sent = 0;
+        while (sent < count)
+        {
+            int32_t const chunk = std::min(count - sent, MAX_BATCH);
+
+            // Resolve every UMEM address first: a reserved TX slot cannot be given back to the ring
+            int32_t ready = 0;
+            while (ready < chunk)
+            {
+                rc = prepareTx(frames[sent + ready], addrs[ready]);
+                if (rc < 0)
+                {
+                    break;
+                }
+                ++ready;
+            }
+
+            uint32_t idx = 0;
+            if (xsk_ring_prod__reserve(&tx_ring_, static_cast<uint32_t>(ready), &idx) != static_cast<uint32_t>(ready))
+            {
+                for (int32_t i = 0; i < ready; ++i)
+                {
+                    if (not isLent(frames[sent + i].data))
+                    {
+                        freeFrame(addrs[i]);
+                    }
+                }
+                rc = -EAGAIN;
+                break;
+            }
+
+            for (int32_t i = 0; i < ready; ++i)
+            {
+                struct xdp_desc* desc = xsk_ring_prod__tx_desc(&tx_ring_, idx + i);
+                desc->addr = addrs[i];
+                desc->len  = static_cast<uint32_t>(frames[sent + i].size);
+            }
+            xsk_ring_prod__submit(&tx_ring_, static_cast<uint32_t>(ready));
+            sent += ready;
+
+            if (ready < chunk)
+            {
+                break;
+            }
+        }
+
+        // Lent buffers go back to the socket whatever the result
+        for (int32_t i = sent; i < count; ++i)
+        {
+            if (isLent(frames[i].data))
+            {
+                freeFrame(chunkOf(frames[i].data));
+            }
+        }
+
+        if ((sent > 0) and xsk_ring_prod__needs_wakeup(&tx_ring_))
         {
             sendto(xsk_socket__fd(xsk_), nullptr, 0, MSG_DONTWAIT, nullptr, 0);
         }
 
-        return frame_size;
+        if (sent == 0)
+        {
+            return rc;
+        }
+        return sent;
     }
 }
@@ -16,4 +16,9 @@ namespace kickcat
     {
         return {}; // Currently no socket supported so no interface to discover/list
     }
+
+    int32_t waitForFrames(AbstractSocket* const*, int32_t, nanoseconds)
+    {
+        return -EOPNOTSUPP;
+    }
 }
@@ -11,6 +11,11 @@ extern "C"
 
 namespace kickcat
 {
+    int32_t waitForFrames(AbstractSocket* const*, int32_t, nanoseconds)
+    {
+        return -EOPNOTSUPP; // SBUF rings are polled by each socket read: the link reads the interfaces in turn
+    }
+
     Socket::Socket(nanoseconds polling_period)
         : AbstractSocket()
         , fd_{}
@@ -46,6 +46,11 @@ namespace kickcat
         return interfaces;
     }
 
+    int32_t waitForFrames(AbstractSocket* const*, int32_t, nanoseconds)
+    {
+        return -EOPNOTSUPP; // pcap handles cannot be multiplexed here: the link reads the interfaces in turn
+    }
+
     Socket::Socket(nanoseconds polling_period)
         : AbstractSocket()
         , fd_{nullptr}
@@ -1,6 +1,8 @@
 #include <algorithm>
 #include <argparse/argparse.hpp>
+#include <cerrno>
 #include <csignal>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <nlohmann/json.hpp>
@@ -12,6 +14,7 @@
 #include "kickcat/helpers.h"
 #include "kickcat/simulation/SimulatedSlave.h"
 #include "kickcat/simulation/SimulatorControlServer.h"
+#include "kickcat/simulation/SlaveStepper.h"
 #include "kickcat/simulation/Topology.h"
 
 using namespace kickcat;
@@ -29,6 +32,7 @@ namespace
         std::string              control_shm;       // break/heal control channel, if any
         std::string              topology_file;
         std::vector<std::string> slave_configs;   // already expanded (see --count)
+        int32_t                  workers{0};      // slave stepping threads besides the RT one
     };
 
     // Parse + validate the CLI. False (after printing the error + usage) on any problem.
@@ -38,7 +42,7 @@ namespace
 
         std::vector<std::string> slave_configs;
         program.add_argument("-i", "--interface")
-            .help("network interface name").required().store_into(opts.interface);
+            .help("network interface name (xdp:<name> for an AF_XDP socket when built with ENABLE_AF_XDP)").required().store_into(opts.interface);
         program.add_argument("-r", "--redundancy")
             .help("redundancy network interface (enables cable-redundancy routing)")
             .default_value(std::string{}).store_into(opts.redundancy_interface);
@@ -48,6 +52,9 @@ namespace
         program.add_argument("--topology")
             .help("JSON topology file: master injection + slave-to-slave links (branching tree)")
             .default_value(std::string{}).store_into(opts.topology_file);
+        program.add_argument("-w", "--workers")
+            .help("threads stepping the slave applications between frames, besides the routing one (0: all inline)")
+            .default_value(0).store_into(opts.workers);
         program.add_argument("-s", "--slaves")
             .help("JSON configuration files for slaves").remaining().store_into(slave_configs);
 
@@ -61,6 +68,11 @@ namespace
             return false;
         }
 
+        if (opts.workers < 0)
+        {
+            std::cerr << "--workers must be positive or null" << std::endl << program;
+            return false;
+        }
         if (slave_configs.empty())
         {
             std::cerr << "No slave configuration files provided" << std::endl << program;
@@ -95,96 +107,186 @@ namespace
         return sim::applyTopology(network, sim::parseTopology(topo, node_count));
     }
 
+    // Frames drained per socket call: recvmmsg/sendmmsg on raw sockets, straight in the UMEM with AF_XDP.
+    constexpr int32_t BATCH_SIZE = 64;
+
+    // One master port of the simulated segment and its batch buffers.
+    struct Port
+    {
+        Port(AbstractSocket* s, bool redundant)
+            : socket{s}
+            , redundant_path{redundant}
+            , frames(BATCH_SIZE)
+            , rx(BATCH_SIZE)
+        {
+            tx.reserve(BATCH_SIZE);
+            lent.reserve(BATCH_SIZE);
+        }
+
+        AbstractSocket*           socket;
+        bool                      redundant_path;   // tail injection order
+        std::vector<Frame>        frames;
+        std::vector<SocketBuffer> rx;
+        std::vector<SocketBuffer> tx;               // routed frames to send back
+        std::vector<SocketBuffer> lent;             // socket buffers to give back once sent
+    };
+
     // Cyclic frame routing until a signal stops the loop. Returns the process exit
     // code (non-zero on a fatal frame-write error).
     int runSimulation(EmulatedNetwork& network, std::vector<sim::SimulatedSlave>& slaves,
-                      AbstractSocket* socket, AbstractSocket* socket_redundancy,
-                      bool redundancy, sim::SimulatorControlServer& control)
+                      sim::SlaveStepper& stepper, AbstractSocket* socket, AbstractSocket* socket_redundancy,
+                      bool redundancy, nanoseconds read_timeout, sim::SimulatorControlServer& control)
     {
         int exit_code = 0;
 
-        // Route one frame received on `in` and send the response the way the physical
-        // layer would: out the opposite master port when the ring is intact, looped
-        // back to the same port when the segment is broken. `redundant_path` picks the
-        // tail injection order. Returns true if a frame was actually serviced.
-        auto serviceFrame = [&](AbstractSocket* in, AbstractSocket* opposite, bool redundant_path)
+        Port ports[] = {{socket, false}, {socket_redundancy, true}};
+        AbstractSocket* sockets[] = {socket, socket_redundancy};
+        int32_t const port_count = redundancy ? 2 : 1;
+
+        // Wait on every port at once and drain them without blocking when the sockets
+        // support it. Otherwise each port is read in turn on its own timeout, one frame
+        // at a time: a batch read would wait for the whole batch.
+        bool const multiplexed = (waitForFrames(sockets, port_count, 0ns) != -EOPNOTSUPP);
+        int32_t batch_size = 1;
+        nanoseconds socket_timeout = read_timeout;
+        if (multiplexed)
+        {
+            batch_size = BATCH_SIZE;
+            socket_timeout = 0ns;
+        }
+        for (int32_t i = 0; i < port_count; ++i)
         {
-            Frame frame;
-            int32_t n = in->read(frame.data(), ETH_MAX_SIZE);
-            if (n <= 0)
+            sockets[i]->setTimeout(socket_timeout);
+        }
+
+        // Route up to batch_size frames received on `in` back to back and send the
+        // responses the way the physical layer would: out the opposite master port
+        // when the ring is intact, looped back to the same port when the segment is
+        // broken. Returns the number of frames serviced.
+        auto serviceFrames = [&](Port& in, Port& opposite) -> int32_t
+        {
+            for (int32_t i = 0; i < batch_size; ++i)
+            {
+                in.rx[i] = {in.frames[i].data(), ETH_MAX_SIZE};
+            }
+
+            int32_t received = 0;
+            if (in.socket->isZeroCopy())
             {
-                return false;
+                received = in.socket->readBorrowed(in.rx.data(), batch_size);
             }
-            if (not network.route(frame, redundant_path))
+            else
             {
-                return true; // frame destroyed by an ESC (circulating flag): nothing to send back
+                received = in.socket->readBatch(in.rx.data(), batch_size);
+            }
+            if (received <= 0)
+            {
+                return 0;
             }
 
-            AbstractSocket* out = in;            // broken segment: loop back to the same port
+            AbstractSocket* out = in.socket;     // broken segment: loop back to the same port
             if (network.ringIntact())
             {
-                out = opposite;                  // intact ring: leave by the opposite port
+                out = opposite.socket;           // intact ring: leave by the opposite port
             }
-            if (out->write(frame.data(), n) < 0)
+
+            in.tx.clear();
+            in.lent.clear();
+            for (int32_t i = 0; i < received; ++i)
+            {
+                Frame& frame = in.frames[i];
+                bool const borrowed = (in.rx[i].data != frame.data());
+                if (borrowed)
+                {
+                    frame.attach(in.rx[i].data); // route the frame in the socket memory
+                }
+
+                if (network.route(frame, in.redundant_path))
+                {
+                    in.tx.push_back(in.rx[i]);
+                    if (borrowed and (out != in.socket))
+                    {
+                        in.lent.push_back(in.rx[i]); // copied by the other socket: give it back once sent
+                    }
+                }
+                else if (borrowed)
+                {
+                    in.lent.push_back(in.rx[i]);     // frame destroyed by an ESC (circulating flag): nothing to send back
+                }
+            }
+
+            // A buffer lent by the output socket itself goes back to it on write
+            int32_t const to_send = static_cast<int32_t>(in.tx.size());
+            if ((to_send > 0) and (out->writeBatch(in.tx.data(), to_send) != to_send))
             {
                 printf("Write back frame: something wrong happened. Aborting...\n");
                 exit_code = -2;
                 running = 0;
             }
-            return true;
+            if (not in.lent.empty())
+            {
+                in.socket->releaseBatch(in.lent.data(), static_cast<int32_t>(in.lent.size()));
+            }
+            for (int32_t i = 0; i < received; ++i)
+            {
+                in.frames[i].attach(nullptr);
+            }
+            return received;
         };
 
         std::vector<nanoseconds> stats;
-        stats.reserve(1000);
+        stats.reserve(1000 + BATCH_SIZE * 2);
         uint32_t iteration_counter = 0;
         uint8_t current_value = 0x11;
         constexpr uint32_t ITER = 1000;
 
         while (running)
         {
-            auto t1 = now();
-
-            bool serviced = serviceFrame(socket, socket_redundancy, false);
-            if (redundancy)
+            uint32_t ready = (1u << port_count) - 1; // not multiplexed: read every port in turn
+            if (multiplexed)
             {
-                serviced |= serviceFrame(socket_redundancy, socket, true);
-            }
-            if (not serviced)
-            {
-                continue;  // both ports idle: re-check `running` (shutdown) and retry
+                int32_t rc = waitForFrames(sockets, port_count, read_timeout);
+                if ((rc == 0) or (rc == -EINTR))
+                {
+                    continue;  // idle (or interrupted): re-check `running` (shutdown) and wait again
+                }
+                if (rc < 0)
+                {
+                    printf("Wait for frames: %s. Aborting...\n", strerror(-rc));
+                    exit_code = -2;
+                    running = 0;
+                    continue;
+                }
+                ready = static_cast<uint32_t>(rc);
             }
 
-            control.drain();
+            auto t1 = now();
 
-            for (auto& sim_slave : slaves)
+            // Drain every queued frame of this wakeup, by batches
+            int32_t serviced = 0;
+            for (int32_t i = 0; i < port_count; ++i)
             {
-                sim_slave.slave->routine();
-                if (sim_slave.slave->state() == State::SAFE_OP)
-                {
-                    // Re-validate every cycle the master is delivering output data (any
-                    // byte differs from the 0xFF init) - not once - so the slave recovers
-                    // if it drops back from OP (e.g. a transient process-data watchdog).
-                    // Input-only slaves reach OP slave-side without this.
-                    bool const written = std::any_of(sim_slave.output.begin(), sim_slave.output.end(),
-                        [](uint8_t b) { return b != 0xFF; });
-                    if (written)
-                    {
-                        sim_slave.slave->validateOutputData();
-                    }
-                }
-
-                // A device behaviour (e.g. a DS402 motor) drives its own TxPDO;
-                // the others just echo a rolling test pattern on their inputs.
-                if (sim_slave.device)
+                if (not (ready & (1u << i)))
                 {
-                    sim_slave.device->step();
+                    continue;
                 }
-                else
+                int32_t received = 0;
+                do
                 {
-                    std::fill(sim_slave.input.begin(), sim_slave.input.end(), current_value);
-                }
+                    received = serviceFrames(ports[i], ports[1 - i]);
+                    serviced += received;
+                } while (multiplexed and (received == batch_size));
+            }
+            if (serviced == 0)
+            {
+                continue;  // every port idle: re-check `running` (shutdown) and retry
             }
 
+            control.drain();
+
+            // Slave applications run between two frames; stepper.step() returns once all are done.
+            stepper.step(current_value);
+
             // Move to next value every ITER iterations: 0x11 -> 0x22 -> ... -> 0xFF -> 0x00.
             if (++iteration_counter >= ITER)
             {
@@ -193,8 +295,10 @@ namespace
                 else                       { current_value += 0x11; }
             }
 
-            auto t2 = now();
-            stats.push_back(t2 - t1);
+            // Per-frame service time: the wakeup work (I/O, routing, slave stepping) shared
+            // by the frames it serviced.
+            nanoseconds const service = (now() - t1) / serviced;
+            stats.insert(stats.end(), static_cast<std::size_t>(serviced), service);
             if (stats.size() >= 1000)
             {
                 std::sort(stats.begin(), stats.end());
@@ -206,13 +310,24 @@ namespace
 
                 control.publishStats(s);
 
+                // Host memory per emulated ESC: the process data RAM pages are only allocated when written
+                std::size_t resident = 0;
+                for (auto const& sim_slave : slaves)
+                {
+                    resident += sim_slave.esc->residentMemory();
+                }
+                if (not slaves.empty())
+                {
+                    resident /= slaves.size();
+                }
+
                 // One overwriting line (\r + trailing pad) instead of a scrolling
                 // log; the GUI shows the live history when launched through KickUI.
-                printf("\rframe proc: min %4llu  max %5llu  avg %4llu \xc2\xb5s  (n=%zu, t=%.0fs)   ",
+                printf("\rframe proc: min %4llu  max %5llu  avg %4llu \xc2\xb5s  (n=%zu, t=%.0fs)  esc mem %zu B/slave   ",
                        static_cast<unsigned long long>(s.min_ns / 1000),
                        static_cast<unsigned long long>(s.max_ns / 1000),
                        static_cast<unsigned long long>(s.avg_ns / 1000),
-                       s.window, seconds_f(since_start()).count());
+                       s.window, seconds_f(since_start()).count(), resident);
                 fflush(stdout);
                 stats.clear();
             }
@@ -298,25 +413,27 @@ int main(int argc, char* argv[])
     }
 
     auto [socket, socket_redundancy] = createSockets(opts.interface, opts.redundancy_interface);
-    // Idle wake-up so SIGINT/SIGTERM is honored. With redundancy both sockets are
-    // polled every loop, so keep the timeout short to stay responsive to the master
-    // (which reads the cross-over port within its own timeout).
+    // Idle wake-up so SIGINT/SIGTERM is honored. With redundancy, sockets that cannot
+    // be waited on together are polled in turn, so keep the timeout short to stay
+    // responsive to the master (which reads the cross-over port within its own timeout).
     nanoseconds read_timeout = 100ms;
     if (redundancy)
     {
         read_timeout = 1ms;
     }
-    socket->setTimeout(read_timeout);
-    if (redundancy)
-    {
-        socket_redundancy->setTimeout(read_timeout);
-    }
 
     for (auto& sim_slave : slaves)
     {
         sim_slave.slave->start();
     }
 
-    return runSimulation(network, slaves, socket.get(), socket_redundancy.get(),
-                         redundancy, control);
+    // Frame routing stays on this thread, the slave applications are sharded on the workers.
+    sim::SlaveStepper stepper(slaves, opts.workers);
+    if (stepper.workers() > 0)
+    {
+        printf("Slave applications stepped on %d worker thread(s)\n", stepper.workers());
+    }
+
+    return runSimulation(network, slaves, stepper, socket.get(), socket_redundancy.get(),
+                         redundancy, read_timeout, control);
 }
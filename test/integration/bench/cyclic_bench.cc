@@ -0,0 +1,202 @@
+// Cyclic process data benchmark: times one LRW cycle (send + answer dispatch) of
+// a mapped bus, with the precompiled cyclic program (Bus::processDataReadWrite)
+// and with the former path that rebuilt every PI frame callback and copied each
+// block IO on its own. The wire is an in-memory echo: it answers each datagram
+// with the working counter the mapping expects, so what is measured is the
+// master overhead only.
+//
+// usage: cyclic_bench [slaves] [cycles]
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "kickcat/Bus.h"
+#include "kickcat/Link.h"
+#include "kickcat/SocketNull.h"
+
+using namespace kickcat;
+
+namespace
+{
+    constexpr int32_t INPUT_SIZE  = 32;
+    constexpr int32_t OUTPUT_SIZE = 32;
+
+    // Echo the written frames back, with the answer working counters
+    class EchoSocket final : public AbstractSocket
+    {
+    public:
+        void open(std::string const&) override {}
+        void setTimeout(nanoseconds) override {}
+        void close() noexcept override {}
+
+        int32_t read(void* frame, int32_t frame_size) override
+        {
+            if (wire_.empty())
+            {
+                return -ETIMEDOUT;
+            }
+
+            auto& next = wire_.front();
+            int32_t size = std::min(frame_size, static_cast<int32_t>(next.size()));
+            std::memcpy(frame, next.data(), static_cast<size_t>(size));
+            wire_.pop_front();
+            return size;
+        }
+
+        int32_t write(void const* data, int32_t size) override
+        {
+            Frame frame(data, size);
+            while (true)
+            {
+                auto [header, payload, wkc] = frame.peekDatagram();
+                if (header == nullptr)
+                {
+                    break;
+                }
+                *wkc = 1;
+                auto it = logical_wkc.find(header->address);
+                if (it != logical_wkc.end())
+                {
+                    *wkc = it->second;
+                }
+            }
+
+            uint8_t const* raw = frame.data();
+            wire_.emplace_back(raw, raw + size);
+            return size;
+        }
+
+        std::map<uint32_t, uint16_t> logical_wkc; // logical address -> LRW answer wkc
+
+    private:
+        std::deque<std::vector<uint8_t>> wire_;
+    };
+
+
+    class BenchBus : public Bus
+    {
+    public:
+        using Bus::Bus;
+
+        void addStaticSlaves(int32_t count)
+        {
+            slaves_.resize(static_cast<size_t>(count));
+            for (int32_t i = 0; i < count; ++i)
+            {
+                auto& slave = slaves_[static_cast<size_t>(i)];
+                slave.address = static_cast<uint16_t>(0x1000 + i);
+                slave.is_static_mapping = true;
+                slave.sii.syncManagers.resize(4);
+                slave.output.sync_manager = 2;
+                slave.output.bsize = OUTPUT_SIZE;
+                slave.input.sync_manager  = 3;
+                slave.input.bsize = INPUT_SIZE;
+            }
+        }
+
+        std::map<uint32_t, uint16_t> expectedWkc() const
+        {
+            std::map<uint32_t, uint16_t> wkc;
+            for (auto const& frame : pi_frames_)
+            {
+                wkc[frame.description.address] = frame.expected_lrw_wkc;
+            }
+            return wkc;
+        }
+
+        // Former cyclic path, kept as the reference: one closure per PI frame and cycle
+        void legacySendLogicalReadWrite(std::function<void(DatagramState const&)> const& error)
+        {
+            for (auto& pi_frame : pi_frames_)
+            {
+                uint8_t* buffer = pi_frame.output_buffer.data();
+                for (auto const& output : pi_frame.outputs)
+                {
+                    std::memcpy(buffer + output.offset, output.iomap, output.size);
+                }
+
+                auto process = [&pi_frame](DatagramHeader const*, uint8_t const* data, uint16_t wkc)
+                {
+                    if (wkc != pi_frame.expected_lrw_wkc)
+                    {
+                        return DatagramState::INVALID_WKC;
+                    }
+
+                    for (auto& input : pi_frame.inputs)
+                    {
+                        std::memcpy(input.iomap, data + input.offset, input.size);
+                    }
+                    return DatagramState::OK;
+                };
+
+                link_->addDatagram(Command::LRW, pi_frame.description.address, buffer,
+                                   static_cast<uint16_t>(pi_frame.description.logical_size), process, error);
+            }
+            link_->processDatagrams();
+        }
+    };
+
+
+    template<typename F>
+    double measure(int32_t cycles, F&& cycle)
+    {
+        for (int32_t i = 0; i < cycles / 10; ++i)
+        {
+            cycle(); // warm-up
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int32_t i = 0; i < cycles; ++i)
+        {
+            cycle();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / cycles;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    int32_t slaves = 60; // configureFMMUs() sends 4 datagrams per slave in one round: 63 max
+    int32_t cycles = 100000;
+    if (argc > 1)
+    {
+        slaves = std::atoi(argv[1]);
+    }
+    if (argc > 2)
+    {
+        cycles = std::atoi(argv[2]);
+    }
+
+    auto socket = std::make_shared<EchoSocket>();
+    auto link = std::make_shared<Link>(socket, std::make_shared<SocketNull>(), [](){});
+    BenchBus bus(link);
+    bus.addStaticSlaves(slaves);
+
+    std::vector<uint8_t> iomap(static_cast<size_t>(slaves * (INPUT_SIZE + OUTPUT_SIZE)));
+    bus.createMapping(iomap.data(), iomap.size());
+    socket->logical_wkc = bus.expectedWkc();
+
+    int64_t errors = 0;
+    auto error = [&errors](DatagramState const&) { ++errors; };
+
+    double legacy   = measure(cycles, [&]() { bus.legacySendLogicalReadWrite(error); });
+    double compiled = measure(cycles, [&]() { bus.processDataReadWrite(error); });
+
+    std::printf("%" PRIi32 " slaves, %zu frame(s), %" PRIi32 " cycles\n",
+                slaves, socket->logical_wkc.size(), cycles);
+    std::printf("  rebuilt per cycle : %8.1f ns/cycle\n", legacy);
+    std::printf("  cyclic program    : %8.1f ns/cycle\n", compiled);
+    if (errors != 0)
+    {
+        std::printf("  %" PRIi64 " datagram errors: the echo is not consistent with the mapping\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,373 @@
+// Master cycle benchmark: drive a Bus against a line of emulated CoE slaves, run in-process
+// through the LoopbackSocket, and report for each line length the time and the heap
+// allocations of the master hot paths:
+//   - init():                  bus discovery, up to PRE_OP
+//   - createMapping():         PDO mapping discovery and process image layout
+//   - processDataReadWrite():  one LRW cycle, in SAFE_OP
+//   - mailbox exchange:        one SDO upload per slave, until every answer is received
+// The slaves are emulated and deterministic: the measured times include their tick (one per
+// frame), so compare runs of the same bench, not with a real wire.
+//
+// usage: master_bench [cycles] [slaves...]    (default: 1000 cycles, 1 10 100 500 slaves)
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "kickcat/Bus.h"
+#include "kickcat/CoE/OD.h"
+#include "kickcat/CoE/mailbox/response.h"
+#include "kickcat/ESC/EmulatedESC.h"
+#include "kickcat/Link.h"
+#include "kickcat/LoopbackSocket.h"
+#include "kickcat/PDO.h"
+#include "kickcat/SIIParser.h"
+#include "kickcat/SocketNull.h"
+#include "kickcat/slave/Slave.h"
+
+#include "mocks/Allocations.h"
+
+using namespace kickcat;
+
+namespace
+{
+    constexpr uint16_t PDO_SIZE = 8; // bytes per direction: two 32 bits entries
+
+    std::vector<uint8_t> coeEeprom()
+    {
+        eeprom::SII sii;
+        sii.strings.push_back(std::string{});
+        sii.info.pdi_control = 0x0005; // SPI PDI: the slave stack drives the AL status
+        sii.info.vendor_id = 0x6A5;
+        sii.info.product_code = 0xB0CAD0;
+        sii.info.standard_recv_mbx_offset = 0x1000;
+        sii.info.standard_recv_mbx_size   = 128;
+        sii.info.standard_send_mbx_offset = 0x1080;
+        sii.info.standard_send_mbx_size   = 128;
+        sii.info.mailbox_protocol = eeprom::MailboxProtocol::CoE;
+        sii.info.size = 0x000F;
+        sii.info.version = 1;
+        sii.general.SDO_set = 1;
+
+        sii.syncManagers.push_back({0x1000, 128,      0x26, 0, 1, SyncManager::MailboxOut});
+        sii.syncManagers.push_back({0x1080, 128,      0x22, 0, 1, SyncManager::MailboxIn});
+        sii.syncManagers.push_back({0x1100, PDO_SIZE, 0x64, 0, 1, SyncManager::Output});
+        sii.syncManagers.push_back({0x1180, PDO_SIZE, 0x20, 0, 1, SyncManager::Input});
+        return sii.serialize();
+    }
+
+
+    CoE::Dictionary coeDictionary()
+    {
+        using CoE::Access::READ;
+        CoE::Dictionary dictionary;
+        auto add = [&](uint16_t index, CoE::ObjectCode code, std::vector<uint32_t> const& entries, uint16_t bitlen)
+        {
+            CoE::Object object{index, code, "", {}};
+            CoE::addEntry<uint8_t>(object, 0, 8, 0, READ, CoE::DataType::UNSIGNED8, "", static_cast<uint8_t>(entries.size()));
+            uint16_t offset = 8;
+            for (uint8_t i = 0; i < entries.size(); ++i)
+            {
+                CoE::DataType type = CoE::DataType::UNSIGNED32;
+                if (bitlen == 8)  { type = CoE::DataType::UNSIGNED8;  }
+                if (bitlen == 16) { type = CoE::DataType::UNSIGNED16; }
+                CoE::addEntry<uint32_t>(object, static_cast<uint8_t>(i + 1), bitlen, offset, READ, type, "", entries[i]);
+                offset = static_cast<uint16_t>(offset + bitlen);
+            }
+            dictionary.push_back(std::move(object));
+        };
+
+        add(0x1600, CoE::ObjectCode::RECORD, {0x70000020, 0x70010020}, 32);
+        add(0x1A00, CoE::ObjectCode::RECORD, {0x60000020, 0x60010020}, 32);
+        add(0x1C00, CoE::ObjectCode::ARRAY,  {SyncManager::MailboxOut, SyncManager::MailboxIn, SyncManager::Output, SyncManager::Input}, 8);
+        add(0x1C12, CoE::ObjectCode::ARRAY,  {0x1600}, 16);
+        add(0x1C13, CoE::ObjectCode::ARRAY,  {0x1A00}, 16);
+
+        // Mapped variables: the slave checks the mapping against them on the way to SAFE_OP
+        for (uint16_t index : {0x6000, 0x6001, 0x7000, 0x7001})
+        {
+            CoE::Object object{index, CoE::ObjectCode::VAR, "", {}};
+            CoE::addEntry<uint32_t>(object, 0, 32, 0, READ | CoE::Access::WRITE, CoE::DataType::UNSIGNED32, "", 0);
+            dictionary.push_back(std::move(object));
+        }
+        return dictionary;
+    }
+
+
+    struct EmulatedSlave
+    {
+        EmulatedSlave()
+            : pdo(&esc)
+            , slave(&esc, &pdo)
+            , mailbox(&esc, 1024)
+            , dictionary(coeDictionary())
+        {
+            esc.loadEeprom(coeEeprom());
+            mailbox.enableCoE(dictionary);
+            slave.setMailbox(&mailbox);
+            slave.setDictionary(&dictionary);
+            pdo.setInput(input, sizeof(input));
+            pdo.setOutput(output, sizeof(output));
+            slave.start();
+        }
+
+        EmulatedESC esc;
+        PDO pdo;
+        slave::Slave slave;
+        mailbox::response::Mailbox mailbox;
+        CoE::Dictionary dictionary;
+        uint8_t input[PDO_SIZE]{};
+        uint8_t output[PDO_SIZE]{};
+    };
+
+
+    // A line of emulated slaves and the bus driving it
+    struct Line
+    {
+        explicit Line(int32_t count)
+        {
+            std::vector<EmulatedESC*> escs;
+            for (int32_t i = 0; i < count; ++i)
+            {
+                slaves.push_back(std::make_unique<EmulatedSlave>());
+                escs.push_back(&slaves.back()->esc);
+            }
+
+            auto tick = [this]()
+            {
+                for (auto& s : slaves)
+                {
+                    s->slave.routine();
+                }
+            };
+            auto socket = std::make_shared<LoopbackSocket>(escs, tick);
+            auto link = std::make_shared<Link>(socket, std::make_shared<SocketNull>(), [](){});
+            link->setTimeout(2ms);
+            bus = std::make_unique<Bus>(link);
+        }
+
+        std::vector<std::unique_ptr<EmulatedSlave>> slaves;
+        std::unique_ptr<Bus> bus;
+    };
+
+
+    class Samples
+    {
+    public:
+        explicit Samples(char const* name)
+            : name_(name)
+        {
+        }
+
+        template<typename F>
+        void measure(F&& f)
+        {
+            AllocationProbe probe;
+            auto start = std::chrono::steady_clock::now();
+            f();
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            allocs_ += probe.count();
+            ns_.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        }
+
+        void report()
+        {
+            if (ns_.empty())
+            {
+                return;
+            }
+
+            std::sort(ns_.begin(), ns_.end());
+            auto percentile = [this](double p)
+            {
+                std::size_t rank = static_cast<std::size_t>(p * static_cast<double>(ns_.size() - 1) + 0.5);
+                return ns_[rank];
+            };
+            int64_t total = 0;
+            for (auto ns : ns_)
+            {
+                total += ns;
+            }
+            double runs = static_cast<double>(ns_.size());
+
+            std::printf("  %-22s %12.0f %12" PRIi64 " %12" PRIi64 " %12" PRIi64 " %10.1f  (%zu runs)\n", name_,
+                        static_cast<double>(total) / runs, percentile(0.5), percentile(0.99), percentile(0.999),
+                        static_cast<double>(allocs_) / runs, ns_.size());
+        }
+
+    private:
+        char const* name_;
+        std::vector<int64_t> ns_;
+        int64_t allocs_{0};
+    };
+
+
+    bool run(int32_t count, int32_t cycles)
+    {
+        auto noop = [](DatagramState const&) {};
+        int32_t errors = 0;
+        auto count_errors = [&errors](DatagramState const&) { ++errors; };
+
+        // Setup: a fresh line per run, the first ones are enough to get the spread
+        int32_t setup_runs = std::max(1, std::min(10, 1000 / count));
+        Samples init{"init()"};
+        Samples mapping{"createMapping()"};
+        std::unique_ptr<Line> line;
+        for (int32_t run = 0; run < setup_runs; ++run)
+        {
+            line = std::make_unique<Line>(count);
+            try
+            {
+                init.measure([&]() { line->bus->init(100ms); });
+                mapping.measure([&]() { line->bus->createMapping(); });
+            }
+            catch (std::exception const& e)
+            {
+                std::printf("  setup failed: %s\n", e.what());
+                return false;
+            }
+        }
+
+        Bus& bus = *line->bus;
+        try
+        {
+            bus.requestState(State::SAFE_OP);
+            bus.waitForState(State::SAFE_OP, 1s, [&]() { bus.processDataReadWrite(noop); });
+        }
+        catch (std::exception const& e)
+        {
+            std::printf("  SAFE_OP not reached: %s\n", e.what());
+            return false;
+        }
+
+        Samples cyclic{"processDataReadWrite()"};
+        for (int32_t i = 0; i < cycles; ++i)
+        {
+            cyclic.measure([&]() { bus.processDataReadWrite(count_errors); });
+        }
+
+        // One SDO upload (the RxPDO assignment count) in flight per slave mailbox
+        Samples exchange{"mailbox exchange"};
+        std::vector<std::shared_ptr<mailbox::request::AbstractMessage>> sdos(bus.slaves().size());
+        std::vector<uint8_t> answers(bus.slaves().size());
+        std::vector<uint32_t> answer_sizes(bus.slaves().size());
+        int32_t mailbox_cycles = std::max(1, cycles / 10);
+        for (int32_t i = 0; i < mailbox_cycles; ++i)
+        {
+            exchange.measure([&]()
+            {
+                for (std::size_t s = 0; s < sdos.size(); ++s)
+                {
+                    // The emulated slaves tick once per frame: a long line takes a while to answer every SDO
+                    answer_sizes[s] = 1;
+                    sdos[s] = bus.slaves()[s].mailbox.createSDO(static_cast<uint16_t>(CoE::SM_CHANNEL + 2), 0, false, CoE::SDO::request::UPLOAD,
+                                                                 &answers[s], &answer_sizes[s], 10s);
+                }
+
+                bool running = true;
+                while (running)
+                {
+                    bus.checkMailboxes(count_errors);
+                    bus.processMessages(count_errors);
+                    running = std::any_of(sdos.begin(), sdos.end(), [](auto const& sdo)
+                    {
+                        return sdo->status() == mailbox::request::MessageStatus::RUNNING;
+                    });
+                }
+            });
+
+            for (auto const& sdo : sdos)
+            {
+                if (sdo->status() != mailbox::request::MessageStatus::SUCCESS)
+                {
+                    ++errors;
+                }
+            }
+        }
+
+        std::size_t resident = 0;
+        for (auto const& slave : line->slaves)
+        {
+            resident += slave->esc.residentMemory();
+        }
+
+        std::printf("  ESC memory: %zu bytes per slave\n", resident / line->slaves.size());
+        std::printf("  %-22s %12s %12s %12s %12s %10s\n", "", "mean ns", "p50 ns", "p99 ns", "p99.9 ns", "allocs");
+        init.report();
+        mapping.report();
+        cyclic.report();
+        exchange.report();
+        if (errors != 0)
+        {
+            std::printf("  %" PRIi32 " datagram or SDO error(s)\n", errors);
+            return false;
+        }
+        return true;
+    }
+
+    // Strictly positive decimal count: no sign, no trailing characters
+    bool parseCount(char const* text, int32_t& count)
+    {
+        if ((text[0] < '0') or (text[0] > '9'))
+        {
+            return false;
+        }
+        char* end = nullptr;
+        errno = 0;
+        long value = std::strtol(text, &end, 10);
+        if ((errno != 0) or (*end != '\0') or (value < 1) or (value > INT32_MAX))
+        {
+            return false;
+        }
+        count = static_cast<int32_t>(value);
+        return true;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    auto usage = [&argv](char const* argument)
+    {
+        std::fprintf(stderr, "invalid argument '%s': a strictly positive number is expected\n", argument);
+        std::fprintf(stderr, "usage: %s [cycles] [slaves...]\n", argv[0]);
+        return 2;
+    };
+
+    int32_t cycles = 1000;
+    if ((argc > 1) and (not parseCount(argv[1], cycles)))
+    {
+        return usage(argv[1]);
+    }
+
+    std::vector<int32_t> lines{1, 10, 100, 500};
+    if (argc > 2)
+    {
+        lines.clear();
+        for (int i = 2; i < argc; ++i)
+        {
+            int32_t count = 0;
+            if (not parseCount(argv[i], count))
+            {
+                return usage(argv[i]);
+            }
+            lines.push_back(count);
+        }
+    }
+
+    bool ok = true;
+    for (auto count : lines)
+    {
+        std::printf("%" PRIi32 " CoE slaves, %" PRIi32 " cycles\n", count, cycles);
+        ok &= run(count, cycles);
+    }
+    if (not ok)
+    {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,211 @@
+// Receive strategy benchmark: round-trip latency of one frame through kickcat::Socket with each
+// ReceiveStrategy. A responder thread echoes the pings on the same interface (loopback by default,
+// or one end of a veth pair / a wired NIC pair), so what is measured is the send + wake-up path of the
+// socket, not an EtherCAT segment. With software RX timestamps, the delay between the frame entering
+// the stack and the read returning is reported too.
+//
+// Requires CAP_NET_RAW (and CAP_NET_ADMIN for the kernel busy poll strategy).
+//
+// usage: socket_latency_bench [interface] [round_trips]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "kickcat/OS/Linux/Socket.h"
+#include "kickcat/protocol.h"
+
+using namespace kickcat;
+
+namespace
+{
+    constexpr uint8_t PING = 0x01;
+    constexpr uint8_t PONG = 0x02;
+
+    struct Probe
+    {
+        EthernetHeader header;
+        uint8_t  kind;
+        uint32_t sequence;
+    } __attribute__((__packed__));
+
+    void prepare(uint8_t* frame, uint8_t kind, uint32_t sequence)
+    {
+        std::memset(frame, 0, ETH_MIN_SIZE);
+        Probe* probe = reinterpret_cast<Probe*>(frame);
+        std::memset(probe->header.dst, 0xFF, sizeof(MAC));
+        std::memcpy(probe->header.src, PRIMARY_IF_MAC, sizeof(MAC));
+        probe->header.type = ETH_ETHERCAT_TYPE;
+        probe->kind = kind;
+        probe->sequence = sequence;
+    }
+
+    // Answer each ping once: AF_PACKET sockets also see the outgoing frames, and loopback delivers them twice.
+    // The responder waits in poll(): a busy loop would compete for the CPU with a busy polling pinger.
+    void respond(std::string const& interface, std::atomic<bool>& running)
+    {
+        Socket socket(-1us, 20us, Socket::ReceiveStrategy::POLL);
+        socket.open(interface);
+        socket.setTimeout(10ms);
+
+        uint8_t frame[ETH_MAX_SIZE];
+        uint32_t answered = 0;
+        while (running)
+        {
+            int32_t rc = socket.read(frame, sizeof(frame));
+            if (rc < static_cast<int32_t>(sizeof(Probe)))
+            {
+                continue;
+            }
+
+            Probe const* probe = reinterpret_cast<Probe const*>(frame);
+            if ((probe->kind != PING) or (probe->sequence <= answered))
+            {
+                continue;
+            }
+            answered = probe->sequence;
+            prepare(frame, PONG, answered);
+            socket.write(frame, ETH_MIN_SIZE);
+        }
+    }
+
+    struct Stats
+    {
+        double min, p50, p99, max;
+    };
+
+    Stats compute(std::vector<double>& samples)
+    {
+        if (samples.empty())
+        {
+            return {0, 0, 0, 0};
+        }
+        std::sort(samples.begin(), samples.end());
+        auto at = [&](double ratio) { return samples[static_cast<size_t>(ratio * static_cast<double>(samples.size() - 1))]; };
+        return {samples.front(), at(0.5), at(0.99), samples.back()};
+    }
+
+    char const* toString(Socket::ReceiveStrategy strategy)
+    {
+        switch (strategy)
+        {
+            case Socket::ReceiveStrategy::SLEEP:            { return "sleep";            }
+            case Socket::ReceiveStrategy::BUSY_POLL:        { return "busy poll";        }
+            case Socket::ReceiveStrategy::KERNEL_BUSY_POLL: { return "kernel busy poll"; }
+            case Socket::ReceiveStrategy::POLL:             { return "poll";             }
+        }
+        return "unknown";
+    }
+
+    void measure(std::string const& interface, Socket::ReceiveStrategy strategy, int32_t round_trips, uint32_t& sequence)
+    {
+        Socket socket(-1us, 20us, strategy);
+        try
+        {
+            socket.open(interface);
+            socket.setTimestamping(Socket::Timestamping::SOFTWARE);
+        }
+        catch (std::exception const& e)
+        {
+            std::printf("  %-17s: skipped (%s)\n", toString(strategy), e.what());
+            return;
+        }
+        socket.setTimeout(10ms);
+
+        std::vector<double> rtt;
+        std::vector<double> wakeup;
+        rtt.reserve(static_cast<size_t>(round_trips));
+        wakeup.reserve(static_cast<size_t>(round_trips));
+        int32_t lost = 0;
+
+        uint8_t frame[ETH_MAX_SIZE];
+        for (int32_t i = 0; i < round_trips; ++i)
+        {
+            ++sequence;
+            prepare(frame, PING, sequence);
+
+            auto start = std::chrono::steady_clock::now();
+            socket.write(frame, ETH_MIN_SIZE);
+            bool answered = false;
+            while (not answered)
+            {
+                int32_t rc = socket.read(frame, sizeof(frame));
+                if (rc < 0)
+                {
+                    break; // timeout
+                }
+
+                Probe const* probe = reinterpret_cast<Probe const*>(frame);
+                answered = (rc >= static_cast<int32_t>(sizeof(Probe))) and (probe->kind == PONG) and (probe->sequence == sequence);
+            }
+            auto stop = std::chrono::steady_clock::now();
+            auto returned = std::chrono::system_clock::now(); // software RX timestamps are CLOCK_REALTIME
+
+            if (not answered)
+            {
+                ++lost;
+                continue;
+            }
+            rtt.push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()) / 1000.0);
+            if (socket.lastRxTimestamp() != 0ns)
+            {
+                auto delay = returned.time_since_epoch() - socket.lastRxTimestamp();
+                wakeup.push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(delay).count()) / 1000.0);
+            }
+        }
+
+        Stats r = compute(rtt);
+        Stats w = compute(wakeup);
+        std::printf("  %-17s: rtt min %7.1f  p50 %7.1f  p99 %7.1f  max %8.1f us | rx->user p50 %6.1f  p99 %7.1f us | lost %" PRIi32 "\n",
+                    toString(strategy), r.min, r.p50, r.p99, r.max, w.p50, w.p99, lost);
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    std::string interface = "lo";
+    int32_t round_trips = 10000;
+    if (argc > 1)
+    {
+        interface = argv[1];
+    }
+    if (argc > 2)
+    {
+        round_trips = std::atoi(argv[2]);
+    }
+
+    std::atomic<bool> running{true};
+    std::thread responder;
+    try
+    {
+        Socket probe;
+        probe.open(interface);
+    }
+    catch (std::exception const& e)
+    {
+        std::printf("Cannot open %s: %s\n", interface.c_str(), e.what());
+        return 1;
+    }
+    responder = std::thread(respond, interface, std::ref(running));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // responder ready
+
+    std::printf("%s, %" PRIi32 " round trips per strategy\n", interface.c_str(), round_trips);
+    uint32_t sequence = 0;
+    for (auto strategy : {Socket::ReceiveStrategy::SLEEP,
+                          Socket::ReceiveStrategy::BUSY_POLL,
+                          Socket::ReceiveStrategy::KERNEL_BUSY_POLL,
+                          Socket::ReceiveStrategy::POLL})
+    {
+        measure(interface, strategy, round_trips, sequence);
+    }
+
+    running = false;
+    responder.join();
+    return 0;
+}
@@ -0,0 +1,296 @@
+// Startup benchmark: time the CoE PDO mapping discovery of Bus::createMapping() on a line of
+// emulated CoE slaves, run in-process. It compares the former sequential walk (one blocking
+// emulated complete access upload after the other, slave by slave) with the concurrent discovery
+// (one SDO in flight per slave mailbox, all the slaves driven by the same mailbox loop).
+//
+// usage: startup_bench [slaves]
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "kickcat/Bus.h"
+#include "kickcat/CoE/OD.h"
+#include "kickcat/CoE/mailbox/response.h"
+#include "kickcat/ESC/EmulatedESC.h"
+#include "kickcat/EmulatedNetwork.h"
+#include "kickcat/Link.h"
+#include "kickcat/PDO.h"
+#include "kickcat/SIIParser.h"
+#include "kickcat/SocketNull.h"
+#include "kickcat/slave/Slave.h"
+
+using namespace kickcat;
+
+namespace
+{
+    constexpr uint16_t PDO_SIZE = 8; // bytes per direction: two 32 bits entries
+
+    // Every master frame goes through the line and the slaves are ticked once. Unlike LoopbackSocket,
+    // the answers are queued: the mailbox loop of a long line spans several frames per round.
+    class LineSocket final : public AbstractSocket
+    {
+    public:
+        LineSocket(std::vector<EmulatedESC*> escs, std::function<void()> tick)
+            : network_(std::move(escs))
+            , tick_(std::move(tick))
+        {
+        }
+
+        void open(std::string const&) override {}
+        void setTimeout(nanoseconds) override {}
+        void close() noexcept override {}
+
+        int32_t write(void const* data, int32_t size) override
+        {
+            Frame frame(data, size);
+            if (network_.route(frame))
+            {
+                uint8_t const* raw = frame.data();
+                wire_.emplace_back(raw, raw + size);
+            }
+            tick_();
+            ++frames;
+            return size;
+        }
+
+        int32_t read(void* data, int32_t size) override
+        {
+            if (wire_.empty())
+            {
+                return -ETIMEDOUT;
+            }
+            auto& next = wire_.front();
+            int32_t n = std::min(size, static_cast<int32_t>(next.size()));
+            std::memcpy(data, next.data(), static_cast<size_t>(n));
+            wire_.pop_front();
+            return n;
+        }
+
+        int64_t frames{0};
+
+    private:
+        EmulatedNetwork network_;
+        std::function<void()> tick_;
+        std::deque<std::vector<uint8_t>> wire_;
+    };
+
+
+    std::vector<uint8_t> coeEeprom()
+    {
+        eeprom::SII sii;
+        sii.strings.push_back(std::string{});
+        sii.info.pdi_control = 0x0005; // SPI PDI: the slave stack drives the AL status
+        sii.info.vendor_id = 0x6A5;
+        sii.info.product_code = 0xB0CAD0;
+        sii.info.standard_recv_mbx_offset = 0x1000;
+        sii.info.standard_recv_mbx_size   = 128;
+        sii.info.standard_send_mbx_offset = 0x1080;
+        sii.info.standard_send_mbx_size   = 128;
+        sii.info.mailbox_protocol = eeprom::MailboxProtocol::CoE;
+        sii.info.size = 0x000F;
+        sii.info.version = 1;
+        sii.general.SDO_set = 1;
+
+        sii.syncManagers.push_back({0x1000, 128,      0x26, 0, 1, SyncManager::MailboxOut});
+        sii.syncManagers.push_back({0x1080, 128,      0x22, 0, 1, SyncManager::MailboxIn});
+        sii.syncManagers.push_back({0x1100, PDO_SIZE, 0x64, 0, 1, SyncManager::Output});
+        sii.syncManagers.push_back({0x1180, PDO_SIZE, 0x20, 0, 1, SyncManager::Input});
+        return sii.serialize();
+    }
+
+
+    CoE::Dictionary coeDictionary()
+    {
+        using CoE::Access::READ;
+        CoE::Dictionary dictionary;
+        auto add = [&](uint16_t index, CoE::ObjectCode code, std::vector<uint32_t> const& entries, uint16_t bitlen)
+        {
+            CoE::Object object{index, code, "", {}};
+            CoE::addEntry<uint8_t>(object, 0, 8, 0, READ, CoE::DataType::UNSIGNED8, "", static_cast<uint8_t>(entries.size()));
+            uint16_t offset = 8;
+            for (uint8_t i = 0; i < entries.size(); ++i)
+            {
+                CoE::DataType type = CoE::DataType::UNSIGNED32;
+                if (bitlen == 8)  { type = CoE::DataType::UNSIGNED8;  }
+                if (bitlen == 16) { type = CoE::DataType::UNSIGNED16; }
+                CoE::addEntry<uint32_t>(object, static_cast<uint8_t>(i + 1), bitlen, offset, READ, type, "", entries[i]);
+                offset = static_cast<uint16_t>(offset + bitlen);
+            }
+            dictionary.push_back(std::move(object));
+        };
+
+        add(0x1600, CoE::ObjectCode::RECORD, {0x70000020, 0x70010020}, 32);
+        add(0x1A00, CoE::ObjectCode::RECORD, {0x60000020, 0x60010020}, 32);
+        add(0x1C00, CoE::ObjectCode::ARRAY,  {SyncManager::MailboxOut, SyncManager::MailboxIn, SyncManager::Output, SyncManager::Input}, 8);
+        add(0x1C12, CoE::ObjectCode::ARRAY,  {0x1600}, 16);
+        add(0x1C13, CoE::ObjectCode::ARRAY,  {0x1A00}, 16);
+        return dictionary;
+    }
+
+
+    struct EmulatedSlave
+    {
+        EmulatedSlave()
+            : pdo(&esc)
+            , slave(&esc, &pdo)
+            , mailbox(&esc, 1024)
+            , dictionary(coeDictionary())
+        {
+            esc.loadEeprom(coeEeprom());
+            mailbox.enableCoE(dictionary);
+            slave.setMailbox(&mailbox);
+            slave.setDictionary(&dictionary);
+            pdo.setInput(input, sizeof(input));
+            pdo.setOutput(output, sizeof(output));
+            slave.start();
+        }
+
+        EmulatedESC esc;
+        PDO pdo;
+        slave::Slave slave;
+        mailbox::response::Mailbox mailbox;
+        CoE::Dictionary dictionary;
+        uint8_t input[PDO_SIZE]{};
+        uint8_t output[PDO_SIZE]{};
+    };
+
+
+    class BenchBus : public Bus
+    {
+    public:
+        using Bus::Bus;
+
+        void concurrentDiscovery()
+        {
+            detectMapping();
+        }
+
+        // Former discovery, kept as the reference: blocking uploads, one slave after the other
+        void sequentialDiscovery()
+        {
+            for (auto& slave : slaves_)
+            {
+                uint8_t sm[512];
+                uint32_t sm_size = sizeof(sm);
+                readSDO(slave, CoE::SM_COM_TYPE, 1, Access::EMULATE_COMPLETE, sm, &sm_size);
+
+                for (uint32_t i = 0; i < sm_size; ++i)
+                {
+                    if (sm[i] <= 2) // mailboxes
+                    {
+                        continue;
+                    }
+
+                    Slave::PIMapping* mapping = &slave.input;
+                    if (sm[i] == SyncManager::Output)
+                    {
+                        mapping = &slave.output;
+                    }
+                    mapping->sync_manager = static_cast<int32_t>(i);
+                    mapping->size = 0;
+
+                    uint16_t mapped_index[128];
+                    uint32_t map_size = sizeof(mapped_index);
+                    readSDO(slave, static_cast<uint16_t>(CoE::SM_CHANNEL + i), 1, Access::EMULATE_COMPLETE, mapped_index, &map_size);
+
+                    for (uint32_t j = 0; j < (map_size / 2); ++j)
+                    {
+                        uint8_t object[512];
+                        uint32_t object_size = sizeof(object);
+                        readSDO(slave, mapped_index[j], 1, Access::EMULATE_COMPLETE, object, &object_size);
+
+                        for (uint32_t k = 0; k < object_size; k += 4)
+                        {
+                            mapping->size += object[k];
+                        }
+                    }
+                    mapping->bsize = (mapping->size + 7) / 8;
+                }
+            }
+        }
+
+        bool mappingDetected() const
+        {
+            for (auto const& slave : slaves_)
+            {
+                if ((slave.input.bsize != PDO_SIZE) or (slave.output.bsize != PDO_SIZE))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+
+    template<typename F>
+    bool measure(char const* name, int32_t count, F&& discover)
+    {
+        std::vector<std::unique_ptr<EmulatedSlave>> slaves;
+        std::vector<EmulatedESC*> escs;
+        for (int32_t i = 0; i < count; ++i)
+        {
+            slaves.push_back(std::make_unique<EmulatedSlave>());
+            escs.push_back(&slaves.back()->esc);
+        }
+
+        auto tick = [&slaves]()
+        {
+            for (auto& s : slaves)
+            {
+                s->slave.routine();
+            }
+        };
+        auto socket = std::make_shared<LineSocket>(escs, tick);
+        auto link = std::make_shared<Link>(socket, std::make_shared<SocketNull>(), [](){});
+        link->setTimeout(2ms);
+        BenchBus bus(link);
+
+        try
+        {
+            bus.init(100ms);
+        }
+        catch (std::exception const& e)
+        {
+            std::printf("  %-11s: init failed (%s)\n", name, e.what());
+            return false;
+        }
+
+        int64_t frames = socket->frames;
+        auto start = std::chrono::steady_clock::now();
+        discover(bus);
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        frames = socket->frames - frames;
+
+        std::printf("  %-11s: %8.1f ms, %7" PRIi64 " frames\n", name,
+                    static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()) / 1000.0, frames);
+        return bus.mappingDetected();
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    int32_t slaves = 32;
+    if (argc > 1)
+    {
+        slaves = std::atoi(argv[1]);
+    }
+
+    std::printf("%" PRIi32 " CoE slaves, PDO mapping discovery\n", slaves);
+    bool ok = measure("sequential", slaves, [](BenchBus& bus) { bus.sequentialDiscovery(); });
+    ok &= measure("concurrent", slaves, [](BenchBus& bus) { bus.concurrentDiscovery(); });
+    if (not ok)
+    {
+        std::printf("  mapping not detected: the emulated slaves are not consistent with the bench\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+#ifndef KICKCAT_MOCK_ALLOCATIONS_H
+#define KICKCAT_MOCK_ALLOCATIONS_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Heap allocations hook: count the allocations of the calling thread inside an AllocationProbe scope.
+// It replaces the global operator new/delete: include it in a single translation unit of the binary.
+namespace
+{
+    thread_local bool    count_allocations = false;
+    thread_local int64_t allocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    if (count_allocations)
+    {
+        ++allocations;
+    }
+
+    void* ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace kickcat
+{
+    class AllocationProbe
+    {
+    public:
+        AllocationProbe()
+        {
+            allocations = 0;
+            count_allocations = true;
+        }
+        ~AllocationProbe()
+        {
+            count_allocations = false;
+        }
+
+        int64_t count() const { return allocations; }
+    };
+}
+
+#endif
@@ -1,12 +1,14 @@
 #ifndef KICKCAT_MOCK_LINK_H
 #define KICKCAT_MOCK_LINK_H
 
+#include <map>
 #include <queue>
 #include <vector>
 #include <cstring>
 #include <gtest/gtest.h>
 
 #include "kickcat/AbstractLink.h"
+#include "kickcat/Error.h"
 
 namespace kickcat
 {
@@ -28,11 +30,20 @@ namespace kickcat
             wtr_responses_.push({expected_command, wkc});
         }
 
+        void handleWriteThenReadError(Command expected_command)
+        {
+            wtr_responses_.push({expected_command, 0, true});
+        }
+
         void writeThenRead(Frame& frame) override
         {
             ASSERT_FALSE(wtr_responses_.empty()) << "MockLink: no writeThenRead response queued";
-            auto [expected_command, wkc] = wtr_responses_.front();
+            auto [expected_command, wkc, failure] = wtr_responses_.front();
             wtr_responses_.pop();
+            if (failure)
+            {
+                THROW_ERROR("MockLink: writeThenRead failure");
+            }
 
             frame.finalize();
 
@@ -52,10 +63,17 @@ namespace kickcat
             frame.setIsDatagramAvailable();
         }
 
+        using AbstractLink::addDatagram;
         void addDatagram(enum Command command, uint32_t address, void const* data, uint16_t data_size,
                          std::function<DatagramState(DatagramHeader const*, uint8_t const* data, uint16_t wkc)> const& process,
                          std::function<void(DatagramState const& state)> const& error) override
         {
+            // Same bound as the Link datagram index window
+            if (pending_datagrams_.size() >= 255)
+            {
+                THROW_ERROR("Too many datagrams in flight. Max is 255");
+            }
+
             PendingDatagram dg;
             dg.command = command;
             dg.address = address;
@@ -118,6 +136,7 @@ namespace kickcat
                     }
                 }
             }
+            sent_datagrams_.insert(sent_datagrams_.end(), pending_datagrams_.begin(), pending_datagrams_.end());
             pending_datagrams_.clear();
 
             if (client_exception)
@@ -135,9 +154,23 @@ namespace kickcat
 
         void checkRedundancyNeeded() override {}
 
-        void attachEcatEventCallback(enum EcatEvent, std::function<void()>) override {}
+        void attachEcatEventCallback(enum EcatEvent event, std::function<void()> callback) override
+        {
+            ecat_events_[event] = std::move(callback);
+        }
+
+        // as if the IRQ field of a received frame rose for this event
+        void raiseEcatEvent(enum EcatEvent event)
+        {
+            auto it = ecat_events_.find(event);
+            if (it != ecat_events_.end())
+            {
+                it->second();
+            }
+        }
 
         std::vector<PendingDatagram> const& pendingDatagrams() const { return pending_datagrams_; }
+        std::vector<PendingDatagram> const& sentDatagrams() const { return sent_datagrams_; } // already processed, in order
 
     private:
         struct QueuedResponse
@@ -148,14 +181,17 @@ namespace kickcat
         };
 
         std::vector<PendingDatagram> pending_datagrams_;
+        std::vector<PendingDatagram> sent_datagrams_;
         std::queue<QueuedResponse> queued_responses_;
         std::vector<LogicalFrameDescription> logical_mapping_;
         struct WtrResponse // wtr: writeThenRead
         {
             Command expected_command{};
             uint16_t wkc{};
+            bool failure{false};    // the link throws instead of answering
         };
         std::queue<WtrResponse> wtr_responses_;
+        std::map<EcatEvent, std::function<void()>> ecat_events_;
     };
 }
 
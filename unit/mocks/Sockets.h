@@ -2,6 +2,10 @@
 #include <cstring>
 #include <queue>
 
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
 #include "kickcat/protocol.h"
 #include "kickcat/Frame.h"
 #include "kickcat/AbstractSocket.h"
@@ -127,6 +131,83 @@ namespace kickcat
     };
 
 
+    // Socket backed by a local socketpair, so that it can be waited on (see waitForFrames()).
+    // Written frames loop back to the socket itself, or are dropped when it does not answer.
+    class LoopbackPairSocket final : public AbstractSocket
+    {
+    public:
+        LoopbackPairSocket()
+        {
+            if (::socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, fds_) < 0)
+            {
+                ADD_FAILURE() << "socketpair(): " << strerror(errno);
+            }
+        }
+        ~LoopbackPairSocket() override
+        {
+            close();
+        }
+
+        void open(std::string const&) override {}
+        void setTimeout(nanoseconds timeout) override { timeout_ = timeout; }
+        void close() noexcept override
+        {
+            for (int& fd : fds_)
+            {
+                if (fd >= 0)
+                {
+                    ::close(fd);
+                    fd = -1;
+                }
+            }
+        }
+
+        int32_t read(void* frame, int32_t frame_size) override
+        {
+            struct pollfd pfd{fds_[0], POLLIN, 0};
+            if (::poll(&pfd, 1, static_cast<int>(duration_cast<milliseconds>(timeout_).count())) == 0)
+            {
+                if (timeout_ > 0ns)
+                {
+                    ++timed_out_reads;
+                }
+                return -ETIMEDOUT;
+            }
+
+            ssize_t rc = ::recv(fds_[0], frame, static_cast<size_t>(frame_size), MSG_DONTWAIT);
+            if (rc < 0)
+            {
+                return -errno;
+            }
+            return static_cast<int32_t>(rc);
+        }
+
+        int32_t write(void const* frame, int32_t frame_size) override
+        {
+            if (answer)
+            {
+                inject(frame, frame_size);
+            }
+            return frame_size;
+        }
+
+        /// Make a frame available for reading
+        void inject(void const* frame, int32_t frame_size)
+        {
+            ASSERT_EQ(frame_size, ::send(fds_[1], frame, static_cast<size_t>(frame_size), 0));
+        }
+
+        int pollHandle() const override { return fds_[0]; }
+
+        bool answer{true};
+        int32_t timed_out_reads{0}; // reads that waited for their whole timeout
+
+    private:
+        int fds_[2]{-1, -1}; // read end, write end
+        nanoseconds timeout_{0};
+    };
+
+
     class MockDiagSocket : public AbstractDiagSocket
     {
     public:
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <system_error>
+#include <unistd.h>
+
+#include "kickcat/BusSnapshot.h"
+#include "kickcat/Error.h"
+#include "kickcat/SIICache.h"
+
+using namespace kickcat;
+
+namespace
+{
+    std::string snapshotPath(char const* name)
+    {
+        std::string path = testing::TempDir() + name;
+        std::remove(path.c_str());
+        return path;
+    }
+}
+
+
+TEST(BusSnapshot, save_load)
+{
+    BusSnapshot snapshot;
+    snapshot.mapped = true;
+    for (uint16_t i = 0; i < 3; ++i)
+    {
+        BusSnapshot::SlaveConfig slave;
+        slave.address = static_cast<uint16_t>(1001 + i);
+        slave.esc = {0x04, 3, 0x0301, 8, 8, 60, 0x0f, 0x01cc};
+        slave.input  = {3, 8 * i};
+        slave.output = {2, 12};
+        slave.sii.assign(64 + i * 2, static_cast<uint8_t>(i));
+        snapshot.slaves.push_back(slave);
+    }
+
+    std::string path = snapshotPath("bus_snapshot.bin");
+    snapshot.save(path);
+
+    BusSnapshot loaded = BusSnapshot::load(path);
+    ASSERT_TRUE(loaded.mapped);
+    ASSERT_EQ(3, loaded.slaves.size());
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+        auto const& expected = snapshot.slaves[i];
+        auto const& slave = loaded.slaves[i];
+        ASSERT_EQ(expected.address, slave.address);
+        ASSERT_EQ(0, std::memcmp(&expected.esc, &slave.esc, sizeof(ESC::Description)));
+        ASSERT_EQ(expected.input.sync_manager, slave.input.sync_manager);
+        ASSERT_EQ(expected.input.size, slave.input.size);
+        ASSERT_EQ(expected.output.sync_manager, slave.output.sync_manager);
+        ASSERT_EQ(expected.output.size, slave.output.size);
+        ASSERT_EQ(expected.sii, slave.sii);
+    }
+}
+
+
+TEST(BusSnapshot, load_errors)
+{
+    std::string path = snapshotPath("bus_snapshot_errors.bin");
+    ASSERT_THROW(BusSnapshot::load(path), std::system_error);
+
+    BusSnapshot snapshot;
+    snapshot.slaves.resize(1);
+    snapshot.slaves[0].sii.assign(64, 0xFF);
+    snapshot.save(path);
+
+    // truncated
+    std::FILE* file = std::fopen(path.c_str(), "r+b");
+    ASSERT_NE(nullptr, file);
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fclose(file);
+    ASSERT_EQ(0, truncate(path.c_str(), size - 1));
+    ASSERT_THROW(BusSnapshot::load(path), Error);
+
+    // not a snapshot
+    file = std::fopen(path.c_str(), "wb");
+    std::fputs("KSII", file);
+    std::fclose(file);
+    ASSERT_THROW(BusSnapshot::load(path), Error);
+}
+
+
+TEST(BusSnapshot, sii_size_limit)
+{
+    // Same limit as the SII cache: a large eeprom fits, a corrupted size is rejected before the allocation
+    std::string path = snapshotPath("bus_snapshot_sii.bin");
+    BusSnapshot snapshot;
+    snapshot.slaves.resize(1);
+    snapshot.slaves[0].sii.assign(256 * 1024, 0xA5);
+    snapshot.save(path);
+    ASSERT_EQ(snapshot.slaves[0].sii, BusSnapshot::load(path).slaves.at(0).sii);
+
+    std::FILE* file = std::fopen(path.c_str(), "r+b");
+    ASSERT_NE(nullptr, file);
+    std::fseek(file, -static_cast<long>(snapshot.slaves[0].sii.size() + sizeof(uint32_t)), SEEK_END);
+    uint32_t sii_size = SIICache::MAX_IMAGE_SIZE + 1;
+    std::fwrite(&sii_size, sizeof(sii_size), 1, file);
+    std::fclose(file);
+    ASSERT_THROW(BusSnapshot::load(path), Error);
+}
@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+
+#include "kickcat/ENI/Parser.h"
+
+using namespace kickcat;
+
+namespace
+{
+    constexpr char const* ENI_XML = R"(<?xml version="1.0" encoding="utf-8"?>
+<EtherCATConfig>
+  <Config>
+    <Master>
+      <Info><Name>Master</Name></Info>
+      <InitCmds>
+        <InitCmd>
+          <Transition>IP</Transition>
+          <Transition>PI</Transition>
+          <BeforeSlave>true</BeforeSlave>
+          <Comment>clear fmmus</Comment>
+          <Cmd>8</Cmd>
+          <Adp>0</Adp>
+          <Ado>#x0600</Ado>
+          <DataLength>256</DataLength>
+          <Cnt>2</Cnt>
+          <Retries>3</Retries>
+        </InitCmd>
+      </InitCmds>
+    </Master>
+    <Slave>
+      <Info>
+        <Name>EK1100</Name>
+        <PhysAddr>1001</PhysAddr>
+        <AutoIncAddr>0</AutoIncAddr>
+        <VendorId>2</VendorId>
+        <ProductCode>#x044c2c52</ProductCode>
+        <RevisionNo>#x00110000</RevisionNo>
+        <SerialNo>0</SerialNo>
+      </Info>
+      <InitCmds>
+        <InitCmd>
+          <Transition>IP</Transition>
+          <Comment>set device state to PREOP</Comment>
+          <Cmd>5</Cmd>
+          <Adp>1001</Adp>
+          <Ado>#x0120</Ado>
+          <Data>0200</Data>
+          <Cnt>1</Cnt>
+        </InitCmd>
+        <InitCmd>
+          <Transition>IP</Transition>
+          <Comment>check device state for PREOP</Comment>
+          <Cmd>4</Cmd>
+          <Adp>1001</Adp>
+          <Ado>#x0130</Ado>
+          <Data>0000</Data>
+          <Cnt>1</Cnt>
+          <Validate>
+            <Data>0200</Data>
+            <DataMask>1f00</DataMask>
+            <Timeout>5000</Timeout>
+          </Validate>
+        </InitCmd>
+      </InitCmds>
+      <ProcessData>
+        <Send><BitStart>208</BitStart><BitLength>16</BitLength></Send>
+        <Recv><BitStart>212</BitStart><BitLength>4</BitLength></Recv>
+      </ProcessData>
+      <Mailbox>
+        <CoE>
+          <InitCmds>
+            <InitCmd Fixed="true" CompleteAccess="true">
+              <Transition>PS</Transition>
+              <Comment>download pdo 0x1C12 index</Comment>
+              <Timeout>2000</Timeout>
+              <Ccs>1</Ccs>
+              <Index>#x1c12</Index>
+              <SubIndex>0</SubIndex>
+              <Data>01000016</Data>
+            </InitCmd>
+          </InitCmds>
+        </CoE>
+      </Mailbox>
+    </Slave>
+    <Cyclic>
+      <CycleTime>1000</CycleTime>
+      <Frame>
+        <Cmd>
+          <State>SAFEOP</State>
+          <State>OP</State>
+          <Cmd>12</Cmd>
+          <Addr>#x00010000</Addr>
+          <DataLength>6</DataLength>
+          <Cnt>3</Cnt>
+          <InputOffs>26</InputOffs>
+          <OutputOffs>26</OutputOffs>
+        </Cmd>
+      </Frame>
+    </Cyclic>
+    <ProcessImage>
+      <Inputs><ByteSize>1536</ByteSize></Inputs>
+      <Outputs><ByteSize>1024</ByteSize></Outputs>
+    </ProcessImage>
+  </Config>
+</EtherCATConfig>
+)";
+}
+
+
+TEST(ENIParser, load_error)
+{
+    ENI::Parser parser;
+    ASSERT_THROW((void) parser.loadFile(""), std::runtime_error);
+    ASSERT_THROW((void) parser.loadString("<EtherCATConfig></EtherCATConfig>"), std::invalid_argument);
+    ASSERT_THROW((void) parser.loadString(
+        "<EtherCATConfig><Config><Master><InitCmds><InitCmd>"
+        "<Transition>XX</Transition><Cmd>8</Cmd><Ado>0</Ado><DataLength>1</DataLength>"
+        "</InitCmd></InitCmds></Master></Config></EtherCATConfig>"), std::invalid_argument);
+    ASSERT_THROW((void) parser.loadString(
+        "<EtherCATConfig><Config><Master><InitCmds><InitCmd>"
+        "<Transition>IP</Transition><Cmd>8</Cmd><Ado>0</Ado><Data>123</Data>"
+        "</InitCmd></InitCmds></Master></Config></EtherCATConfig>"), std::invalid_argument);
+    ASSERT_THROW((void) parser.loadString(
+        "<EtherCATConfig><Config><Master/><Slave><Info><PhysAddr>1001</PhysAddr></Info>"
+        "<Mailbox><CoE><InitCmds><InitCmd>"
+        "<Transition>PS</Transition><Ccs>2</Ccs><Index>#x1c12</Index><SubIndex>0</SubIndex><Data>00</Data>"
+        "</InitCmd></InitCmds></CoE></Mailbox></Slave></Config></EtherCATConfig>"), std::invalid_argument);
+    ASSERT_THROW((void) parser.loadString(
+        "<EtherCATConfig><Config><Master/><Slave><Info><PhysAddr>1001</PhysAddr></Info><ProcessData>"
+        "<Recv><BitStart>0</BitStart><BitLength>8</BitLength></Recv>"
+        "<Recv><BitStart>8</BitStart><BitLength>8</BitLength></Recv>"
+        "</ProcessData></Slave></Config></EtherCATConfig>"), std::invalid_argument);
+}
+
+
+TEST(ENIParser, load)
+{
+    ENI::Parser parser;
+    ENI::Network network = parser.loadString(ENI_XML);
+
+    ASSERT_EQ(1, network.master_init_cmds.size());
+    auto const& master_cmd = network.master_init_cmds[0];
+    ASSERT_EQ(ENI::IP | ENI::PI, master_cmd.transitions);
+    ASSERT_TRUE(master_cmd.before_slave);
+    ASSERT_EQ("clear fmmus", master_cmd.comment);
+    ASSERT_EQ(Command::BWR, master_cmd.command);
+    ASSERT_EQ(createAddress(0, 0x0600), master_cmd.address);
+    ASSERT_EQ(std::vector<uint8_t>(256, 0), master_cmd.data);
+    ASSERT_EQ(2, master_cmd.wkc);
+    ASSERT_EQ(3, master_cmd.retries);
+
+    ASSERT_EQ(1, network.slaves.size());
+    auto const& slave = network.slaves[0];
+    ASSERT_EQ("EK1100", slave.name);
+    ASSERT_EQ(1001, slave.address);
+    ASSERT_EQ(2, slave.vendor_id);
+    ASSERT_EQ(0x044c2c52, slave.product_code);
+    ASSERT_EQ(0x00110000, slave.revision);
+    ASSERT_EQ(2, slave.init_cmds.size());
+    ASSERT_EQ((std::vector<uint8_t>{0x02, 0x00}), slave.init_cmds[0].data);
+    ASSERT_FALSE(slave.init_cmds[0].validate);
+
+    auto const& validate = slave.init_cmds[1].validate;
+    ASSERT_TRUE(validate);
+    ASSERT_EQ((std::vector<uint8_t>{0x02, 0x00}), validate->data);
+    ASSERT_EQ((std::vector<uint8_t>{0x1f, 0x00}), validate->mask);
+    ASSERT_EQ(5000ms, validate->timeout);
+
+    ASSERT_EQ(1, slave.coe_init_cmds.size());
+    auto const& coe_cmd = slave.coe_init_cmds[0];
+    ASSERT_EQ(ENI::PS, coe_cmd.transitions);
+    ASSERT_TRUE(coe_cmd.complete_access);
+    ASSERT_EQ(0x1C12, coe_cmd.index);
+    ASSERT_EQ(0, coe_cmd.subindex);
+    ASSERT_EQ((std::vector<uint8_t>{0x01, 0x00, 0x00, 0x16}), coe_cmd.data);
+    ASSERT_EQ(2000ms, coe_cmd.timeout);
+    ASSERT_EQ("download pdo 0x1C12 index", coe_cmd.comment);
+
+    ASSERT_TRUE(slave.outputs);
+    ASSERT_EQ(208, slave.outputs->bit_start);
+    ASSERT_EQ(16,  slave.outputs->bit_length);
+    ASSERT_TRUE(slave.inputs);
+    ASSERT_EQ(212, slave.inputs->bit_start);
+    ASSERT_EQ(4,   slave.inputs->bit_length);
+
+    auto commands = network.initCommands(ENI::IP);
+    ASSERT_EQ(3, commands.size());
+    ASSERT_EQ(&master_cmd, commands[0]);
+    ASSERT_EQ(1, network.initCommands(ENI::PI).size());
+    ASSERT_EQ(0, network.initCommands(ENI::PS).size());
+
+    ASSERT_EQ(1000us, network.cycle_time);
+    ASSERT_EQ(1, network.frames.size());
+    auto const& cyclic = network.frames[0].commands.at(0);
+    ASSERT_EQ(State::SAFE_OP | State::OPERATIONAL, cyclic.states);
+    ASSERT_EQ(Command::LRW, cyclic.command);
+    ASSERT_EQ(0x00010000, cyclic.address);
+    ASSERT_EQ(6, cyclic.length);
+    ASSERT_EQ(3, cyclic.wkc);
+    ASSERT_EQ(26, cyclic.input_offset);
+    ASSERT_EQ(26, cyclic.output_offset);
+
+    ASSERT_EQ(1536, network.input_size);
+    ASSERT_EQ(1024, network.output_size);
+}
@@ -410,6 +410,57 @@ TEST(EmulatedESC, ecat_fmmu_out_of_bounds_is_skipped)
     ASSERT_EQ(wkc, 0);
 }
 
+TEST(EmulatedESC, ram_pages_allocated_on_first_write)
+{
+    EmulatedESC esc;
+
+    uint8_t current = State::PRE_OP;
+    esc.write(reg::AL_STATUS, &current, 1);
+    uint8_t next = State::SAFE_OP;
+    esc.write(reg::AL_CONTROL, &next, 1);
+
+    // Output and input FMMUs on the same 4 bytes, across the 0x2400 RAM page boundary
+    fmmu::Register fmmu;
+    memset(&fmmu, 0, sizeof(fmmu::Register));
+    fmmu.type             = 2;      // write access
+    fmmu.logical_address  = 0x4000;
+    fmmu.length           = 4;
+    fmmu.logical_stop_bit = 0x7;
+    fmmu.physical_address = 0x23FE;
+    fmmu.activate         = 1;
+    esc.write(reg::FMMU + 0x00, &fmmu, sizeof(fmmu::Register));
+    fmmu.type = 1;                  // read access
+    esc.write(reg::FMMU + 0x10, &fmmu, sizeof(fmmu::Register));
+
+    DatagramHeader header{Command::BRD, 0, 0, sizeof(uint32_t), 0, 0, 0, 0};
+    uint32_t buf = 0;
+    uint16_t wkc = 0;
+    esc.processDatagram(&header, &buf, &wkc);
+    std::size_t const configured = esc.residentMemory();
+
+    // Unwritten RAM reads as zeros, without allocating anything
+    header.command = Command::LRD;
+    header.address = 0x4000;
+    buf = 0xFFFFFFFF;
+    wkc = 0;
+    esc.processDatagram(&header, &buf, &wkc);
+    ASSERT_EQ(1, wkc);
+    ASSERT_EQ(0, buf);
+    ASSERT_EQ(configured, esc.residentMemory());
+
+    header.command = Command::LWR;
+    buf = 0xCAFEDECA;
+    wkc = 0;
+    esc.processDatagram(&header, &buf, &wkc);
+    ASSERT_EQ(1, wkc);
+    ASSERT_EQ(configured + 2 * 0x400, esc.residentMemory());
+
+    header.command = Command::LRD;
+    buf = 0;
+    esc.processDatagram(&header, &buf, &wkc);
+    ASSERT_EQ(0xCAFEDECA, buf);
+}
+
 TEST(EmulatedESC, ecat_fmmu_maps_register_bit)
 {
     // A single-bit FMMU into register space (physical < 0x1000) is how a master maps
@@ -641,6 +692,70 @@ TEST(EmulatedESC, ecat_eeprom_master_write_sequence)
     ASSERT_EQ(masterReadEepromWords(esc, station, 2), 0x11031102u); // image words 2 and 3 untouched
 }
 
+TEST(EmulatedESC, ecat_eeprom_reads_8_bytes)
+{
+    EmulatedESC esc;
+    std::vector<uint16_t> image(8);
+    for (size_t i = 0; i < image.size(); ++i)
+    {
+        image[i] = static_cast<uint16_t>(0x1100 + i);
+    }
+    esc.loadEeprom(image);
+
+    eeprom::Request req{eeprom::Control::READ, 5, 0};
+    esc.write(reg::EEPROM_CONTROL, &req, sizeof(req));
+    uint16_t wkc = 0;
+    DatagramHeader nop{Command::NOP, 0, 0, 0, 0, 0, 0, 0};
+    esc.processDatagram(&nop, nullptr, &wkc);   // runs the internal logic -> READ
+
+    uint16_t control = 0;
+    esc.read(reg::EEPROM_CONTROL, &control, sizeof(control));
+    ASSERT_NE(control & eeprom::Control::NB_READ_BYTES, 0);
+    ASSERT_EQ(control & eeprom::Control::COMMAND, 0);
+
+    // words 5 to 7, then past the end of the image: unwritten EEPROM
+    uint64_t data = 0;
+    esc.read(reg::EEPROM_DATA, &data, sizeof(data));
+    ASSERT_EQ(0xFFFF110711061105u, data);
+}
+
+
+TEST(EmulatedESC, ecat_al_status_event)
+{
+    EmulatedESC esc;
+    uint16_t wkc = 0;
+    DatagramHeader nop{Command::NOP, 0, 0, 0, 0, 0, 0, 0};
+
+    // masked: the pending event is not reported
+    uint8_t pre_op = State::PRE_OP;
+    esc.write(reg::AL_STATUS, &pre_op, 1);
+    esc.processDatagram(&nop, nullptr, &wkc);
+    ASSERT_EQ(0, nop.irq);
+
+    uint16_t mask = EcatEvent::AL_STATUS;
+    esc.write(reg::ECAT_EVENT_MASK, &mask, sizeof(mask));
+    esc.processDatagram(&nop, nullptr, &wkc);
+    ASSERT_EQ(EcatEvent::AL_STATUS, nop.irq);
+
+    // an ECAT read of the AL status clears it
+    uint16_t al_status = 0;
+    DatagramHeader brd{Command::BRD, 0, createAddress(0, reg::AL_STATUS), sizeof(al_status), 0, 0, 0, 0};
+    esc.processDatagram(&brd, &al_status, &wkc);
+    ASSERT_EQ(State::PRE_OP, al_status);
+    ASSERT_EQ(0, brd.irq);
+
+    nop.irq = 0;
+    esc.processDatagram(&nop, nullptr, &wkc);
+    ASSERT_EQ(0, nop.irq);
+
+    // next state change
+    uint8_t safe_op = State::SAFE_OP;
+    esc.write(reg::AL_STATUS, &safe_op, 1);
+    esc.processDatagram(&nop, nullptr, &wkc);
+    ASSERT_EQ(EcatEvent::AL_STATUS, nop.irq);
+}
+
+
 TEST(LoopbackSocket, runs_frame_through_slave_and_ticks)
 {
     EmulatedESC esc;
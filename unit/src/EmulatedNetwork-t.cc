@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <tuple>
 
 #include "mocks/EmulatedNetworkHelpers.h"
 
@@ -251,6 +252,60 @@ TEST(EmulatedNetwork, split_ring_lrw_master_merge_rebuilds_inputs)
 }
 
 
+TEST(EmulatedNetwork, logical_datagram_only_copies_on_overlapping_slaves)
+{
+    auto slaves = makeSlaves(3);
+    EmulatedNetwork net(pointers(slaves));
+
+    for (size_t i = 0; i < slaves.size(); ++i)
+    {
+        configureOverlappedPdo(*slaves[i], static_cast<uint32_t>(i * 8), static_cast<uint32_t>(0xA0B0C000 + i));
+    }
+
+    // Slave 0 does not map the datagram but still reports its pending AL status event
+    uint16_t mask = EcatEvent::AL_STATUS;
+    slaves[0]->write(reg::ECAT_EVENT_MASK, &mask, sizeof(mask));
+    uint16_t al_status = State::SAFE_OP | 0x10;
+    slaves[0]->write(reg::AL_STATUS, &al_status, sizeof(al_status));
+
+    auto routeLogical = [&](Command command, uint32_t address, uint16_t size)
+    {
+        uint8_t payload[16]{};
+        Frame frame;
+        frame.addDatagram(0, command, address, payload, size);
+        frame.finalize();
+        net.route(frame);
+
+        frame.resetContext();
+        auto [header, data, wkc] = frame.peekDatagram();
+        uint32_t input = 0;
+        std::memcpy(&input, data, sizeof(input));
+        uint16_t const event = header->irq;
+        return std::make_tuple(*wkc, input, event);
+    };
+
+    auto [wkc, input, irq] = routeLogical(Command::LRD, 8, 4);
+    EXPECT_EQ(1, wkc);
+    EXPECT_EQ(0xA0B0C001, input);
+    EXPECT_EQ(EcatEvent::AL_STATUS, irq & EcatEvent::AL_STATUS);
+
+    std::tie(wkc, input, irq) = routeLogical(Command::LRW, 4, 8);
+    EXPECT_EQ(3, wkc); // the unmapped gap 4..7 does not count
+
+    std::tie(wkc, input, irq) = routeLogical(Command::LRD, 24, 4);
+    EXPECT_EQ(0, wkc);
+
+    // Remapping slave 2 over slave 1: the index follows the FMMUs reconfiguration
+    configureOverlappedPdo(*slaves[2], 8, 0xCAFEDECA);
+    std::tie(wkc, input, irq) = routeLogical(Command::LRD, 8, 4);
+    EXPECT_EQ(2, wkc);
+    EXPECT_EQ(0xCAFEDECA, input);
+
+    std::tie(wkc, input, irq) = routeLogical(Command::LRD, 16, 4);
+    EXPECT_EQ(0, wkc);
+}
+
+
 TEST(EmulatedNetwork, brd_or_merges_data_and_increments_adp)
 {
     auto slaves = makeSlaves(3);
@@ -0,0 +1,460 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstring>
+#include <map>
+#include <system_error>
+#include <vector>
+
+#include <dlfcn.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+
+#include "kickcat/OS/Linux/Socket.h"
+#include "kickcat/protocol.h"
+
+using namespace kickcat;
+
+// Override of the socket calls used by the Linux Socket, resolved from this exe's own object before the libc ones:
+// these tests have their own executable (see unit/CMakeLists.txt). Out of a test (not armed), the calls go to the
+// next definition, the libc one.
+namespace
+{
+    struct FakeKernel
+    {
+        bool armed{false};
+        std::vector<int> peers;                         // other end of the sockets given to the Sockets
+
+        std::map<int, std::vector<uint8_t>> options;    // SOL_SOCKET options: last value set
+        std::map<int, int> option_sets;                 // SOL_SOCKET options: setsockopt calls
+        int reject_option{-1};                          // this option is rejected (ENOPROTOOPT)
+        bool reject_hw_timestamps{false};               // SIOCSHWTSTAMP is rejected (EOPNOTSUPP)
+
+        bool stamp{false};                              // add a SCM_TIMESTAMPING message to the next frames
+        struct scm_timestamping stamps{};               // stamps of the next frame, the next ones get +1ns
+    };
+    FakeKernel kernel;
+
+    template<typename Function>
+    Function next(char const* name)
+    {
+        return reinterpret_cast<Function>(::dlsym(RTLD_NEXT, name));
+    }
+
+    void addStamp(struct msghdr* msg, std::size_t control_size)
+    {
+        if ((not kernel.stamp) or (control_size < CMSG_SPACE(sizeof(kernel.stamps))))
+        {
+            return;
+        }
+
+        msg->msg_controllen = control_size;
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type  = SCM_TIMESTAMPING;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(kernel.stamps));
+        std::memcpy(CMSG_DATA(cmsg), &kernel.stamps, sizeof(kernel.stamps));
+        msg->msg_controllen = CMSG_SPACE(sizeof(kernel.stamps));
+
+        for (auto& stamp : kernel.stamps.ts)
+        {
+            ++stamp.tv_nsec;
+        }
+    }
+}
+
+extern "C"
+{
+    int socket(int domain, int type, int protocol) noexcept
+    {
+        if (not kernel.armed)
+        {
+            static auto const real = next<int(*)(int, int, int)>("socket");
+            return real(domain, type, protocol);
+        }
+
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) < 0)
+        {
+            return -1;
+        }
+        kernel.peers.push_back(fds[1]);
+        return fds[0];
+    }
+
+    int bind(int fd, struct sockaddr const* address, socklen_t length) noexcept
+    {
+        if (not kernel.armed)
+        {
+            static auto const real = next<int(*)(int, struct sockaddr const*, socklen_t)>("bind");
+            return real(fd, address, length);
+        }
+        return 0;
+    }
+
+    int ioctl(int fd, unsigned long request, ...) noexcept
+    {
+        va_list args;
+        va_start(args, request);
+        void* arg = va_arg(args, void*);
+        va_end(args);
+
+        if (not kernel.armed)
+        {
+            static auto const real = next<int(*)(int, unsigned long, ...)>("ioctl");
+            return real(fd, request, arg);
+        }
+
+        if ((request == SIOCSHWTSTAMP) and kernel.reject_hw_timestamps)
+        {
+            errno = EOPNOTSUPP;
+            return -1;
+        }
+        return 0; // interface index, flags, ...: nothing to check
+    }
+
+    int setsockopt(int fd, int level, int name, void const* value, socklen_t length) noexcept
+    {
+        if (not kernel.armed)
+        {
+            static auto const real = next<int(*)(int, int, int, void const*, socklen_t)>("setsockopt");
+            return real(fd, level, name, value, length);
+        }
+
+        if (name == kernel.reject_option)
+        {
+            errno = ENOPROTOOPT;
+            return -1;
+        }
+        if (level == SOL_SOCKET)
+        {
+            uint8_t const* raw = static_cast<uint8_t const*>(value);
+            kernel.options[name].assign(raw, raw + length);
+            ++kernel.option_sets[name];
+        }
+        return 0;
+    }
+
+    ssize_t recvmsg(int fd, struct msghdr* msg, int flags)
+    {
+        static auto const real = next<ssize_t(*)(int, struct msghdr*, int)>("recvmsg");
+        std::size_t const control_size = msg->msg_controllen;
+        ssize_t size = real(fd, msg, flags);
+        if (kernel.armed and (size >= 0))
+        {
+            addStamp(msg, control_size);
+        }
+        return size;
+    }
+
+    int recvmmsg(int fd, struct mmsghdr* msgs, unsigned int count, int flags, struct timespec* timeout)
+    {
+        static auto const real = next<int(*)(int, struct mmsghdr*, unsigned int, int, struct timespec*)>("recvmmsg");
+        std::vector<std::size_t> control_sizes;
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            control_sizes.push_back(msgs[i].msg_hdr.msg_controllen);
+        }
+
+        int received = real(fd, msgs, count, flags, timeout);
+        if (kernel.armed)
+        {
+            for (int i = 0; i < received; ++i)
+            {
+                addStamp(&msgs[i].msg_hdr, control_sizes[static_cast<std::size_t>(i)]);
+            }
+        }
+        return received;
+    }
+}
+
+
+class LinuxSocket : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        kernel = FakeKernel{};
+        kernel.armed = true;
+    }
+
+    void TearDown() override
+    {
+        for (int peer : kernel.peers)
+        {
+            ::close(peer);
+        }
+        kernel.armed = false;
+    }
+
+    bool isSet(int name) const
+    {
+        return kernel.options.count(name) != 0;
+    }
+
+    template<typename T>
+    T option(int name) const
+    {
+        T value{};
+        auto const& raw = kernel.options.at(name);
+        EXPECT_EQ(sizeof(T), raw.size());
+        std::memcpy(&value, raw.data(), std::min(sizeof(T), raw.size()));
+        return value;
+    }
+
+    int32_t receiveTimeout() const // SO_RCVTIMEO, us
+    {
+        auto tv = option<struct timeval>(SO_RCVTIMEO);
+        return static_cast<int32_t>(tv.tv_sec * 1000000 + tv.tv_usec);
+    }
+
+    void inject() // a frame for the last opened socket
+    {
+        uint8_t frame[ETH_MIN_SIZE]{};
+        ASSERT_EQ(ETH_MIN_SIZE, ::send(kernel.peers.back(), frame, sizeof(frame), 0));
+    }
+};
+
+
+TEST_F(LinuxSocket, sleep_strategy_does_not_touch_the_kernel_polling)
+{
+    Socket socket(-1us, 20us, Socket::ReceiveStrategy::SLEEP);
+    socket.open("eth0");
+    socket.setTimeout(2ms);
+
+    ASSERT_FALSE(isSet(SO_BUSY_POLL));
+    ASSERT_FALSE(isSet(SO_RCVTIMEO));   // non-blocking reads
+    ASSERT_FALSE(isSet(SO_TIMESTAMPING));
+
+    uint8_t frame[ETH_MAX_SIZE];
+    ASSERT_EQ(-ETIMEDOUT, socket.read(frame, sizeof(frame)));
+    inject();
+    ASSERT_EQ(ETH_MIN_SIZE, socket.read(frame, sizeof(frame)));
+}
+
+
+TEST_F(LinuxSocket, busy_poll_and_poll_strategies_do_not_touch_the_kernel_polling)
+{
+    for (auto strategy : {Socket::ReceiveStrategy::BUSY_POLL, Socket::ReceiveStrategy::POLL})
+    {
+        kernel.options.clear();
+        Socket socket(-1us, 20us, strategy);
+        socket.open("eth0");
+        socket.setTimeout(2ms);
+        ASSERT_EQ(strategy, socket.receiveStrategy());
+        ASSERT_FALSE(isSet(SO_BUSY_POLL));
+        ASSERT_FALSE(isSet(SO_RCVTIMEO));
+    }
+}
+
+
+TEST_F(LinuxSocket, kernel_busy_poll_strategy)
+{
+    Socket socket(-1us, 50us, Socket::ReceiveStrategy::KERNEL_BUSY_POLL);
+    socket.open("eth0");
+    ASSERT_EQ(50, option<int>(SO_BUSY_POLL));           // busy poll the NIC for the polling period
+#ifdef SO_PREFER_BUSY_POLL
+    ASSERT_EQ(1, option<int>(SO_PREFER_BUSY_POLL));
+#endif
+    ASSERT_FALSE(isSet(SO_RCVTIMEO));                   // no timeout yet: non-blocking reads
+
+    // Blocking reads bounded by the timeout, rounded up to the kernel granularity
+    socket.setTimeout(2500us);
+    ASSERT_EQ(3000, receiveTimeout());
+
+    socket.setTimeout(300ns);                           // 0 would be infinite
+    ASSERT_EQ(1000, receiveTimeout());
+
+    socket.setTimeout(-1ns);                            // blocking without timeout
+    ASSERT_EQ(0, receiveTimeout());
+
+    // A sub-microsecond polling period still polls
+    Socket fast(-1us, 100ns, Socket::ReceiveStrategy::KERNEL_BUSY_POLL);
+    fast.open("eth0");
+    ASSERT_EQ(1, option<int>(SO_BUSY_POLL));
+}
+
+
+TEST_F(LinuxSocket, kernel_busy_poll_receive_timeout_is_set_when_it_changes)
+{
+    Socket socket(-1us, 50us, Socket::ReceiveStrategy::KERNEL_BUSY_POLL);
+    socket.open("eth0");
+
+    // The link sets the remaining time of its deadline before each read
+    for (nanoseconds remaining = 1ms; remaining > 0ns; remaining -= 30us)
+    {
+        socket.setTimeout(remaining);
+    }
+    ASSERT_EQ(1000, receiveTimeout());
+    ASSERT_EQ(1, kernel.option_sets[SO_RCVTIMEO]);
+
+    socket.setTimeout(1500us);
+    ASSERT_EQ(2000, receiveTimeout());
+    ASSERT_EQ(2, kernel.option_sets[SO_RCVTIMEO]);
+
+    // A new socket gets it again
+    socket.close();
+    socket.open("eth0");
+    ASSERT_EQ(3, kernel.option_sets[SO_RCVTIMEO]);
+}
+
+
+TEST_F(LinuxSocket, switch_strategy)
+{
+    Socket socket(-1us, 40us, Socket::ReceiveStrategy::SLEEP);
+    socket.open("eth0");
+    socket.setTimeout(1ms);
+    ASSERT_FALSE(isSet(SO_BUSY_POLL));
+
+    socket.setReceiveStrategy(Socket::ReceiveStrategy::KERNEL_BUSY_POLL);
+    ASSERT_EQ(40, option<int>(SO_BUSY_POLL));
+    ASSERT_EQ(1000, receiveTimeout());
+
+    // Leaving the kernel busy polling resets the socket options
+    socket.setReceiveStrategy(Socket::ReceiveStrategy::POLL);
+    ASSERT_EQ(0, option<int>(SO_BUSY_POLL));
+#ifdef SO_PREFER_BUSY_POLL
+    ASSERT_EQ(0, option<int>(SO_PREFER_BUSY_POLL));
+#endif
+    ASSERT_EQ(0, receiveTimeout());
+
+    // Before open(): applied by open()
+    kernel.options.clear();
+    Socket later(-1us, 40us, Socket::ReceiveStrategy::SLEEP);
+    later.setReceiveStrategy(Socket::ReceiveStrategy::KERNEL_BUSY_POLL);
+    ASSERT_FALSE(isSet(SO_BUSY_POLL));
+    later.open("eth0");
+    ASSERT_EQ(40, option<int>(SO_BUSY_POLL));
+}
+
+
+TEST_F(LinuxSocket, rejected_receive_timeout_falls_back_on_non_blocking_reads)
+{
+    kernel.reject_option = SO_RCVTIMEO;
+    Socket socket(-1us, 20us, Socket::ReceiveStrategy::KERNEL_BUSY_POLL);
+    socket.open("eth0");
+    socket.setTimeout(1ms);
+    ASSERT_FALSE(isSet(SO_RCVTIMEO));
+
+    // A blocking read would never return: the read times out instead
+    uint8_t frame[ETH_MAX_SIZE];
+    ASSERT_EQ(-ETIMEDOUT, socket.read(frame, sizeof(frame)));
+}
+
+
+TEST_F(LinuxSocket, rejected_kernel_busy_poll)
+{
+    kernel.reject_option = SO_BUSY_POLL;
+    Socket socket(-1us, 20us, Socket::ReceiveStrategy::KERNEL_BUSY_POLL);
+    ASSERT_THROW(socket.open("eth0"), std::system_error);
+}
+
+
+TEST_F(LinuxSocket, hardware_timestamps)
+{
+    Socket socket;
+    socket.setTimestamping(Socket::Timestamping::HARDWARE);
+    socket.open("eth0");
+    socket.setTimeout(1ms);
+    ASSERT_EQ(Socket::Timestamping::HARDWARE, socket.timestamping());
+    ASSERT_EQ(SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE, option<int>(SO_TIMESTAMPING));
+
+    // The raw hardware stamp is reported
+    kernel.stamp = true;
+    kernel.stamps.ts[0] = {1, 111};
+    kernel.stamps.ts[2] = {2, 222};
+    inject();
+    uint8_t frame[ETH_MAX_SIZE];
+    ASSERT_EQ(ETH_MIN_SIZE, socket.read(frame, sizeof(frame)));
+    ASSERT_EQ(2s + 222ns, socket.lastRxTimestamp());
+
+    // No control message: no stamp
+    kernel.stamp = false;
+    inject();
+    ASSERT_EQ(ETH_MIN_SIZE, socket.read(frame, sizeof(frame)));
+    ASSERT_EQ(0ns, socket.lastRxTimestamp());
+}
+
+
+TEST_F(LinuxSocket, hardware_timestamps_fall_back_on_software_ones)
+{
+    kernel.reject_hw_timestamps = true;
+    Socket socket;
+    socket.setTimestamping(Socket::Timestamping::HARDWARE);
+    socket.open("eth0");
+    socket.setTimeout(1ms);
+    ASSERT_EQ(Socket::Timestamping::SOFTWARE, socket.timestamping());
+    ASSERT_EQ(SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE, option<int>(SO_TIMESTAMPING));
+
+    // The software stamp is reported
+    kernel.stamp = true;
+    kernel.stamps.ts[0] = {1, 111};
+    kernel.stamps.ts[2] = {2, 222};
+    inject();
+    uint8_t frame[ETH_MAX_SIZE];
+    ASSERT_EQ(ETH_MIN_SIZE, socket.read(frame, sizeof(frame)));
+    ASSERT_EQ(1s + 111ns, socket.lastRxTimestamp());
+}
+
+
+TEST_F(LinuxSocket, batch_read_timestamps)
+{
+    Socket socket;
+    socket.setTimestamping(Socket::Timestamping::HARDWARE);
+    socket.open("eth0");
+    socket.setTimeout(1ms);
+
+    // The stamp of the last frame of the batch is reported
+    kernel.stamp = true;
+    kernel.stamps.ts[0] = {1, 111};
+    kernel.stamps.ts[2] = {2, 222};
+    for (int i = 0; i < 3; ++i)
+    {
+        inject();
+    }
+
+    uint8_t frames[3][ETH_MAX_SIZE];
+    SocketBuffer buffers[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        buffers[i] = {frames[i], ETH_MAX_SIZE};
+    }
+    ASSERT_EQ(3, socket.readBatch(buffers, 3));
+    for (auto const& buffer : buffers)
+    {
+        ASSERT_EQ(ETH_MIN_SIZE, buffer.size);
+    }
+    ASSERT_EQ(2s + 224ns, socket.lastRxTimestamp());
+
+    // No control message: no stamp
+    kernel.stamp = false;
+    inject();
+    buffers[0].size = ETH_MAX_SIZE;
+    ASSERT_EQ(1, socket.readBatch(buffers, 1));
+    ASSERT_EQ(0ns, socket.lastRxTimestamp());
+}
+
+
+TEST_F(LinuxSocket, timestamping)
+{
+    // Applied right away on an open socket, disabled with NONE
+    Socket socket;
+    socket.open("eth0");
+    ASSERT_FALSE(isSet(SO_TIMESTAMPING));
+
+    socket.setTimestamping(Socket::Timestamping::SOFTWARE);
+    ASSERT_EQ(SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE, option<int>(SO_TIMESTAMPING));
+
+    socket.setTimestamping(Socket::Timestamping::NONE);
+    ASSERT_EQ(0, option<int>(SO_TIMESTAMPING));
+
+    // Rejected by the kernel
+    kernel.reject_option = SO_TIMESTAMPING;
+    ASSERT_THROW(socket.setTimestamping(Socket::Timestamping::SOFTWARE), std::system_error);
+}
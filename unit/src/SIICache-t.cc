@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+
+#include "kickcat/Error.h"
+#include "kickcat/SIICache.h"
+
+using namespace kickcat;
+
+namespace
+{
+    std::vector<uint8_t> createImage(uint32_t serial, uint8_t checksum, std::size_t size = 64)
+    {
+        std::vector<uint8_t> image(size, 0xA5);
+        uint32_t identity[4] = {0x6A5, 0xB0CAD0, 0x1, serial};
+        std::memset(image.data(), 0, 16);
+        image[14] = checksum;
+        std::memcpy(image.data() + 16, identity, sizeof(identity));
+        return image;
+    }
+
+    std::string cachePath(char const* name)
+    {
+        std::string path = testing::TempDir() + name;
+        std::remove(path.c_str());
+        return path;
+    }
+}
+
+
+TEST(SIICache, find_matching_header_only)
+{
+    SIICache cache(cachePath("sii_cache_find.bin"));
+    ASSERT_EQ(0, cache.size());
+
+    auto image = createImage(42, 0x12);
+    cache.store(image);
+    ASSERT_EQ(1, cache.size());
+
+    auto const* found = cache.find(image.data());
+    ASSERT_NE(nullptr, found);
+    ASSERT_EQ(image, *found);
+
+    // unknown identity
+    auto other = createImage(43, 0x12);
+    ASSERT_EQ(nullptr, cache.find(other.data()));
+
+    // same identity, other checksum: reflashed EEPROM
+    auto reflashed = createImage(42, 0x34);
+    ASSERT_EQ(nullptr, cache.find(reflashed.data()));
+
+    // storing it replaces the previous image
+    cache.store(reflashed);
+    ASSERT_EQ(1, cache.size());
+    ASSERT_NE(nullptr, cache.find(reflashed.data()));
+
+    ASSERT_THROW(cache.store(std::vector<uint8_t>(16)), Error);
+}
+
+
+TEST(SIICache, save_and_load)
+{
+    std::string path = cachePath("sii_cache_save.bin");
+    {
+        SIICache cache(path);
+        cache.store(createImage(1, 0x11, 64));
+        cache.store(createImage(2, 0x22, 128));
+        cache.save();
+    }
+
+    SIICache cache(path);
+    ASSERT_EQ(2, cache.size());
+    auto image = createImage(2, 0x22, 128);
+    auto const* found = cache.find(image.data());
+    ASSERT_NE(nullptr, found);
+    ASSERT_EQ(image, *found);
+    std::remove(path.c_str());
+}
+
+
+TEST(SIICache, save_in_the_working_directory)
+{
+    // No directory in the path: the working directory entries are synced
+    std::string path = "sii_cache_working_directory.bin";
+    std::remove(path.c_str());
+    {
+        SIICache cache(path);
+        cache.store(createImage(1, 0x11, 64));
+        cache.save();
+    }
+
+    SIICache cache(path);
+    ASSERT_EQ(1, cache.size());
+    std::remove(path.c_str());
+}
+
+
+TEST(SIICache, corrupted_file_is_discarded)
+{
+    std::string path = cachePath("sii_cache_corrupted.bin");
+    {
+        SIICache cache(path);
+        cache.store(createImage(1, 0x11));
+        cache.save();
+    }
+
+    // truncate the image
+    std::FILE* file = std::fopen(path.c_str(), "r+b");
+    ASSERT_NE(nullptr, file);
+    uint32_t size = 4096;
+    std::fseek(file, 8, SEEK_SET);
+    std::fwrite(&size, sizeof(size), 1, file);
+    std::fclose(file);
+
+    SIICache cache(path);
+    ASSERT_EQ(0, cache.size());
+    std::remove(path.c_str());
+}
+
+
+TEST(SIICache, corrupted_size_is_rejected_before_allocation)
+{
+    std::string path = cachePath("sii_cache_corrupted_size.bin");
+    for (uint32_t size : {0xFFFFFFFFu, SIICache::MAX_IMAGE_SIZE + 1, SIICache::HEADER_SIZE - 1})
+    {
+        {
+            SIICache cache(path);
+            cache.store(createImage(1, 0x11));
+            cache.save();
+        }
+
+        std::FILE* file = std::fopen(path.c_str(), "r+b");
+        ASSERT_NE(nullptr, file);
+        std::fseek(file, 8, SEEK_SET);
+        std::fwrite(&size, sizeof(size), 1, file);
+        std::fclose(file);
+
+        SIICache cache(path);
+        ASSERT_EQ(0, cache.size());
+        std::remove(path.c_str());
+    }
+
+    SIICache cache(path);
+    ASSERT_THROW(cache.store(std::vector<uint8_t>(SIICache::MAX_IMAGE_SIZE + 1)), Error);
+}
+
+
+TEST(SIICache, save_error)
+{
+    SIICache cache(testing::TempDir() + "no_such_directory/sii_cache.bin");
+    cache.save(); // nothing to save
+
+    cache.store(createImage(1, 0x11));
+    ASSERT_THROW(cache.save(), std::system_error);
+}
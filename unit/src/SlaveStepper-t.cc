@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+#include "kickcat/simulation/SlaveStepper.h"
+
+using namespace kickcat;
+using namespace kickcat::sim;
+
+namespace
+{
+    std::vector<SimulatedSlave> makeSlaves(std::size_t count)
+    {
+        std::vector<SimulatedSlave> slaves;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            SimulatedSlave sim;
+            sim.esc   = std::make_unique<EmulatedESC>();
+            sim.pdo   = std::make_unique<PDO>(sim.esc.get());
+            sim.slave = std::make_unique<slave::Slave>(sim.esc.get(), sim.pdo.get());
+            sim.input.assign(16, 0);
+            sim.output.assign(16, 0xFF);
+            slaves.push_back(std::move(sim));
+        }
+        return slaves;
+    }
+}
+
+TEST(SlaveStepper, steps_every_slave_inline)
+{
+    auto slaves = makeSlaves(3);
+    SlaveStepper stepper(slaves, 0);
+    ASSERT_EQ(0, stepper.workers());
+
+    stepper.step(0x22);
+    for (auto const& sim : slaves)
+    {
+        ASSERT_EQ(std::vector<uint8_t>(16, 0x22), sim.input);
+    }
+}
+
+TEST(SlaveStepper, shards_slaves_on_workers)
+{
+    auto slaves = makeSlaves(10);
+    SlaveStepper stepper(slaves, 3);
+    ASSERT_EQ(3, stepper.workers());
+
+    // step() is a frame barrier: every slave is stepped when it returns
+    for (uint8_t pattern = 0; pattern < 100; ++pattern)
+    {
+        stepper.step(pattern);
+        for (auto const& sim : slaves)
+        {
+            ASSERT_EQ(std::vector<uint8_t>(16, pattern), sim.input);
+        }
+    }
+}
+
+TEST(SlaveStepper, no_more_workers_than_slaves)
+{
+    auto slaves = makeSlaves(2);
+    SlaveStepper stepper(slaves, 8);
+    ASSERT_EQ(1, stepper.workers());
+
+    std::vector<SimulatedSlave> none;
+    SlaveStepper idle(none, 4);
+    ASSERT_EQ(0, idle.workers());
+    idle.step(0x11);
+}
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstring>
+#include <functional>
+
+#include "kickcat/Bus.h"
+#include "kickcat/Link.h"
+#include "kickcat/LoopbackSocket.h"
+#include "kickcat/SocketNull.h"
+
+#include "mocks/Allocations.h"
+
+namespace kickcat
+{
+    // Echo the written frames back with a fixed working counter. No dynamic memory: the wire is a fixed ring.
+    class StaticEchoSocket final : public AbstractSocket
+    {
+    public:
+        void open(std::string const&) override {}
+        void setTimeout(nanoseconds) override {}
+        void close() noexcept override {}
+
+        int32_t read(void* frame, int32_t frame_size) override
+        {
+            if (head_ == tail_)
+            {
+                return -ETIMEDOUT;
+            }
+
+            auto const& next = wire_[tail_ % wire_.size()];
+            int32_t size = std::min(frame_size, next.size);
+            std::memcpy(frame, next.data.data(), static_cast<std::size_t>(size));
+            ++tail_;
+            return size;
+        }
+
+        int32_t write(void const* data, int32_t size) override
+        {
+            Frame frame(data, size);
+            while (true)
+            {
+                auto [header, payload, wkc] = frame.peekDatagram();
+                if (header == nullptr)
+                {
+                    break;
+                }
+                *wkc = answer_wkc;
+            }
+
+            auto& slot = wire_[head_ % wire_.size()];
+            std::memcpy(slot.data.data(), frame.data(), static_cast<std::size_t>(size));
+            slot.size = size;
+            ++head_;
+            return size;
+        }
+
+        uint16_t answer_wkc{1}; // one slave answering: enough for the mapping configuration
+
+    private:
+        struct Slot
+        {
+            std::array<uint8_t, ETH_MAX_SIZE> data;
+            int32_t size;
+        };
+        std::array<Slot, 4> wire_{};
+        uint32_t head_{0};
+        uint32_t tail_{0};
+    };
+
+
+    class StaticBus : public Bus
+    {
+    public:
+        using Bus::Bus;
+
+        void addStaticSlaves(int32_t count, int32_t input_size, int32_t output_size)
+        {
+            slaves_.resize(static_cast<std::size_t>(count));
+            for (int32_t i = 0; i < count; ++i)
+            {
+                auto& slave = slaves_[static_cast<std::size_t>(i)];
+                slave.address = static_cast<uint16_t>(0x1000 + i);
+                slave.is_static_mapping = true;
+                slave.sii.syncManagers.resize(4);
+                slave.output.sync_manager = 2;
+                slave.output.bsize = output_size;
+                slave.input.sync_manager  = 3;
+                slave.input.bsize = input_size;
+            }
+        }
+
+        uint16_t expectedLrwWkc() const
+        {
+            return pi_frames_.at(0).expected_lrw_wkc;
+        }
+
+        void enableDriftCompensation()
+        {
+            dc_slave_ = &slaves_.at(0);
+        }
+    };
+
+
+    TEST(Allocation, process_data_cycle_does_not_allocate)
+    {
+        auto socket = std::make_shared<StaticEchoSocket>();
+        auto link = std::make_shared<Link>(socket, std::make_shared<SocketNull>(), [](){});
+        StaticBus bus(link);
+        bus.addStaticSlaves(4, 8, 8);
+
+        std::array<uint8_t, 64> iomap{};
+        bus.createMapping(iomap.data(), iomap.size());
+        socket->answer_wkc = bus.expectedLrwWkc();
+
+        int32_t errors = 0;
+        auto error = [&errors](DatagramState const&) { ++errors; };
+        bus.processDataReadWrite(error); // first cycle: the link sizes its frame pools
+
+        AllocationProbe probe;
+        for (int32_t i = 0; i < 100; ++i)
+        {
+            bus.processDataReadWrite(error);
+        }
+        ASSERT_EQ(0, probe.count());
+        ASSERT_EQ(0, errors);
+    }
+
+
+    TEST(Allocation, process_data_cycle_with_large_error_capture_does_not_allocate)
+    {
+        auto socket = std::make_shared<StaticEchoSocket>();
+        auto link = std::make_shared<Link>(socket, std::make_shared<SocketNull>(), [](){});
+        StaticBus bus(link);
+        bus.addStaticSlaves(4, 8, 8);
+
+        std::array<uint8_t, 64> iomap{};
+        bus.createMapping(iomap.data(), iomap.size());
+        bus.enableDriftCompensation();
+        socket->answer_wkc = bus.expectedLrwWkc();
+
+        // Far bigger than any std::function small buffer
+        int32_t errors = 0;
+        std::array<int64_t, 32> payload{};
+        auto error = [&errors, payload](DatagramState const&) { errors += static_cast<int32_t>(payload.size()); };
+        std::function<void(DatagramState const&)> const client_function = error;
+        auto plain_error = [](void* context, DatagramState const&) { ++*static_cast<int32_t*>(context); };
+
+        bus.processDataReadWrite(error); // first cycle: the link sizes its frame pools
+
+        AllocationProbe probe;
+        for (int32_t i = 0; i < 100; ++i)
+        {
+            bus.processDataReadWrite(error);
+            bus.processDataReadWrite(client_function);
+            bus.processDataReadWrite(plain_error, &errors);
+        }
+        ASSERT_EQ(0, probe.count());
+        ASSERT_EQ(0, errors);
+    }
+
+
+    TEST(Allocation, split_cycle_with_large_error_capture_does_not_allocate)
+    {
+        auto socket = std::make_shared<StaticEchoSocket>();
+        auto link = std::make_shared<Link>(socket, std::make_shared<SocketNull>(), [](){});
+        StaticBus bus(link);
+        bus.addStaticSlaves(4, 8, 8);
+
+        std::array<uint8_t, 64> iomap{};
+        bus.createMapping(iomap.data(), iomap.size());
+        socket->answer_wkc = bus.expectedLrwWkc();
+
+        // Far bigger than any std::function small buffer: copied once by the setter
+        int32_t errors = 0;
+        std::array<int64_t, 32> payload{};
+        std::function<void(DatagramState const&)> error = [&errors, payload](DatagramState const&)
+        {
+            errors += static_cast<int32_t>(payload.size());
+        };
+        bus.setLogicalErrorCallbacks(error, error, error);
+        bus.sendLogicalReadWrite(); // first cycle: the link sizes its frame pools
+        bus.processAwaitingFrames();
+
+        AllocationProbe probe;
+        for (int32_t i = 0; i < 100; ++i)
+        {
+            bus.sendLogicalReadWrite();
+            bus.processAwaitingFrames();
+        }
+        ASSERT_EQ(0, probe.count());
+        ASSERT_EQ(0, errors);
+    }
+
+
+    TEST(Allocation, loopback_socket_does_not_allocate)
+    {
+        EmulatedESC esc;
+        LoopbackSocket socket({&esc}, [](){});
+
+        Frame frame;
+        uint16_t value = 0;
+        frame.addDatagram(0, Command::BRD, createAddress(0, reg::TYPE), &value, sizeof(value));
+        int32_t size = frame.finalize();
+        std::array<uint8_t, ETH_MAX_SIZE> buffer;
+
+        socket.write(frame.data(), size); // first frame: the network builds its routing tables
+        socket.read(buffer.data(), static_cast<int32_t>(buffer.size()));
+
+        AllocationProbe probe;
+        for (int32_t i = 0; i < 100; ++i)
+        {
+            // several frames in flight, then drained
+            for (int32_t j = 0; j < 4; ++j)
+            {
+                ASSERT_EQ(size, socket.write(frame.data(), size));
+            }
+            for (int32_t j = 0; j < 4; ++j)
+            {
+                ASSERT_EQ(size, socket.read(buffer.data(), static_cast<int32_t>(buffer.size())));
+            }
+        }
+        ASSERT_EQ(0, probe.count());
+        ASSERT_EQ(0, socket.read(buffer.data(), static_cast<int32_t>(buffer.size())));
+    }
+
+
+    TEST(Allocation, probe_counts_allocations)
+    {
+        AllocationProbe probe;
+        auto value = std::make_unique<int32_t>(42);
+        ASSERT_EQ(1, probe.count());
+    }
+}
@@ -1,9 +1,15 @@
+#include <algorithm>
+
 #include <gtest/gtest.h>
 #include "mocks/Link.h"
 #include "mocks/Time.h"
 
 #include "kickcat/Bus.h"
+#include "kickcat/BusSnapshot.h"
+#include "kickcat/ENI/Network.h"
 #include "kickcat/MailboxSequencer.h"
+#include "kickcat/SDOBatch.h"
+#include "kickcat/SIICache.h"
 
 using namespace kickcat;
 
@@ -16,6 +22,16 @@ struct SDOAnswer
 } __attribute__((__packed__));
 
 
+namespace
+{
+    DatagramState last_process_data_error = DatagramState::OK;
+    void recordProcessDataError(DatagramState const& state)
+    {
+        last_process_data_error = state;
+    }
+}
+
+
 struct BusAccessor : public Bus
 {
     using Bus::Bus;
@@ -33,22 +49,93 @@ public:
         initBus();
     }
 
-    void addFetchEepromWord(uint32_t word)
+    struct EepromInterface
     {
-        // broadcastWrite: set address (wkc checked against slave count)
-        mock_link->handleWriteThenRead(Command::BWR, nb_slaves_);
+        uint16_t control;
+        uint32_t address;
+        uint32_t data[2];
+    } __attribute__((__packed__));
 
-        // areEepromReady: one status FPRD (not busy) per slave
+    void addFetchEepromWord(uint32_t word)
+    {
+        // one frame: read request then status poll (ready, 4 bytes read) of each slave (same content for all)
+        EepromInterface answer{0, eeprom_address_, {word, 0}};
+        if (eeprom_address_ == 0)
+        {
+            // the first request is applied after the poll of its frame, which reads the register reset value:
+            // the answer comes with the next poll
+            EepromInterface stale{0, 0, {0xDEADBEEF, 0}};
+            for (int i = 0; i < nb_slaves_; ++i)
+            {
+                mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+                mock_link->handleProcess(Command::FPRD, stale, 1);
+            }
+            for (int i = 0; i < nb_slaves_; ++i)
+            {
+                mock_link->handleProcess(Command::FPRD, answer, 1);
+            }
+            eeprom_address_ += 2;
+            return;
+        }
         for (int i = 0; i < nb_slaves_; ++i)
         {
-            mock_link->handleProcess(Command::FPRD, uint16_t{0x0080}, 1);
+            mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+            mock_link->handleProcess(Command::FPRD, answer, 1);
         }
+        eeprom_address_ += 2;
+    }
 
-        // readEeprom: one data FPRD per pending slave (same content for all)
-        for (int i = 0; i < nb_slaves_; ++i)
+    // fetchEeprom: the SII of the fixture slaves, 4 bytes at a time
+    void addFetchEeprom()
+    {
+        eeprom_address_ = 0;
+        addFetchEepromWord(0);
+        addFetchEepromWord(0);
+        addFetchEepromWord(0);
+        addFetchEepromWord(0);
+
+        addFetchEepromWord(0xCAFEDECA);     // vendor id
+        addFetchEepromWord(0xA5A5A5A5);     // product code
+        addFetchEepromWord(0x5A5A5A5A);     // revision number
+        addFetchEepromWord(0x12345678);     // serial number
+        addFetchEepromWord(0);              // hardware delay
+        addFetchEepromWord(0);              // hardware delay
+        addFetchEepromWord(0);              // bootstrap mailbox
+        addFetchEepromWord(0);              // bootstrap mailbox
+        addFetchEepromWord(0x01001000);     // mailbox rcv offset + size
+        addFetchEepromWord(0x02002000);     // mailbox snd offset + size
+        addFetchEepromWord(4);              // mailbox protocol: CoE
+        addFetchEepromWord(0);              // eeprom size
+
+        for (int i = 0; i < 18; ++i)
         {
-            mock_link->handleProcess(Command::FPRD, word, 1);
+            addFetchEepromWord(0);
         }
+
+        // -- TxPDO
+        addFetchEepromWord(0x00080032);     // section TxPDO, 16 bytes
+        addFetchEepromWord(0x00010000);     // one entry
+        addFetchEepromWord(0);              // 'padding'
+        addFetchEepromWord(0x00000000);
+        addFetchEepromWord(0x0000FF00);     // 255 bits
+
+        // -- RxPDO
+        addFetchEepromWord(0x000C0033);     // section RxPDO, 24 bytes
+        addFetchEepromWord(0x00020000);     // two entries
+        addFetchEepromWord(0);              // 'padding'
+        addFetchEepromWord(0x00000000);
+        addFetchEepromWord(0x0000FF00);     // 255 bits
+        addFetchEepromWord(0x00000000);
+        addFetchEepromWord(0x00008000);     // 128 bits
+
+        // -- SyncManagers
+        addFetchEepromWord(0x00080029);     // section SM, 16 bytes
+        addFetchEepromWord(0x00001000);
+        addFetchEepromWord(0x03010064);
+        addFetchEepromWord(0x00001200);
+        addFetchEepromWord(0x04010020);
+
+        addFetchEepromWord(0xFFFFFFFF);     // end of eeprom
     }
 
     void detectAndReset()
@@ -79,8 +166,11 @@ public:
         // eeprom to master
         mock_link->handleWriteThenRead(Command::BWR, nb_slaves_);
 
-        // setAddresses: all APWR datagrams are packed in a single frame
-        mock_link->handleWriteThenRead(Command::APWR, 1);
+        // setAddresses: the APWR datagrams are packed by frames of MAX_ETHERCAT_DATAGRAMS
+        for (int i = 0; i < nb_slaves_; i += MAX_ETHERCAT_DATAGRAMS)
+        {
+            mock_link->handleWriteThenRead(Command::APWR, 1);
+        }
 
         // fetchESC: one FPRD per slave
         for (int i = 0; i < nb_slaves_; ++i)
@@ -103,54 +193,7 @@ public:
             mock_link->handleProcess(Command::FPRD, uint8_t(State::INIT), 1);
         }
 
-        // fetchEeprom
-        addFetchEepromWord(0);
-        addFetchEepromWord(0);
-        addFetchEepromWord(0);
-        addFetchEepromWord(0);
-
-        addFetchEepromWord(0xCAFEDECA);     // vendor id
-        addFetchEepromWord(0xA5A5A5A5);     // product code
-        addFetchEepromWord(0x5A5A5A5A);     // revision number
-        addFetchEepromWord(0x12345678);     // serial number
-        addFetchEepromWord(0);              // hardware delay
-        addFetchEepromWord(0);              // hardware delay
-        addFetchEepromWord(0);              // bootstrap mailbox
-        addFetchEepromWord(0);              // bootstrap mailbox
-        addFetchEepromWord(0x01001000);     // mailbox rcv offset + size
-        addFetchEepromWord(0x02002000);     // mailbox snd offset + size
-        addFetchEepromWord(4);              // mailbox protocol: CoE
-        addFetchEepromWord(0);              // eeprom size
-
-        for (int i = 0; i < 18; ++i)
-        {
-            addFetchEepromWord(0);
-        }
-
-        // -- TxPDO
-        addFetchEepromWord(0x00080032);     // section TxPDO, 16 bytes
-        addFetchEepromWord(0x00010000);     // one entry
-        addFetchEepromWord(0);              // 'padding'
-        addFetchEepromWord(0x00000000);
-        addFetchEepromWord(0x0000FF00);     // 255 bits
-
-        // -- RxPDO
-        addFetchEepromWord(0x000C0033);     // section RxPDO, 24 bytes
-        addFetchEepromWord(0x00020000);     // two entries
-        addFetchEepromWord(0);              // 'padding'
-        addFetchEepromWord(0x00000000);
-        addFetchEepromWord(0x0000FF00);     // 255 bits
-        addFetchEepromWord(0x00000000);
-        addFetchEepromWord(0x00008000);     // 128 bits
-
-        // -- SyncManagers
-        addFetchEepromWord(0x00080029);     // section SM, 16 bytes
-        addFetchEepromWord(0x00001000);
-        addFetchEepromWord(0x03010064);
-        addFetchEepromWord(0x00001200);
-        addFetchEepromWord(0x04010020);
-
-        addFetchEepromWord(0xFFFFFFFF);     // end of eeprom
+        addFetchEeprom();
 
         // configureMailboxes: one FPWR per slave
         for (int i = 0; i < nb_slaves_; ++i)
@@ -167,14 +210,18 @@ public:
             mock_link->handleProcess(Command::FPRD, uint8_t(State::PRE_OP), 1);
         }
 
-        // checkMailboxes: write checks (all slaves) then read checks (all slaves)
-        for (int i = 0; i < nb_slaves_; ++i)
-        {
-            mock_link->handleProcess(Command::FPRD, uint8_t{0x08}, 1);
-        }
-        for (int i = 0; i < nb_slaves_; ++i)
+        // checkMailboxes: write checks then read checks, by rounds of 127 slaves
+        for (int begin = 0; begin < nb_slaves_; begin += 127)
         {
-            mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+            int round = std::min(127, nb_slaves_ - begin);
+            for (int i = 0; i < round; ++i)
+            {
+                mock_link->handleProcess(Command::FPRD, uint8_t{0x08}, 1);
+            }
+            for (int i = 0; i < round; ++i)
+            {
+                mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+            }
         }
 
         bus.init(watchdog);
@@ -233,10 +280,24 @@ public:
         }
     }
 
+    // Replace the initialized slave by 'count' copies of it, to check the rounds of large buses
+    void replicateSlave(int count)
+    {
+        nb_slaves_ = count;
+        Slave model = bus.slaves().at(0);
+        bus.slaves().clear();
+        for (int i = 0; i < count; ++i)
+        {
+            bus.slaves().push_back(model);
+            bus.slaves().back().address = static_cast<uint16_t>(0x1000 + i);
+        }
+    }
+
 protected:
     std::shared_ptr<MockLink> mock_link{ std::make_shared<MockLink>() };
     BusAccessor bus{ mock_link };
     int nb_slaves_{1}; // set in a derived fixture constructor, before SetUp runs
+    uint32_t eeprom_address_{0}; // next SII word read by fetchEeprom
 };
 
 TEST_F(BusTest, nop)
@@ -289,6 +350,15 @@ TEST_F(BusTest, createMapping_throws_when_iomap_too_small)
 }
 
 
+TEST_F(BusTest, createMapping_throws_on_null_iomap)
+{
+    // no silent switch to the in-frame process image: nothing is sent to the slaves
+    std::size_t already_sent = mock_link->sentDatagrams().size();
+    ASSERT_THROW(bus.createMapping(nullptr, 256), Error);
+    ASSERT_EQ(already_sent, mock_link->sentDatagrams().size());
+}
+
+
 TEST_F(BusTest, logical_cmd)
 {
     auto& slave = bus.slaves().at(0);
@@ -350,6 +420,61 @@ TEST_F(BusTest, logical_cmd)
 
     mock_link->handleProcess(Command::LRW, uint8_t{0}, 0);
     ASSERT_THROW(bus.processDataReadWrite([](DatagramState const&){ throw std::overflow_error(""); }), std::overflow_error);
+
+    // a plain function is accepted as error callback
+    mock_link->handleProcess(Command::LRD, uint8_t{0}, 0);
+    last_process_data_error = DatagramState::OK;
+    bus.processDataRead(recordProcessDataError);
+    ASSERT_EQ(DatagramState::INVALID_WKC, last_process_data_error);
+
+    mock_link->handleProcess(Command::LWR, uint8_t{0}, 0);
+    last_process_data_error = DatagramState::OK;
+    bus.processDataWrite(recordProcessDataError);
+    ASSERT_EQ(DatagramState::INVALID_WKC, last_process_data_error);
+
+    mock_link->handleProcess(Command::LRW, uint8_t{0}, 0);
+    last_process_data_error = DatagramState::OK;
+    bus.processDataReadWrite(recordProcessDataError);
+    ASSERT_EQ(DatagramState::INVALID_WKC, last_process_data_error);
+}
+
+
+TEST_F(BusTest, logical_cmd_in_frame_process_image)
+{
+    auto& slave = bus.slaves().at(0);
+    slave.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
+
+    bus.createMapping();
+
+    // Slave PI points straight into the PI frame payloads
+    auto const& frame = bus.pi_frames_[0];
+    ASSERT_EQ(frame.output_buffer.data(), slave.output.data);
+    ASSERT_EQ(frame.input_buffer.data(),  slave.input.data);
+    ASSERT_TRUE(frame.gather.empty());
+
+    int64_t logical_write = 0x1716151413121110;
+    std::memcpy(slave.output.data, &logical_write, sizeof(int64_t));
+    int64_t logical_read = 0x0001020304050607;
+    mock_link->handleProcess(Command::LRW, logical_read, 3);
+    bus.sendLogicalReadWrite([](DatagramState const&){ FAIL(); });
+
+    // The queued payload is the output image itself
+    ASSERT_EQ(1u, mock_link->pendingDatagrams().size());
+    ASSERT_EQ(0, std::memcmp(&logical_write, mock_link->pendingDatagrams()[0].data.data(), sizeof(int64_t)));
+
+    mock_link->processDatagrams();
+    for (int i = 0; i < 8; ++i)
+    {
+        ASSERT_EQ(7 - i, slave.input.data[i]);
+    }
+
+    // Outputs are not overwritten by the answer
+    ASSERT_EQ(0, std::memcmp(&logical_write, slave.output.data, sizeof(int64_t)));
 }
 
 
@@ -597,6 +722,156 @@ TEST_F(BusTest, read_SDO_buffer_too_small)
 }
 
 
+TEST_F(BusTest, fetch_eeprom_with_sii_cache)
+{
+    std::string path = testing::TempDir() + "bus_sii_cache.bin";
+    std::remove(path.c_str());
+
+    // unknown slave: read in full, then cached
+    SIICache cache(path);
+    bus.setSIICache(&cache);
+    addFetchEeprom();
+    bus.fetchEeprom();
+    ASSERT_EQ(1, cache.size());
+
+    // restart: the header matches, the rest of the SII comes from the cache
+    SIICache reloaded(path);
+    ASSERT_EQ(1, reloaded.size());
+    bus.setSIICache(&reloaded);
+    bus.slaves().at(0).sii = {};
+    eeprom_address_ = 0;
+    for (uint32_t word : {0u, 0u, 0u, 0u, 0xCAFEDECAu, 0xA5A5A5A5u, 0x5A5A5A5Au, 0x12345678u})
+    {
+        addFetchEepromWord(word);
+    }
+    bus.fetchEeprom();
+
+    // nothing else was read
+    mock_link->handleProcess(Command::NOP, uint8_t{0}, 1);
+    bus.sendNop([](DatagramState const&){});
+    bus.finalizeDatagrams();
+    bus.processAwaitingFrames();
+
+    auto const& slave = bus.slaves().at(0);
+    ASSERT_EQ(0xCAFEDECA, slave.sii.info.vendor_id);
+    ASSERT_EQ(0x12345678, slave.sii.info.serial_number);
+    ASSERT_EQ(0x0100,     slave.mailbox.recv_size);
+    ASSERT_EQ(1, slave.sii.TxPDO.size());
+    ASSERT_EQ(2, slave.sii.RxPDO[0].entries.size());
+    std::remove(path.c_str());
+}
+
+
+TEST_F(BusTest, fetch_eeprom_first_status_polled_after_the_request_frame)
+{
+    // The ESC applies the first read request after the status poll of its frame: the register still reads
+    // address 0, not busy. This stale status shall not be taken as the first word.
+    bus.slaves().at(0).sii = {};
+    std::size_t already_sent = mock_link->sentDatagrams().size();
+    addFetchEeprom();
+    bus.fetchEeprom();
+
+    auto const& sent = mock_link->sentDatagrams();
+    ASSERT_EQ(Command::FPWR, sent[already_sent + 0].command);
+    ASSERT_EQ(Command::FPRD, sent[already_sent + 1].command);
+    ASSERT_EQ(Command::FPRD, sent[already_sent + 2].command);   // next round: poll only
+    ASSERT_EQ(Command::FPWR, sent[already_sent + 3].command);   // then the second read
+    ASSERT_EQ(Command::FPRD, sent[already_sent + 4].command);
+
+    auto const& slave = bus.slaves().at(0);
+    ASSERT_EQ(0xCAFEDECA, slave.sii.info.vendor_id);
+    ASSERT_EQ(0x12345678, slave.sii.info.serial_number);
+    ASSERT_EQ(2, slave.sii.RxPDO[0].entries.size());
+}
+
+
+TEST_F(BusTest, fetch_eeprom_more_slaves_than_a_datagram_window)
+{
+    // Two datagrams per slave and per round: 200 slaves do not fit in the 255 datagrams of the link index window
+    replicateSlave(200);
+    for (auto& slave : bus.slaves())
+    {
+        slave.sii = {};
+    }
+
+    addFetchEeprom();
+    bus.fetchEeprom();
+
+    for (auto const& slave : bus.slaves())
+    {
+        ASSERT_EQ(0xCAFEDECA, slave.sii.info.vendor_id);
+        ASSERT_EQ(0x12345678, slave.sii.info.serial_number);
+        ASSERT_EQ(2, slave.sii.RxPDO[0].entries.size());
+    }
+}
+
+
+TEST_F(BusTest, mailbox_rounds_of_more_slaves_than_a_datagram_window)
+{
+    // Up to two datagrams per slave for the mailbox checks and the messages: 200 slaves need two rounds
+    replicateSlave(200);
+
+    // checkMailboxes: write checks then read checks of the slaves of each round
+    for (int round : {127, 73})
+    {
+        for (int i = 0; i < round; ++i)
+        {
+            mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+        }
+        for (int i = 0; i < round; ++i)
+        {
+            mock_link->handleProcess(Command::FPRD, uint8_t{0x08}, 1);
+        }
+    }
+    bus.checkMailboxes([](DatagramState const&){ throw std::runtime_error("unexpected error"); });
+
+    for (auto const& slave : bus.slaves())
+    {
+        ASSERT_TRUE(slave.mailbox.can_write);
+        ASSERT_TRUE(slave.mailbox.can_read);
+    }
+
+    // processMessages: one SDO request then its answer per slave
+    std::vector<uint32_t> values(bus.slaves().size(), 0);
+    std::vector<uint32_t> sizes(bus.slaves().size(), sizeof(uint32_t));
+    std::vector<std::shared_ptr<mailbox::request::AbstractMessage>> sdos;
+    for (std::size_t i = 0; i < bus.slaves().size(); ++i)
+    {
+        auto& mailbox = bus.slaves()[i].mailbox;
+        mailbox.can_read = false;
+        // the test clock ticks on each now() call: the default timeout is too short for 200 slaves
+        sdos.push_back(mailbox.createSDO(0x1018, 1, false, CoE::SDO::request::UPLOAD, &values[i], &sizes[i], 10s));
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
+    bus.processMessages([](DatagramState const&){ throw std::runtime_error("unexpected error"); });
+
+    SDOAnswer answer;
+    answer.header.len = 10;
+    answer.header.address = 0;
+    answer.header.type = mailbox::Type::CoE;
+    answer.coe.service = CoE::Service::SDO_RESPONSE;
+    answer.sdo.command = CoE::SDO::response::UPLOAD;
+    answer.sdo.index = 0x1018;
+    answer.sdo.subindex = 1;
+    answer.sdo.transfer_type = 1;
+    answer.sdo.block_size = 0;
+    for (std::size_t i = 0; i < bus.slaves().size(); ++i)
+    {
+        bus.slaves()[i].mailbox.can_read = true;
+        uint32_t value = static_cast<uint32_t>(i);
+        std::memcpy(answer.payload, &value, sizeof(value));
+        mock_link->handleProcess(Command::FPRD, answer, 1);
+    }
+    bus.processMessages([](DatagramState const&){ throw std::runtime_error("unexpected error"); });
+
+    for (std::size_t i = 0; i < sdos.size(); ++i)
+    {
+        ASSERT_EQ(mailbox::request::MessageStatus::SUCCESS, sdos[i]->status());
+        ASSERT_EQ(i, values[i]);
+    }
+}
+
+
 TEST_F(BusTest, detect_mapping_CoE)
 {
     addReadEmulatedSDO<uint8_t>(CoE::SM_COM_TYPE,    { 2, SyncManager::Output, SyncManager::Input});
@@ -1217,6 +1492,28 @@ public:
 };
 
 
+// More slaves than the link datagram index window (255): every per slave step of init() goes by rounds
+class BusTestLargeBus : public BusTest
+{
+public:
+    BusTestLargeBus()
+    {
+        nb_slaves_ = 300;
+    }
+};
+
+
+TEST_F(BusTestLargeBus, init_by_rounds)
+{
+    // initBus() (SetUp) checked the SII of every slave: nothing else was sent
+    ASSERT_EQ(300, bus.slaves().size());
+
+    mock_link->handleProcess(Command::NOP, uint8_t{0}, 1);
+    bus.sendNop([](DatagramState const&){});
+    bus.processAwaitingFrames();
+}
+
+
 TEST_F(BusTest2Slaves, description_entries_multi_slave_offsets)
 {
     auto& slave0 = bus.slaves().at(0);
@@ -1256,23 +1553,65 @@ TEST_F(BusTest2Slaves, description_entries_multi_slave_offsets)
 }
 
 
-TEST_F(BusTest2Slaves, description_entries_mailbox_only_slave_contribution)
+TEST_F(BusTest2Slaves, cyclic_program_coalesces_contiguous_blocks)
 {
-    auto& slave0 = bus.slaves().at(0);
-    auto& slave1 = bus.slaves().at(1);
+    for (auto& slave : bus.slaves())
+    {
+        slave.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+    }
 
-    // slave 0: mailbox but no PDO at all
-    slave0.is_static_mapping = true;
-    slave0.input.bsize = 0;
-    slave0.output.bsize = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
 
-    // slave 1: plain PDO slave, out of the mailbox status scope
-    slave1.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+    uint8_t iomap[256];
+    bus.createMapping(iomap, sizeof(iomap));
 
-    bus.configureMailboxStatusCheck(MailboxStatusFMMU::READ_CHECK | MailboxStatusFMMU::WRITE_CHECK);
+    // Slaves are laid out every max(in, out) = 48 bytes: outputs are contiguous in the frame and in the iomap,
+    // the 32 bytes inputs leave a gap in the frame.
+    auto const& frame = bus.pi_frames_[0];
+    ASSERT_EQ(1u, frame.gather.size());
+    ASSERT_EQ(0u, frame.gather[0].offset);
+    ASSERT_EQ(96, frame.gather[0].size);
+    ASSERT_EQ(bus.slaves().at(0).output.data, frame.gather[0].iomap);
 
-    // configureFMMUs: 4 FPWR for slave 1, then 2 FPWR for slave 0 mailbox status FMMUs
-    for (int i = 0; i < 6; ++i)
+    ASSERT_EQ(2u, frame.scatter.size());
+    ASSERT_EQ(48u, frame.scatter[1].offset);
+    ASSERT_EQ(32, frame.scatter[1].size);
+
+    ASSERT_EQ(2, frame.expected_lrd_wkc);
+    ASSERT_EQ(2, frame.expected_lwr_wkc);
+    ASSERT_EQ(6, frame.expected_lrw_wkc);
+
+    // The precompiled program moves the data of both slaves
+    for (int32_t i = 0; i < 96; ++i)
+    {
+        bus.slaves().at(i / 48).output.data[i % 48] = static_cast<uint8_t>(i);
+    }
+    std::array<uint8_t, 96> lrw{};
+    lrw[0]  = 0xA0;
+    lrw[48] = 0xA1;
+    mock_link->handleProcess(Command::LRW, lrw, 6);
+    bus.processDataReadWrite([](DatagramState const&){ FAIL(); });
+    ASSERT_EQ(0xA0, bus.slaves().at(0).input.data[0]);
+    ASSERT_EQ(0xA1, bus.slaves().at(1).input.data[0]);
+    ASSERT_EQ(47, frame.output_buffer[47]);
+    ASSERT_EQ(95, frame.output_buffer[95]);
+}
+
+
+TEST_F(BusTest2Slaves, cycle_divisor_groups_slaves_by_rate)
+{
+    for (auto& slave : bus.slaves())
+    {
+        slave.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+    }
+    auto& fast = bus.slaves().at(1);
+    auto& slow = bus.slaves().at(0);
+    slow.cycle_divisor = 4;
+
+    for (int i = 0; i < 8; ++i)
     {
         mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
     }
@@ -1280,132 +1619,1429 @@ TEST_F(BusTest2Slaves, description_entries_mailbox_only_slave_contribution)
     uint8_t iomap[256];
     bus.createMapping(iomap, sizeof(iomap));
 
-    ASSERT_EQ(1u, bus.pi_frames_.size());
-    auto const& frame = bus.pi_frames_[0];
-    auto const& entries = frame.description.entries;
-    ASSERT_EQ(2u, entries.size());
+    // One frame per rate, fastest first, each with its own expectations
+    ASSERT_EQ(2u, bus.pi_frames_.size());
+    ASSERT_EQ(1, bus.pi_frames_[0].divisor);
+    ASSERT_EQ(4, bus.pi_frames_[1].divisor);
+    ASSERT_EQ(0u, fast.input.address);
+    ASSERT_EQ(MAX_ETHERCAT_PAYLOAD_SIZE, slow.input.address);
+    ASSERT_EQ(3, bus.pi_frames_[0].expected_lrw_wkc);
+    ASSERT_EQ(3, bus.pi_frames_[1].expected_lrw_wkc);
+    ASSERT_EQ(2u, mock_link->logicalMapping().size());
+    ASSERT_EQ(MAX_ETHERCAT_PAYLOAD_SIZE, mock_link->logicalMapping()[1].address);
+
+    // The slow frame is only on the wire every fourth cycle
+    for (int32_t cycle = 0; cycle < 8; ++cycle)
+    {
+        bus.sendLogicalReadWrite([](DatagramState const&){ FAIL(); });
+        auto const& pending = mock_link->pendingDatagrams();
+        if ((cycle % 4) == 0)
+        {
+            ASSERT_EQ(2u, pending.size());
+            ASSERT_EQ(MAX_ETHERCAT_PAYLOAD_SIZE, pending[1].address);
+            mock_link->handleProcess(Command::LRW, uint8_t{0}, 3);
+        }
+        else
+        {
+            ASSERT_EQ(1u, pending.size());
+        }
+        ASSERT_EQ(0u, pending[0].address);
+        mock_link->handleProcess(Command::LRW, uint8_t{0}, 3);
+        mock_link->processDatagrams();
+    }
 
-    // counted exactly once although both read and write status FMMUs reference it
-    ASSERT_EQ(1, entries[0].contribution);
-    ASSERT_EQ(-1, entries[0].input_offset);
-    ASSERT_EQ(0, entries[0].input_size);
+    // A read and the write that follows it are the same cycle
+    bus.sendLogicalRead([](DatagramState const&){ FAIL(); });
+    bus.sendLogicalWrite([](DatagramState const&){ FAIL(); });
+    ASSERT_EQ(4u, mock_link->pendingDatagrams().size());
+}
 
-    ASSERT_EQ(3, entries[1].contribution);
-    ASSERT_EQ(0, entries[1].input_offset);
-    ASSERT_EQ(slave1.input.bsize, entries[1].input_size);
 
-    ASSERT_EQ(1, frame.mailbox_status_wkc_read_adjust);
+TEST_F(BusTest, cycle_divisor_shall_be_positive)
+{
+    bus.slaves().at(0).cycle_divisor = 0;
+    uint8_t iomap[256];
+    ASSERT_THROW(bus.createMapping(iomap, sizeof(iomap)), Error);
 }
 
 
-TEST_F(BusTest, output_buffer_zeroed_between_blocks)
+TEST_F(BusTest2Slaves, cycle_divisor_shall_not_exceed_the_watchdog)
 {
-    auto& slave = bus.slaves().at(0);
-    slave.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
-    slave.is_static_mapping = true;
-    slave.input.bsize = 8;
-    slave.input.sync_manager = 1;
-    slave.output.bsize = 4;
-    slave.output.sync_manager = 0;
+    for (auto& slave : bus.slaves())
+    {
+        slave.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+    }
+    bus.slaves().at(0).cycle_divisor = 4;
+    uint8_t iomap[256];
 
-    // configureFMMUs: 4 FPWR
-    for (int i = 0; i < 4; ++i)
+    // 4 x 30ms: the outputs of the slow slave would not be written within the 100ms watchdog of init()
+    bus.configureCyclePeriod(30ms);
+    ASSERT_THROW(bus.createMapping(iomap, sizeof(iomap)), Error);
+
+    // 4 x 25ms fits
+    bus.configureCyclePeriod(25ms);
+    for (int i = 0; i < 8; ++i)
     {
         mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
     }
+    bus.createMapping(iomap, sizeof(iomap));
+    ASSERT_EQ(2u, bus.pi_frames_.size());
+}
 
-    uint8_t iomap[256];
-    std::memset(iomap, 0xFF, sizeof(iomap)); // dirty client buffer: zeroes must come from the mapping
+
+TEST_F(BusTest2Slaves, bit_packed_mapping)
+{
+    auto& slave0 = bus.slaves().at(0);
+    auto& slave1 = bus.slaves().at(1);
+    auto setStaticBits = [](Slave& slave, int32_t input_bits, int32_t output_bits)
+    {
+        slave.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+        slave.is_static_mapping = true;
+        slave.sii.syncManagers.resize(4);
+        slave.input.sync_manager  = 3;
+        slave.input.bsize = 1;
+        slave.input.size  = input_bits;
+        slave.output.sync_manager = 2;
+        slave.output.bsize = 1;
+        slave.output.size  = output_bits;
+    };
+    setStaticBits(slave0, 2, 2);
+    setStaticBits(slave1, 3, 1);
+    bus.configureBitPackedMapping(true);
+
+    for (int i = 0; i < 8; ++i)
+    {
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
+
+    uint8_t iomap[2] = {}; // both slaves share one input and one output byte
     bus.createMapping(iomap, sizeof(iomap));
 
-    // logical size = max(in 8, out 4); bytes 4-7 are an input-only gap
-    auto const& frame = bus.pi_frames_[0];
-    ASSERT_EQ(8, frame.description.logical_size);
-    ASSERT_EQ(8u, frame.output_buffer.size());
-    for (uint8_t byte : frame.output_buffer)
+    ASSERT_EQ(1, bus.pi_frames_[0].description.logical_size);
+    ASSERT_EQ(0u, slave1.input.address);
+    ASSERT_EQ(0, slave0.input.bit_offset);
+    ASSERT_EQ(2, slave1.input.bit_offset);
+    ASSERT_EQ(slave0.input.data,  slave1.input.data);
+    ASSERT_EQ(slave0.output.data, slave1.output.data);
+
+    // FMMUs only own the bits of their slave: configureFMMUs() sends SM + FMMU for input then output, per slave
+    auto const& sent = mock_link->sentDatagrams();
+    ASSERT_LE(8u, sent.size());
+    std::vector<fmmu::Register> fmmus;
+    for (auto dg = sent.end() - 8; dg != sent.end(); ++dg)
     {
-        ASSERT_EQ(0, byte);
+        if (dg->data.size() == sizeof(fmmu::Register))
+        {
+            fmmu::Register fmmu;
+            std::memcpy(&fmmu, dg->data.data(), sizeof(fmmu::Register));
+            fmmus.push_back(fmmu);
+        }
     }
+    ASSERT_EQ(4u, fmmus.size());
+    ASSERT_EQ(0, fmmus[0].logical_start_bit);
+    ASSERT_EQ(1, fmmus[0].logical_stop_bit);
+    ASSERT_EQ(2, fmmus[2].logical_start_bit);
+    ASSERT_EQ(4, fmmus[2].logical_stop_bit);    // slave 1 input: 3 bits
+    ASSERT_EQ(2, fmmus[3].logical_stop_bit);    // slave 1 output: 1 bit
+    ASSERT_EQ(1, fmmus[3].length);
+
+    // Redundancy attributes the shared byte bit by bit
+    auto const& entries = bus.pi_frames_[0].description.entries;
+    ASSERT_EQ(0x03, entries[0].input_mask);
+    ASSERT_EQ(0x1C, entries[1].input_mask);
+
+    slave0.output.setBit(0, true);
+    slave0.output.setBit(1, false);
+    slave1.output.setBit(0, true);
+    mock_link->handleProcess(Command::LRW, uint8_t{0x16}, 6); // slave 0 inputs: 0b10, slave 1 inputs: 0b101
+    bus.sendLogicalReadWrite([](DatagramState const&){ FAIL(); });
+    ASSERT_EQ(1u, mock_link->pendingDatagrams()[0].data.size());
+    ASSERT_EQ(0x05, mock_link->pendingDatagrams()[0].data[0]);
+    mock_link->processDatagrams();
+
+    ASSERT_FALSE(slave0.input.bit(0));
+    ASSERT_TRUE (slave0.input.bit(1));
+    ASSERT_TRUE (slave1.input.bit(0));
+    ASSERT_FALSE(slave1.input.bit(1));
+    ASSERT_TRUE (slave1.input.bit(2));
+}
 
-    // LRW payload: output block from the iomap, input-only gap still zeroed
-    std::memset(slave.output.data, 0xAB, 4);
-    bus.sendLogicalReadWrite([](DatagramState const&){});
 
-    ASSERT_EQ(1u, mock_link->pendingDatagrams().size());
-    auto const& sent = mock_link->pendingDatagrams()[0];
-    ASSERT_EQ(Command::LRW, sent.command);
-    ASSERT_EQ(8u, sent.data.size());
+TEST_F(BusTest2Slaves, detect_mapping_CoE_all_slaves_at_once)
+{
+    // Both slaves upload the same objects: each subindex takes one mailbox round for all the slaves,
+    // the mock enforcing that the datagrams of the two slaves are interleaved.
+    auto addReadEmulatedSDOs = [&](uint16_t index, std::vector<uint16_t> const& slave0, std::vector<uint16_t> const& slave1)
+    {
+        SDOAnswer answer;
+        answer.header.len = 10;
+        answer.header.address = 0;
+        answer.header.type = mailbox::Type::CoE;
+        answer.coe.service = CoE::Service::SDO_RESPONSE;
+        answer.sdo.command = CoE::SDO::response::UPLOAD;
+        answer.sdo.index = index;
+        answer.sdo.transfer_type = 1;
+        answer.sdo.block_size = 2;
+        std::memset(answer.payload, 0, 4);
+
+        for (uint32_t i = 0; i < slave0.size(); ++i)
+        {
+            // checkMailboxes: can write, nothing to read - write to both mailboxes
+            for (int j = 0; j < 4; ++j)
+            {
+                mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+            }
+            mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+            mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+
+            // checkMailboxes: can write, something to read - read both answers
+            mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+            mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+            mock_link->handleProcess(Command::FPRD, uint8_t{0x08}, 1);
+            mock_link->handleProcess(Command::FPRD, uint8_t{0x08}, 1);
+
+            answer.sdo.subindex = static_cast<uint8_t>(i);
+            std::memcpy(answer.payload, &slave0[i], sizeof(uint16_t));
+            mock_link->handleProcess(Command::FPRD, answer, 1);
+            std::memcpy(answer.payload, &slave1[i], sizeof(uint16_t));
+            mock_link->handleProcess(Command::FPRD, answer, 1);
+        }
+    };
+
+    addReadEmulatedSDOs(CoE::SM_COM_TYPE,    { 1, SyncManager::Input },  { 1, SyncManager::Input });
+    addReadEmulatedSDOs(CoE::SM_CHANNEL + 0, { 1, 0x1A00 },              { 1, 0x1A00 });
+    addReadEmulatedSDOs(0x1A00,              { 1, 16 },                  { 1, 40 });
+
+    // configureFMMUs: SM + FMMU for the inputs of each slave
     for (int i = 0; i < 4; ++i)
     {
-        ASSERT_EQ(0xAB, sent.data[i]);
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
     }
-    for (int i = 4; i < 8; ++i)
+
+    uint8_t iomap[256];
+    bus.createMapping(iomap, sizeof(iomap));
+
+    ASSERT_EQ(2, bus.slaves().at(0).input.bsize);
+    ASSERT_EQ(5, bus.slaves().at(1).input.bsize);
+    ASSERT_EQ(0, bus.slaves().at(0).output.bsize);
+}
+
+
+TEST_F(BusTest2Slaves, detect_mapping_CoE_failure_cancels_the_other_discoveries)
+{
+    // checkMailboxes: can write, nothing to read - write to both mailboxes
+    for (int j = 0; j < 4; ++j)
     {
-        ASSERT_EQ(0, sent.data[i]);
+        mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
     }
+    mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
 
-    // drain the awaiting datagram (wkc = 1 input + 2 * 1 output)
-    uint64_t reply = 0;
-    mock_link->handleProcess(Command::LRW, reply, 3);
-    bus.processAwaitingFrames();
+    // checkMailboxes: slave 0 answered, slave 1 is still busy on its SDO
+    mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPRD, uint8_t{0x08}, 1);
+    mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+
+    SDOAnswer answer;
+    answer.header.len = 10;
+    answer.header.address = 0;
+    answer.header.type = mailbox::Type::CoE;
+    answer.coe.service = CoE::Service::SDO_RESPONSE;
+    answer.sdo.command = CoE::SDO::request::ABORT;
+    answer.sdo.index = CoE::SM_COM_TYPE;
+    answer.sdo.subindex = 0;
+    *reinterpret_cast<uint32_t*>(answer.payload) = CoE::SDO::abort::OBJECT_DOES_NOT_EXIST;
+    mock_link->handleProcess(Command::FPRD, answer, 1);
+
+    // Only the permanent receivers (emergencies, ...) shall remain once the mapping is over
+    std::vector<std::size_t> receivers;
+    for (auto& slave : bus.slaves())
+    {
+        receivers.push_back(slave.mailbox.to_process.size());
+    }
+
+    uint8_t iomap[256];
+    ASSERT_THROW(bus.createMapping(iomap, sizeof(iomap)), Error);
+
+    // The SDO of slave 1 pointed into its discovery, gone with the exception: it shall not be left in its mailbox
+    for (std::size_t i = 0; i < bus.slaves().size(); ++i)
+    {
+        ASSERT_TRUE(bus.slaves().at(i).mailbox.to_send.empty());
+        ASSERT_EQ(receivers.at(i), bus.slaves().at(i).mailbox.to_process.size());
+    }
 }
 
 
-TEST_F(BusTest, create_mapping_twice_does_not_duplicate_state)
+TEST_F(BusTest2Slaves, sdo_batch_transfers_all_slaves_at_once)
 {
-    auto& slave = bus.slaves().at(0);
-    slave.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+    // Each slave downloads then uploads: one SDO in flight per slave, the two slaves sharing each mailbox round
+    SDOAnswer answer;
+    answer.header.len = 10;
+    answer.header.address = 0;
+    answer.header.type = mailbox::Type::CoE;
+    answer.coe.service = CoE::Service::SDO_RESPONSE;
+    answer.sdo.index = 0x1018;
+    answer.sdo.transfer_type = 1;
+    answer.sdo.block_size = 0;
+    std::memset(answer.payload, 0, 4);
 
-    uint8_t iomap[256];
-    for (int run = 0; run < 2; ++run)
+    auto addRound = [&](uint8_t command, uint8_t subindex, uint32_t slave0, uint32_t slave1)
     {
-        // configureFMMUs: 4 FPWR per run
+        // checkMailboxes: can write, nothing to read - write to both mailboxes
         for (int i = 0; i < 4; ++i)
         {
-            mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+            mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
         }
-        bus.createMapping(iomap, sizeof(iomap));
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
 
-        ASSERT_EQ(1u, bus.pi_frames_.size());
-        auto const& frame = bus.pi_frames_[0];
-        ASSERT_EQ(1u, frame.inputs.size());
-        ASSERT_EQ(1u, frame.outputs.size());
-        ASSERT_EQ(1u, frame.description.entries.size());
-        ASSERT_EQ(3, frame.description.entries[0].contribution);
-        ASSERT_EQ(0, frame.description.entries[0].input_offset);
-        ASSERT_EQ(slave.input.bsize, frame.description.entries[0].input_size);
+        // checkMailboxes: can write, something to read - read both answers
+        mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+        mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+        mock_link->handleProcess(Command::FPRD, uint8_t{0x08}, 1);
+        mock_link->handleProcess(Command::FPRD, uint8_t{0x08}, 1);
+
+        answer.sdo.command = command;
+        answer.sdo.subindex = subindex;
+        std::memcpy(answer.payload, &slave0, sizeof(uint32_t));
+        mock_link->handleProcess(Command::FPRD, answer, 1);
+        std::memcpy(answer.payload, &slave1, sizeof(uint32_t));
+        mock_link->handleProcess(Command::FPRD, answer, 1);
+    };
+    addRound(CoE::SDO::response::DOWNLOAD, 1, 0, 0);
+    addRound(CoE::SDO::response::UPLOAD,   2, 0xCAFEDECA, 0xDEADBEEF);
 
-        // The link copy tracks the current mapping: replaced, not appended
-        auto const& mapping = mock_link->logicalMapping();
-        ASSERT_EQ(1u, mapping.size());
-        ASSERT_EQ(frame.description.address, mapping[0].address);
-        ASSERT_EQ(frame.description.logical_size, mapping[0].logical_size);
-        ASSERT_EQ(frame.description.entries.size(), mapping[0].entries.size());
+    SDOBatch batch(bus);
+    int32_t completed = 0;
+    auto count = [&completed](SDOBatch::Transfer const&) { ++completed; };
+
+    uint32_t value = 42;
+    uint32_t read[2] = {0, 0};
+    std::vector<SDOBatch::Handle> handles;
+    for (int i = 0; i < 2; ++i)
+    {
+        auto& slave = bus.slaves().at(i);
+        handles.push_back(batch.write(slave, 0x1018, 1, Bus::Access::PARTIAL, &value, sizeof(value), count));
+        handles.push_back(batch.read (slave, 0x1018, 2, Bus::Access::PARTIAL, &read[i], sizeof(read[i]), count));
+    }
+    value = 0; // the batch copied it
+    ASSERT_FALSE(batch.done());
+
+    batch.wait();
+    ASSERT_TRUE(batch.done());
+    ASSERT_EQ(4, completed);
+    for (auto const& handle : handles)
+    {
+        ASSERT_TRUE(handle->done());
+        ASSERT_EQ(mailbox::request::MessageStatus::SUCCESS, handle->status());
+        ASSERT_EQ(4, handle->size());
     }
+    ASSERT_EQ(0xCAFEDECA, read[0]);
+    ASSERT_EQ(0xDEADBEEF, read[1]);
 }
 
 
-TEST_F(BusTest, logical_mapping_shared_with_link_at_mapping)
+TEST_F(BusTest2Slaves, sdo_batch_chains_a_new_slave_from_a_completion)
 {
-    auto& slave = bus.slaves().at(0);
-    slave.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+    SDOAnswer answer;
+    answer.header.len = 10;
+    answer.header.address = 0;
+    answer.header.type = mailbox::Type::CoE;
+    answer.coe.service = CoE::Service::SDO_RESPONSE;
+    answer.sdo.command = CoE::SDO::response::DOWNLOAD;
+    answer.sdo.index = 0x1C12;
+    answer.sdo.subindex = 0;
+    answer.sdo.transfer_type = 0;
+    answer.sdo.block_size = 0;
+    std::memset(answer.payload, 0, 4);
 
-    for (int i = 0; i < 4; ++i)
+    // One slave after the other: the write then the answer of each
+    for (uint8_t slave0_read : {uint8_t{0x08}, uint8_t{0}})
     {
+        for (int i = 0; i < 4; ++i)
+        {
+            mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+        }
         mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+
+        mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+        mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+        mock_link->handleProcess(Command::FPRD, slave0_read, 1);
+        mock_link->handleProcess(Command::FPRD, uint8_t(slave0_read ^ 0x08), 1);
+        mock_link->handleProcess(Command::FPRD, answer, 1);
     }
 
-    uint8_t iomap[256];
-    bus.createMapping(iomap, sizeof(iomap));
+    SDOBatch batch(bus);
+    uint8_t value = 0;
+    SDOBatch::Handle chained;
+    auto first = batch.write(bus.slaves().at(0), 0x1C12, 0, Bus::Access::PARTIAL, &value, sizeof(value),
+        [&](SDOBatch::Transfer const&)
+        {
+            // the batch did not know this slave yet
+            chained = batch.write(bus.slaves().at(1), 0x1C12, 0, Bus::Access::PARTIAL, &value, sizeof(value));
+        });
+
+    batch.wait();
+    ASSERT_TRUE(batch.done());
+    ASSERT_EQ(mailbox::request::MessageStatus::SUCCESS, first->status());
+    ASSERT_NE(nullptr, chained);
+    ASSERT_EQ(mailbox::request::MessageStatus::SUCCESS, chained->status());
+}
 
-    auto const& mapping = mock_link->logicalMapping();
-    ASSERT_EQ(1u, mapping.size());
-    auto const& desc = mapping[0];
-    ASSERT_EQ(bus.pi_frames_[0].description.address, desc.address);
-    ASSERT_EQ(48, desc.logical_size); // max(in 32, out 48)
-    ASSERT_EQ(48, desc.pdo_size);
-    ASSERT_EQ(1u, desc.entries.size());
-    ASSERT_EQ(3, desc.entries[0].contribution); // 1 input + 2 outputs
-    ASSERT_EQ(0, desc.entries[0].input_offset);
-    ASSERT_EQ(32, desc.entries[0].input_size);
+
+TEST_F(BusTest, sdo_batch_failure_cancels_the_slave_sequence)
+{
+    // checkMailboxes: can write, nothing to read
+    mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+
+    // write to mailbox
+    mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+
+    // checkMailboxes: can write, something to read
+    mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPRD, uint8_t{0x08}, 1);
+
+    SDOAnswer answer;
+    answer.header.len = 10;
+    answer.header.address = 0;
+    answer.header.type = mailbox::Type::CoE;
+    answer.coe.service = CoE::Service::SDO_RESPONSE;
+    answer.sdo.command = CoE::SDO::request::ABORT;
+    answer.sdo.index = 0x1600;
+    answer.sdo.subindex = 0;
+    *reinterpret_cast<uint32_t*>(answer.payload) = CoE::SDO::abort::UNSUPPORTED_ACCESS;
+    mock_link->handleProcess(Command::FPRD, answer, 1);
+
+    auto& slave = bus.slaves().at(0);
+    SDOBatch batch(bus);
+
+    uint32_t cancelled = 0;
+    uint8_t count = 0;
+    auto first  = batch.write(slave, 0x1600, 0, Bus::Access::PARTIAL, &count, sizeof(count));
+    auto second = batch.write(slave, 0x1600, 1, Bus::Access::PARTIAL, &count, sizeof(count),
+        [&cancelled](SDOBatch::Transfer const& transfer) { cancelled = transfer.status(); });
+
+    ASSERT_THROW(batch.wait(), Error);
+    ASSERT_EQ(CoE::SDO::abort::UNSUPPORTED_ACCESS, first->status());
+    ASSERT_EQ(mailbox::request::MessageStatus::CANCELLED, second->status());
+    ASSERT_EQ(mailbox::request::MessageStatus::CANCELLED, cancelled);
+    ASSERT_TRUE(batch.done());
+
+    // the error is reported once
+    batch.wait();
+}
+
+
+TEST_F(BusTest, sdo_batch_destruction_cancels_the_transfers_in_flight)
+{
+    auto& slave = bus.slaves().at(0);
+    std::size_t receivers = slave.mailbox.to_process.size();
+
+    SDOBatch::Handle first;
+    SDOBatch::Handle second;
+    {
+        SDOBatch batch(bus);
+        uint32_t value = 0;
+        first  = batch.read(slave, 0x1018, 1, Bus::Access::PARTIAL, &value, sizeof(value));
+        second = batch.read(slave, 0x1018, 2, Bus::Access::PARTIAL, &value, sizeof(value));
+        ASSERT_EQ(1, slave.mailbox.to_send.size());
+    }
+
+    // The SDO pointed into the batch and the client buffer: it shall not be left in the mailbox
+    ASSERT_TRUE(slave.mailbox.to_send.empty());
+    ASSERT_EQ(receivers, slave.mailbox.to_process.size());
+    ASSERT_EQ(mailbox::request::MessageStatus::CANCELLED, first->status());
+    ASSERT_EQ(mailbox::request::MessageStatus::CANCELLED, second->status());
+}
+
+
+TEST_F(BusTest2Slaves, fetch_eeprom_slaves_advance_independently)
+{
+    // Slave 0 reads 8 bytes at a time, slave 1 reads 4 bytes at a time and is busy on its first poll:
+    // each one requests its next read as soon as the previous one is over, in the same frames.
+    std::vector<uint32_t> sii(34, 0);
+    sii[4] = 0xCAFEDECA;    // vendor id
+    sii[7] = 0x12345678;    // serial number
+    sii[32] = 0xFFFFFFFF;   // end of eeprom
+    sii[33] = 0xFFFFFFFF;
+
+    uint32_t pos0 = 0;  // next SII uint32 of each slave
+    uint32_t pos1 = 0;
+    int32_t round = 0;
+    int32_t frames_slave0 = 0;
+    while ((pos0 < 33) or (pos1 < 33))
+    {
+        if (round == 0)
+        {
+            // the first status poll is not trusted, whatever it reads
+            EepromInterface stale{eeprom::Control::NB_READ_BYTES, 0, {0xDEADBEEF, 0xDEADBEEF}};
+            mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+            mock_link->handleProcess(Command::FPRD, stale, 1);
+        }
+        else if (pos0 < 33)
+        {
+            if (round > 1)
+            {
+                mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+            }
+            EepromInterface answer{eeprom::Control::NB_READ_BYTES, pos0 * 2, {sii[pos0], sii[pos0 + 1]}};
+            mock_link->handleProcess(Command::FPRD, answer, 1);
+            pos0 += 2;
+            ++frames_slave0;
+        }
+
+        if (round == 0)
+        {
+            EepromInterface busy{static_cast<uint16_t>(eeprom::Control::BUSY | eeprom::Control::READ), 0, {0, 0}};
+            mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+            mock_link->handleProcess(Command::FPRD, busy, 1);
+        }
+        else if (pos1 < 33)
+        {
+            if (round > 1)
+            {
+                mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1); // no new request while the first read is pending
+            }
+            EepromInterface answer{0, pos1 * 2, {sii[pos1], 0xDEADBEEF}};
+            mock_link->handleProcess(Command::FPRD, answer, 1);
+            ++pos1;
+        }
+        ++round;
+    }
+
+    bus.fetchEeprom();
+
+    // nothing else was read
+    mock_link->handleProcess(Command::NOP, uint8_t{0}, 1);
+    bus.sendNop([](DatagramState const&){});
+    bus.finalizeDatagrams();
+    bus.processAwaitingFrames();
+
+    ASSERT_EQ(17, frames_slave0);
+    ASSERT_EQ(34, round);
+    for (auto const& slave : bus.slaves())
+    {
+        ASSERT_EQ(0xCAFEDECA, slave.sii.info.vendor_id);
+        ASSERT_EQ(0x12345678, slave.sii.info.serial_number);
+    }
+}
+
+
+TEST_F(BusTest2Slaves, description_entries_mailbox_only_slave_contribution)
+{
+    auto& slave0 = bus.slaves().at(0);
+    auto& slave1 = bus.slaves().at(1);
+
+    // slave 0: mailbox but no PDO at all
+    slave0.is_static_mapping = true;
+    slave0.input.bsize = 0;
+    slave0.output.bsize = 0;
+
+    // slave 1: plain PDO slave, out of the mailbox status scope
+    slave1.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+
+    bus.configureMailboxStatusCheck(MailboxStatusFMMU::READ_CHECK | MailboxStatusFMMU::WRITE_CHECK);
+
+    // configureFMMUs: 4 FPWR for slave 1, then 2 FPWR for slave 0 mailbox status FMMUs
+    for (int i = 0; i < 6; ++i)
+    {
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
+
+    uint8_t iomap[256];
+    bus.createMapping(iomap, sizeof(iomap));
+
+    ASSERT_EQ(1u, bus.pi_frames_.size());
+    auto const& frame = bus.pi_frames_[0];
+    auto const& entries = frame.description.entries;
+    ASSERT_EQ(2u, entries.size());
+
+    // counted exactly once although both read and write status FMMUs reference it
+    ASSERT_EQ(1, entries[0].contribution);
+    ASSERT_EQ(-1, entries[0].input_offset);
+    ASSERT_EQ(0, entries[0].input_size);
+
+    ASSERT_EQ(3, entries[1].contribution);
+    ASSERT_EQ(0, entries[1].input_offset);
+    ASSERT_EQ(slave1.input.bsize, entries[1].input_size);
+
+    ASSERT_EQ(1, frame.mailbox_status_wkc_read_adjust);
+}
+
+
+TEST_F(BusTest, output_buffer_zeroed_between_blocks)
+{
+    auto& slave = bus.slaves().at(0);
+    slave.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+    slave.is_static_mapping = true;
+    slave.input.bsize = 8;
+    slave.input.sync_manager = 1;
+    slave.output.bsize = 4;
+    slave.output.sync_manager = 0;
+
+    // configureFMMUs: 4 FPWR
+    for (int i = 0; i < 4; ++i)
+    {
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
+
+    uint8_t iomap[256];
+    std::memset(iomap, 0xFF, sizeof(iomap)); // dirty client buffer: zeroes must come from the mapping
+    bus.createMapping(iomap, sizeof(iomap));
+
+    // logical size = max(in 8, out 4); bytes 4-7 are an input-only gap
+    auto const& frame = bus.pi_frames_[0];
+    ASSERT_EQ(8, frame.description.logical_size);
+    ASSERT_EQ(8u, frame.output_buffer.size());
+    for (uint8_t byte : frame.output_buffer)
+    {
+        ASSERT_EQ(0, byte);
+    }
+
+    // LRW payload: output block from the iomap, input-only gap still zeroed
+    std::memset(slave.output.data, 0xAB, 4);
+    bus.sendLogicalReadWrite([](DatagramState const&){});
+
+    ASSERT_EQ(1u, mock_link->pendingDatagrams().size());
+    auto const& sent = mock_link->pendingDatagrams()[0];
+    ASSERT_EQ(Command::LRW, sent.command);
+    ASSERT_EQ(8u, sent.data.size());
+    for (int i = 0; i < 4; ++i)
+    {
+        ASSERT_EQ(0xAB, sent.data[i]);
+    }
+    for (int i = 4; i < 8; ++i)
+    {
+        ASSERT_EQ(0, sent.data[i]);
+    }
+
+    // drain the awaiting datagram (wkc = 1 input + 2 * 1 output)
+    uint64_t reply = 0;
+    mock_link->handleProcess(Command::LRW, reply, 3);
+    bus.processAwaitingFrames();
+}
+
+
+TEST_F(BusTest, create_mapping_twice_does_not_duplicate_state)
+{
+    auto& slave = bus.slaves().at(0);
+    slave.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+
+    uint8_t iomap[256];
+    for (int run = 0; run < 2; ++run)
+    {
+        // configureFMMUs: 4 FPWR per run
+        for (int i = 0; i < 4; ++i)
+        {
+            mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+        }
+        bus.createMapping(iomap, sizeof(iomap));
+
+        ASSERT_EQ(1u, bus.pi_frames_.size());
+        auto const& frame = bus.pi_frames_[0];
+        ASSERT_EQ(1u, frame.inputs.size());
+        ASSERT_EQ(1u, frame.outputs.size());
+        ASSERT_EQ(1u, frame.description.entries.size());
+        ASSERT_EQ(3, frame.description.entries[0].contribution);
+        ASSERT_EQ(0, frame.description.entries[0].input_offset);
+        ASSERT_EQ(slave.input.bsize, frame.description.entries[0].input_size);
+
+        // The link copy tracks the current mapping: replaced, not appended
+        auto const& mapping = mock_link->logicalMapping();
+        ASSERT_EQ(1u, mapping.size());
+        ASSERT_EQ(frame.description.address, mapping[0].address);
+        ASSERT_EQ(frame.description.logical_size, mapping[0].logical_size);
+        ASSERT_EQ(frame.description.entries.size(), mapping[0].entries.size());
+    }
+}
+
+
+TEST_F(BusTest, logical_mapping_shared_with_link_at_mapping)
+{
+    auto& slave = bus.slaves().at(0);
+    slave.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
+
+    uint8_t iomap[256];
+    bus.createMapping(iomap, sizeof(iomap));
+
+    auto const& mapping = mock_link->logicalMapping();
+    ASSERT_EQ(1u, mapping.size());
+    auto const& desc = mapping[0];
+    ASSERT_EQ(bus.pi_frames_[0].description.address, desc.address);
+    ASSERT_EQ(48, desc.logical_size); // max(in 32, out 48)
+    ASSERT_EQ(48, desc.pdo_size);
+    ASSERT_EQ(1u, desc.entries.size());
+    ASSERT_EQ(3, desc.entries[0].contribution); // 1 input + 2 outputs
+    ASSERT_EQ(0, desc.entries[0].input_offset);
+    ASSERT_EQ(32, desc.entries[0].input_size);
+}
+
+
+TEST_F(BusTest2Slaves, wait_for_state_on_events)
+{
+    bus.configureEventDrivenStateWait(true, 100ms);
+    auto brd_count = [&]()
+    {
+        return std::count_if(mock_link->sentDatagrams().begin(), mock_link->sentDatagrams().end(),
+                             [](auto const& dg) { return dg.command == Command::BRD; });
+    };
+
+    // AL status event enabled, one slave still in PRE_OP, then the event raised by the background frames
+    mock_link->handleWriteThenRead(Command::BWR, 2);
+    mock_link->handleProcess(Command::BRD, uint16_t(State::PRE_OP | State::SAFE_OP), 2);
+    mock_link->handleProcess(Command::BRD, uint16_t(State::SAFE_OP), 2);
+    mock_link->handleWriteThenRead(Command::BWR, 2); // event mask restored
+
+    int rounds = 0;
+    bus.waitForState(State::SAFE_OP, 1s, [&]()
+    {
+        if (++rounds == 5)
+        {
+            mock_link->raiseEcatEvent(EcatEvent::AL_STATUS);
+        }
+    });
+    ASSERT_EQ(5, rounds);
+    ASSERT_EQ(2, brd_count());
+
+    // no event (no background frame): checked every poll period
+    mock_link->handleWriteThenRead(Command::BWR, 2);
+    mock_link->handleProcess(Command::BRD, uint16_t(State::SAFE_OP), 2);
+    mock_link->handleProcess(Command::BRD, uint16_t(State::OPERATIONAL), 2);
+    mock_link->handleWriteThenRead(Command::BWR, 2);
+
+    nanoseconds start = now();
+    bus.waitForState(State::OPERATIONAL, 1s);
+    ASSERT_GE(now() - start, 100ms);
+    ASSERT_EQ(4, brd_count());
+}
+
+
+TEST_F(BusTest2Slaves, wait_for_state_on_events_reads_slaves_on_error)
+{
+    bus.configureEventDrivenStateWait(true);
+
+    struct Feedback
+    {
+        uint8_t status;
+        uint8_t padding[3];
+        uint16_t error;
+    } __attribute__((__packed__));
+
+    // error indicator in the broadcast: each slave is read to get its status code
+    mock_link->handleWriteThenRead(Command::BWR, 2);
+    mock_link->handleProcess(Command::BRD, uint16_t(State::SAFE_OP | AL_STATUS_ERR_IND), 2);
+    mock_link->handleProcess(Command::FPRD, Feedback{State::SAFE_OP, {}, 0}, 1);
+    mock_link->handleProcess(Command::FPRD, Feedback{State::PRE_OP | AL_STATUS_ERR_IND, {}, 0x001D}, 1);
+    mock_link->handleWriteThenRead(Command::BWR, 2);
+
+    try
+    {
+        bus.waitForState(State::SAFE_OP, 1s);
+        FAIL() << "AL status error not reported";
+    }
+    catch (ErrorAL const& error)
+    {
+        ASSERT_EQ(0x001D, error.code());
+    }
+}
+
+
+TEST_F(BusTest2Slaves, wait_for_state_on_events_reports_the_wait_error_when_restore_fails)
+{
+    bus.configureEventDrivenStateWait(true);
+
+    struct Feedback
+    {
+        uint8_t status;
+        uint8_t padding[3];
+        uint16_t error;
+    } __attribute__((__packed__));
+
+    mock_link->handleWriteThenRead(Command::BWR, 2);
+    mock_link->handleProcess(Command::BRD, uint16_t(State::SAFE_OP | AL_STATUS_ERR_IND), 2);
+    mock_link->handleProcess(Command::FPRD, Feedback{State::SAFE_OP, {}, 0}, 1);
+    mock_link->handleProcess(Command::FPRD, Feedback{State::PRE_OP | AL_STATUS_ERR_IND, {}, 0x001D}, 1);
+    mock_link->handleWriteThenReadError(Command::BWR); // event mask not restored
+
+    try
+    {
+        bus.waitForState(State::SAFE_OP, 1s);
+        FAIL() << "AL status error not reported";
+    }
+    catch (ErrorAL const& error)
+    {
+        ASSERT_EQ(0x001D, error.code());
+    }
+}
+
+
+TEST_F(BusTest, warm_start_from_snapshot)
+{
+    auto& slave = bus.slaves().at(0);
+    slave.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+
+    // configureFMMUs: SM+FMMU for input + SM+FMMU for output
+    for (int i = 0; i < 4; ++i)
+    {
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
+    uint8_t iomap[256];
+    bus.createMapping(iomap, sizeof(iomap));
+
+    BusSnapshot snapshot = bus.snapshot();
+    ASSERT_TRUE(snapshot.mapped);
+    ASSERT_EQ(1, snapshot.slaves.size());
+    ASSERT_EQ(slave.address, snapshot.slaves[0].address);
+    ASSERT_EQ(255, snapshot.slaves[0].input.size);
+    ASSERT_EQ(383, snapshot.slaves[0].output.size);
+
+    auto warmStart = [&](uint32_t serial_number)
+    {
+        detectAndReset();
+        for (int i = 0; i < 4; ++i)
+        {
+            mock_link->handleWriteThenRead(Command::BWR, 1); // PDIO watchdog and eeprom to master
+        }
+        mock_link->handleWriteThenRead(Command::APWR, 1);
+        mock_link->handleProcess(Command::FPRD, uint16_t(0x0030), 1); // DL status
+
+        // identity only: one broadcast read request and one frame per SII word, whatever the number of slaves
+        for (uint32_t word : {uint32_t{0xCAFEDECA}, uint32_t{0xA5A5A5A5}, uint32_t{0x5A5A5A5A}, serial_number})
+        {
+            mock_link->handleWriteThenRead(Command::BWR, 1);
+            mock_link->handleProcess(Command::FPRD, uint16_t{0}, 1);   // eeprom ready
+            mock_link->handleProcess(Command::FPRD, word, 1);
+        }
+    };
+
+    BusAccessor warm{mock_link};
+    warm.configureWaitLatency(0ns, 0ns);
+
+    warmStart(0x12345679);
+    ASSERT_THROW(warm.init(snapshot), Error);
+
+    warmStart(0x12345678);
+    mock_link->handleWriteThenRead(Command::BWR, 1);
+    mock_link->handleProcess(Command::FPRD, uint8_t(State::INIT), 1);
+    mock_link->handleWriteThenRead(Command::BWR, 1);
+    mock_link->handleProcess(Command::FPRD, uint8_t(State::PRE_OP), 1);
+    warm.init(snapshot);
+
+    auto& restored = warm.slaves().at(0);
+    ASSERT_EQ(0x12345678, restored.sii.info.serial_number);
+    ASSERT_EQ(eeprom::MailboxProtocol::None, restored.sii.info.mailbox_protocol);
+    ASSERT_TRUE(restored.is_static_mapping);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
+    warm.createMapping(iomap, sizeof(iomap));
+    ASSERT_EQ(32,  restored.input.bsize);
+    ASSERT_EQ(255, restored.input.size);
+    ASSERT_EQ(48,  restored.output.bsize);
+    ASSERT_EQ(383, restored.output.size);
+
+    // an empty bus does not match an empty snapshot
+    BusAccessor empty{mock_link};
+    mock_link->handleWriteThenRead(Command::BRD, 0);
+    ASSERT_THROW(empty.init(BusSnapshot{}), Error);
+}
+
+
+TEST_F(BusTest, eni_init_commands)
+{
+    auto command = [](uint16_t transitions, Command cmd, uint32_t address, std::vector<uint8_t> data, std::optional<uint16_t> wkc)
+    {
+        ENI::InitCommand init_cmd;
+        init_cmd.transitions = transitions;
+        init_cmd.command = cmd;
+        init_cmd.address = address;
+        init_cmd.data = std::move(data);
+        init_cmd.wkc = wkc;
+        return init_cmd;
+    };
+
+    ENI::Network network;
+    network.slaves.resize(2);
+    network.slaves[0].init_cmds.push_back(command(ENI::IP, Command::FPWR, createAddress(0x1001, 0x0800), {1, 2, 3, 4}, 1));
+    network.slaves[0].init_cmds.back().retries = 1;
+    network.slaves[1].init_cmds.push_back(command(ENI::PS, Command::FPWR, createAddress(0x1002, 0x0800), {5, 6}, 1));
+    network.slaves[1].init_cmds.push_back(command(ENI::IP, Command::FPWR, createAddress(0x1002, 0x0800), {7, 8}, 1));
+
+    network.master_init_cmds.push_back(command(ENI::IP, Command::FPRD, createAddress(0x1001, reg::AL_STATUS), {0, 0}, 1));
+    network.master_init_cmds.back().validate = ENI::InitCommand::Validation{{0x02, 0x00}, {0x0F, 0x00}, 100ms};
+    network.master_init_cmds.push_back(command(ENI::IP, Command::BWR, createAddress(0, reg::AL_CONTROL), {0x04, 0x00}, std::nullopt));
+    network.master_init_cmds.push_back(command(ENI::IP | ENI::PS, Command::BWR, createAddress(0, reg::AL_CONTROL), {0x02, 0x00}, 2));
+    network.master_init_cmds.back().before_slave = true;
+
+    auto commands = network.initCommands(ENI::IP);
+    ASSERT_EQ(5, commands.size());
+    ASSERT_EQ(&network.master_init_cmds[2], commands[0]);
+    ASSERT_EQ(&network.slaves[0].init_cmds[0], commands[1]);
+    ASSERT_EQ(&network.slaves[1].init_cmds[1], commands[2]);
+    ASSERT_EQ(&network.master_init_cmds[0], commands[3]);
+    ASSERT_EQ(&network.master_init_cmds[1], commands[4]);
+
+    // first batch up to the validated command, sent again from the failed FPWR to keep the commands order
+    mock_link->handleProcess(Command::BWR,  uint8_t{0}, 2);
+    mock_link->handleProcess(Command::FPWR, uint8_t{0}, 0);
+    mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPRD, uint16_t{0x0001}, 1);
+    mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPRD, uint16_t{0x0001}, 1);
+
+    // validation: polled until the masked answer matches
+    mock_link->handleProcess(Command::FPRD, uint16_t{0x0001}, 1);
+    mock_link->handleProcess(Command::FPRD, uint16_t{0x0012}, 1);
+
+    // second batch: no expected WKC
+    mock_link->handleProcess(Command::BWR, uint8_t{0}, 0);
+
+    std::size_t already_sent = mock_link->sentDatagrams().size();
+    bus.runInitCommands(network, ENI::IP);
+
+    auto const& sent = mock_link->sentDatagrams();
+    ASSERT_EQ(already_sent + 10, sent.size());
+    ASSERT_EQ(createAddress(0x1001, 0x0800), sent[already_sent + 4].address);
+    ASSERT_EQ((std::vector<uint8_t>{1, 2, 3, 4}), sent[already_sent + 4].data);
+    ASSERT_EQ(createAddress(0x1002, 0x0800), sent[already_sent + 5].address);
+    ASSERT_EQ((std::vector<uint8_t>{7, 8}), sent[already_sent + 5].data);
+    ASSERT_EQ(Command::FPRD, sent[already_sent + 6].command);
+    ASSERT_EQ(Command::BWR, sent.back().command);
+    ASSERT_EQ((std::vector<uint8_t>{0x04, 0x00}), sent.back().data);
+
+    // out of retries
+    mock_link->handleProcess(Command::BWR,  uint8_t{0}, 2);
+    mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPWR, uint8_t{0}, 0);
+    mock_link->handleProcess(Command::FPRD, uint16_t{0x0002}, 1);
+    ASSERT_THROW(bus.runInitCommands(network, ENI::IP), Error);
+
+    // validation timeout
+    network.master_init_cmds[0].validate->timeout = 0ms;
+    mock_link->handleProcess(Command::BWR,  uint8_t{0}, 2);
+    mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPRD, uint16_t{0x0004}, 1);
+    ASSERT_THROW(bus.runInitCommands(network, ENI::IP), Error);
+}
+
+
+TEST_F(BusTest, eni_init_commands_more_than_a_datagram_window)
+{
+    // One FPWR per slave: 300 commands do not fit in the 255 datagrams of the link index window
+    ENI::Network network;
+    network.slaves.resize(300);
+    for (std::size_t i = 0; i < network.slaves.size(); ++i)
+    {
+        ENI::InitCommand init_cmd;
+        init_cmd.transitions = ENI::PS;
+        init_cmd.command = Command::FPWR;
+        init_cmd.address = createAddress(static_cast<uint16_t>(0x1001 + i), reg::SYNC_MANAGER);
+        init_cmd.data = {1, 2, 3, 4};
+        init_cmd.wkc = 1;
+        network.slaves[i].init_cmds.push_back(init_cmd);
+    }
+
+    for (std::size_t i = 0; i < network.slaves.size(); ++i)
+    {
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
+
+    std::size_t already_sent = mock_link->sentDatagrams().size();
+    bus.runInitCommands(network, ENI::PS);
+
+    auto const& sent = mock_link->sentDatagrams();
+    ASSERT_EQ(already_sent + 300, sent.size());
+    ASSERT_EQ(createAddress(0x1001 + 299, reg::SYNC_MANAGER), sent.back().address);
+    ASSERT_TRUE(mock_link->pendingDatagrams().empty());
+}
+
+
+TEST_F(BusTest2Slaves, eni_mailbox_init_commands)
+{
+    auto command = [](uint16_t transitions, uint16_t index, uint8_t subindex, std::vector<uint8_t> data)
+    {
+        ENI::CoEInitCommand init_cmd;
+        init_cmd.transitions = transitions;
+        init_cmd.index = index;
+        init_cmd.subindex = subindex;
+        init_cmd.data = std::move(data);
+        return init_cmd;
+    };
+
+    ENI::Network network;
+    network.slaves.resize(2);
+    network.slaves[0].address = 1002;
+    network.slaves[0].coe_init_cmds.push_back(command(ENI::PS, 0x1C12, 0, {0x00}));
+    network.slaves[0].coe_init_cmds.push_back(command(ENI::OP, 0x1C13, 0, {0x00}));
+    network.slaves[1].address = 1001;
+    network.slaves[1].coe_init_cmds.push_back(command(ENI::PS, 0x1C12, 0, {0x00}));
+    network.slaves[1].coe_init_cmds.back().timeout = 10s;
+
+    // Both slaves at once: checkMailboxes, write both SDO, then read both answers
+    for (int i = 0; i < 4; ++i)
+    {
+        mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+    }
+    mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+    mock_link->handleProcess(Command::FPRD, uint8_t{0x08}, 1);
+    mock_link->handleProcess(Command::FPRD, uint8_t{0x08}, 1);
+
+    SDOAnswer answer;
+    answer.header.len = 10;
+    answer.header.address = 0;
+    answer.header.type = mailbox::Type::CoE;
+    answer.coe.service = CoE::Service::SDO_RESPONSE;
+    answer.sdo.command = CoE::SDO::response::DOWNLOAD;
+    answer.sdo.index = 0x1C12;
+    answer.sdo.subindex = 0;
+    answer.sdo.transfer_type = 0;
+    answer.sdo.block_size = 0;
+    std::memset(answer.payload, 0, 4);
+    mock_link->handleProcess(Command::FPRD, answer, 1);
+    mock_link->handleProcess(Command::FPRD, answer, 1);
+
+    std::size_t already_sent = mock_link->sentDatagrams().size();
+    bus.runMailboxInitCommands(network, ENI::PS);
+    ASSERT_EQ(already_sent + 12, mock_link->sentDatagrams().size());
+
+    // nothing to send for this transition
+    bus.runMailboxInitCommands(network, ENI::SO);
+    ASSERT_EQ(already_sent + 12, mock_link->sentDatagrams().size());
+
+    // unknown slave
+    network.slaves[1].address = 1003;
+    ASSERT_THROW(bus.runMailboxInitCommands(network, ENI::PS), Error);
+}
+
+
+TEST_F(BusTest2Slaves, eni_check_mapping)
+{
+    auto& slave0 = bus.slaves().at(0);
+    auto& slave1 = bus.slaves().at(1);
+    slave0.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+    slave1.sii.info.mailbox_protocol = eeprom::MailboxProtocol::None;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
+    uint8_t iomap[256];
+    bus.createMapping(iomap, sizeof(iomap));
+
+    // Two slaves with 32 bytes of inputs and 48 bytes of outputs, overlapped in one frame
+    ENI::CyclicCommand lrw;
+    lrw.states = State::SAFE_OP | State::OPERATIONAL;
+    lrw.command = Command::LRW;
+    lrw.address = 0x00010000;
+    lrw.length = 96;
+    lrw.wkc = 6;
+    ENI::CyclicCommand brd;
+    brd.states = State::OPERATIONAL;
+    brd.command = Command::BRD;
+    brd.address = createAddress(0, reg::AL_STATUS);
+    brd.length = 2;
+
+    ENI::Network network;
+    network.frames.push_back({{lrw, brd}});
+    network.input_size = 64;
+    network.output_size = 96;
+    ASSERT_TRUE(bus.checkMapping(network));
+
+    network.frames[0].commands[0].wkc = 3;
+    ASSERT_FALSE(bus.checkMapping(network));
+    network.frames[0].commands[0].wkc = 6;
+
+    network.frames[0].commands[0].length = 64;
+    ASSERT_FALSE(bus.checkMapping(network));
+    network.frames[0].commands[0].length = 96;
+
+    network.input_size = 32;
+    ASSERT_FALSE(bus.checkMapping(network));
+    network.input_size = 64;
+
+    // one logical frame more than the mapping
+    lrw.address = 0x00020000;
+    network.frames.push_back({{lrw}});
+    ASSERT_FALSE(bus.checkMapping(network));
+
+    // the same frame sent as LRD then LWR
+    ENI::CyclicCommand lrd = lrw;
+    lrd.address = 0x00010000;
+    lrd.command = Command::LRD;
+    lrd.wkc = 2;
+    ENI::CyclicCommand lwr = lrd;
+    lwr.command = Command::LWR;
+    network.frames = {{{lrd, lwr}}};
+    ASSERT_TRUE(bus.checkMapping(network));
+}
+
+
+TEST_F(BusTest2Slaves, eni_mapping)
+{
+    auto& slave0 = bus.slaves().at(0);
+    auto& slave1 = bus.slaves().at(1);
+
+    // One LRW: the inputs at 4 bytes in the input image, the outputs at 2 bytes in the output image
+    ENI::CyclicCommand lrw;
+    lrw.states = State::SAFE_OP | State::OPERATIONAL;
+    lrw.command = Command::LRW;
+    lrw.address = 0x00020000;
+    lrw.length = 4;
+    lrw.wkc = 7;
+    lrw.input_offset = 4;
+    lrw.output_offset = 2;
+
+    ENI::Network network;
+    network.frames.push_back({{lrw}});
+    network.input_size = 8;
+    network.output_size = 8;
+    network.slaves.resize(2);
+    network.slaves[0].address = slave0.address;
+    network.slaves[0].inputs  = ENI::ProcessData{32, 16};
+    network.slaves[0].outputs = ENI::ProcessData{16, 16};
+    network.slaves[1].address = slave1.address;
+    network.slaves[1].inputs  = ENI::ProcessData{48, 4};
+    network.slaves[1].outputs = ENI::ProcessData{40, 8};
+
+    uint8_t iomap[16]{};
+    ASSERT_THROW(bus.createMapping(network, nullptr, sizeof(iomap)), Error);
+    ASSERT_THROW(bus.createMapping(network, iomap, 15), Error);
+
+    std::size_t already_sent = mock_link->sentDatagrams().size();
+    bus.createMapping(network, iomap, sizeof(iomap));
+    ASSERT_EQ(already_sent, mock_link->sentDatagrams().size()); // the ENI init commands program the slaves
+
+    ASSERT_EQ(iomap + 4, slave0.input.data);
+    ASSERT_EQ(2, slave0.input.bsize);
+    ASSERT_EQ(iomap + 6, slave1.input.data);
+    ASSERT_EQ(4, slave1.input.size);
+    ASSERT_EQ(iomap + 8 + 2, slave0.output.data);
+    ASSERT_EQ(iomap + 8 + 5, slave1.output.data);
+    ASSERT_EQ(0x00020000, slave0.input.address);
+    ASSERT_EQ(0x00020002, slave1.input.address);
+    ASSERT_EQ(0x00020003, slave1.output.address);
+
+    auto const& mapping = mock_link->logicalMapping();
+    ASSERT_EQ(1, mapping.size());
+    ASSERT_EQ(0x00020000, mapping[0].address);
+    ASSERT_EQ(4, mapping[0].logical_size);
+    ASSERT_TRUE(bus.checkMapping(network));
+
+    // The ENI working counter prevails: 7 is no error
+    slave0.output.data[0] = 0xAA;
+    slave0.output.data[1] = 0xBB;
+    slave1.output.data[0] = 0xCC;
+    uint32_t logical_read = 0x00032211;
+    mock_link->handleProcess(Command::LRW, logical_read, 7);
+    bus.processDataReadWrite([](DatagramState const&){ throw std::logic_error("unexpected wkc"); });
+
+    std::vector<uint8_t> expected_outputs{0xAA, 0xBB, 0x00, 0xCC};
+    ASSERT_EQ(expected_outputs, mock_link->sentDatagrams().back().data);
+    ASSERT_EQ(0x11, slave0.input.data[0]);
+    ASSERT_EQ(0x22, slave0.input.data[1]);
+    ASSERT_EQ(0x03, slave1.input.data[0]);
+
+    // the slave 1 inputs are out of the LRW data
+    network.frames[0].commands[0].length = 2;
+    ASSERT_THROW(bus.createMapping(network, iomap, sizeof(iomap)), Error);
+    network.frames[0].commands[0].length = 4;
+
+    network.frames[0].commands[0].output_offset.reset();
+    ASSERT_THROW(bus.createMapping(network, iomap, sizeof(iomap)), Error);
+    network.frames[0].commands[0].output_offset = 2;
+
+    network.slaves[1].address = 1003;
+    ASSERT_THROW(bus.createMapping(network, iomap, sizeof(iomap)), Error);
+}
+
+
+TEST_F(BusTest2Slaves, logical_mailboxes)
+{
+    auto& slave0 = bus.slaves().at(0);
+    auto& slave1 = bus.slaves().at(1);
+    std::vector<Slave*> slaves{&slave0, &slave1};
+
+    slave0.esc.fmmus = 8;
+    slave1.esc.fmmus = 3;
+    ASSERT_THROW(bus.configureLogicalMailboxes(slaves, 0x10000), Error);
+    slave1.esc.fmmus = 4;
+
+    // one read and one write FMMU per slave
+    for (int i = 0; i < 4; ++i)
+    {
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
+    std::size_t already_sent = mock_link->sentDatagrams().size();
+    bus.configureLogicalMailboxes(slaves, 0x10000);
+    ASSERT_TRUE(slave0.is_logical_mailbox);
+    ASSERT_TRUE(slave1.is_logical_mailbox);
+
+    auto const& fmmu_dg = mock_link->sentDatagrams().at(already_sent + 3); // slave 1 write mailbox: FMMU2
+    ASSERT_EQ(createAddress(slave1.address, reg::FMMU + 0x20), fmmu_dg.address);
+    fmmu::Register fmmu;
+    std::memcpy(&fmmu, fmmu_dg.data.data(), sizeof(fmmu));
+    ASSERT_EQ(0x10000 + 2 * 0x200 + 0x100, fmmu.logical_address);   // after the read mailboxes and slave 0 one
+    ASSERT_EQ(0x100, fmmu.length);
+    ASSERT_EQ(slave1.mailbox.recv_offset, fmmu.physical_address);
+    ASSERT_EQ(2, fmmu.type);
+
+    uint32_t data[2] = {0};
+    uint32_t data_size[2] = {sizeof(uint32_t), sizeof(uint32_t)};
+    auto sdo0 = slave0.mailbox.createSDO(0x1018, 1, false, CoE::SDO::request::UPLOAD, &data[0], &data_size[0]);
+    auto sdo1 = slave1.mailbox.createSDO(0x1018, 1, false, CoE::SDO::request::UPLOAD, &data[1], &data_size[1]);
+    auto error = [](DatagramState const&) { THROW_ERROR("error"); };
+
+    // both can write: a single LWR over the two write mailboxes, nothing to read: no LRD
+    slave0.mailbox.can_write = true;
+    slave1.mailbox.can_write = true;
+    slave0.mailbox.can_read = false;
+    slave1.mailbox.can_read = false;
+    mock_link->handleProcess(Command::LWR, uint8_t{0}, 2);
+    already_sent = mock_link->sentDatagrams().size();
+    bus.processMessages(error);
+    ASSERT_EQ(already_sent + 1, mock_link->sentDatagrams().size());
+    ASSERT_EQ(0x10000 + 2 * 0x200, mock_link->sentDatagrams().back().address);
+    ASSERT_EQ(2 * 0x100, mock_link->sentDatagrams().back().data.size());
+
+    // only slave 1 answered yet: one LRD over its read mailbox only
+    SDOAnswer answer;
+    answer.header.len = 10;
+    answer.header.address = 0;
+    answer.header.type = mailbox::Type::CoE;
+    answer.coe.service = CoE::Service::SDO_RESPONSE;
+    answer.sdo.command = CoE::SDO::response::UPLOAD;
+    answer.sdo.index = 0x1018;
+    answer.sdo.subindex = 1;
+    answer.sdo.transfer_type = 1;
+    answer.sdo.block_size = 0;
+    *reinterpret_cast<uint32_t*>(answer.payload) = 0xDEADBEEF;
+
+    struct
+    {
+        SDOAnswer slave1;
+        uint8_t padding[0x200 - sizeof(SDOAnswer)];
+    } __attribute__((__packed__)) read_mailbox{};
+    read_mailbox.slave1 = answer;
+
+    slave1.mailbox.can_read = true;
+    mock_link->handleProcess(Command::LRD, read_mailbox, 1);
+    already_sent = mock_link->sentDatagrams().size();
+    bus.processMessages(error);
+    ASSERT_EQ(already_sent + 1, mock_link->sentDatagrams().size());
+    ASSERT_EQ(0x10000 + 0x200, mock_link->sentDatagrams().back().address);
+    ASSERT_EQ(0x200, mock_link->sentDatagrams().back().data_size);
+    ASSERT_EQ(mailbox::request::MessageStatus::RUNNING, sdo0->status());
+    ASSERT_EQ(mailbox::request::MessageStatus::SUCCESS, sdo1->status());
+    ASSERT_EQ(0xDEADBEEF, data[1]);
+
+    // a mailbox that cannot receive is left out of the LWR: one per remaining run
+    slave0.mailbox.createSDO(0x1018, 1, false, CoE::SDO::request::UPLOAD, &data[0], &data_size[0]);
+    slave1.mailbox.createSDO(0x1018, 1, false, CoE::SDO::request::UPLOAD, &data[1], &data_size[1]);
+    slave0.mailbox.can_write = false;
+    slave1.mailbox.can_read = false;
+    mock_link->handleProcess(Command::LWR, uint8_t{0}, 1);
+    bus.processMessages(error);
+    ASSERT_EQ(0x10000 + 2 * 0x200 + 0x100, mock_link->sentDatagrams().back().address);
+    ASSERT_EQ(0x100, mock_link->sentDatagrams().back().data.size());
+    ASSERT_EQ(1, slave0.mailbox.to_send.size());
+    ASSERT_EQ(0, slave1.mailbox.to_send.size());
+
+    // a short working counter: the messages of the run stay queued, then are sent again
+    int32_t errors = 0;
+    auto count_error = [&errors](DatagramState const&) { ++errors; };
+    slave0.mailbox.can_write = true;
+    slave1.mailbox.createSDO(0x1018, 1, false, CoE::SDO::request::UPLOAD, &data[1], &data_size[1]);
+    mock_link->handleProcess(Command::LWR, uint8_t{0}, 1);
+    bus.processMessages(count_error);
+    ASSERT_EQ(1, errors);
+    ASSERT_EQ(1, slave0.mailbox.to_send.size());
+    ASSERT_EQ(1, slave1.mailbox.to_send.size());
+
+    mock_link->handleProcess(Command::LWR, uint8_t{0}, 2);
+    bus.processMessages(count_error);
+    ASSERT_EQ(1, errors);
+    ASSERT_EQ(2 * 0x100, mock_link->sentDatagrams().back().data.size());
+    ASSERT_EQ(0, slave0.mailbox.to_send.size());
+    ASSERT_EQ(0, slave1.mailbox.to_send.size());
+}
+
+
+TEST_F(BusTest, logical_mailboxes_more_slaves_than_a_datagram_window)
+{
+    // Two FMMU datagrams per slave: 200 slaves do not fit in the 255 datagrams of the link index window
+    replicateSlave(200);
+    std::vector<Slave*> slaves;
+    for (auto& slave : bus.slaves())
+    {
+        slave.esc.fmmus = 4;
+        slaves.push_back(&slave);
+    }
+
+    for (int i = 0; i < 2 * 200; ++i)
+    {
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
+    std::size_t already_sent = mock_link->sentDatagrams().size();
+    bus.configureLogicalMailboxes(slaves, 0x10000);
+    ASSERT_EQ(already_sent + 2 * 200, mock_link->sentDatagrams().size());
+
+    for (auto const& slave : bus.slaves())
+    {
+        ASSERT_TRUE(slave.is_logical_mailbox);
+    }
+
+    auto const& fmmu_dg = mock_link->sentDatagrams().back(); // last slave write mailbox
+    ASSERT_EQ(createAddress(bus.slaves().back().address, reg::FMMU + 0x20), fmmu_dg.address);
+    fmmu::Register fmmu;
+    std::memcpy(&fmmu, fmmu_dg.data.data(), sizeof(fmmu));
+    ASSERT_EQ(0x10000 + 200 * 0x200 + 199 * 0x100, fmmu.logical_address);
+}
+
+
+TEST_F(BusTest, logical_mailboxes_on_a_full_mailbox_round)
+{
+    // 254 slaves: two logical mailboxes, then 252 regular ones. The last round has 127 regular mailboxes to write then
+    // read (254 datagrams): the LWR and the LRD of the logical mailboxes do not fit in the same window.
+    replicateSlave(254);
+    std::vector<Slave*> logical{&bus.slaves().at(0), &bus.slaves().at(1)};
+    for (auto* slave : logical)
+    {
+        slave->esc.fmmus = 4;
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+    }
+    bus.configureLogicalMailboxes(logical, 0x10000);
+
+    std::vector<uint32_t> values(bus.slaves().size(), 0);
+    std::vector<uint32_t> sizes(bus.slaves().size(), sizeof(uint32_t));
+    std::vector<std::shared_ptr<mailbox::request::AbstractMessage>> sdos;
+    for (std::size_t i = 0; i < bus.slaves().size(); ++i)
+    {
+        auto& mailbox = bus.slaves()[i].mailbox;
+        mailbox.can_write = true;
+        mailbox.can_read = true;
+        sdos.push_back(mailbox.createSDO(0x1018, 1, false, CoE::SDO::request::UPLOAD, &values[i], &sizes[i], 10s));
+    }
+
+    SDOAnswer answer;
+    answer.header.len = 10;
+    answer.header.address = 0;
+    answer.header.type = mailbox::Type::CoE;
+    answer.coe.service = CoE::Service::SDO_RESPONSE;
+    answer.sdo.command = CoE::SDO::response::UPLOAD;
+    answer.sdo.index = 0x1018;
+    answer.sdo.subindex = 1;
+    answer.sdo.transfer_type = 1;
+    answer.sdo.block_size = 0;
+    std::memset(answer.payload, 0, 4);
+
+    for (int round : {125, 127})
+    {
+        for (int i = 0; i < round; ++i)
+        {
+            mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+        }
+        if (round == 127)
+        {
+            mock_link->handleProcess(Command::LWR, uint8_t{0}, 2);
+        }
+        for (int i = 0; i < round; ++i)
+        {
+            mock_link->handleProcess(Command::FPRD, answer, 1);
+        }
+    }
+    mock_link->handleProcess(Command::LRD, uint8_t{0}, 0);
+
+    std::size_t already_sent = mock_link->sentDatagrams().size();
+    bus.processMessages([](DatagramState const&){ throw std::runtime_error("unexpected error"); });
+
+    auto const& sent = mock_link->sentDatagrams();
+    ASSERT_EQ(already_sent + 2 * 125 + 2 * 127 + 2, sent.size());
+    ASSERT_EQ(Command::LRD, sent.back().command);
+    ASSERT_EQ(0x10000, sent.back().address);
+    ASSERT_TRUE(mock_link->pendingDatagrams().empty());
+}
+
+
+TEST_F(BusTest, map_PDO_complete_access)
+{
+    auto& slave = bus.slaves().at(0);
+    slave.sii.general.SDO_complete_access = 1;
+
+    SDOAnswer answer;
+    answer.header.len = 10;
+    answer.header.address = 0;
+    answer.header.type = mailbox::Type::CoE;
+    answer.coe.service = CoE::Service::SDO_RESPONSE;
+    answer.sdo.command = CoE::SDO::response::DOWNLOAD;
+    answer.sdo.subindex = 0;
+    answer.sdo.transfer_type = 0;
+    answer.sdo.block_size = 0;
+    std::memset(answer.payload, 0, 4);
+
+    // one SDO for the mapping record, one for the assignment
+    for (uint16_t index : {0x1600, 0x1C12})
+    {
+        mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+        mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+        mock_link->handleProcess(Command::FPWR, uint8_t{0}, 1);
+        mock_link->handleProcess(Command::FPRD, uint8_t{0}, 1);
+        mock_link->handleProcess(Command::FPRD, uint8_t{0x08}, 1);
+        answer.sdo.index = index;
+        mock_link->handleProcess(Command::FPRD, answer, 1);
+    }
+
+    uint32_t mapping[3] = {0x60410010, 0x60640020, 0x606C0020};
+    std::size_t already_sent = mock_link->sentDatagrams().size();
+    mapPDO(bus, slave, 0x1600, mapping, 3, 0x1C12);
+
+    std::vector<std::vector<uint8_t>> requests;
+    for (std::size_t i = already_sent; i < mock_link->sentDatagrams().size(); ++i)
+    {
+        auto const& dg = mock_link->sentDatagrams()[i];
+        if (dg.command == Command::FPWR)
+        {
+            requests.push_back(dg.data);
+        }
+    }
+    ASSERT_EQ(2, requests.size());
+
+    auto sdoOf = [](std::vector<uint8_t> const& request)
+    {
+        return reinterpret_cast<CoE::ServiceData const*>(request.data() + sizeof(mailbox::Header) + sizeof(CoE::Header));
+    };
+    uint8_t const* payload = reinterpret_cast<uint8_t const*>(sdoOf(requests[0]) + 1);
+
+    // normal transfer: complete size then the record, subindex 0 on 16 bits
+    ASSERT_TRUE(sdoOf(requests[0])->complete_access);
+    ASSERT_EQ(0x1600, sdoOf(requests[0])->index);
+    uint32_t size;
+    std::memcpy(&size, payload, sizeof(size));
+    ASSERT_EQ(2 + sizeof(mapping), size);
+    ASSERT_EQ(3, payload[4]);
+    ASSERT_EQ(0, payload[5]);
+    ASSERT_EQ(0, std::memcmp(payload + 6, mapping, sizeof(mapping)));
+
+    // expedited transfer: count and the PDO index
+    payload = reinterpret_cast<uint8_t const*>(sdoOf(requests[1]) + 1);
+    ASSERT_TRUE(sdoOf(requests[1])->complete_access);
+    ASSERT_EQ(0x1C12, sdoOf(requests[1])->index);
+    uint8_t const expected_assignment[4] = {1, 0, 0x00, 0x16};
+    ASSERT_EQ(0, std::memcmp(payload, expected_assignment, sizeof(expected_assignment)));
 }
@@ -379,6 +379,34 @@ TEST_F(DcBusTest, drift_compensation_converges_with_injected_drift)
 }
 
 
+TEST_F(DcBusTest, static_drift_compensation_stops_once_converged)
+{
+    createSlaves(4, 100ns);
+    slaves_[1]->setClockDrift(80.0);
+    slaves_[2]->setClockDrift(-120.0);
+    slaves_[3]->setClockDrift(40.0);
+    initBus();
+
+    // the emulated slaves settle a few hundreds of ns around the reference
+    bus_->configureStaticDriftCompensation(15000, 1us);
+    bus_->enableDC(1ms, 0ns, 0ns);
+    auto const& report = bus_->staticDriftReport();
+    EXPECT_TRUE(report.converged);
+    EXPECT_LT(report.iterations, 15000);
+    EXPECT_EQ(0, report.iterations % 1000);  // stopped on a convergence check
+    EXPECT_GT(report.duration, 0ns);
+    EXPECT_TRUE(bus_->isDCSynchronized(10us));
+
+    // no threshold: the whole budget is spent
+    bus_->configureStaticDriftCompensation(2000, 0ns);
+    bus_->enableDC(1ms, 0ns, 0ns);
+    EXPECT_FALSE(bus_->staticDriftReport().converged);
+    EXPECT_EQ(2000, bus_->staticDriftReport().iterations);
+
+    EXPECT_THROW(bus_->configureStaticDriftCompensation(1000, 100ns, 0), Error);
+}
+
+
 TEST_F(DcBusTest, enable_dc_retries_lost_start_time_read)
 {
     createSlaves(3, 100ns);
@@ -121,6 +121,41 @@ TEST(Frame, move_constructor)
 }
 
 
+TEST(Frame, attach_external_buffer)
+{
+    EthernetFrame storage;
+    storage.fill(0xA5);
+
+    Frame frame;
+    frame.attach(storage.data());
+    ASSERT_TRUE(frame.isAttached());
+    ASSERT_EQ(storage.data(), frame.data());
+
+    frame.prepare();
+    frame.setSourceMAC(PRIMARY_IF_MAC);
+    frame.addDatagram(3, Command::BRD, 0, nullptr, 4);
+    int32_t to_write = frame.finalize();
+    ASSERT_EQ(ETH_MIN_SIZE, to_write);
+    ASSERT_EQ(ETH_ETHERCAT_TYPE, pointData<EthernetHeader>(storage.data())->type);
+
+    // Parse it in place, as a received frame
+    Frame rx;
+    rx.attach(storage.data());
+    ASSERT_EQ(to_write, checkFrame(rx, to_write));
+    auto [header, data, wkc] = rx.nextDatagram();
+    ASSERT_EQ(3, header->index);
+    ASSERT_EQ(storage.data() + sizeof(EthernetHeader) + sizeof(EthercatHeader) + sizeof(DatagramHeader), data);
+    ASSERT_EQ(0, wkc);
+
+    // Moving keeps the external buffer, detaching goes back to the frame own storage
+    Frame moved = std::move(rx);
+    ASSERT_EQ(storage.data(), moved.data());
+    moved.attach(nullptr);
+    ASSERT_FALSE(moved.isAttached());
+    ASSERT_NE(storage.data(), moved.data());
+}
+
+
 TEST(Frame, clear_frame)
 {
     Frame frame;
@@ -1,6 +1,10 @@
+#include <deque>
+#include <numeric>
+
 #include "mocks/Sockets.h"
 
 #include "kickcat/Link.h"
+#include "kickcat/SocketNull.h"
 
 using ::testing::Return;
 using ::testing::_;
@@ -30,7 +34,8 @@ public:
 
     void sendFrame()
     {
-        link.sendFrame();
+        link.queueFrame();
+        link.sendFrames();
     }
 
     void checkSendFrameError()
@@ -57,6 +62,12 @@ public:
         return link.sent_frame_;
     }
 
+    static void setCycleCounters(Link& other, uint32_t counter)
+    {
+        other.cycles_head_ = counter;
+        other.cycles_tail_ = counter;
+    }
+
     template<typename T>
     void checkSendFrameRedundancy(std::vector<DatagramCheck<T>> expecteds)
     {
@@ -64,6 +75,20 @@ public:
         io_redundancy->checkSendFrame(expecteds);
     }
 
+    // Queued frames are flushed in one batch per interface: every nominal write, then every redundancy one.
+    template<typename T>
+    void checkSendFramesRedundancy(std::vector<DatagramCheck<T>> expecteds, int32_t frames)
+    {
+        for (int32_t i = 0; i < frames; ++i)
+        {
+            io_nominal->checkSendFrame(expecteds);
+        }
+        for (int32_t i = 0; i < frames; ++i)
+        {
+            io_redundancy->checkSendFrame(expecteds);
+        }
+    }
+
     template<typename T, typename U>
     void addDatagram(Command cmd, T& payload, U& expected_data, uint16_t expected_wkc, bool error = false)
     {
@@ -718,10 +743,7 @@ TEST_F(LinkTest, process_datagrams_multiple_frames)
 
     int32_t frame_number = 14;
 
-    for (int32_t i = 0; i < frame_number; i++)
-    {
-        checkSendFrameRedundancy(expecteds); // check frame is sent on both interfaces.
-    }
+    checkSendFramesRedundancy(expecteds, frame_number); // check frames are sent on both interfaces.
 
     for (int32_t i = 0; i < frame_number; i++)
     {
@@ -729,8 +751,15 @@ TEST_F(LinkTest, process_datagrams_multiple_frames)
         {
             addDatagram(cmd, skip, logical_read, 2, false);
         }
+    }
 
+    // Responses are drained in one batch per interface
+    for (int32_t i = 0; i < frame_number; i++)
+    {
         io_redundancy->handleReply<int64_t>(answers, 2);
+    }
+    for (int32_t i = 0; i < frame_number; i++)
+    {
         io_nominal->handleReply<int64_t>(skips, 0);
     }
 
@@ -757,8 +786,10 @@ TEST_F(LinkTest, process_datagrams_multiple_frames_split)
     std::vector<int64_t> answers_4(4, logical_read);
     std::vector<int64_t> skips_4(4, skip);
 
-    checkSendFrameRedundancy(expecteds_15);
-    checkSendFrameRedundancy(expecteds_4);
+    io_nominal->checkSendFrame(expecteds_15);
+    io_nominal->checkSendFrame(expecteds_4);
+    io_redundancy->checkSendFrame(expecteds_15);
+    io_redundancy->checkSendFrame(expecteds_4);
 
     for (int32_t j = 0; j < 19; j++)
     {
@@ -766,8 +797,8 @@ TEST_F(LinkTest, process_datagrams_multiple_frames_split)
     }
 
     io_redundancy->handleReply<int64_t>(answers_15, 2);
-    io_nominal->handleReply<int64_t>(skips_15, 0);
     io_redundancy->handleReply<int64_t>(answers_4, 2);
+    io_nominal->handleReply<int64_t>(skips_15, 0);
     io_nominal->handleReply<int64_t>(skips_4, 0);
 
     link.processDatagrams();
@@ -798,8 +829,10 @@ TEST_F(LinkTest, process_big_datagram_multiframe)
 
     InSequence s;
 
-    checkSendFrameRedundancy(expecteds_5);
-    checkSendFrameRedundancy(expecteds_big);
+    io_nominal->checkSendFrame(expecteds_5);
+    io_nominal->checkSendFrame(expecteds_big);
+    io_redundancy->checkSendFrame(expecteds_5);
+    io_redundancy->checkSendFrame(expecteds_big);
 
     for (int32_t i=0; i<5; ++i)
     {
@@ -808,8 +841,8 @@ TEST_F(LinkTest, process_big_datagram_multiframe)
     addDatagram(cmd, big_payload, big_payload, 2);
 
     io_redundancy->handleReply<uint8_t>(answers_5, 2);
-    io_nominal->handleReply<uint8_t>(skips_5, 0);
     io_redundancy->handleReply<std::array<uint8_t, MAX_ETHERCAT_PAYLOAD_SIZE>>(answers_big, 2);
+    io_nominal->handleReply<uint8_t>(skips_5, 0);
     io_nominal->handleReply<std::array<uint8_t, MAX_ETHERCAT_PAYLOAD_SIZE>>(skips_big, 0);
 
     link.processDatagrams();
@@ -830,10 +863,7 @@ TEST_F(LinkTest, add_too_many_datagrams)
     {
         InSequence s;
 
-        for (int32_t i = 0; i < (SEND_DATAGRAMS_OK / 15); ++i)
-        {
-            checkSendFrameRedundancy(expecteds_15);
-        }
+        checkSendFramesRedundancy(expecteds_15, SEND_DATAGRAMS_OK / 15);
     }
 
 
@@ -974,11 +1004,7 @@ TEST_F(LinkTest, process_datagrams_error_rethrow)
     {
         return ETH_MIN_SIZE;
     }));
-    EXPECT_CALL(*io_redundancy, read(_,_))
-    .WillOnce(Invoke([&](void*, int32_t)
-    {
-        return ETH_MIN_SIZE;
-    }));
+    io_redundancy->handleReply<uint8_t>({payload, payload, payload, payload, payload}, 0);
 
     EXPECT_THROW(link.processDatagrams(), std::overflow_error);
 }
@@ -1317,11 +1343,11 @@ TEST_F(LinkTest, process_datagrams_mismatched_pair_dispatches_both_datagrams)
     std::vector<int64_t> answers_4(4, logical_read);
     std::vector<int64_t> skips_4(4, skip);
 
-    // Frame 1 is lost on the nominal interface at send time: only the redundancy
+    // Frame 1 is lost on the wire of the nominal interface: only the redundancy
     // socket will ever deliver it.
-    EXPECT_CALL(*io_nominal, write(_,_)).WillOnce(Return(0));
-    io_redundancy->checkSendFrame(expecteds_15);
+    EXPECT_CALL(*io_nominal, write(_,_)).WillOnce(::testing::ReturnArg<1>());
     io_nominal->checkSendFrame(expecteds_4);
+    io_redundancy->checkSendFrame(expecteds_15);
     io_redundancy->checkSendFrame(expecteds_4);
 
     for (int32_t j = 0; j < 19; j++)
@@ -1329,13 +1355,14 @@ TEST_F(LinkTest, process_datagrams_mismatched_pair_dispatches_both_datagrams)
         addDatagram(cmd, skip, logical_read, 2, false);
     }
 
-    // First read round pairs frame 1 (from io_redundancy) with frame 2 (from io_nominal):
+    // First pair of the batch is frame 1 (from io_redundancy) with frame 2 (from io_nominal):
     // mismatched indexes, frame 1 datagrams dispatched, frame 2 copies dropped.
+    // Second pair: frame 2 recovered from io_redundancy.
     io_redundancy->handleReply<int64_t>(answers_15, 2);
-    io_nominal->handleReply<int64_t>(skips_4, 0);
-    // Retry read granted by the dropped datagrams: frame 2 recovered from io_redundancy.
     io_redundancy->handleReply<int64_t>(answers_4, 2);
+    io_nominal->handleReply<int64_t>(skips_4, 0);
     io_nominal->readError();
+    // Retry read granted by the dropped datagrams: nothing left.
     io_redundancy->readError();
     io_nominal->readError();
 
@@ -1396,8 +1423,10 @@ TEST_F(LinkTest, process_datagrams_never_downgrades_ok_status)
 
     InSequence s;
 
-    checkSendFrameRedundancy(expecteds_big);   // frame 1: index 0 alone (fills the frame)
-    checkSendFrameRedundancy(expecteds_small); // frame 2: index 1 alone
+    io_nominal->checkSendFrame(expecteds_big);      // frame 1: index 0 alone (fills the frame)
+    io_nominal->checkSendFrame(expecteds_small);    // frame 2: index 1 alone
+    io_redundancy->checkSendFrame(expecteds_big);
+    io_redundancy->checkSendFrame(expecteds_small);
 
     addDatagram(cmd, big_payload, big_payload, 2);
     addDatagram(cmd, data, data, 2);
@@ -1405,6 +1434,7 @@ TEST_F(LinkTest, process_datagrams_never_downgrades_ok_status)
     // Round 1: index 0 dispatched OK from the redundancy socket alone; the nominal
     // socket keeps its copy queued.
     io_redundancy->handleReply<std::array<uint8_t, MAX_ETHERCAT_PAYLOAD_SIZE>>(answers_big, 2);
+    io_redundancy->readError();
     io_nominal->readError();
     // Round 2: the nominal socket delivers the index-0 duplicate (garbage payload):
     // already OK, it must be skipped, and the dropped index-1 copy grants a retry.
@@ -1721,4 +1751,461 @@ TEST_F(LRWMergeTest, wkc_inside_a_contribution_attributes_started_slave_to_prefi
                                   0x28 | 0xB8, 0x29 | 0xB9};
     ASSERT_EQ(0, std::memcmp(nominal, expected, sizeof(expected)));
 }
+
+
+
+// Echo socket that only supports the batched path: every written frame comes back as is.
+class BatchEchoSocket final : public AbstractSocket
+{
+public:
+    void open(std::string const&) override {}
+    void setTimeout(nanoseconds) override {}
+    void close() noexcept override {}
+    int32_t read(void*, int32_t) override
+    {
+        ADD_FAILURE() << "Link shall use readBatch()";
+        return -EIO;
+    }
+    int32_t write(void const*, int32_t) override
+    {
+        ADD_FAILURE() << "Link shall use writeBatch()";
+        return -EIO;
+    }
+
+    int32_t writeBatch(SocketBuffer const* frames, int32_t count) override
+    {
+        ++write_calls;
+        for (int32_t i = 0; i < count; ++i)
+        {
+            uint8_t const* data = static_cast<uint8_t const*>(frames[i].data);
+            wire.emplace_back(data, data + frames[i].size);
+        }
+        return count;
+    }
+
+    int32_t readBatch(SocketBuffer* frames, int32_t count) override
+    {
+        ++read_calls;
+        int32_t received = 0;
+        while ((received < count) and (not wire.empty()))
+        {
+            std::memcpy(frames[received].data, wire.front().data(), wire.front().size());
+            frames[received].size = static_cast<int32_t>(wire.front().size());
+            wire.pop_front();
+            ++received;
+        }
+        return received;
+    }
+
+    std::deque<std::vector<uint8_t>> wire;
+    int32_t write_calls{0};
+    int32_t read_calls{0};
+};
+
+
+TEST(LinkBatch, frames_are_flushed_and_drained_in_one_call)
+{
+    auto socket = std::make_shared<BatchEchoSocket>();
+    Link link(socket, std::make_shared<SocketNull>(), [](){});
+
+    int32_t processed = 0;
+    std::array<uint8_t, 1000> payload{};
+    for (int32_t i = 0; i < 5; ++i) // one frame each
+    {
+        link.addDatagram(Command::BWR, 0, payload.data(), static_cast<uint16_t>(payload.size()),
+            [&](DatagramHeader const*, uint8_t const*, uint16_t) { ++processed; return DatagramState::OK; },
+            [](DatagramState const&) { FAIL() << "datagram lost"; });
+    }
+    ASSERT_EQ(0, socket->write_calls); // frames are queued until the flush
+
+    link.processDatagrams();
+    ASSERT_EQ(5, processed);
+    ASSERT_EQ(1, socket->write_calls);
+    ASSERT_EQ(1, socket->read_calls);
+}
+
+
+TEST(LinkBatch, big_cycles_are_split_in_several_batches)
+{
+    auto socket = std::make_shared<BatchEchoSocket>();
+    Link link(socket, std::make_shared<SocketNull>(), [](){});
+
+    int32_t processed = 0;
+    std::array<uint8_t, 1000> payload{};
+    int32_t const frames = Link::MAX_BATCH_FRAMES + 8;
+    for (int32_t i = 0; i < frames; ++i)
+    {
+        link.addDatagram(Command::BWR, 0, payload.data(), static_cast<uint16_t>(payload.size()),
+            [&](DatagramHeader const*, uint8_t const*, uint16_t) { ++processed; return DatagramState::OK; },
+            [](DatagramState const&) { FAIL() << "datagram lost"; });
+    }
+    ASSERT_EQ(1, socket->write_calls); // a full batch is flushed right away
+
+    link.processDatagrams();
+    ASSERT_EQ(frames, processed);
+    ASSERT_EQ(2, socket->write_calls);
+    ASSERT_EQ(2, socket->read_calls);
+
+    // Second cycle reuses the buffers
+    processed = 0;
+    link.addDatagram(Command::BWR, 0, payload.data(), static_cast<uint16_t>(payload.size()),
+        [&](DatagramHeader const*, uint8_t const*, uint16_t) { ++processed; return DatagramState::OK; },
+        [](DatagramState const&) { FAIL() << "datagram lost"; });
+    link.processDatagrams();
+    ASSERT_EQ(1, processed);
+}
+
+
+// Lends a fixed pool of buffers: frames travel on the "wire" as pointers, never copied.
+class ZeroCopyEchoSocket final : public AbstractSocket
+{
+public:
+    ZeroCopyEchoSocket()
+    {
+        for (auto& buffer : pool)
+        {
+            free.push_back(buffer.data());
+        }
+    }
+
+    void open(std::string const&) override {}
+    void setTimeout(nanoseconds) override {}
+    void close() noexcept override {}
+    int32_t read(void*, int32_t) override
+    {
+        ADD_FAILURE() << "Link shall use readBorrowed()";
+        return -EIO;
+    }
+    int32_t write(void const*, int32_t) override
+    {
+        ADD_FAILURE() << "Link shall use writeBatch()";
+        return -EIO;
+    }
+
+    bool isZeroCopy() const override { return true; }
+
+    void* borrowBuffer() override
+    {
+        if (free.empty())
+        {
+            return nullptr;
+        }
+        void* buffer = free.front();
+        free.pop_front();
+        return buffer;
+    }
+
+    void returnBuffer(void* buffer) override
+    {
+        EXPECT_TRUE(isLent(buffer));
+        free.push_back(buffer);
+    }
+
+    int32_t writeBatch(SocketBuffer const* frames, int32_t count) override
+    {
+        for (int32_t i = 0; i < count; ++i)
+        {
+            EXPECT_TRUE(isLent(frames[i].data)) << "frame built out of the socket memory";
+            wire.push_back(frames[i]);
+        }
+        return count;
+    }
+
+    int32_t readBorrowed(SocketBuffer* frames, int32_t count) override
+    {
+        int32_t received = 0;
+        while ((received < count) and (not wire.empty()))
+        {
+            frames[received] = wire.front();
+            wire.pop_front();
+            ++received;
+        }
+        return received;
+    }
+
+    void releaseBatch(SocketBuffer const* frames, int32_t count) override
+    {
+        for (int32_t i = 0; i < count; ++i)
+        {
+            EXPECT_TRUE(isLent(frames[i].data));
+            free.push_back(frames[i].data);
+        }
+    }
+
+    bool isLent(void const* data) const
+    {
+        uint8_t const* pos = static_cast<uint8_t const*>(data);
+        return (pos >= pool[0].data()) and (pos < pool.back().data() + ETH_MAX_SIZE);
+    }
+
+    std::array<EthernetFrame, 8> pool;
+    std::deque<void*> free;
+    std::deque<SocketBuffer> wire;
+};
+
+
+TEST(LinkBatch, zero_copy_socket_frames_are_built_and_dispatched_in_place)
+{
+    auto socket = std::make_shared<ZeroCopyEchoSocket>();
+    Link link(socket, std::make_shared<SocketNull>(), [](){});
+
+    for (int32_t cycle = 0; cycle < 2; ++cycle)
+    {
+        int32_t processed = 0;
+        std::array<uint8_t, 1000> payload{};
+        for (int32_t i = 0; i < 3; ++i) // one frame each
+        {
+            payload[0] = static_cast<uint8_t>(i);
+            link.addDatagram(Command::BWR, 0, payload.data(), static_cast<uint16_t>(payload.size()),
+                [&](DatagramHeader const*, uint8_t const* data, uint16_t)
+                {
+                    EXPECT_TRUE(socket->isLent(data));
+                    EXPECT_EQ(processed, data[0]);
+                    ++processed;
+                    return DatagramState::OK;
+                },
+                [](DatagramState const&) { FAIL() << "datagram lost"; });
+        }
+        ASSERT_EQ(socket->pool.size() - 3, socket->free.size());
+
+        link.processDatagrams();
+        ASSERT_EQ(3, processed);
+        ASSERT_EQ(socket->pool.size(), socket->free.size()); // every buffer is back to the socket
+    }
+}
+
+
+TEST(LinkBatch, zero_copy_socket_buffers_of_unsent_frames_are_returned)
+{
+    auto socket = std::make_shared<ZeroCopyEchoSocket>();
+    {
+        Link link(socket, std::make_shared<SocketNull>(), [](){});
+
+        std::array<uint8_t, 1000> payload{};
+        for (int32_t i = 0; i < 3; ++i) // two frames queued, the third one being built
+        {
+            link.addDatagram(Command::BWR, 0, payload.data(), static_cast<uint16_t>(payload.size()),
+                [](DatagramHeader const*, uint8_t const*, uint16_t) { return DatagramState::OK; },
+                [](DatagramState const&) {});
+        }
+        ASSERT_EQ(socket->pool.size() - 3, socket->free.size());
+    }
+    ASSERT_EQ(socket->pool.size(), socket->free.size());
+    ASSERT_TRUE(socket->wire.empty());
+}
+
+
+TEST(LinkPipeline, cycles_are_completed_in_order)
+{
+    auto socket = std::make_shared<BatchEchoSocket>();
+    Link link(socket, std::make_shared<SocketNull>(), [](){});
+    link.setPipelineDepth(2);
+
+    std::vector<int32_t> processed;
+    auto submit = [&](int32_t cycle)
+    {
+        uint8_t payload = 0;
+        link.addDatagram(Command::BRD, 0, payload,
+            [&processed, cycle](DatagramHeader const*, uint8_t const*, uint16_t)
+            {
+                processed.push_back(cycle);
+                return DatagramState::OK;
+            },
+            [](DatagramState const&) { FAIL() << "datagram lost"; });
+        return link.submitCycle();
+    };
+
+    ASSERT_EQ(0u, submit(0));
+    ASSERT_EQ(1u, submit(1));
+    ASSERT_EQ(2, link.cyclesInFlight());
+    ASSERT_EQ(2, socket->write_calls);
+    ASSERT_EQ(0, socket->read_calls);   // nothing waited for yet
+    ASSERT_TRUE(processed.empty());
+
+    ASSERT_EQ(2u, submit(2));            // pipeline full: the oldest cycle is completed first
+    ASSERT_EQ(2, link.cyclesInFlight());
+    ASSERT_EQ(std::vector<int32_t>({0}), processed);
+
+    Link::CycleCompletion completion;
+    ASSERT_TRUE(link.popCompletion(completion));
+    ASSERT_EQ(0u, completion.cycle);
+    ASSERT_EQ(DatagramState::OK, completion.status);
+    ASSERT_FALSE(link.popCompletion(completion));
+
+    ASSERT_TRUE(link.completeCycle());
+    ASSERT_EQ(std::vector<int32_t>({0, 1}), processed);
+
+    link.processDatagrams();            // drains the pipeline
+    ASSERT_EQ(0, link.cyclesInFlight());
+    ASSERT_EQ(std::vector<int32_t>({0, 1, 2}), processed);
+    ASSERT_FALSE(link.completeCycle());
+
+    for (uint32_t id : {1u, 2u})
+    {
+        ASSERT_TRUE(link.popCompletion(completion));
+        ASSERT_EQ(id, completion.cycle);
+    }
+    ASSERT_FALSE(link.popCompletion(completion));
+}
+
+
+TEST(LinkPipeline, lost_cycle_is_reported_in_its_completion)
+{
+    auto socket = std::make_shared<BatchEchoSocket>();
+    Link link(socket, std::make_shared<SocketNull>(), [](){});
+    link.setPipelineDepth(2);
+
+    int32_t errors = 0;
+    uint8_t payload = 0;
+    link.addDatagram(Command::BRD, 0, payload,
+        [](DatagramHeader const*, uint8_t const*, uint16_t) { return DatagramState::OK; },
+        [&](DatagramState const& state) { EXPECT_EQ(DatagramState::LOST, state); ++errors; });
+    link.submitCycle();
+    socket->wire.clear();               // the frame never comes back
+
+    link.addDatagram(Command::BRD, 0, payload,
+        [](DatagramHeader const*, uint8_t const*, uint16_t) { return DatagramState::OK; },
+        [](DatagramState const&) { FAIL() << "datagram lost"; });
+    link.submitCycle();
+
+    ASSERT_TRUE(link.completeCycle());
+    ASSERT_TRUE(link.completeCycle());
+    ASSERT_EQ(1, errors);
+
+    Link::CycleCompletion completion;
+    ASSERT_TRUE(link.popCompletion(completion));
+    ASSERT_EQ(DatagramState::LOST, completion.status);
+    ASSERT_TRUE(link.popCompletion(completion));
+    ASSERT_EQ(DatagramState::OK, completion.status);
+}
+
+
+TEST_F(LinkTest, pipeline_survives_cycle_counter_wrap)
+{
+    auto socket = std::make_shared<BatchEchoSocket>();
+    Link pipelined(socket, std::make_shared<SocketNull>(), [](){});
+    pipelined.setPipelineDepth(Link::MAX_CYCLES_IN_FLIGHT);
+    setCycleCounters(pipelined, UINT32_MAX - 3); // the counters wrap with the pipeline full
+
+    std::vector<int32_t> processed;
+    for (int32_t cycle = 0; cycle < Link::MAX_CYCLES_IN_FLIGHT + 2; ++cycle)
+    {
+        uint8_t payload = 0;
+        pipelined.addDatagram(Command::BRD, 0, payload,
+            [&processed, cycle](DatagramHeader const*, uint8_t const*, uint16_t)
+            {
+                processed.push_back(cycle);
+                return DatagramState::OK;
+            },
+            [](DatagramState const&) { FAIL() << "datagram lost"; });
+        pipelined.submitCycle();
+    }
+    pipelined.processDatagrams();
+
+    std::vector<int32_t> expected(Link::MAX_CYCLES_IN_FLIGHT + 2);
+    std::iota(expected.begin(), expected.end(), 0);
+    ASSERT_EQ(expected, processed);
+    ASSERT_EQ(0, pipelined.cyclesInFlight());
+
+    // Every cycle is completed once, in order, with its own record
+    Link::CycleCompletion completion;
+    for (uint32_t id = 0; id < static_cast<uint32_t>(Link::MAX_CYCLES_IN_FLIGHT + 2); ++id)
+    {
+        ASSERT_TRUE(pipelined.popCompletion(completion));
+        ASSERT_EQ(id, completion.cycle);
+        ASSERT_EQ(DatagramState::OK, completion.status);
+    }
+    ASSERT_FALSE(pipelined.popCompletion(completion));
+}
+
+
+TEST(LinkPipeline, depth_is_bounded)
+{
+    Link link(std::make_shared<SocketNull>(), std::make_shared<SocketNull>(), [](){});
+    ASSERT_THROW(link.setPipelineDepth(0), Error);
+    ASSERT_THROW(link.setPipelineDepth(Link::MAX_CYCLES_IN_FLIGHT + 1), Error);
+    link.setPipelineDepth(Link::MAX_CYCLES_IN_FLIGHT);
+}
+
+
+TEST(LinkBatch, function_pointer_callbacks_are_called_with_their_context)
+{
+    auto socket = std::make_shared<BatchEchoSocket>();
+    Link link(socket, std::make_shared<SocketNull>(), [](){});
+
+    struct Context
+    {
+        int32_t processed{0};
+        int32_t errors{0};
+        DatagramState answer{DatagramState::OK};
+    };
+    auto process = [](void* context, DatagramHeader const*, uint8_t const*, uint16_t)
+    {
+        auto ctx = static_cast<Context*>(context);
+        ++ctx->processed;
+        return ctx->answer;
+    };
+    auto error = [](void* context, DatagramState const& state)
+    {
+        EXPECT_EQ(DatagramState::INVALID_WKC, state);
+        ++static_cast<Context*>(context)->errors;
+    };
+
+    Context ok;
+    Context ko;
+    ko.answer = DatagramState::INVALID_WKC;
+
+    uint8_t payload = 0;
+    link.addDatagram(Command::BRD, 0, &payload, sizeof(payload), process, error, &ok);
+    link.addDatagram(Command::BRD, 0, &payload, sizeof(payload), process, error, &ko);
+    link.processDatagrams();
+
+    ASSERT_EQ(1, ok.processed);
+    ASSERT_EQ(0, ok.errors);
+    ASSERT_EQ(1, ko.processed);
+    ASSERT_EQ(1, ko.errors);
+}
+
+
+TEST(LinkMultiplexedRead, quiet_interface_does_not_cost_its_timeout)
+{
+    // Line topology: the frames come back on the nominal interface, the redundancy one is unplugged
+    auto nominal = std::make_shared<LoopbackPairSocket>();
+    auto redundancy = std::make_shared<LoopbackPairSocket>();
+    redundancy->answer = false;
+
+    Link link(nominal, redundancy, [](){});
+    link.setTimeout(10ms);
+
+    for (int32_t i = 0; i < 3; ++i)
+    {
+        int32_t processed = 0;
+        uint8_t payload = 0;
+        link.addDatagram(Command::BRD, 0, payload,
+            [&](DatagramHeader const*, uint8_t const*, uint16_t) { ++processed; return DatagramState::OK; },
+            [](DatagramState const&) { FAIL() << "datagram lost"; });
+        link.processDatagrams();
+        ASSERT_EQ(1, processed);
+    }
+
+    // Both interfaces are waited on at once: the quiet one is never read with a timeout
+    ASSERT_EQ(0, redundancy->timed_out_reads);
+    ASSERT_EQ(0, nominal->timed_out_reads);
+}
+
+
+TEST(LinkRedundancy, split_merge_keeps_bit_packed_neighbours)
+{
+    // Two slaves share one byte: slave 0 owns bits 0-1 and answered on the redundancy copy,
+    // slave 1 owns bits 2-4 and answered on the nominal copy.
+    LogicalFrameDescription desc{};
+    desc.logical_size = 1;
+    desc.pdo_size = 1;
+    desc.entries = {{3, 0, 1, 0x03}, {3, 0, 1, 0x1C}};
+
+    uint8_t nominal = 0x14;             // slave 1: 0b101, slave 0 bits not processed
+    uint8_t const redundancy = 0x02;    // slave 0: 0b10
+    mergeSplitLRW(desc, &nominal, &redundancy, 3, 3);
+    ASSERT_EQ(0x16, nominal);
+}
 }
@@ -24,3 +24,88 @@ TEST(DiagSocket, index_rolling)
         ASSERT_LT(index, mailbox::GATEWAY_MAX_REQUEST);
     }
 }
+
+
+TEST(AbstractSocket, write_batch_default_loops_until_first_failure)
+{
+    MockSocket socket;
+    uint8_t frames[3][ETH_MIN_SIZE] = {};
+    SocketBuffer buffers[3] = {{frames[0], ETH_MIN_SIZE}, {frames[1], ETH_MIN_SIZE}, {frames[2], ETH_MIN_SIZE}};
+
+    ::testing::InSequence s;
+    EXPECT_CALL(socket, write(frames[0], ETH_MIN_SIZE)).WillOnce(::testing::Return(ETH_MIN_SIZE));
+    EXPECT_CALL(socket, write(frames[1], ETH_MIN_SIZE)).WillOnce(::testing::Return(ETH_MIN_SIZE - 1));
+    ASSERT_EQ(1, socket.writeBatch(buffers, 3));
+
+    EXPECT_CALL(socket, write(frames[0], ETH_MIN_SIZE)).WillOnce(::testing::Return(-EIO));
+    ASSERT_EQ(-EIO, socket.writeBatch(buffers, 3));
+}
+
+
+TEST(AbstractSocket, read_batch_default_loops_until_first_failure)
+{
+    MockSocket socket;
+    uint8_t frames[3][ETH_MAX_SIZE] = {};
+    SocketBuffer buffers[3] = {{frames[0], ETH_MAX_SIZE}, {frames[1], ETH_MAX_SIZE}, {frames[2], ETH_MAX_SIZE}};
+
+    ::testing::InSequence s;
+    EXPECT_CALL(socket, read(frames[0], ETH_MAX_SIZE)).WillOnce(::testing::Return(ETH_MIN_SIZE));
+    EXPECT_CALL(socket, read(frames[1], ETH_MAX_SIZE)).WillOnce(::testing::Return(100));
+    EXPECT_CALL(socket, read(frames[2], ETH_MAX_SIZE)).WillOnce(::testing::Return(-ETIMEDOUT));
+    ASSERT_EQ(2, socket.readBatch(buffers, 3));
+    ASSERT_EQ(ETH_MIN_SIZE, buffers[0].size);
+    ASSERT_EQ(100, buffers[1].size);
+
+    buffers[0].size = ETH_MAX_SIZE;
+    EXPECT_CALL(socket, read(frames[0], ETH_MAX_SIZE)).WillOnce(::testing::Return(-ETIMEDOUT));
+    ASSERT_EQ(-ETIMEDOUT, socket.readBatch(buffers, 3));
+}
+
+
+TEST(WaitForFrames, not_supported_without_poll_handle)
+{
+    SocketNull null;
+    LoopbackPairSocket pollable;
+    AbstractSocket* sockets[] = {&pollable, &null};
+    ASSERT_EQ(-EOPNOTSUPP, waitForFrames(sockets, 2, 0ns));
+}
+
+
+TEST(WaitForFrames, report_ready_sockets)
+{
+    LoopbackPairSocket first;
+    LoopbackPairSocket second;
+    AbstractSocket* sockets[] = {&first, &second};
+    ASSERT_EQ(0, waitForFrames(sockets, 2, 0ns));
+
+    uint8_t frame[ETH_MIN_SIZE]{};
+    second.inject(frame, sizeof(frame));
+    ASSERT_EQ(0b10, waitForFrames(sockets, 2, 1s));
+
+    first.inject(frame, sizeof(frame));
+    ASSERT_EQ(0b11, waitForFrames(sockets, 2, 1s));
+}
+
+
+TEST(WaitForFrames, busy_polled_sockets)
+{
+    class BusyPolledSocket final : public AbstractSocket
+    {
+    public:
+        void open(std::string const&) override {}
+        void setTimeout(nanoseconds) override {}
+        void close() noexcept override {}
+        int32_t read(void*, int32_t) override { return -EAGAIN; }
+        int32_t write(void const*, int32_t size) override { return size; }
+        int32_t pendingFrames() override { return pending; }
+        int32_t pending{0};
+    };
+
+    BusyPolledSocket busy;
+    LoopbackPairSocket pollable;
+    AbstractSocket* sockets[] = {&busy, &pollable};
+    ASSERT_EQ(0, waitForFrames(sockets, 2, 0ns));
+
+    busy.pending = 1;
+    ASSERT_EQ(0b01, waitForFrames(sockets, 2, 1s));
+}